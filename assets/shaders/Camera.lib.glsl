@@ -4,7 +4,19 @@
 struct Camera {
   mat4x4 view;
   mat4x4 proj;
+  mat4x4 invViewProj;
   vec3 position;
 };
 
+// The depth is the one written with the projection of the camera and uv the position on
+// the screen from 0 to 1.
+vec3 reconstructPosition(mat4x4 invViewProj, vec2 uv, float depth) {
+  vec4 position = invViewProj * vec4(uv * 2.0 - 1.0, depth, 1.0);
+  return position.xyz / position.w;
+}
+
+vec3 reconstructPosition(Camera cam, vec2 uv, float depth) {
+  return reconstructPosition(cam.invViewProj, uv, depth);
+}
+
 #endif // CAMERA_LIB
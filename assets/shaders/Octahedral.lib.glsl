@@ -0,0 +1,21 @@
+#ifndef OCTAHEDRAL_LIB
+#define OCTAHEDRAL_LIB
+
+// Folds the lower half of the octahedron over the diagonals onto the corners.
+vec2 octWrap(vec2 point) {
+  vec2 signs = vec2(point.x >= 0.0 ? 1.0 : -1.0, point.y >= 0.0 ? 1.0 : -1.0);
+  return (1.0 - abs(point.yx)) * signs;
+}
+
+// Maps a unit vector onto an octahedron unfolded into the -1..1 square.
+vec2 octEncode(vec3 normal) {
+  vec2 projected = normal.xy / (abs(normal.x) + abs(normal.y) + abs(normal.z));
+  return normal.z >= 0.0 ? projected : octWrap(projected);
+}
+
+vec3 octDecode(vec2 encoded) {
+  float z = 1.0 - abs(encoded.x) - abs(encoded.y);
+  return normalize(vec3(z >= 0.0 ? encoded : octWrap(encoded), z));
+}
+
+#endif // OCTAHEDRAL_LIB
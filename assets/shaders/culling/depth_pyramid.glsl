@@ -0,0 +1,29 @@
+#version 460
+
+// Mirrors pbr::DepthPyramidSystem::LOCAL_SIZE.
+layout(local_size_x = 8, local_size_y = 8) in;
+
+// The depth of the g-buffer or the level before the written one.
+layout(set = 0, binding = 0) uniform sampler2D inputDepth;
+layout(set = 0, binding = 1, r32f) uniform writeonly image2D outputDepth;
+
+void main() {
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(texel, imageSize(outputDepth)))) {
+        return;
+    }
+
+    // Halving an odd size drops the last row or column, so those sizes also reduce the
+    // texels after the 2x2 block to keep every input texel covered.
+    ivec2 inputSize = textureSize(inputDepth, 0);
+    ivec2 first = texel * 2;
+    ivec2 last = min(first + 1 + (inputSize & 1), inputSize - 1);
+
+    float depth = 0.0;
+    for (int y = first.y; y <= last.y; ++y) {
+        for (int x = first.x; x <= last.x; ++x) {
+            depth = max(depth, texelFetch(inputDepth, ivec2(x, y), 0).r);
+        }
+    }
+    imageStore(outputDepth, texel, vec4(depth));
+}
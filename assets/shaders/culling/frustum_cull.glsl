@@ -0,0 +1,219 @@
+#version 460
+
+layout(local_size_x = 64) in;
+
+struct Instance {
+    mat4x4 model;
+    mat3x3 normalModel;
+    uint material;
+};
+
+struct CullInstance {
+    // Mesh space bounding sphere, the radius is in w.
+    vec4 boundingSphere;
+    // Mirrors pbr::Meshlet::cone, the mesh space axis is in xyz and w is 1 if the bounds
+    // can not face away from the camera.
+    vec4 cone;
+    uint batch;
+    // The instance of the draw list.
+    uint instance;
+    // The slot of the visibility buffer, it stays the same across frames.
+    uint visibility;
+};
+
+struct Batch {
+    uint indexCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+    // Index of the run of batches drawn by a single indirect draw.
+    uint run;
+    // First batch of the run.
+    uint runFirstBatch;
+};
+
+// VkDrawIndexedIndirectCommand
+struct DrawCommand {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer InstanceBuffer {
+    Instance instances[];
+};
+layout(std430, set = 0, binding = 1) readonly buffer CullInstanceBuffer {
+    CullInstance cullInstances[];
+};
+layout(std430, set = 0, binding = 2) readonly buffer BatchBuffer {
+    Batch batches[];
+};
+layout(std430, set = 0, binding = 3) buffer InstanceCountBuffer {
+    uint instanceCounts[];
+};
+layout(std430, set = 0, binding = 4) writeonly buffer VisibleInstanceBuffer {
+    uint visibleInstances[];
+};
+layout(std430, set = 0, binding = 5) writeonly buffer DrawCommandBuffer {
+    DrawCommand drawCommands[];
+};
+layout(std430, set = 0, binding = 6) buffer RunCountBuffer {
+    uint runCounts[];
+};
+
+#ifdef OCCLUSION
+// Whether every instance passed the occlusion test of the previous frame, indexed by the
+// visibility slot of the cull instance.
+layout(std430, set = 0, binding = 7) buffer VisibilityBuffer {
+    uint visibilities[];
+};
+layout(std430, set = 0, binding = 8) readonly buffer ViewBuffer {
+    mat4x4 viewProj;
+};
+// Mirrors pbr::DepthPyramidSystem, every texel holds the farthest depth it covers.
+layout(set = 1, binding = 0) uniform sampler2D depthPyramid;
+#endif
+
+layout(push_constant) uniform PushConstants {
+    vec4 planes[6];
+    vec4 cameraPosition;
+    // 0 culls the instances, 1 writes the draw commands of the batches. With occlusion 0
+    // only keeps the instances visible in the previous frame, 2 tests every instance
+    // against the depth pyramid and keeps the newly visible ones and 3 keeps every
+    // visible one.
+    uint pass;
+    uint count;
+};
+
+// The radius is in w.
+vec4 getWorldSphere(Instance instance, vec4 sphere) {
+    vec3 center = (instance.model * vec4(sphere.xyz, 1.0)).xyz;
+    float scale = max(length(instance.model[0].xyz),
+            max(length(instance.model[1].xyz), length(instance.model[2].xyz)));
+    return vec4(center, sphere.w * scale);
+}
+
+bool isInFrustum(vec4 sphere) {
+    for (int i = 0; i < 6; ++i) {
+        if (dot(planes[i].xyz, sphere.xyz) + planes[i].w < -sphere.w) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Mirrors pbr::isMeshletBackfacing.
+bool isBackfacing(Instance instance, vec4 sphere, vec4 cone) {
+    if (cone.w >= 1.0) {
+        return false;
+    }
+    vec3 axis = normalize(instance.normalModel * cone.xyz);
+    vec3 toCenter = sphere.xyz - cameraPosition.xyz;
+    return dot(toCenter, axis) >= cone.w * length(toCenter) + sphere.w;
+}
+
+bool isVisible(CullInstance cullInstance, vec4 sphere) {
+    return isInFrustum(sphere)
+            && !isBackfacing(instances[cullInstance.instance], sphere, cullInstance.cone);
+}
+
+void appendInstance(CullInstance cullInstance) {
+    uint slot = atomicAdd(instanceCounts[cullInstance.batch], 1);
+    visibleInstances[batches[cullInstance.batch].firstInstance + slot] =
+            cullInstance.instance;
+}
+
+void cullInstance(uint index) {
+    CullInstance cullInstance = cullInstances[index];
+#ifdef OCCLUSION
+    if (visibilities[cullInstance.visibility] == 0) {
+        return;
+    }
+#endif
+    vec4 sphere = getWorldSphere(instances[cullInstance.instance],
+            cullInstance.boundingSphere);
+    if (!isVisible(cullInstance, sphere)) {
+        return;
+    }
+    appendInstance(cullInstance);
+}
+
+#ifdef OCCLUSION
+// Mirrors pbr::projectSphere, the box around the sphere is projected and its nearest
+// depth is compared against the pyramid level where the box covers at most 2x2 texels.
+bool isOccluded(vec4 sphere) {
+    vec3 minNdc = vec3(1e30);
+    vec3 maxNdc = vec3(-1e30);
+    for (uint corner = 0u; corner < 8u; ++corner) {
+        vec3 offset = vec3((corner & 1u) != 0u ? sphere.w : -sphere.w,
+                (corner & 2u) != 0u ? sphere.w : -sphere.w,
+                (corner & 4u) != 0u ? sphere.w : -sphere.w);
+        vec4 clip = viewProj * vec4(sphere.xyz + offset, 1.0);
+        // Boxes reaching behind the camera cannot be projected.
+        if (clip.w <= 0.0) {
+            return false;
+        }
+        vec3 ndc = clip.xyz / clip.w;
+        minNdc = min(minNdc, ndc);
+        maxNdc = max(maxNdc, ndc);
+    }
+    vec2 uvMin = clamp(minNdc.xy * 0.5 + 0.5, 0.0, 1.0);
+    vec2 uvMax = clamp(maxNdc.xy * 0.5 + 0.5, 0.0, 1.0);
+
+    vec2 size = (uvMax - uvMin) * vec2(textureSize(depthPyramid, 0));
+    int level = clamp(int(ceil(log2(max(max(size.x, size.y), 1.0)))), 0,
+            textureQueryLevels(depthPyramid) - 1);
+    ivec2 levelSize = textureSize(depthPyramid, level);
+    ivec2 texelMin = min(ivec2(uvMin * vec2(levelSize)), levelSize - 1);
+    ivec2 texelMax = min(ivec2(uvMax * vec2(levelSize)), levelSize - 1);
+    float depth = max(
+            max(texelFetch(depthPyramid, texelMin, level).r,
+                texelFetch(depthPyramid, ivec2(texelMax.x, texelMin.y), level).r),
+            max(texelFetch(depthPyramid, ivec2(texelMin.x, texelMax.y), level).r,
+                texelFetch(depthPyramid, texelMax, level).r));
+    return minNdc.z > depth;
+}
+
+void cullOccludedInstance(uint index, bool keepEveryVisible) {
+    CullInstance cullInstance = cullInstances[index];
+    vec4 sphere = getWorldSphere(instances[cullInstance.instance],
+            cullInstance.boundingSphere);
+    bool visible = isVisible(cullInstance, sphere) && !isOccluded(sphere);
+    // The first pass already kept the instances that were visible before.
+    bool wasVisible = visibilities[cullInstance.visibility] != 0;
+    visibilities[cullInstance.visibility] = visible ? 1 : 0;
+    if (visible && (keepEveryVisible || !wasVisible)) {
+        appendInstance(cullInstance);
+    }
+}
+#endif
+
+void writeDrawCommand(uint index) {
+    uint instanceCount = instanceCounts[index];
+    if (instanceCount == 0) {
+        return;
+    }
+    Batch batch = batches[index];
+    uint slot = atomicAdd(runCounts[batch.run], 1);
+    drawCommands[batch.runFirstBatch + slot] = DrawCommand(batch.indexCount, instanceCount,
+            batch.firstIndex, batch.vertexOffset, batch.firstInstance);
+}
+
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= count) {
+        return;
+    }
+    if (pass == 0) {
+        cullInstance(index);
+    } else if (pass == 1) {
+        writeDrawCommand(index);
+    }
+#ifdef OCCLUSION
+    else {
+        cullOccludedInstance(index, pass == 3);
+    }
+#endif
+}
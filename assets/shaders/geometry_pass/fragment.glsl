@@ -1,31 +1,71 @@
 #version 460
 
+#ifdef BINDLESS
+#extension GL_EXT_nonuniform_qualifier : require
+#endif
+
+#include "../Octahedral.lib.glsl"
+
+#ifdef COMPACT_GBUFFER
+// Positions are reconstructed from the depth.
+layout(location = 0) out vec2 outNormals;
+layout(location = 1) out vec4 outAlbedo;
+#else
 layout(location = 0) out vec4 outPositions;
 layout(location = 1) out vec4 outNormals;
 layout(location = 2) out vec4 outAlbedo;
+#endif
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec3 inTangent;
 layout(location = 3) in vec3 inBitangent;
 layout(location = 4) in vec2 inTexCoords;
+layout(location = 5) flat in uint inMaterial;
+
+#ifdef BINDLESS
+struct Material {
+    vec4 color;
+    uint colorTexture;
+    uint normalTexture;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer MaterialBuffer {
+    Material materials[];
+};
+layout(set = 1, binding = 1) uniform sampler2D textures[];
 
+#define MATERIAL_COLOR materials[inMaterial].color
+#define COLOR_SAMPLER textures[nonuniformEXT(materials[inMaterial].colorTexture)]
+#define NORMAL_SAMPLER textures[nonuniformEXT(materials[inMaterial].normalTexture)]
+#else
 layout(set = 1, binding = 0) uniform MaterialUBO {
     vec4 color;
 } mat;
 layout(set = 1, binding = 1) uniform sampler2D colorSampler;
 layout(set = 1, binding = 2) uniform sampler2D normalSampler;
 
+#define MATERIAL_COLOR mat.color
+#define COLOR_SAMPLER colorSampler
+#define NORMAL_SAMPLER normalSampler
+#endif
+
 void main() {
+#ifndef COMPACT_GBUFFER
     // Positions
     outPositions = vec4(inPosition, 0.0);
+#endif
 
     // Normals
     mat3 tbn = mat3(inTangent, inBitangent, inNormal);
-    vec3 normal = texture(normalSampler, inTexCoords).xyz * 2.0 - 1.0;
+    vec3 normal = texture(NORMAL_SAMPLER, inTexCoords).xyz * 2.0 - 1.0;
     normal = normalize(tbn * normal);
+#ifdef COMPACT_GBUFFER
+    outNormals = octEncode(normal);
+#else
     outNormals = vec4(normal, 0.0);
+#endif
 
     // Albedo
-    outAlbedo = mat.color * texture(colorSampler, inTexCoords);
+    outAlbedo = MATERIAL_COLOR * texture(COLOR_SAMPLER, inTexCoords);
 }
@@ -3,6 +3,7 @@
 #include "../Camera.lib.glsl"
 
 layout(location = 0) in vec3 inPosition;
+#ifndef DEPTH_ONLY
 layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec4 inTangent;
 layout(location = 3) in vec2 inTexCoords;
@@ -12,26 +13,52 @@ layout(location = 1) out vec3 outNormal;
 layout(location = 2) out vec3 outTangent;
 layout(location = 3) out vec3 outBitangent;
 layout(location = 4) out vec2 outTexCoords;
+layout(location = 5) flat out uint outMaterial;
+#endif
 
-layout(push_constant) uniform PC {
+// The depth pre-pass and the geometry pass test for equal depths, so both have to compute
+// the exact same positions.
+invariant gl_Position;
+
+struct Instance {
     mat4x4 model;
     mat3x3 normalModel;
-} pc;
+    uint material;
+};
 
 layout(set = 0, binding = 0) uniform SceneUBO {
     Camera cam;
 };
 
+layout(std430, set = 2, binding = 0) readonly buffer InstanceBuffer {
+    Instance instances[];
+};
+
+#ifdef INDIRECT
+// Written by the culling pass, maps the drawn instances to the visible ones.
+layout(std430, set = 2, binding = 1) readonly buffer VisibleInstanceBuffer {
+    uint visibleInstances[];
+};
+#endif
+
 void main() {
-    vec4 worldPos = pc.model * vec4(inPosition, 1.0);
+#ifdef INDIRECT
+    Instance instance = instances[visibleInstances[gl_InstanceIndex]];
+#else
+    Instance instance = instances[gl_InstanceIndex];
+#endif
+    vec4 worldPos = instance.model * vec4(inPosition, 1.0);
 
     gl_Position = cam.proj * cam.view * worldPos;
 
+#ifndef DEPTH_ONLY
     outPosition = worldPos.xyz;
 
-    outNormal = normalize(pc.normalModel * inNormal);
-    outTangent = normalize(pc.normalModel * inTangent.xyz);
-    outBitangent = normalize(pc.normalModel * (cross(inNormal, inTangent.xyz) * inTangent.w));
+    outNormal = normalize(instance.normalModel * inNormal);
+    outTangent = normalize(instance.normalModel * inTangent.xyz);
+    outBitangent = normalize(instance.normalModel * (cross(inNormal, inTangent.xyz) * inTangent.w));
 
     outTexCoords = inTexCoords;
+    outMaterial = instance.material;
+#endif
 }
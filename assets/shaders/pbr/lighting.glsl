@@ -2,6 +2,7 @@
 
 #include "../Camera.lib.glsl"
 #include "../BlinnPhong.lib.glsl"
+#include "../Octahedral.lib.glsl"
 
 layout(location = 0) out vec4 outColor;
 
@@ -10,20 +11,27 @@ layout(location = 0) in vec2 inTexCoords;
 layout(set = 0, binding = 0) uniform SceneUBO {
     Camera cam;
 };
+#ifndef COMPACT_GBUFFER
 layout(set = 1, binding = 0) uniform texture2D texPositions;
+#endif
 layout(set = 1, binding = 1) uniform texture2D texNormals;
 layout(set = 1, binding = 2) uniform texture2D texAlbedo;
 layout(set = 1, binding = 3) uniform sampler gBufferSampler;
 layout(set = 1, binding = 4) uniform sampler2D depthSampler;
 
 void main() {
-    vec4 position = texture(sampler2D(texPositions, gBufferSampler), inTexCoords);
-    vec4 normal = texture(sampler2D(texNormals, gBufferSampler), inTexCoords);
     vec4 albedo = texture(sampler2D(texAlbedo, gBufferSampler), inTexCoords);
     float depth = texture(depthSampler, inTexCoords).r;
+#ifdef COMPACT_GBUFFER
+    vec3 position = reconstructPosition(cam, inTexCoords, depth);
+    vec3 normal = octDecode(texture(sampler2D(texNormals, gBufferSampler), inTexCoords).xy);
+#else
+    vec3 position = texture(sampler2D(texPositions, gBufferSampler), inTexCoords).xyz;
+    vec3 normal = texture(sampler2D(texNormals, gBufferSampler), inTexCoords).xyz;
+#endif
 
-    vec3 V = normalize(cam.position - position.xyz);
+    vec3 V = normalize(cam.position - position);
     vec3 L = V;
 
-    outColor = blinnPhongLighting(albedo, normal.xyz, V, L);
+    outColor = blinnPhongLighting(albedo, normal, V, L);
 }
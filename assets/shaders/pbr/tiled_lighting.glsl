@@ -0,0 +1,204 @@
+#version 460
+
+#include "../BlinnPhong.lib.glsl"
+#include "../Camera.lib.glsl"
+#include "../Octahedral.lib.glsl"
+
+// Mirrors pbr::TiledLightingSystem::TILE_SIZE.
+layout(local_size_x = 16, local_size_y = 16) in;
+
+// Mirrors pbr::TiledLightingSystem::LIGHTS_PER_BATCH, every thread tests one light.
+const uint LIGHTS_PER_BATCH = 256;
+const uint BATCH_WORDS = LIGHTS_PER_BATCH / 32;
+
+// Mirrors pbr::LightType.
+const uint LIGHT_POINT = 0;
+const uint LIGHT_SPOT = 1;
+const uint LIGHT_DIRECTIONAL = 2;
+
+// Mirrors pbr::LightData.
+struct Light {
+    vec3 position;
+    float range;
+    vec3 color;
+    float intensity;
+    vec3 direction;
+    uint type;
+    float cosInnerCone;
+    float cosOuterCone;
+};
+
+#ifndef COMPACT_GBUFFER
+layout(set = 0, binding = 0) uniform texture2D texPositions;
+#endif
+layout(set = 0, binding = 1) uniform texture2D texNormals;
+layout(set = 0, binding = 2) uniform texture2D texAlbedo;
+layout(set = 0, binding = 3) uniform sampler gBufferSampler;
+layout(set = 0, binding = 4) uniform sampler2D depthSampler;
+
+layout(std430, set = 1, binding = 0) readonly buffer LightBuffer {
+    Light lights[];
+};
+layout(rgba16f, set = 1, binding = 1) writeonly uniform image2D outImage;
+// Mirrors pbr::TiledLightingSystem::Counters.
+layout(std430, set = 1, binding = 2) buffer CounterBuffer {
+    uint overflowTiles;
+} counters;
+
+// Mirrors pbr::TiledLightingSystem::PushConstants.
+layout(push_constant) uniform PushConstants {
+    mat4x4 invViewProj;
+    vec3 cameraPosition;
+    uint lightCount;
+    uvec2 extent;
+} pc;
+
+shared uint tileMinDepth;
+shared uint tileMaxDepth;
+shared vec3 tileCorners[8];
+shared uint tileLightCount;
+// One bit per light of the batch touching the tile.
+shared uint tileLightMask[BATCH_WORDS];
+
+// Smoothly reaches zero at the range of the light.
+float attenuate(Light light, float distance) {
+    float ratio = distance / light.range;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    return light.intensity * window * window / max(distance * distance, 0.0001);
+}
+
+vec3 shadeLight(Light light, vec3 albedo, vec3 N, vec3 V, vec3 position) {
+    vec3 L;
+    float radiance = light.intensity;
+    if (light.type == LIGHT_DIRECTIONAL) {
+        L = -light.direction;
+    } else {
+        vec3 toLight = light.position - position;
+        float distance = length(toLight);
+        L = toLight / max(distance, 0.0001);
+        radiance = attenuate(light, distance);
+        if (light.type == LIGHT_SPOT) {
+            radiance *= smoothstep(light.cosOuterCone, light.cosInnerCone,
+                                   dot(-L, light.direction));
+        }
+    }
+    vec3 H = normalize(V + L);
+    float NdotL = max(dot(N, L), 0.0);
+    float spec = pow(max(dot(N, H), 0.0), 64);
+    return (albedo * NdotL + spec * NdotL) * light.color * radiance;
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    bool inside = all(lessThan(gl_GlobalInvocationID.xy, pc.extent));
+    vec2 uv = (vec2(pixel) + 0.5) / vec2(pc.extent);
+
+    if (gl_LocalInvocationIndex == 0) {
+        tileMinDepth = 0xFFFFFFFFu;
+        tileMaxDepth = 0;
+        tileLightCount = 0;
+    }
+    barrier();
+
+    // The background is not lit so it does not widen the depth range of the tile.
+    float depth = inside ? texelFetch(depthSampler, pixel, 0).r : 1.0;
+    if (depth < 1.0) {
+        // Non negative floats order the same as their bits.
+        atomicMin(tileMinDepth, floatBitsToUint(depth));
+        atomicMax(tileMaxDepth, floatBitsToUint(depth));
+    }
+    barrier();
+
+    // Only tiles with geometry bin lights, the rest is just background.
+    bool tileHasGeometry = tileMinDepth <= tileMaxDepth;
+    if (tileHasGeometry && gl_LocalInvocationIndex < 8) {
+        uint corner = gl_LocalInvocationIndex;
+        vec2 tileMin = vec2(gl_WorkGroupID.xy * gl_WorkGroupSize.xy) / vec2(pc.extent);
+        vec2 tileMax = min(vec2((gl_WorkGroupID.xy + 1u) * gl_WorkGroupSize.xy) / vec2(pc.extent),
+                           vec2(1.0));
+        vec2 cornerUv = vec2((corner & 1u) != 0 ? tileMax.x : tileMin.x,
+                             (corner & 2u) != 0 ? tileMax.y : tileMin.y);
+        float cornerDepth = uintBitsToFloat((corner & 4u) != 0 ? tileMaxDepth : tileMinDepth);
+        tileCorners[corner] = reconstructPosition(pc.invViewProj, cornerUv, cornerDepth);
+    }
+    barrier();
+
+    // The box enclosing the slice of the frustum covered by the tile.
+    vec3 boxMin = tileCorners[0];
+    vec3 boxMax = tileCorners[0];
+    for (uint corner = 1; corner < 8; ++corner) {
+        boxMin = min(boxMin, tileCorners[corner]);
+        boxMax = max(boxMax, tileCorners[corner]);
+    }
+
+    vec4 color = vec4(0.0);
+    vec3 albedo = vec3(0.0);
+    vec3 position = vec3(0.0);
+    vec3 N = vec3(0.0);
+    vec3 V = vec3(0.0);
+    if (inside) {
+        vec4 texel = texelFetch(sampler2D(texAlbedo, gBufferSampler), pixel, 0);
+#ifdef COMPACT_GBUFFER
+        position = reconstructPosition(pc.invViewProj, uv, depth);
+        N = octDecode(texelFetch(sampler2D(texNormals, gBufferSampler), pixel, 0).xy);
+#else
+        position = texelFetch(sampler2D(texPositions, gBufferSampler), pixel, 0).xyz;
+        N = texelFetch(sampler2D(texNormals, gBufferSampler), pixel, 0).xyz;
+#endif
+        V = normalize(pc.cameraPosition - position);
+        albedo = texel.rgb;
+        // The light at the camera of the fullscreen lighting pass.
+        color = blinnPhongLighting(texel, N, V, V);
+    }
+
+    // The lights are binned and shaded a batch at a time so none are dropped, and every
+    // pixel adds them up in the order of the light buffer whatever order the threads bin
+    // them in. The batch count is the same for every thread, so the barriers are reached
+    // by the whole workgroup.
+    uint batchCount =
+        tileHasGeometry ? (pc.lightCount + LIGHTS_PER_BATCH - 1) / LIGHTS_PER_BATCH : 0;
+    for (uint batch = 0; batch < batchCount; ++batch) {
+        if (gl_LocalInvocationIndex < BATCH_WORDS) {
+            tileLightMask[gl_LocalInvocationIndex] = 0;
+        }
+        barrier();
+
+        uint firstLight = batch * LIGHTS_PER_BATCH;
+        uint index = firstLight + gl_LocalInvocationIndex;
+        if (index < pc.lightCount) {
+            Light light = lights[index];
+            // Spot lights are culled by the sphere around them, which is conservative.
+            vec3 offset = clamp(light.position, boxMin, boxMax) - light.position;
+            if (light.type == LIGHT_DIRECTIONAL
+                || dot(offset, offset) <= light.range * light.range) {
+                atomicOr(tileLightMask[gl_LocalInvocationIndex / 32],
+                         1u << (gl_LocalInvocationIndex % 32));
+                atomicAdd(tileLightCount, 1u);
+            }
+        }
+        barrier();
+
+        if (inside && depth < 1.0) {
+            for (uint word = 0; word < BATCH_WORDS; ++word) {
+                uint mask = tileLightMask[word];
+                while (mask != 0) {
+                    uint bit = uint(findLSB(mask));
+                    mask &= mask - 1u;
+                    Light light = lights[firstLight + word * 32 + bit];
+                    color.rgb += shadeLight(light, albedo, N, V, position);
+                }
+            }
+        }
+        // The mask is cleared for the next batch once every thread has shaded.
+        barrier();
+    }
+
+    // A list of one batch of lights would have overflowed in these tiles.
+    if (gl_LocalInvocationIndex == 0 && tileLightCount > LIGHTS_PER_BATCH) {
+        atomicAdd(counters.overflowTiles, 1u);
+    }
+
+    if (inside) {
+        imageStore(outImage, pixel, color);
+    }
+}
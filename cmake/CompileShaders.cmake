@@ -3,13 +3,15 @@
 #   shader_path - relative path (from assets/shaders) to the shader to compile
 #   compiled_name - the name of the compiled shader
 #   stage - the stage to pass into glslc
+#   ARGN - optional macros to define while compiling
 function(compileShader shader_path compiled_name stage)
     set(compiled_shader_path "compiled/${compiled_name}.spv")
+    list(TRANSFORM ARGN PREPEND "-D" OUTPUT_VARIABLE defines)
 
     message("Compiling ${stage} shader ${shader_path} to ${compiled_shader_path}")
 
     execute_process(
-      COMMAND glslc "-O" "-fshader-stage=${stage}" ${shader_path} "-o" ${compiled_shader_path}
+      COMMAND glslc "-O" "-fshader-stage=${stage}" ${defines} ${shader_path} "-o" ${compiled_shader_path}
         WORKING_DIRECTORY ${CMAKE_SOURCE_DIR}/assets/shaders
     )
 endfunction()
@@ -20,14 +22,27 @@ function(compileAllShaders)
     compileShader("fullscreen_vertex.glsl" "fullscreen_quad" "vertex")
     # Geometry pass
     compileShader("geometry_pass/vertex.glsl" "geometry_pass_vertex" "vertex")
+    compileShader("geometry_pass/vertex.glsl" "geometry_pass_vertex_indirect" "vertex" "INDIRECT")
+    compileShader("geometry_pass/vertex.glsl" "geometry_pass_vertex_depth" "vertex" "DEPTH_ONLY")
+    compileShader("geometry_pass/vertex.glsl" "geometry_pass_vertex_indirect_depth" "vertex" "INDIRECT" "DEPTH_ONLY")
     compileShader("geometry_pass/fragment.glsl" "geometry_pass_fragment" "fragment")
+    compileShader("geometry_pass/fragment.glsl" "geometry_pass_fragment_bindless" "fragment" "BINDLESS")
+    compileShader("geometry_pass/fragment.glsl" "geometry_pass_fragment_compact" "fragment" "COMPACT_GBUFFER")
+    compileShader("geometry_pass/fragment.glsl" "geometry_pass_fragment_bindless_compact" "fragment" "BINDLESS" "COMPACT_GBUFFER")
     # PBR
     compileShader("pbr/vertex.glsl" "pbr_vertex" "vertex")
     compileShader("pbr/fragment.glsl" "pbr_fragment" "fragment")
     compileShader("pbr/lighting.glsl" "pbr_lighting" "fragment")
+    compileShader("pbr/lighting.glsl" "pbr_lighting_compact" "fragment" "COMPACT_GBUFFER")
+    compileShader("pbr/tiled_lighting.glsl" "pbr_tiled_lighting" "compute")
+    compileShader("pbr/tiled_lighting.glsl" "pbr_tiled_lighting_compact" "compute" "COMPACT_GBUFFER")
     # Imgui
     compileShader("imgui/vertex.glsl" "imgui_vertex" "vertex")
     compileShader("imgui/fragment.glsl" "imgui_fragment" "fragment")
     # Tonemappers
     compileShader("tonemappers/aces+gamma.glsl" "tm_aces+gamma" "compute")
+    # Culling
+    compileShader("culling/frustum_cull.glsl" "frustum_cull" "compute")
+    compileShader("culling/frustum_cull.glsl" "occlusion_cull" "compute" "OCCLUSION")
+    compileShader("culling/depth_pyramid.glsl" "depth_pyramid" "compute")
 endfunction()
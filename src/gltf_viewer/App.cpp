@@ -9,39 +9,37 @@
 
 #include "pbr/core/GpuHandle.hpp"
 
-#include "pbr/AsyncSubmitInfo.hpp"
+#include "pbr/FrameRing.hpp"
 #include "pbr/GBuffer.hpp"
+#include "pbr/GpuProfiler.hpp"
+#include "pbr/HdrImage.hpp"
 #include "pbr/PbrPipeline.hpp"
 #include "pbr/PbrRenderSystem.hpp"
+#include "pbr/RenderGraph.hpp"
 #include "pbr/Scene.hpp"
 #include "pbr/SwapchainImageView.hpp"
-#include "pbr/TransferStager.hpp"
+#include "pbr/ThreadPool.hpp"
 #include "pbr/gltf/Asset.hpp"
-#include "pbr/gltf/Loader.hpp"
 #include "pbr/imgui/Pipeline.hpp"
 #include "pbr/imgui/Renderer.hpp"
 #include "pbr/memory/IAllocator.hpp"
 #include "pbr/memory/MemoryAllocator.hpp"
+#include "pbr/memory/TransientAllocator.hpp"
 
 #include "CameraController.hpp"
+#include "Setup.hpp"
 
 #include "backends/imgui_impl_glfw.h"
 #include "imgui.h"
 
-#include <array>
 #include <cassert>
 #include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <filesystem>
-#include <format>
-#include <fstream>
-#include <ios>
 #include <memory>
 #include <memory_resource>
 #include <ranges>
-#include <stdexcept>
-#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -59,128 +57,17 @@ constexpr static auto DEFAULT_WINDOW_HEIGHT = 720uz;
 
 namespace {
 [[nodiscard]]
-constexpr auto loadBinary(std::filesystem::path const& path)
-    -> std::vector<std::uint32_t> {
-  std::ifstream file(path, std::ios::in | std::ios::binary);
-  auto const size = std::filesystem::file_size(path);
-  std::vector<std::uint32_t> binary(size / 4);
-
-  // NOLINTNEXTLINE casting to char* is not UB
-  file.read(reinterpret_cast<char*>(binary.data()), static_cast<std::streamsize>(size));
-
-  return binary;
-}
-[[nodiscard]]
 constexpr auto createLogger() -> std::shared_ptr<spdlog::logger> {
   return spdlog::stdout_color_mt("app");
 }
 [[nodiscard]]
-constexpr auto validatePath(std::filesystem::path path) -> std::filesystem::path {
-  if (!std::filesystem::exists(path)) {
-    throw std::runtime_error(std::format("No such file: {}", path.c_str()));
-  }
-  if (!std::filesystem::is_regular_file(path)) {
-    throw std::runtime_error(std::format("{} is not a regular file", path.c_str()));
-  }
-  return path;
-}
-[[nodiscard]]
-constexpr auto loadShader(pbr::core::GpuHandle const& gpu, std::string_view name)
-    -> vk::UniqueShaderModule {
-  auto const spv = loadBinary(std::filesystem::path("assets/shaders/compiled") / name);
-  return gpu.getDevice().createShaderModuleUnique(
-      vk::ShaderModuleCreateInfo {}.setCode(spv));
-}
-struct ShaderNames {
-  std::string_view vertexName {};
-  std::string_view fragmentName {};
-};
-[[nodiscard]]
-constexpr auto loadShaders(pbr::core::GpuHandle const& gpu, ShaderNames names)
-    -> std::pair<vk::UniqueShaderModule, vk::UniqueShaderModule> {
-  return std::make_pair(loadShader(gpu, names.vertexName),
-                        loadShader(gpu, names.fragmentName));
-}
-[[nodiscard]]
-constexpr auto createPbrPipeline(pbr::core::GpuHandle const& gpu, vk::Format outputFormat)
-    -> pbr::PbrPipeline {
-  auto const [vertexModule, fragmentModule] = loadShaders(
-      gpu, {.vertexName = "pbr_vertex.spv", .fragmentName = "pbr_fragment.spv"});
-  return {
-      gpu,
-      pbr::PbrPipelineCreateInfo {
-          .vertexStage {
-              .stage = vk::ShaderStageFlagBits::eVertex,
-              .module = vertexModule.get(),
-              .pName = "main",
-          },
-          .fragmentStage {
-              .stage = vk::ShaderStageFlagBits::eFragment,
-              .module = fragmentModule.get(),
-              .pName = "main",
-          },
-          .outputFormat = outputFormat,
-      },
-  };
-}
-[[nodiscard]]
-constexpr auto createPbrRenderSystem(pbr::core::SharedGpuHandle gpu)
-    -> pbr::PbrRenderSystem {
-  auto const [geometryVertex, geometryFragment] =
-      loadShaders(*gpu, {.vertexName = "geometry_pass_vertex.spv",
-                         .fragmentName = "geometry_pass_fragment.spv"});
-  auto const [lightingVertex, lightingFragment] = loadShaders(
-      *gpu, {.vertexName = "fullscreen_quad.spv", .fragmentName = "pbr_lighting.spv"});
-  return {
-      std::move(gpu),
-      pbr::PbrRenderSystemCreateInfo {
-          .geometryVertexShader {
-              .stage = vk::ShaderStageFlagBits::eVertex,
-              .module = geometryVertex.get(),
-              .pName = "main",
-          },
-          .geometryFragmentShader {
-              .stage = vk::ShaderStageFlagBits::eFragment,
-              .module = geometryFragment.get(),
-              .pName = "main",
-          },
-          .lightingVertexShader {
-              .stage = vk::ShaderStageFlagBits::eVertex,
-              .module = lightingVertex.get(),
-              .pName = "main",
-          },
-          .lightingFragmentShader {
-              .stage = vk::ShaderStageFlagBits::eFragment,
-              .module = lightingFragment.get(),
-              .pName = "main",
-          },
-      },
-  };
-}
-[[nodiscard]]
-constexpr auto loadScene(std::filesystem::path const& path,
-                         pbr::gltf::AssetDependencies dependencies,
-                         vk::CommandPool cmdPool, std::pmr::polymorphic_allocator<> alloc) -> pbr::Scene {
-  pbr::TransferStager stager(dependencies.gpu, dependencies.allocator);
-
-  pbr::gltf::Loader loader;
-  auto asset = loader.loadAsset(path, std::move(dependencies));
-
-  auto scene = asset.loadScene(stager, 0, alloc);
-
-  stager.submit(cmdPool);
-  stager.wait();
-
-  return scene;
-}
-[[nodiscard]]
 constexpr auto createImguiRenderer(pbr::core::SharedGpuHandle gpu,
                                    std::shared_ptr<pbr::IAllocator> allocator,
                                    vkfw::Window const& window, vk::CommandPool cmdPool,
                                    vk::Format outputFormat) -> pbr::imgui::Renderer {
   ImGui::CreateContext();
   ImGui_ImplGlfw_InitForOther(window, false);
-  auto const [vertexModule, fragmentModule] = loadShaders(
+  auto const [vertexModule, fragmentModule] = app::loadShaders(
       *gpu, {.vertexName = "imgui_vertex.spv", .fragmentName = "imgui_fragment.spv"});
   return {
       std::move(gpu),
@@ -201,23 +88,11 @@ constexpr auto createImguiRenderer(pbr::core::SharedGpuHandle gpu,
       },
   };
 }
-[[nodiscard]]
-constexpr auto createTonemapper(pbr::core::SharedGpuHandle gpu) -> pbr::TonemapperSystem {
-  auto const shader = loadShader(*gpu, "tm_aces+gamma.spv");
-  return {
-      std::move(gpu),
-      vk::PipelineShaderStageCreateInfo {
-          .stage = vk::ShaderStageFlagBits::eCompute,
-          .module = shader.get(),
-          .pName = "main",
-      },
-  };
-}
 } // namespace
 
 app::App::App(std::filesystem::path path, bool vkValidation)
     : _logger(::createLogger())
-    , _path(::validatePath(std::move(path)))
+    , _path(app::validatePath(std::move(path)))
     , _window(vkfw::createWindowUnique(constants::DEFAULT_WINDOW_WIDTH,
                                        constants::DEFAULT_WINDOW_HEIGHT, path.c_str()))
     , _controller(_window.get())
@@ -227,6 +102,7 @@ app::App::App(std::filesystem::path path, bool vkValidation)
           .enableValidation = vkValidation,
       }))
     , _allocator(std::make_shared<pbr::MemoryAllocator>(_gpu))
+    , _threadPool(std::make_shared<pbr::ThreadPool>())
     , _surface(_gpu, vkfw::createWindowSurfaceUnique(_gpu->getInstance(), _window.get()),
                pbr::utils::toExtent(_window->getFramebufferSize()))
     , _commandPool(_gpu->getDevice().createCommandPoolUnique({
@@ -234,31 +110,15 @@ app::App::App(std::filesystem::path path, bool vkValidation)
           .queueFamilyIndex =
               _gpu->getPhysicalDeviceProperties().graphicsTransferPresentQueue,
       }))
-    , _descPool([this] {
-      std::array const sizes {
-          vk::DescriptorPoolSize {
-              .type = vk::DescriptorType::eUniformBuffer,
-              .descriptorCount = 6,
-          },
-          vk::DescriptorPoolSize {
-              .type = vk::DescriptorType::eSampledImage,
-              .descriptorCount = 5,
-          },
-      };
-      return _gpu->getDevice().createDescriptorPoolUnique(vk::DescriptorPoolCreateInfo {
-          .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
-          .maxSets = 6,
-      }
-                                                              .setPoolSizes(sizes));
-    }())
+    , _descPool(app::createSceneDescriptorPool(*_gpu))
     , _imguiRenderer(::createImguiRenderer(_gpu, _allocator, _window.get(),
                                            _commandPool.get(),
                                            _surface.getFormat().format))
-    , _pbrPipeline(::createPbrPipeline(*_gpu, _surface.getFormat().format))
-    , _pbrSystem(::createPbrRenderSystem(_gpu))
-    , _tonemapper(::createTonemapper(_gpu))
+    , _pbrPipeline(app::createPbrPipeline(*_gpu, _surface.getFormat().format))
+    , _pbrSystem(app::createPbrRenderSystem(_gpu, _allocator, _threadPool))
+    , _tonemapper(app::createTonemapper(_gpu))
     , _sceneMemory()
-    , _scene(::loadScene(
+    , _scene(app::loadScene(
           _path,
           {
               .gpu = _gpu,
@@ -266,13 +126,19 @@ app::App::App(std::filesystem::path path, bool vkValidation)
               .cameraAllocator {_gpu, _descPool.get(), _pbrPipeline.getCameraSetLayout()},
               .materialAllocator {_gpu, _descPool.get(),
                                   _pbrPipeline.getMaterialSetLayout()},
+              .materialRegistry = _pbrSystem.getMaterialRegistry(),
+              .framesInFlight = FRAMES_IN_FLIGHT,
           },
           _commandPool.get(), &_sceneMemory))
+    , _transientAllocator(app::createTransientAllocator(
+          _gpu, _allocator, pbr::utils::toExtent(_window->getFramebufferSize()),
+          _pbrSystem.getGBufferLayout()))
     , _gBuffer(_pbrSystem.allocateGBuffer(
-          *_allocator, pbr::utils::toExtent(_window->getFramebufferSize())))
+          _transientAllocator, pbr::utils::toExtent(_window->getFramebufferSize())))
     , _hdrImage(_tonemapper.allocateHdrImage(
-          *_allocator, pbr::utils::toExtent(_window->getFramebufferSize())))
-    , _submitter(_gpu) {
+          _transientAllocator, pbr::utils::toExtent(_window->getFramebufferSize())))
+    , _frames(_gpu, FRAMES_IN_FLIGHT)
+    , _gpuProfiler(_gpu, FRAMES_IN_FLIGHT) {
   setupWindowCallbacks();
   setupUi();
 
@@ -300,17 +166,20 @@ auto app::App::run() -> void {
     _ui.render(frameDuration);
 
     _controller.update(deltaTime);
-    if (auto const camera = _scene.findCamera(); camera) {
-      camera.value()->set(_controller.getCameraData());
+    if (auto* const camera = _scene.getActiveCamera(); camera != nullptr) {
+      camera->set(_controller.getCameraData());
     }
-    for (auto& node : _scene.iterateAllNodes() | std::views::filter([](auto const& node) {
-                        return node.getMesh() != nullptr;
-                      }) | std::views::take(9)) {
+    for (auto node : _scene.iterateNodes()
+                         | std::views::filter([](pbr::Node const& node) {
+                             return node.getMesh() != nullptr;
+                           })
+                         | std::views::take(9)) {
       auto transform = node.getTransform();
       transform.rotation = glm::rotate(transform.rotation, static_cast<float>(deltaTime),
                                        {0.0f, 1.0f, 0.0f});
       node.setTransform(transform);
     }
+    _scene.updateWorldTransforms();
 
     ImGui::Render();
     renderAndPresent();
@@ -326,6 +195,8 @@ app::App::~App() noexcept {
 auto app::App::setupWindowCallbacks() -> void {
   _window->callbacks()->on_window_resize = [this](vkfw::Window const&, std::size_t width,
                                                   std::size_t height) {
+    // The old swapchain images may still be used by frames in flight.
+    _frames.waitIdle();
     _surface.recreateSwapchain(pbr::utils::toExtent(width, height));
     _controller.onWindowResize(width, height);
   };
@@ -362,122 +233,93 @@ auto app::App::setupWindowCallbacks() -> void {
 }
 
 auto app::App::setupUi() -> void {
+  _ui.performanceOverlay.setScene(&_scene);
+  _ui.performanceOverlay.setRenderSystem(&_pbrSystem);
+  _ui.performanceOverlay.setFrameRing(&_frames);
+  _ui.performanceOverlay.setGBuffer(&_gBuffer);
+  _ui.performanceOverlay.setTransientAllocator(&_transientAllocator);
+  _ui.performanceOverlay.setRenderGraph(&_renderGraph);
+  _ui.performanceOverlay.setGpuProfiler(&_gpuProfiler);
   _ui.sceneTree.setScene(&_scene);
 }
 
-auto app::App::makeAsyncSubmitInfo() -> pbr::AsyncSubmitInfo {
-  return {
-      .waitSemaphore =
-          pbr::AsyncSubmitInfo::WaitSemaphore {
-              .semaphore = _gpu->getDevice().createSemaphoreUnique({}),
-              .waitDstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput,
-          },
-      .signalSemaphore = _gpu->getDevice().createSemaphoreUnique({}),
-      .cmdBuffer =
-          std::move(_gpu->getDevice()
-                        .allocateCommandBuffersUnique(
-                            {.commandPool = _commandPool.get(), .commandBufferCount = 1})
-                        .front()),
-  };
-}
-
-auto app::App::recordCommands(vk::CommandBuffer cmdBuffer,
+auto app::App::recordCommands(vk::CommandBuffer cmdBuffer, std::uint32_t frameIndex,
                               pbr::SwapchainImageView imageView) -> void {
+  // The frame slot was waited on, so this reads the timings it recorded last time.
+  _gpuProfiler.beginFrame(cmdBuffer, frameIndex);
+
   // Render the scene
-  _pbrSystem.render(cmdBuffer, _scene, _gBuffer, _hdrImage.getImage(),
+  app::addAliasingPass(_renderGraph, _transientAllocator, SCENE_PASS);
+  _pbrSystem.render(_renderGraph, frameIndex, _scene, _gBuffer, _hdrImage.getImage(),
                     _hdrImage.getExtent());
 
   // Run tonemapper
-  _hdrImage.updateOutputTexture(imageView.getImage(), imageView.getImageView());
-  _tonemapper.run(cmdBuffer, _hdrImage);
-
-  { // Render imgui
-    {
-      vk::ImageMemoryBarrier2 const barrier {
-          .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
-          .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
-          .dstStageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput,
-          .dstAccessMask = vk::AccessFlagBits2::eColorAttachmentWrite,
-          .oldLayout = vk::ImageLayout::eGeneral,
-          .newLayout = vk::ImageLayout::eColorAttachmentOptimal,
-          .image = imageView.getImage(),
-          .subresourceRange {
-              .aspectMask = vk::ImageAspectFlagBits::eColor,
-              .levelCount = 1,
-              .layerCount = 1,
-          },
-      };
-      cmdBuffer.pipelineBarrier2(vk::DependencyInfo {}.setImageMemoryBarriers(barrier));
-    }
-    vk::RenderingAttachmentInfo const attachmentInfo {
-        .imageView = imageView.getImageView(),
-        .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
-        .loadOp = vk::AttachmentLoadOp::eLoad,
-        .storeOp = vk::AttachmentStoreOp::eStore,
-    };
-    auto const renderInfo =
-        vk::RenderingInfo {
-            .renderArea {
-                .extent = imageView.getExtent(),
-            },
-            .layerCount = 1,
-        }
-            .setColorAttachments(attachmentInfo);
-    cmdBuffer.beginRendering(renderInfo);
-    _imguiRenderer.render(cmdBuffer);
-    cmdBuffer.endRendering();
-  }
+  _hdrImage.updateOutputTexture(frameIndex, imageView.getImage(),
+                                imageView.getImageView());
+  app::addAliasingPass(_renderGraph, _transientAllocator, TONEMAP_PASS);
+  _tonemapper.run(_renderGraph, _hdrImage, frameIndex);
+
+  // Render imgui
+  auto const swapchainImage =
+      _renderGraph.importImage(imageView.getImage(), vk::ImageAspectFlagBits::eColor);
+  _renderGraph
+      .addPass("imgui",
+               [this, imageView, frameIndex](vk::CommandBuffer const passCmdBuffer) {
+                 vk::RenderingAttachmentInfo const attachmentInfo {
+                     .imageView = imageView.getImageView(),
+                     .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
+                     .loadOp = vk::AttachmentLoadOp::eLoad,
+                     .storeOp = vk::AttachmentStoreOp::eStore,
+                 };
+                 auto const renderInfo =
+                     vk::RenderingInfo {
+                         .renderArea {
+                             .extent = imageView.getExtent(),
+                         },
+                         .layerCount = 1,
+                     }
+                         .setColorAttachments(attachmentInfo);
+                 passCmdBuffer.beginRendering(renderInfo);
+                 _imguiRenderer.render(passCmdBuffer, frameIndex);
+                 passCmdBuffer.endRendering();
+               })
+      .write(swapchainImage, pbr::usages::COLOR_ATTACHMENT_LOAD);
+  _renderGraph.exportImage(swapchainImage, pbr::usages::PRESENT);
+
+  _renderGraph.execute(cmdBuffer, &_gpuProfiler);
 }
 
 auto app::App::resizeBuffers() -> void {
   auto const windowExtent = pbr::utils::toExtent(_window->getFramebufferSize());
-
-  if (_gBuffer.getExtent() != windowExtent) {
-    _gBuffer = _pbrSystem.allocateGBuffer(*_allocator, windowExtent);
+  if (_gBuffer.getExtent() == windowExtent && _hdrImage.getExtent() == windowExtent) {
+    return;
   }
+  // Every frame in flight renders into the same buffers.
+  _frames.waitIdle();
 
-  if (_hdrImage.getExtent() != windowExtent) {
-    _hdrImage = _tonemapper.allocateHdrImage(*_allocator, windowExtent);
-  }
+  // Both images are placed in the same memory, so they are replaced together.
+  app::reserveFrameImages(_transientAllocator, windowExtent, _pbrSystem.getGBufferLayout());
+  _gBuffer = _pbrSystem.allocateGBuffer(_transientAllocator, windowExtent);
+  _hdrImage = _tonemapper.allocateHdrImage(_transientAllocator, windowExtent);
 }
 
 auto app::App::renderAndPresent() -> void {
-  auto asyncInfo = _submitter.isSubmitted() ? _submitter.wait() : makeAsyncSubmitInfo();
-  assert(asyncInfo.waitSemaphore.has_value());
-  assert(asyncInfo.signalSemaphore.has_value());
-  auto const renderDoneSemaphore = asyncInfo.signalSemaphore->get();
+  auto& frame = _frames.beginFrame();
 
-  auto imageView =
-      _surface.acquireSwapchainImageView(asyncInfo.waitSemaphore->semaphore.get());
+  auto imageView = _surface.acquireSwapchainImageView(frame.imageAvailable.get());
   assert(imageView.has_value());
 
-  asyncInfo.cmdBuffer->reset();
-  asyncInfo.cmdBuffer->begin(vk::CommandBufferBeginInfo {
+  frame.cmdBuffer->begin(vk::CommandBufferBeginInfo {
       .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
 
   resizeBuffers();
 
-  recordCommands(asyncInfo.cmdBuffer.get(), *imageView);
-  {
-    vk::ImageMemoryBarrier2 const barrier {
-        .srcStageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput,
-        .srcAccessMask = vk::AccessFlagBits2::eColorAttachmentWrite,
-        .dstStageMask = vk::PipelineStageFlagBits2::eBottomOfPipe,
-        .oldLayout = vk::ImageLayout::eColorAttachmentOptimal,
-        .newLayout = vk::ImageLayout::ePresentSrcKHR,
-        .image = imageView->getImage(),
-        .subresourceRange {
-            .aspectMask = vk::ImageAspectFlagBits::eColor,
-            .levelCount = 1,
-            .layerCount = 1,
-        },
-    };
-    asyncInfo.cmdBuffer->pipelineBarrier2(
-        vk::DependencyInfo {}.setImageMemoryBarriers(barrier));
-  }
-  asyncInfo.cmdBuffer->end();
+  recordCommands(frame.cmdBuffer.get(), frame.index, *imageView);
+  frame.cmdBuffer->end();
 
-  _submitter.submit(std::move(asyncInfo));
+  // The tonemapper writes the swapchain image from a compute shader.
+  _frames.submit(frame, vk::PipelineStageFlagBits::eComputeShader
+                            | vk::PipelineStageFlagBits::eColorAttachmentOutput);
 
-  imageView->present(renderDoneSemaphore);
+  imageView->present(frame.renderDone.get());
 }
@@ -6,21 +6,25 @@
 
 #include "pbr/core/GpuHandle.hpp"
 
-#include "pbr/AsyncSubmitInfo.hpp"
-#include "pbr/AsyncSubmitter.hpp"
+#include "pbr/FrameRing.hpp"
 #include "pbr/GBuffer.hpp"
+#include "pbr/GpuProfiler.hpp"
 #include "pbr/HdrImage.hpp"
 #include "pbr/PbrPipeline.hpp"
 #include "pbr/PbrRenderSystem.hpp"
+#include "pbr/RenderGraph.hpp"
 #include "pbr/Scene.hpp"
 #include "pbr/Surface.hpp"
 #include "pbr/SwapchainImageView.hpp"
+#include "pbr/ThreadPool.hpp"
 #include "pbr/TonemapperSystem.hpp"
 #include "pbr/imgui/Renderer.hpp"
 #include "pbr/memory/IAllocator.hpp"
+#include "pbr/memory/TransientAllocator.hpp"
 
 #include "CameraController.hpp"
 
+#include <cstdint>
 #include <filesystem>
 #include <memory>
 
@@ -40,6 +44,7 @@ class App {
 
   pbr::core::SharedGpuHandle _gpu;
   std::shared_ptr<pbr::IAllocator> _allocator;
+  std::shared_ptr<pbr::ThreadPool> _threadPool;
   pbr::Surface _surface;
 
   vk::UniqueCommandPool _commandPool;
@@ -56,9 +61,14 @@ class App {
   pbr::Scene _scene;
 
   // Frame data
+  /// Aliases the memory of the G-buffer and the HDR image where their passes allow.
+  pbr::TransientAllocator _transientAllocator;
   pbr::GBuffer _gBuffer;
   pbr::HdrImage _hdrImage;
-  pbr::AsyncSubmitter _submitter;
+  pbr::FrameRing _frames;
+  /// Tracks the layouts of the frame images across frames.
+  pbr::RenderGraph _renderGraph;
+  pbr::GpuProfiler _gpuProfiler;
 
 public:
   explicit App(std::filesystem::path path, bool vkValidation);
@@ -75,8 +85,8 @@ public:
 private:
   auto setupWindowCallbacks() -> void;
   auto setupUi() -> void;
-  auto makeAsyncSubmitInfo() -> pbr::AsyncSubmitInfo;
-  auto recordCommands(vk::CommandBuffer, pbr::SwapchainImageView) -> void;
+  auto recordCommands(vk::CommandBuffer, std::uint32_t frameIndex,
+                      pbr::SwapchainImageView) -> void;
   auto resizeBuffers() -> void;
   auto renderAndPresent() -> void;
 };
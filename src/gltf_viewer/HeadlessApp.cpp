@@ -0,0 +1,446 @@
+#include "HeadlessApp.hpp"
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/core/GpuHandle.hpp"
+
+#include "pbr/CameraData.hpp"
+#include "pbr/FrameRing.hpp"
+#include "pbr/GpuProfiler.hpp"
+#include "pbr/ImageEncoder.hpp"
+#include "pbr/Mesh.hpp"
+#include "pbr/OffscreenTarget.hpp"
+#include "pbr/ReadbackRing.hpp"
+#include "pbr/RenderGraph.hpp"
+#include "pbr/Scene.hpp"
+#include "pbr/ThreadPool.hpp"
+#include "pbr/TileGrid.hpp"
+#include "pbr/memory/MemoryAllocator.hpp"
+
+#include "OutputFormat.hpp"
+#include "Setup.hpp"
+#include "TiledImageWriter.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <ios>
+#include <memory>
+#include <numbers>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <spdlog/logger.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include <glm/ext/vector_float3.hpp>
+#include <glm/geometric.hpp>
+
+namespace {
+[[nodiscard]]
+auto createLogger() -> std::shared_ptr<spdlog::logger> {
+  return spdlog::stdout_color_mt("headless");
+}
+[[nodiscard]]
+auto getOutputFormat(std::filesystem::path const& path) -> app::OutputFormat {
+  if (path.extension() == ".png") {
+    return app::OutputFormat::Png;
+  }
+  if (path.extension() == ".exr") {
+    return app::OutputFormat::Exr;
+  }
+  throw std::runtime_error(std::format("{} is neither a png nor an exr", path.c_str()));
+}
+/**
+ * Leaves the encoders one frame in flight and a frame to encode each.
+ */
+[[nodiscard]]
+auto getReadbackSlotCount() noexcept -> std::uint32_t {
+  return app::FRAMES_IN_FLIGHT + pbr::ThreadPool::getDefaultThreadCount();
+}
+[[nodiscard]]
+auto getMaxTileSize(pbr::core::GpuHandle const& gpu, std::uint32_t const tileSize)
+    -> std::uint32_t {
+  return std::min(tileSize,
+                  gpu.getPhysicalDevice().getProperties().limits.maxImageDimension2D);
+}
+/**
+ * Adds a cube of instances of the meshes of the scene, the meshes take turns.
+ * @throws std::runtime_error If the scene has no meshes.
+ */
+auto addSyntheticInstances(pbr::Scene& scene, std::uint32_t const count) -> void {
+  std::vector<std::shared_ptr<pbr::Mesh>> meshes;
+  // The instances are spaced by the largest mesh so they never overlap.
+  auto spacing = 0.0f;
+  for (auto const& mesh : scene.getMeshes()) {
+    if (mesh != nullptr && !std::ranges::contains(meshes, mesh)) {
+      meshes.push_back(mesh);
+      auto const sphere = mesh->getBoundingSphere();
+      spacing = std::max(spacing, 2.0f * (glm::length(glm::vec3(sphere)) + sphere.w));
+    }
+  }
+  if (meshes.empty()) {
+    throw std::runtime_error("The scene has no meshes to instance");
+  }
+
+  auto const side =
+      static_cast<std::uint32_t>(std::ceil(std::cbrt(static_cast<double>(count))));
+  auto const center = static_cast<float>(side - 1) * 0.5f;
+  for (auto index = 0u; index < count; ++index) {
+    glm::vec3 const cell(static_cast<float>(index % side),
+                         static_cast<float>(index / side % side),
+                         static_cast<float>(index / (side * side)));
+    scene.addNode("instance", {.position = (cell - center) * spacing})
+        .setMesh(meshes[index % meshes.size()]);
+  }
+}
+auto writeFile(std::filesystem::path const& path, std::span<std::byte const> bytes)
+    -> void {
+  std::ofstream file(path, std::ios::out | std::ios::binary);
+  if (!file) {
+    throw std::runtime_error(std::format("Failed to open {}", path.c_str()));
+  }
+  // NOLINTNEXTLINE casting to char* is not UB
+  file.write(reinterpret_cast<char const*>(bytes.data()),
+             static_cast<std::streamsize>(bytes.size()));
+}
+} // namespace
+
+app::HeadlessApp::HeadlessApp(HeadlessOptions options)
+    : _logger(::createLogger())
+    , _options(std::move(options))
+    , _format(::getOutputFormat(_options.output))
+    , _gpu(pbr::core::makeGpuHandle({
+          .enableValidation = _options.vkValidation,
+      }))
+    , _allocator(std::make_shared<pbr::MemoryAllocator>(_gpu))
+    , _threadPool(std::make_shared<pbr::ThreadPool>())
+    , _commandPool(_gpu->getDevice().createCommandPoolUnique({
+          .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+          .queueFamilyIndex =
+              _gpu->getPhysicalDeviceProperties().graphicsTransferPresentQueue,
+      }))
+    , _descPool(app::createSceneDescriptorPool(*_gpu))
+    , _pbrPipeline(app::createPbrPipeline(*_gpu, pbr::OffscreenTarget::FORMAT))
+    , _pbrSystem(app::createPbrRenderSystem(_gpu, _allocator, _threadPool))
+    , _tonemapper(app::createTonemapper(_gpu))
+    , _sceneMemory()
+    , _scene(app::loadScene(
+          app::validatePath(_options.path),
+          {
+              .gpu = _gpu,
+              .allocator = _allocator,
+              .cameraAllocator {_gpu, _descPool.get(), _pbrPipeline.getCameraSetLayout()},
+              .materialAllocator {_gpu, _descPool.get(),
+                                  _pbrPipeline.getMaterialSetLayout()},
+              .materialRegistry = _pbrSystem.getMaterialRegistry(),
+              .framesInFlight = FRAMES_IN_FLIGHT,
+          },
+          _commandPool.get(), &_sceneMemory))
+    , _tiles(_options.extent, ::getMaxTileSize(*_gpu, _options.tileSize))
+    , _transientAllocator(app::createTransientAllocator(
+          _gpu, _allocator, _tiles.getTileExtent(), _pbrSystem.getGBufferLayout()))
+    , _gBuffer(_pbrSystem.allocateGBuffer(_transientAllocator, _tiles.getTileExtent()))
+    , _hdrImage(
+          _tonemapper.allocateHdrImage(_transientAllocator, _tiles.getTileExtent()))
+    , _target(*_gpu, *_allocator, _tiles.getTileExtent())
+    , _frames(_gpu, FRAMES_IN_FLIGHT)
+    , _gpuProfiler(_gpu, FRAMES_IN_FLIGHT)
+    , _readbacks(*_allocator,
+                 static_cast<vk::DeviceSize>(_tiles.getTileExtent().width)
+                     * _tiles.getTileExtent().height * app::getPixelSize(_format),
+                 ::getReadbackSlotCount())
+    , _pendingFrames(FRAMES_IN_FLIGHT) {
+  _logger->info("Initialized headless rendering of {} at {}x{}", _options.path.c_str(),
+                _options.extent.width, _options.extent.height);
+  if (_options.benchmarkInstances > 0) {
+    ::addSyntheticInstances(_scene, _options.benchmarkInstances);
+    _logger->info("Added {} instances, the scene has {} nodes",
+                  _options.benchmarkInstances, _scene.getNodeCount());
+  } else if (isTiled()) {
+    _logger->info("Rendering {} tiles of {}x{}", _tiles.getTileCount(),
+                  _tiles.getTileExtent().width, _tiles.getTileExtent().height);
+  }
+}
+
+app::HeadlessApp::~HeadlessApp() noexcept {
+  _gpu->getQueue().waitIdle();
+}
+
+auto app::HeadlessApp::run() -> void {
+  if (_options.benchmarkInstances > 0) {
+    runBenchmark();
+    return;
+  }
+
+  auto const start = std::chrono::steady_clock::now();
+  for (auto frame = 0u; frame < _options.frameCount; ++frame) {
+    for (auto tile = 0u; tile < _tiles.getTileCount(); ++tile) {
+      if (isTiled() && tile % _tiles.getColumns() == 0) {
+        // The strip of the row was last used two rows earlier, whose last tiles may
+        // still be in flight.
+        flushPendingFrames();
+        if (tile == 0) {
+          if (frame > 0) {
+            finishTiledFrame(frame - 1);
+          }
+          _tiledWriter = std::make_unique<TiledImageWriter>(getOutputPath(frame),
+                                                            _tiles, _format);
+        }
+        _tiledWriter->beginRow(tile / _tiles.getColumns());
+      }
+      renderTile(frame, tile);
+    }
+  }
+
+  flushPendingFrames();
+  // Slots are released before the files are written, so waiting for the ring would
+  // miss the writes of the last frames.
+  waitForEncoders();
+  if (isTiled()) {
+    finishTiledFrame(_options.frameCount - 1);
+  }
+
+  auto const seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  _logger->info(
+      "Rendered {} frames in {:.3f} s ({:.1f} fps), waited {:.1f} ms for the encoders",
+      _options.frameCount, seconds, static_cast<double>(_options.frameCount) / seconds,
+      std::chrono::duration<double, std::milli>(_readbacks.getStats().slotWait).count());
+  // The frames still in flight at the end are not timed.
+  for (auto const& pass : _gpuProfiler.getTimings().getPasses()) {
+    _logger->info("GPU pass {} took {:.3f} ms on average", pass.name,
+                  std::chrono::duration<double, std::milli>(pass.average).count());
+  }
+  if (_failedFrames != 0) {
+    throw std::runtime_error(
+        std::format("Failed to write {} frames or tiles", _failedFrames.load()));
+  }
+}
+
+auto app::HeadlessApp::isTiled() const noexcept -> bool {
+  return _tiles.getTileCount() > 1;
+}
+
+auto app::HeadlessApp::getCameraData(std::uint32_t frame) const noexcept
+    -> pbr::CameraData {
+  // Turntables orbit the target around the vertical axis.
+  auto const angle = 2.0f * std::numbers::pi_v<float> * static_cast<float>(frame)
+                     / static_cast<float>(_options.frameCount);
+  auto const offset = _options.position - _options.target;
+  auto const position =
+      _options.target
+      + glm::vec3(offset.x * std::cos(angle) + offset.z * std::sin(angle), offset.y,
+                  offset.z * std::cos(angle) - offset.x * std::sin(angle));
+  return pbr::makeCameraData(position, _options.target, _options.fov,
+                             static_cast<float>(_options.extent.width)
+                                 / static_cast<float>(_options.extent.height));
+}
+
+auto app::HeadlessApp::renderTile(std::uint32_t const frame, std::uint32_t const tile)
+    -> void {
+  auto& context = _frames.beginFrame();
+  // The fence of the slot was waited on, so its readback holds a whole tile.
+  encodePendingFrame(context.index);
+
+  if (auto* const camera = _scene.getActiveCamera(); camera != nullptr) {
+    camera->set(_tiles.getTileCameraData(getCameraData(frame), tile));
+  }
+  _scene.updateWorldTransforms();
+
+  // Only waits once the encoders fall behind by every slot.
+  auto const slot = _readbacks.acquire();
+  context.cmdBuffer->begin(vk::CommandBufferBeginInfo {
+      .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+  recordCommands(context.cmdBuffer.get(), context.index, slot);
+  context.cmdBuffer->end();
+
+  _frames.submit(context);
+  _pendingFrames[context.index] =
+      PendingFrame {.frame = frame, .tile = tile, .slot = slot};
+}
+
+auto app::HeadlessApp::recordCommands(vk::CommandBuffer cmdBuffer,
+                                      std::uint32_t frameIndex,
+                                      std::optional<std::uint32_t> const readbackSlot)
+    -> void {
+  _gpuProfiler.beginFrame(cmdBuffer, frameIndex);
+
+  // Render the scene
+  app::addAliasingPass(_renderGraph, _transientAllocator, SCENE_PASS);
+  _pbrSystem.render(_renderGraph, frameIndex, _scene, _gBuffer, _hdrImage.getImage(),
+                    _hdrImage.getExtent());
+  app::addAliasingPass(_renderGraph, _transientAllocator, TONEMAP_PASS);
+
+  if (_format == OutputFormat::Exr) {
+    if (readbackSlot.has_value()) {
+      _readbacks.addReadback(_renderGraph, *readbackSlot,
+                             _hdrImage.getImage().getImage(), _hdrImage.getExtent());
+    }
+  } else {
+    _hdrImage.updateOutputTexture(frameIndex, _target.getImage().getImage(),
+                                  _target.getImage().getImageView());
+    _tonemapper.run(_renderGraph, _hdrImage, frameIndex);
+    if (readbackSlot.has_value()) {
+      _readbacks.addReadback(_renderGraph, *readbackSlot, _target.getImage().getImage(),
+                             _target.getExtent());
+    }
+  }
+
+  _renderGraph.execute(cmdBuffer, &_gpuProfiler);
+}
+
+auto app::HeadlessApp::runBenchmark() -> void {
+  auto const toMilliseconds = [](std::chrono::nanoseconds const duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  };
+  if (_options.frameCount <= FRAMES_IN_FLIGHT) {
+    _logger->warn("Only frames after the first {} are timed on the gpu, pass -frames",
+                  FRAMES_IN_FLIGHT);
+  }
+  for (auto const gpuDriven : {false, true}) {
+    if (gpuDriven && !_pbrSystem.isGpuDrivenSupported()) {
+      _logger->warn("The gpu driven path is not supported by the device");
+      break;
+    }
+    _pbrSystem.setGpuDriven(gpuDriven);
+    // Every path has a profiler of its own, so their averages do not mix.
+    _frames.waitIdle();
+    _gpuProfiler = pbr::GpuProfiler(_gpu, FRAMES_IN_FLIGHT);
+
+    std::chrono::nanoseconds cpuTime {};
+    for (auto frame = 0u; frame < _options.frameCount; ++frame) {
+      cpuTime += renderBenchmarkFrame(frame);
+    }
+
+    // The gpu times average over the last frames, the ones still in flight are not timed.
+    auto const* const path = gpuDriven ? "gpu driven path" : "cpu loop";
+    _logger->info("The {} took {:.3f} ms on the cpu and {:.3f} ms on the gpu per frame",
+                  path, toMilliseconds(cpuTime / _options.frameCount),
+                  toMilliseconds(_gpuProfiler.getTimings().getFrame().average));
+    for (auto const& pass : _gpuProfiler.getTimings().getPasses()) {
+      _logger->info("GPU pass {} of the {} took {:.3f} ms on average", pass.name, path,
+                    toMilliseconds(pass.average));
+    }
+  }
+}
+
+auto app::HeadlessApp::renderBenchmarkFrame(std::uint32_t const frame)
+    -> std::chrono::nanoseconds {
+  auto& context = _frames.beginFrame();
+  if (auto* const camera = _scene.getActiveCamera(); camera != nullptr) {
+    camera->set(_tiles.getTileCameraData(getCameraData(frame), 0));
+  }
+  _scene.updateWorldTransforms();
+
+  auto const start = std::chrono::steady_clock::now();
+  context.cmdBuffer->begin(vk::CommandBufferBeginInfo {
+      .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+  recordCommands(context.cmdBuffer.get(), context.index, std::nullopt);
+  context.cmdBuffer->end();
+  auto const cpuTime = std::chrono::steady_clock::now() - start;
+
+  _frames.submit(context);
+  return cpuTime;
+}
+
+auto app::HeadlessApp::encodePendingFrame(std::uint32_t frameIndex) -> void {
+  auto const pending = std::exchange(_pendingFrames[frameIndex], std::nullopt);
+  if (!pending.has_value()) {
+    return;
+  }
+  ++_encodingFrames;
+  _encoders.submit([this, pending = *pending] {
+    if (isTiled()) {
+      copyTile(pending);
+    } else {
+      encodeFrame(pending);
+    }
+    // The encoders are destroyed first, so the app outlives the notification.
+    --_encodingFrames;
+    _encodingFrames.notify_all();
+  });
+}
+
+auto app::HeadlessApp::flushPendingFrames() -> void {
+  _frames.waitIdle();
+  for (auto index = 0u; index < FRAMES_IN_FLIGHT; ++index) {
+    encodePendingFrame(index);
+  }
+}
+
+auto app::HeadlessApp::waitForEncoders() -> void {
+  for (auto encoding = _encodingFrames.load(); encoding != 0;
+       encoding = _encodingFrames.load()) {
+    _encodingFrames.wait(encoding);
+  }
+}
+
+auto app::HeadlessApp::encodeFrame(PendingFrame pending) -> void {
+  auto const path = getOutputPath(pending.frame);
+  try {
+    std::vector<std::byte> encoded;
+    try {
+      auto const mapping = _readbacks.map(pending.slot);
+      std::span const pixels(static_cast<std::byte const*>(mapping.get()),
+                             _readbacks.getSlotSize());
+      auto const [width, height] = _options.extent;
+      encoded = _format == OutputFormat::Png ? pbr::encodePng(pixels, width, height)
+                                             : pbr::encodeExr(pixels, width, height);
+    } catch (...) {
+      _readbacks.release(pending.slot);
+      throw;
+    }
+    // Rendering can reuse the slot while the file is written.
+    _readbacks.release(pending.slot);
+
+    ::writeFile(path, encoded);
+    _logger->info("Wrote frame {} to {}", pending.frame, path.c_str());
+  } catch (std::exception const& error) {
+    _logger->error("Failed to write frame {} to {}: {}", pending.frame, path.c_str(),
+                   error.what());
+    ++_failedFrames;
+  }
+}
+
+auto app::HeadlessApp::copyTile(PendingFrame pending) -> void {
+  try {
+    auto const mapping = _readbacks.map(pending.slot);
+    _tiledWriter->writeTile(pending.tile,
+                            std::span(static_cast<std::byte const*>(mapping.get()),
+                                      _readbacks.getSlotSize()));
+  } catch (std::exception const& error) {
+    _logger->error("Failed to read back tile {} of frame {}: {}", pending.tile,
+                   pending.frame, error.what());
+    ++_failedFrames;
+    _tiledWriter->writeTile(pending.tile, {});
+  }
+  _readbacks.release(pending.slot);
+}
+
+auto app::HeadlessApp::finishTiledFrame(std::uint32_t const frame) -> void {
+  _tiledWriter->finish();
+  _tiledWriter.reset();
+  _logger->info("Wrote frame {} to {}", frame, getOutputPath(frame).c_str());
+}
+
+auto app::HeadlessApp::getOutputPath(std::uint32_t frame) const
+    -> std::filesystem::path {
+  if (_options.frameCount == 1) {
+    return _options.output;
+  }
+  auto path = _options.output;
+  path.replace_filename(std::format("{}_{:04}{}", _options.output.stem().c_str(), frame,
+                                    _options.output.extension().c_str()));
+  return path;
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/core/GpuHandle.hpp"
+
+#include "pbr/CameraData.hpp"
+#include "pbr/FrameRing.hpp"
+#include "pbr/GBuffer.hpp"
+#include "pbr/GpuProfiler.hpp"
+#include "pbr/HdrImage.hpp"
+#include "pbr/OffscreenTarget.hpp"
+#include "pbr/PbrPipeline.hpp"
+#include "pbr/PbrRenderSystem.hpp"
+#include "pbr/ReadbackRing.hpp"
+#include "pbr/RenderGraph.hpp"
+#include "pbr/Scene.hpp"
+#include "pbr/ThreadPool.hpp"
+#include "pbr/TileGrid.hpp"
+#include "pbr/TonemapperSystem.hpp"
+#include "pbr/memory/IAllocator.hpp"
+#include "pbr/memory/TransientAllocator.hpp"
+
+#include "OutputFormat.hpp"
+#include "TiledImageWriter.hpp"
+
+#include <glm/ext/scalar_constants.hpp>
+#include <glm/ext/vector_float3.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+
+#include <spdlog/logger.h>
+
+namespace app {
+/**
+ * What the headless app renders and where it writes it.
+ */
+struct HeadlessOptions {
+  std::filesystem::path path;
+  /// The extension selects the format, frames are numbered if there is more than one.
+  std::filesystem::path output = "render.png";
+  vk::Extent2D extent {.width = 1280, .height = 720};
+  glm::vec3 position {0.0f, 0.0f, 3.0f};
+  glm::vec3 target {};
+  /// The vertical fov in radians.
+  float fov = glm::half_pi<float>();
+  /// The camera orbits the target once over the frames, for turntables.
+  std::uint32_t frameCount = 1;
+  /// Larger images are rendered in tiles and streamed to their file a row of tiles at
+  /// a time, the device limit caps it.
+  std::uint32_t tileSize = 4096;
+  /// Adds a grid of this many instances of the meshes of the scene and times the frames
+  /// of the cpu loop and of the gpu driven path instead of writing images.
+  std::uint32_t benchmarkInstances = 0;
+  bool vkValidation = false;
+};
+/**
+ * Renders a gltf file into images without a window, on devices that cannot present.
+ */
+class HeadlessApp {
+  /// A rendered tile whose readback has not been encoded yet.
+  struct PendingFrame {
+    std::uint32_t frame;
+    std::uint32_t tile;
+    std::uint32_t slot;
+  };
+
+  std::shared_ptr<spdlog::logger> _logger;
+  HeadlessOptions _options;
+  OutputFormat _format;
+
+  pbr::core::SharedGpuHandle _gpu;
+  std::shared_ptr<pbr::IAllocator> _allocator;
+  std::shared_ptr<pbr::ThreadPool> _threadPool;
+
+  vk::UniqueCommandPool _commandPool;
+  vk::UniqueDescriptorPool _descPool;
+
+  pbr::PbrPipeline _pbrPipeline;
+  pbr::PbrRenderSystem _pbrSystem;
+  pbr::TonemapperSystem _tonemapper;
+
+  std::pmr::synchronized_pool_resource _sceneMemory;
+  pbr::Scene _scene;
+
+  // Frame data
+  /// The render targets have the extent of a tile.
+  pbr::TileGrid _tiles;
+  pbr::TransientAllocator _transientAllocator;
+  pbr::GBuffer _gBuffer;
+  pbr::HdrImage _hdrImage;
+  pbr::OffscreenTarget _target;
+  pbr::FrameRing _frames;
+  pbr::RenderGraph _renderGraph;
+  pbr::GpuProfiler _gpuProfiler;
+  pbr::ReadbackRing _readbacks;
+  /// The frame every frame slot copied out, encoded once the gpu is done with the slot.
+  std::vector<std::optional<PendingFrame>> _pendingFrames;
+  std::atomic<std::uint32_t> _failedFrames = 0;
+  /// Queued frames and tiles whose encoding, or file write, has not finished yet.
+  std::atomic<std::uint32_t> _encodingFrames = 0;
+  /// Assembles the tiles of the frame being rendered, if it has more than one.
+  std::unique_ptr<TiledImageWriter> _tiledWriter;
+  /// Encodes frames apart from the pool the render system records with, so encoding
+  /// never delays the recording of a frame. Destroyed first since tasks use the ring.
+  pbr::ThreadPool _encoders;
+
+public:
+  explicit HeadlessApp(HeadlessOptions options);
+
+  HeadlessApp(const HeadlessApp&) = delete;
+  auto operator=(const HeadlessApp&) -> HeadlessApp& = delete;
+  HeadlessApp(HeadlessApp&&) = delete;
+  auto operator=(HeadlessApp&&) -> HeadlessApp& = delete;
+
+  ~HeadlessApp() noexcept;
+
+  /**
+   * Renders every frame, frames and tiles are read back and encoded while the next ones
+   * render. Benchmarks only time the frames.
+   * @throws std::runtime_error If a frame could not be written.
+   */
+  auto run() -> void;
+
+private:
+  [[nodiscard]]
+  auto isTiled() const noexcept -> bool;
+  [[nodiscard]]
+  auto getCameraData(std::uint32_t frame) const noexcept -> pbr::CameraData;
+  auto renderTile(std::uint32_t frame, std::uint32_t tile) -> void;
+  /**
+   * @param readbackSlot Optional, the slot the image is copied to.
+   */
+  auto recordCommands(vk::CommandBuffer cmdBuffer, std::uint32_t frameIndex,
+                      std::optional<std::uint32_t> readbackSlot) -> void;
+  /**
+   * Renders every frame with the cpu loop and then with the gpu driven path, and logs
+   * their average cpu and gpu times.
+   */
+  auto runBenchmark() -> void;
+  /**
+   * Renders the first tile of the frame without reading it back.
+   * @returns The cpu time of recording the frame.
+   */
+  auto renderBenchmarkFrame(std::uint32_t frame) -> std::chrono::nanoseconds;
+  /**
+   * Queues the encoding of the frame the frame slot copied out, if any.
+   * @note The gpu must have finished the frame slot.
+   */
+  auto encodePendingFrame(std::uint32_t frameIndex) -> void;
+  /**
+   * Waits for every frame slot and queues what they copied out.
+   */
+  auto flushPendingFrames() -> void;
+  /**
+   * Blocks until every queued frame is encoded and written, or has failed.
+   */
+  auto waitForEncoders() -> void;
+  /**
+   * Runs on the encoders, the readback slot is released before the file is written.
+   */
+  auto encodeFrame(PendingFrame pending) -> void;
+  /**
+   * Runs on the encoders, copies the tile into the tiled writer.
+   */
+  auto copyTile(PendingFrame pending) -> void;
+  /**
+   * Waits until every row of the frame is written.
+   * @note Every tile of the frame must have been copied or be queued for it.
+   */
+  auto finishTiledFrame(std::uint32_t frame) -> void;
+  [[nodiscard]]
+  auto getOutputPath(std::uint32_t frame) const -> std::filesystem::path;
+};
+} // namespace app
@@ -1,21 +1,102 @@
 #include "App.hpp"
+#include "HeadlessApp.hpp"
 #include "vkfw/vkfw.hpp"
 
+#include <glm/ext/vector_float3.hpp>
+
 #include <algorithm>
+#include <charconv>
+#include <cstdint>
 #include <filesystem>
+#include <format>
 #include <iterator>
 #include <print>
 #include <span>
+#include <stdexcept>
 #include <string_view>
+#include <system_error>
 
 namespace {
 using ArgvType = char const* const*;
+
+template <typename T>
+[[nodiscard]]
+auto parseNumber(std::string_view text) -> T {
+  T value {};
+  auto const* const last = text.data() + text.size();
+  auto const [end, error] = std::from_chars(text.data(), last, value);
+  if (error != std::errc() || end != last) {
+    throw std::runtime_error(std::format("Invalid number: {}", text));
+  }
+  return value;
+}
+/**
+ * Parses comma separated components like 1,2.5,-3.
+ */
+[[nodiscard]]
+auto parseVec3(std::string_view text) -> glm::vec3 {
+  glm::vec3 value {};
+  for (auto i = 0; i < 3; ++i) {
+    auto const comma = i < 2 ? text.find(',') : text.size();
+    if (comma == std::string_view::npos) {
+      throw std::runtime_error(std::format("Invalid vector: {}", text));
+    }
+    value[i] = ::parseNumber<float>(text.substr(0, comma));
+    text.remove_prefix(std::min(comma + 1, text.size()));
+  }
+  return value;
+}
+/**
+ * -headless <gltf> [-output <png or exr>] [-width <w>] [-height <h>] [-position x,y,z]
+ * [-target x,y,z] [-fov <radians>] [-frames <n>] [-tile-size <pixels>]
+ * [-benchmark <instances>] [-vulkan-validation]
+ */
+[[nodiscard]]
+auto parseHeadlessOptions(std::span<char const* const> args) -> app::HeadlessOptions {
+  app::HeadlessOptions options {.path = args.front()};
+  for (auto arg = std::next(args.begin()); arg != args.end(); ++arg) {
+    std::string_view const name = *arg;
+    if (name == "-vulkan-validation") {
+      options.vkValidation = true;
+      continue;
+    }
+    if (std::next(arg) == args.end()) {
+      throw std::runtime_error(std::format("Missing value for {}", name));
+    }
+    std::string_view const value = *++arg;
+    if (name == "-output") {
+      options.output = value;
+    } else if (name == "-width") {
+      options.extent.width = ::parseNumber<std::uint32_t>(value);
+    } else if (name == "-height") {
+      options.extent.height = ::parseNumber<std::uint32_t>(value);
+    } else if (name == "-position") {
+      options.position = ::parseVec3(value);
+    } else if (name == "-target") {
+      options.target = ::parseVec3(value);
+    } else if (name == "-fov") {
+      options.fov = ::parseNumber<float>(value);
+    } else if (name == "-frames") {
+      options.frameCount = std::max(::parseNumber<std::uint32_t>(value), 1u);
+    } else if (name == "-tile-size") {
+      options.tileSize = std::max(::parseNumber<std::uint32_t>(value), 1u);
+    } else if (name == "-benchmark") {
+      options.benchmarkInstances = ::parseNumber<std::uint32_t>(value);
+    } else {
+      throw std::runtime_error(std::format("Unknown option: {}", name));
+    }
+  }
+  return options;
 }
+} // namespace
 
 auto main(int const argc, ArgvType const argv) -> int {
   std::span const args(std::next(argv), argc - 1);
 
-  if (!args.empty()) {
+  if (args.size() > 1 && std::string_view(args.front()) == "-headless") {
+    // Rendering offscreen needs neither a window nor a display.
+    app::HeadlessApp(::parseHeadlessOptions(args.subspan(1))).run();
+  } else if (!args.empty()) {
     vkfw::init({
         .platform = vkfw::Platform::eX11,
     });
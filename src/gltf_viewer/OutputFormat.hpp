@@ -0,0 +1,26 @@
+#pragma once
+
+#include "pbr/OffscreenTarget.hpp"
+
+#include <cstdint>
+
+namespace app {
+enum struct OutputFormat : std::uint8_t {
+  /// The tonemapped image.
+  Png,
+  /// The HDR image before it is tonemapped.
+  Exr,
+};
+/**
+ * @returns The bytes of a pixel read back for the format.
+ */
+[[nodiscard]]
+constexpr auto getPixelSize(OutputFormat format) noexcept -> std::uint32_t;
+} // namespace app
+
+/* IMPLEMENTATIONS */
+
+constexpr auto app::getPixelSize(OutputFormat const format) noexcept -> std::uint32_t {
+  // The HDR image holds 4 half floats.
+  return format == OutputFormat::Png ? pbr::OffscreenTarget::BYTES_PER_PIXEL : 8;
+}
@@ -0,0 +1,284 @@
+#include "Setup.hpp"
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/core/GpuHandle.hpp"
+
+#include "pbr/GBuffer.hpp"
+#include "pbr/HdrImage.hpp"
+#include "pbr/PbrPipeline.hpp"
+#include "pbr/PbrRenderSystem.hpp"
+#include "pbr/RenderGraph.hpp"
+#include "pbr/Scene.hpp"
+#include "pbr/ThreadPool.hpp"
+#include "pbr/TonemapperSystem.hpp"
+#include "pbr/TransferStager.hpp"
+#include "pbr/gltf/Asset.hpp"
+#include "pbr/gltf/Loader.hpp"
+#include "pbr/memory/IAllocator.hpp"
+#include "pbr/memory/TransientAllocator.hpp"
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <ios>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace constants {
+constexpr static auto COMPACT_G_BUFFER =
+    app::G_BUFFER_LAYOUT == pbr::GBufferLayout::Compact;
+} // namespace constants
+
+namespace {
+[[nodiscard]]
+auto loadBinary(std::filesystem::path const& path) -> std::vector<std::uint32_t> {
+  std::ifstream file(path, std::ios::in | std::ios::binary);
+  auto const size = std::filesystem::file_size(path);
+  std::vector<std::uint32_t> binary(size / 4);
+
+  // NOLINTNEXTLINE casting to char* is not UB
+  file.read(reinterpret_cast<char*>(binary.data()), static_cast<std::streamsize>(size));
+
+  return binary;
+}
+} // namespace
+
+auto app::validatePath(std::filesystem::path path) -> std::filesystem::path {
+  if (!std::filesystem::exists(path)) {
+    throw std::runtime_error(std::format("No such file: {}", path.c_str()));
+  }
+  if (!std::filesystem::is_regular_file(path)) {
+    throw std::runtime_error(std::format("{} is not a regular file", path.c_str()));
+  }
+  return path;
+}
+
+auto app::loadShader(pbr::core::GpuHandle const& gpu, std::string_view name)
+    -> vk::UniqueShaderModule {
+  auto const spv = ::loadBinary(std::filesystem::path("assets/shaders/compiled") / name);
+  return gpu.getDevice().createShaderModuleUnique(
+      vk::ShaderModuleCreateInfo {}.setCode(spv));
+}
+
+auto app::loadShaders(pbr::core::GpuHandle const& gpu, ShaderNames names)
+    -> std::pair<vk::UniqueShaderModule, vk::UniqueShaderModule> {
+  return std::make_pair(loadShader(gpu, names.vertexName),
+                        loadShader(gpu, names.fragmentName));
+}
+
+auto app::createSceneDescriptorPool(pbr::core::GpuHandle const& gpu)
+    -> vk::UniqueDescriptorPool {
+  std::array const sizes {
+      vk::DescriptorPoolSize {
+          .type = vk::DescriptorType::eUniformBuffer,
+          .descriptorCount = 6 * FRAMES_IN_FLIGHT,
+      },
+      vk::DescriptorPoolSize {
+          .type = vk::DescriptorType::eSampledImage,
+          .descriptorCount = 5,
+      },
+  };
+  // Cameras allocate a set for every frame in flight.
+  return gpu.getDevice().createDescriptorPoolUnique(vk::DescriptorPoolCreateInfo {
+      .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+      .maxSets = 6 * FRAMES_IN_FLIGHT,
+  }
+                                                        .setPoolSizes(sizes));
+}
+
+auto app::createPbrPipeline(pbr::core::GpuHandle const& gpu, vk::Format outputFormat)
+    -> pbr::PbrPipeline {
+  auto const [vertexModule, fragmentModule] = loadShaders(
+      gpu, {.vertexName = "pbr_vertex.spv", .fragmentName = "pbr_fragment.spv"});
+  return {
+      gpu,
+      pbr::PbrPipelineCreateInfo {
+          .vertexStage {
+              .stage = vk::ShaderStageFlagBits::eVertex,
+              .module = vertexModule.get(),
+              .pName = "main",
+          },
+          .fragmentStage {
+              .stage = vk::ShaderStageFlagBits::eFragment,
+              .module = fragmentModule.get(),
+              .pName = "main",
+          },
+          .outputFormat = outputFormat,
+      },
+      FRAMES_IN_FLIGHT,
+  };
+}
+
+auto app::createPbrRenderSystem(pbr::core::SharedGpuHandle gpu,
+                                std::shared_ptr<pbr::IAllocator> allocator,
+                                std::shared_ptr<pbr::ThreadPool> threadPool)
+    -> pbr::PbrRenderSystem {
+  auto const [geometryVertex, geometryFragment] = loadShaders(
+      *gpu, {.vertexName = "geometry_pass_vertex.spv",
+             .fragmentName = constants::COMPACT_G_BUFFER
+                                 ? "geometry_pass_fragment_compact.spv"
+                                 : "geometry_pass_fragment.spv"});
+  auto const [lightingVertex, lightingFragment] = loadShaders(
+      *gpu, {.vertexName = "fullscreen_quad.spv",
+             .fragmentName = constants::COMPACT_G_BUFFER ? "pbr_lighting_compact.spv"
+                                                         : "pbr_lighting.spv"});
+  auto const geometryIndirectVertex =
+      loadShader(*gpu, "geometry_pass_vertex_indirect.spv");
+  auto const frustumCull = loadShader(*gpu, "frustum_cull.spv");
+  auto const depthPrepassVertex = loadShader(*gpu, "geometry_pass_vertex_depth.spv");
+  auto const depthPrepassIndirectVertex =
+      loadShader(*gpu, "geometry_pass_vertex_indirect_depth.spv");
+  auto const depthPyramid = loadShader(*gpu, "depth_pyramid.spv");
+  auto const occlusionCull = loadShader(*gpu, "occlusion_cull.spv");
+  auto const geometryBindlessFragment =
+      loadShader(*gpu, constants::COMPACT_G_BUFFER
+                           ? "geometry_pass_fragment_bindless_compact.spv"
+                           : "geometry_pass_fragment_bindless.spv");
+  auto const tiledLighting =
+      loadShader(*gpu, constants::COMPACT_G_BUFFER ? "pbr_tiled_lighting_compact.spv"
+                                                   : "pbr_tiled_lighting.spv");
+  return {
+      std::move(gpu),
+      std::move(allocator),
+      pbr::PbrRenderSystemCreateInfo {
+          .geometryVertexShader {
+              .stage = vk::ShaderStageFlagBits::eVertex,
+              .module = geometryVertex.get(),
+              .pName = "main",
+          },
+          .geometryFragmentShader {
+              .stage = vk::ShaderStageFlagBits::eFragment,
+              .module = geometryFragment.get(),
+              .pName = "main",
+          },
+          .lightingVertexShader {
+              .stage = vk::ShaderStageFlagBits::eVertex,
+              .module = lightingVertex.get(),
+              .pName = "main",
+          },
+          .lightingFragmentShader {
+              .stage = vk::ShaderStageFlagBits::eFragment,
+              .module = lightingFragment.get(),
+              .pName = "main",
+          },
+          .geometryIndirectVertexShader {
+              .stage = vk::ShaderStageFlagBits::eVertex,
+              .module = geometryIndirectVertex.get(),
+              .pName = "main",
+          },
+          .cullingComputeShader {
+              .stage = vk::ShaderStageFlagBits::eCompute,
+              .module = frustumCull.get(),
+              .pName = "main",
+          },
+          .geometryBindlessFragmentShader {
+              .stage = vk::ShaderStageFlagBits::eFragment,
+              .module = geometryBindlessFragment.get(),
+              .pName = "main",
+          },
+          .tiledLightingComputeShader {
+              .stage = vk::ShaderStageFlagBits::eCompute,
+              .module = tiledLighting.get(),
+              .pName = "main",
+          },
+          .depthPrepassVertexShader {
+              .stage = vk::ShaderStageFlagBits::eVertex,
+              .module = depthPrepassVertex.get(),
+              .pName = "main",
+          },
+          .depthPrepassIndirectVertexShader {
+              .stage = vk::ShaderStageFlagBits::eVertex,
+              .module = depthPrepassIndirectVertex.get(),
+              .pName = "main",
+          },
+          .depthPyramidComputeShader {
+              .stage = vk::ShaderStageFlagBits::eCompute,
+              .module = depthPyramid.get(),
+              .pName = "main",
+          },
+          .occlusionCullingComputeShader {
+              .stage = vk::ShaderStageFlagBits::eCompute,
+              .module = occlusionCull.get(),
+              .pName = "main",
+          },
+          .framesInFlight = FRAMES_IN_FLIGHT,
+          .gBufferLayout = G_BUFFER_LAYOUT,
+      },
+      std::move(threadPool),
+  };
+}
+
+auto app::loadScene(std::filesystem::path const& path,
+                    pbr::gltf::AssetDependencies dependencies, vk::CommandPool cmdPool,
+                    std::pmr::polymorphic_allocator<> alloc) -> pbr::Scene {
+  pbr::TransferStager stager(dependencies.gpu, dependencies.allocator);
+
+  pbr::gltf::Loader loader;
+  auto asset = loader.loadAsset(path, std::move(dependencies));
+
+  auto scene = asset.loadScene(stager, 0, alloc);
+
+  stager.submit(cmdPool);
+  stager.wait();
+
+  return scene;
+}
+
+auto app::createTonemapper(pbr::core::SharedGpuHandle gpu) -> pbr::TonemapperSystem {
+  auto const shader = loadShader(*gpu, "tm_aces+gamma.spv");
+  return {
+      std::move(gpu),
+      vk::PipelineShaderStageCreateInfo {
+          .stage = vk::ShaderStageFlagBits::eCompute,
+          .module = shader.get(),
+          .pName = "main",
+      },
+      FRAMES_IN_FLIGHT,
+  };
+}
+
+auto app::reserveFrameImages(pbr::TransientAllocator& allocator,
+                             vk::Extent2D const extent,
+                             pbr::GBufferLayout const layout) -> void {
+  allocator.clear();
+  for (auto const& info : pbr::GBuffer::getImageInfos(extent, layout)) {
+    allocator.reserveImage(info, {
+                                     .firstPass = SCENE_PASS,
+                                     .lastPass = SCENE_PASS,
+                                 });
+  }
+  allocator.reserveImage(pbr::HdrImage::getImageInfo(extent),
+                         {
+                             .firstPass = SCENE_PASS,
+                             .lastPass = TONEMAP_PASS,
+                         });
+  allocator.allocate();
+}
+
+auto app::createTransientAllocator(pbr::core::SharedGpuHandle gpu,
+                                   std::shared_ptr<pbr::IAllocator> allocator,
+                                   vk::Extent2D const extent,
+                                   pbr::GBufferLayout const layout)
+    -> pbr::TransientAllocator {
+  pbr::TransientAllocator transientAllocator(std::move(gpu), std::move(allocator));
+  reserveFrameImages(transientAllocator, extent, layout);
+  return transientAllocator;
+}
+auto app::addAliasingPass(pbr::RenderGraph& graph,
+                          pbr::TransientAllocator const& allocator,
+                          std::uint32_t const pass) -> void {
+  // The aliased images are not tracked by the graph, so the pass is always kept.
+  graph
+      .addPass(std::format("aliasing {}", pass),
+               [&allocator, pass](vk::CommandBuffer const cmdBuffer) {
+                 allocator.recordAliasingBarriers(cmdBuffer, pass);
+               })
+      .setSideEffects();
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/core/GpuHandle.hpp"
+
+#include "pbr/GBuffer.hpp"
+#include "pbr/PbrPipeline.hpp"
+#include "pbr/PbrRenderSystem.hpp"
+#include "pbr/RenderGraph.hpp"
+#include "pbr/Scene.hpp"
+#include "pbr/ThreadPool.hpp"
+#include "pbr/TonemapperSystem.hpp"
+#include "pbr/gltf/Asset.hpp"
+#include "pbr/memory/IAllocator.hpp"
+#include "pbr/memory/TransientAllocator.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <utility>
+
+/**
+ * Creates what the windowed and the headless app share to render a scene.
+ */
+namespace app {
+/// The cpu records a frame while the gpu executes the previous one.
+inline constexpr std::uint32_t FRAMES_IN_FLIGHT = 2;
+/// Writes less than half the bytes of the wide layout in the geometry pass.
+inline constexpr auto G_BUFFER_LAYOUT = pbr::GBufferLayout::Compact;
+/// The passes of a frame the frame images live through.
+inline constexpr std::uint32_t SCENE_PASS = 0;
+inline constexpr std::uint32_t TONEMAP_PASS = 1;
+
+struct ShaderNames {
+  std::string_view vertexName {};
+  std::string_view fragmentName {};
+};
+
+/**
+ * @throws std::runtime_error If the path is not a regular file.
+ */
+[[nodiscard]]
+auto validatePath(std::filesystem::path path) -> std::filesystem::path;
+[[nodiscard]]
+auto loadShader(pbr::core::GpuHandle const& gpu, std::string_view name)
+    -> vk::UniqueShaderModule;
+[[nodiscard]]
+auto loadShaders(pbr::core::GpuHandle const& gpu, ShaderNames names)
+    -> std::pair<vk::UniqueShaderModule, vk::UniqueShaderModule>;
+/**
+ * @returns A pool for the cameras and the materials of a scene.
+ */
+[[nodiscard]]
+auto createSceneDescriptorPool(pbr::core::GpuHandle const& gpu)
+    -> vk::UniqueDescriptorPool;
+[[nodiscard]]
+auto createPbrPipeline(pbr::core::GpuHandle const& gpu, vk::Format outputFormat)
+    -> pbr::PbrPipeline;
+[[nodiscard]]
+auto createPbrRenderSystem(pbr::core::SharedGpuHandle gpu,
+                           std::shared_ptr<pbr::IAllocator> allocator,
+                           std::shared_ptr<pbr::ThreadPool> threadPool)
+    -> pbr::PbrRenderSystem;
+[[nodiscard]]
+auto createTonemapper(pbr::core::SharedGpuHandle gpu) -> pbr::TonemapperSystem;
+/**
+ * Loads the first scene of the gltf file and waits for its upload.
+ */
+[[nodiscard]]
+auto loadScene(std::filesystem::path const& path,
+               pbr::gltf::AssetDependencies dependencies, vk::CommandPool cmdPool,
+               std::pmr::polymorphic_allocator<> alloc) -> pbr::Scene;
+/**
+ * Places the images of a frame in the memory of the transient allocator, the G-buffer is
+ * only used by the scene pass while the HDR image lives until it is tonemapped.
+ */
+auto reserveFrameImages(pbr::TransientAllocator& allocator, vk::Extent2D extent,
+                        pbr::GBufferLayout layout) -> void;
+[[nodiscard]]
+auto createTransientAllocator(pbr::core::SharedGpuHandle gpu,
+                              std::shared_ptr<pbr::IAllocator> allocator,
+                              vk::Extent2D extent, pbr::GBufferLayout layout)
+    -> pbr::TransientAllocator;
+/**
+ * Adds a pass making the frame images whose lifetime starts at the pass wait for the
+ * images they alias.
+ */
+auto addAliasingPass(pbr::RenderGraph& graph, pbr::TransientAllocator const& allocator,
+                     std::uint32_t pass) -> void;
+} // namespace app
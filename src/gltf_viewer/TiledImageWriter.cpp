@@ -0,0 +1,137 @@
+#include "TiledImageWriter.hpp"
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/ImageEncoder.hpp"
+#include "pbr/ThreadPool.hpp"
+#include "pbr/TileGrid.hpp"
+
+#include "OutputFormat.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <future>
+#include <ios>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace {
+[[nodiscard]]
+auto createEncoder(vk::Extent2D const extent, app::OutputFormat const format)
+    -> std::variant<pbr::PngEncoder, pbr::ExrEncoder> {
+  if (format == app::OutputFormat::Png) {
+    return pbr::PngEncoder(extent.width, extent.height);
+  }
+  return pbr::ExrEncoder(extent.width, extent.height);
+}
+auto writeBytes(std::ofstream& file, std::span<std::byte const> bytes) -> void {
+  // NOLINTNEXTLINE casting to char* is not UB
+  file.write(reinterpret_cast<char const*>(bytes.data()),
+             static_cast<std::streamsize>(bytes.size()));
+  if (!file) {
+    throw std::runtime_error("Failed to write the image");
+  }
+}
+} // namespace
+
+app::TiledImageWriter::TiledImageWriter(std::filesystem::path const& path,
+                                        pbr::TileGrid const grid,
+                                        OutputFormat const format)
+    : _grid(grid)
+    , _pixelSize(app::getPixelSize(format))
+    , _file(path, std::ios::out | std::ios::binary)
+    , _encoder(::createEncoder(grid.getImageExtent(), format))
+    , _writer(1) {
+  if (!_file) {
+    throw std::runtime_error(std::format("Failed to open {}", path.c_str()));
+  }
+  std::visit([this](auto const& encoder) { ::writeBytes(_file, encoder.begin()); },
+             _encoder);
+  for (auto& strip : _strips) {
+    strip.pixels.resize(static_cast<std::size_t>(_grid.getImageExtent().width)
+                        * _grid.getTileExtent().height * _pixelSize);
+  }
+}
+
+app::TiledImageWriter::~TiledImageWriter() noexcept {
+  {
+    std::scoped_lock const lock(_mutex);
+    _abandoned = true;
+  }
+  _tileCopied.notify_all();
+}
+
+auto app::TiledImageWriter::beginRow(std::uint32_t const row) -> void {
+  auto& strip = _strips[row % _strips.size()];
+  if (strip.written.valid()) {
+    strip.written.get();
+  }
+  {
+    std::scoped_lock const lock(_mutex);
+    strip.missingTiles = _grid.getColumns();
+  }
+  std::packaged_task<void()> task([this, row] { writeRow(row); });
+  strip.written = task.get_future();
+  _writer.submit(std::move(task));
+}
+
+auto app::TiledImageWriter::writeTile(std::uint32_t const tile,
+                                      std::span<std::byte const> const pixels) -> void {
+  auto const row = tile / _grid.getColumns();
+  auto& strip = _strips[row % _strips.size()];
+  if (!pixels.empty()) {
+    auto const rect = _grid.getTile(tile);
+    auto const imageWidth = static_cast<std::size_t>(_grid.getImageExtent().width);
+    auto const tileRowSize =
+        static_cast<std::size_t>(_grid.getTileExtent().width) * _pixelSize;
+    auto const copySize = static_cast<std::size_t>(rect.extent.width) * _pixelSize;
+    for (auto y = 0uz; y < rect.extent.height; ++y) {
+      auto const destination =
+          (y * imageWidth + static_cast<std::size_t>(rect.offset.x)) * _pixelSize;
+      std::memcpy(strip.pixels.data() + destination, pixels.data() + y * tileRowSize,
+                  copySize);
+    }
+  }
+  // Notifies under the lock, the writer may be destroyed as soon as the last row is.
+  std::scoped_lock const lock(_mutex);
+  assert(strip.missingTiles > 0);
+  --strip.missingTiles;
+  _tileCopied.notify_all();
+}
+
+auto app::TiledImageWriter::finish() -> void {
+  for (auto& strip : _strips) {
+    if (strip.written.valid()) {
+      strip.written.get();
+    }
+  }
+}
+
+auto app::TiledImageWriter::writeRow(std::uint32_t const row) -> void {
+  auto& strip = _strips[row % _strips.size()];
+  {
+    std::unique_lock lock(_mutex);
+    _tileCopied.wait(lock,
+                     [this, &strip] { return strip.missingTiles == 0 || _abandoned; });
+    if (_abandoned) {
+      return;
+    }
+  }
+  // The last row of tiles may reach past the image.
+  auto const height = _grid.getTile(row * _grid.getColumns()).extent.height;
+  auto const pixels = std::span<std::byte const>(strip.pixels)
+                          .first(static_cast<std::size_t>(_grid.getImageExtent().width)
+                                 * height * _pixelSize);
+  std::visit(
+      [this, pixels](auto& encoder) { ::writeBytes(_file, encoder.encodeRows(pixels)); },
+      _encoder);
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "pbr/ImageEncoder.hpp"
+#include "pbr/ThreadPool.hpp"
+#include "pbr/TileGrid.hpp"
+
+#include "OutputFormat.hpp"
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <span>
+#include <variant>
+#include <vector>
+
+namespace app {
+/**
+ * Streams an image rendered in tiles to its file a row of tiles at a time.
+ *
+ * The tiles of a row are copied into a strip as their readbacks arrive, once every tile
+ * of the row is there a writer thread encodes the strip and appends it to the file. Two
+ * strips alternate so a row renders while the previous one is written, which bounds the
+ * memory by the width of the image instead of its area.
+ */
+class TiledImageWriter {
+  struct Strip {
+    std::vector<std::byte> pixels;
+    std::uint32_t missingTiles = 0;
+    std::future<void> written;
+  };
+
+  pbr::TileGrid _grid;
+  std::uint32_t _pixelSize;
+  std::ofstream _file;
+  std::variant<pbr::PngEncoder, pbr::ExrEncoder> _encoder;
+
+  std::mutex _mutex;
+  std::condition_variable _tileCopied;
+  std::array<Strip, 2> _strips;
+  /// Lets the writer give up on rows whose tiles will never arrive.
+  bool _abandoned = false;
+  /// Writes the strips in the order of their rows, destroyed first.
+  pbr::ThreadPool _writer;
+
+public:
+  /**
+   * @throws std::runtime_error If the file can not be opened.
+   */
+  TiledImageWriter(std::filesystem::path const& path, pbr::TileGrid grid,
+                   OutputFormat format);
+
+  TiledImageWriter(const TiledImageWriter&) = delete;
+  auto operator=(const TiledImageWriter&) -> TiledImageWriter& = delete;
+  TiledImageWriter(TiledImageWriter&&) = delete;
+  auto operator=(TiledImageWriter&&) -> TiledImageWriter& = delete;
+
+  ~TiledImageWriter() noexcept;
+
+  /**
+   * Queues the writing of the row, it blocks until the strip it reuses is written.
+   * @note Every tile of the row that used the strip before must have been written.
+   * @throws std::runtime_error If writing an earlier row failed.
+   */
+  auto beginRow(std::uint32_t row) -> void;
+  /**
+   * Copies the pixels of a tile into the strip of its row, safe to call from any thread.
+   * @param pixels The tightly packed pixels of the tile extent, empty for a tile that
+   * failed, which then only counts as arrived.
+   */
+  auto writeTile(std::uint32_t tile, std::span<std::byte const> pixels) -> void;
+  /**
+   * Waits until every row is written.
+   * @throws std::runtime_error If writing a row failed.
+   */
+  auto finish() -> void;
+
+private:
+  auto writeRow(std::uint32_t row) -> void;
+};
+} // namespace app
@@ -1,10 +1,85 @@
 #include "ui/PerformanceOverlay.hpp"
 
+#include "pbr/FrameRing.hpp"
+#include "pbr/GBuffer.hpp"
+#include "pbr/GpuProfiler.hpp"
+#include "pbr/PbrRenderSystem.hpp"
+#include "pbr/RenderGraph.hpp"
+#include "pbr/Scene.hpp"
+#include "pbr/memory/TransientAllocator.hpp"
+
 #include "imgui.h"
 
 #include <chrono>
 #include <limits>
 
+auto app::ui::PerformanceOverlay::getScene() const noexcept -> pbr::Scene const* {
+  return _scene;
+}
+
+auto app::ui::PerformanceOverlay::setScene(pbr::Scene const* scene) noexcept -> void {
+  _scene = scene;
+}
+
+auto app::ui::PerformanceOverlay::getRenderSystem() const noexcept
+    -> pbr::PbrRenderSystem* {
+  return _renderSystem;
+}
+
+auto app::ui::PerformanceOverlay::setRenderSystem(
+    pbr::PbrRenderSystem* renderSystem) noexcept -> void {
+  _renderSystem = renderSystem;
+}
+
+auto app::ui::PerformanceOverlay::getFrameRing() const noexcept
+    -> pbr::FrameRing const* {
+  return _frameRing;
+}
+
+auto app::ui::PerformanceOverlay::setFrameRing(pbr::FrameRing const* frameRing) noexcept
+    -> void {
+  _frameRing = frameRing;
+}
+
+auto app::ui::PerformanceOverlay::getGBuffer() const noexcept -> pbr::GBuffer const* {
+  return _gBuffer;
+}
+
+auto app::ui::PerformanceOverlay::setGBuffer(pbr::GBuffer const* gBuffer) noexcept
+    -> void {
+  _gBuffer = gBuffer;
+}
+
+auto app::ui::PerformanceOverlay::getTransientAllocator() const noexcept
+    -> pbr::TransientAllocator const* {
+  return _transientAllocator;
+}
+
+auto app::ui::PerformanceOverlay::setTransientAllocator(
+    pbr::TransientAllocator const* transientAllocator) noexcept -> void {
+  _transientAllocator = transientAllocator;
+}
+
+auto app::ui::PerformanceOverlay::getRenderGraph() const noexcept
+    -> pbr::RenderGraph const* {
+  return _renderGraph;
+}
+
+auto app::ui::PerformanceOverlay::setRenderGraph(
+    pbr::RenderGraph const* renderGraph) noexcept -> void {
+  _renderGraph = renderGraph;
+}
+
+auto app::ui::PerformanceOverlay::getGpuProfiler() const noexcept
+    -> pbr::GpuProfiler const* {
+  return _gpuProfiler;
+}
+
+auto app::ui::PerformanceOverlay::setGpuProfiler(
+    pbr::GpuProfiler const* gpuProfiler) noexcept -> void {
+  _gpuProfiler = gpuProfiler;
+}
+
 auto app::ui::PerformanceOverlay::render(std::chrono::nanoseconds deltaTime) -> void {
   ImGui::SetNextWindowPos(calculateOverlayPosition(), ImGuiCond_Always);
   ImGui::SetNextWindowSizeConstraints(
@@ -17,10 +92,207 @@ auto app::ui::PerformanceOverlay::render(std::chrono::nanoseconds deltaTime) ->
         "Frame time %.3f ms",
         std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(deltaTime)
             .count());
+    if (_frameRing != nullptr) {
+      renderFrameStats();
+    }
+    if (_gpuProfiler != nullptr && _gpuProfiler->isSupported()) {
+      ImGui::Separator();
+      renderGpuTimings();
+    }
+    if (_gBuffer != nullptr) {
+      ImGui::Separator();
+      renderGBufferStats();
+    }
+    if (_transientAllocator != nullptr) {
+      renderTransientStats();
+    }
+    if (_renderGraph != nullptr) {
+      ImGui::Separator();
+      renderGraphStats();
+    }
+    if (_scene != nullptr) {
+      auto const stats = _scene->getLastUpdateStats();
+      ImGui::Separator();
+      ImGui::Text("Nodes %u", _scene->getNodeCount());
+      ImGui::Text("Dirty nodes %u", stats.dirtyNodes);
+      ImGui::Text("Recomputed matrices %u", stats.recomputedMatrices);
+    }
+    if (_renderSystem != nullptr) {
+      ImGui::Separator();
+      renderDrawStats();
+      if (_renderSystem->isDepthPrepassSupported()
+          || _renderSystem->isOverdrawQuerySupported()) {
+        ImGui::Separator();
+        renderOverdrawStats();
+      }
+      if (_renderSystem->isTiledLightingSupported()) {
+        ImGui::Separator();
+        renderLightingStats();
+      }
+    }
     ImGui::End();
   }
 }
 
+auto app::ui::PerformanceOverlay::renderFrameStats() const -> void {
+  auto const stats = _frameRing->getStats();
+  // Every frame the gpu was still executing overlapped with recording this one.
+  ImGui::Text("Frames in flight %u / %u", stats.framesInFlight + 1,
+              _frameRing->getFrameCount());
+  ImGui::Text(
+      "Fence wait %.3f ms",
+      std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(
+          stats.fenceWait)
+          .count());
+}
+
+auto app::ui::PerformanceOverlay::renderGBufferStats() const -> void {
+  static constexpr auto MIB = 1024.0 * 1024.0;
+  auto const toMib = [extent = _gBuffer->getExtent()](pbr::GBufferLayout const layout) {
+    return static_cast<double>(pbr::GBuffer::getBytesPerFrame(layout, extent)) / MIB;
+  };
+  // The geometry pass writes these bytes every frame and the lighting pass reads them.
+  ImGui::Text("G-buffer %.1f MiB", toMib(_gBuffer->getLayout()));
+  ImGui::Text("Wide %.1f MiB, compact %.1f MiB", toMib(pbr::GBufferLayout::Wide),
+              toMib(pbr::GBufferLayout::Compact));
+}
+
+auto app::ui::PerformanceOverlay::renderTransientStats() const -> void {
+  static constexpr auto MIB = 1024.0 * 1024.0;
+  auto const stats = _transientAllocator->getStats();
+  auto const toMib = [](auto const bytes) { return static_cast<double>(bytes) / MIB; };
+  // Images used in different passes share memory, so less than the sum is allocated.
+  ImGui::Text("Render targets %.1f MiB of %.1f MiB", toMib(stats.allocatedSize),
+              toMib(stats.summedSize));
+  ImGui::Text("Peak %.1f MiB, aliased images %u / %u", toMib(stats.peakSize),
+              stats.aliasedImages, stats.images);
+}
+
+auto app::ui::PerformanceOverlay::renderGraphStats() const -> void {
+  auto const stats = _renderGraph->getStats();
+  ImGui::Text("Passes %u, culled %u", stats.passes, stats.culledPasses);
+  // Every batch is a single pipeline barrier command.
+  ImGui::Text("Barriers %u image, %u buffer in %u batches", stats.imageBarriers,
+              stats.bufferBarriers, stats.barrierBatches);
+}
+
+auto app::ui::PerformanceOverlay::renderGpuTimings() const -> void {
+  auto const toMs = [](std::chrono::nanoseconds const duration) {
+    return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(duration)
+        .count();
+  };
+  auto const& timings = _gpuProfiler->getTimings();
+  // The timings lag behind by the frames in flight, a gpu time close to the frame time
+  // means the frame is gpu bound.
+  ImGui::Text("GPU time %.3f ms (max %.3f ms)", toMs(timings.getFrame().average),
+              toMs(timings.getFrame().max));
+  for (auto const& pass : timings.getPasses()) {
+    ImGui::Text("  %s %.3f ms", pass.name.c_str(), toMs(pass.average));
+  }
+}
+
+auto app::ui::PerformanceOverlay::renderDrawStats() -> void {
+  if (_renderSystem->isGpuDrivenSupported()) {
+    auto gpuDriven = _renderSystem->isGpuDriven();
+    if (ImGui::Checkbox("GPU driven", &gpuDriven)) {
+      _renderSystem->setGpuDriven(gpuDriven);
+    }
+  }
+
+  auto frustumCulling = _renderSystem->isFrustumCulling();
+  if (ImGui::Checkbox("CPU frustum culling", &frustumCulling)) {
+    _renderSystem->setFrustumCulling(frustumCulling);
+  }
+  if (_renderSystem->isFrustumCulling()) {
+    auto const stats = _renderSystem->getFrustumCullingStats();
+    ImGui::Text("Visible nodes %u, culled %u", stats.visibleNodes, stats.culledNodes);
+  }
+
+  auto softwareOcclusionCulling = _renderSystem->isSoftwareOcclusionCulling();
+  if (ImGui::Checkbox("CPU occlusion culling", &softwareOcclusionCulling)) {
+    _renderSystem->setSoftwareOcclusionCulling(softwareOcclusionCulling);
+  }
+  if (_renderSystem->isSoftwareOcclusionCulling()) {
+    auto const stats = _renderSystem->getSoftwareOcclusionStats();
+    ImGui::Text("Occluders %u (%u triangles)", stats.occluders, stats.occluderTriangles);
+    ImGui::Text("Occluded nodes %u of %u", stats.occludedNodes, stats.testedNodes);
+  }
+
+  auto lods = _renderSystem->isLods();
+  if (ImGui::Checkbox("Mesh LODs", &lods)) {
+    _renderSystem->setLods(lods);
+  }
+
+  if (_renderSystem->isGpuDriven() && _renderSystem->isGpuDrivenSupported()) {
+    if (_renderSystem->isOcclusionCullingSupported()) {
+      auto occlusionCulling = _renderSystem->isOcclusionCulling();
+      if (ImGui::Checkbox("Occlusion culling", &occlusionCulling)) {
+        _renderSystem->setOcclusionCulling(occlusionCulling);
+      }
+    }
+    auto meshletCulling = _renderSystem->isMeshletCulling();
+    if (ImGui::Checkbox("Meshlet culling", &meshletCulling)) {
+      _renderSystem->setMeshletCulling(meshletCulling);
+    }
+    auto const stats = _renderSystem->getCullingStats();
+    ImGui::Text("Batches %u", stats.batches);
+    ImGui::Text("Instances %u", stats.instances);
+    ImGui::Text("Meshlet instances %u", stats.meshletInstances);
+    ImGui::Text("Indirect draws %u", stats.indirectDraws);
+    return;
+  }
+
+  auto const stats = _renderSystem->getDrawListStats();
+  ImGui::Text("Draws %u", stats.draws);
+  ImGui::Text("Instances %u", stats.instances);
+  ImGui::Text("Triangles %u", stats.triangles);
+  ImGui::Text("Material binds %u", stats.materialBinds);
+  ImGui::Text("Mesh binds %u", stats.meshBinds);
+  ImGui::Text("Binds avoided %u", stats.bindsAvoided);
+}
+
+auto app::ui::PerformanceOverlay::renderOverdrawStats() -> void {
+  if (_renderSystem->isDepthPrepassSupported()) {
+    auto depthPrepass = _renderSystem->isDepthPrepass();
+    if (ImGui::Checkbox("Depth pre-pass", &depthPrepass)) {
+      _renderSystem->setDepthPrepass(depthPrepass);
+    }
+  }
+  if (!_renderSystem->isOverdrawQuerySupported()) {
+    return;
+  }
+
+  auto const stats = _renderSystem->getOverdrawStats();
+  ImGui::Text("G-buffer samples %llu",
+              static_cast<unsigned long long>(stats.gBufferSamples));
+  // Without the pre-pass every sample that passed its depth test is written.
+  if (stats.depthSamples != 0 && stats.gBufferSamples != 0) {
+    auto const saved = stats.depthSamples - stats.gBufferSamples;
+    ImGui::Text("Samples saved %llu (%.2fx overdraw)",
+                static_cast<unsigned long long>(saved),
+                static_cast<double>(stats.depthSamples)
+                    / static_cast<double>(stats.gBufferSamples));
+  }
+}
+
+auto app::ui::PerformanceOverlay::renderLightingStats() -> void {
+  auto tiledLighting = _renderSystem->isTiledLighting();
+  if (ImGui::Checkbox("Tiled lighting", &tiledLighting)) {
+    _renderSystem->setTiledLighting(tiledLighting);
+  }
+
+  if (_renderSystem->isTiledLighting()) {
+    auto const stats = _renderSystem->getTiledLightingStats();
+    ImGui::Text("Lights %u", stats.lights);
+    ImGui::Text("Tiles %u", stats.tiles);
+    // Every light still shades these tiles, they just take several batches.
+    ImGui::Text("Overflowing tiles %u", stats.overflowTiles);
+    // Only lights that changed since the frame last used its buffer are written.
+    ImGui::Text("Rewritten lights %u",
+                _renderSystem->getLightBufferStats().rewrittenLights);
+  }
+}
+
 auto app::ui::PerformanceOverlay::calculateOverlayPosition() -> ImVec2 {
   auto const* const viewport = ImGui::GetMainViewport();
   return {viewport->WorkPos.x + PADDING, viewport->WorkPos.y + PADDING};
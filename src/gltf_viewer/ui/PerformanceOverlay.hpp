@@ -1,5 +1,13 @@
 #pragma once
 
+#include "pbr/FrameRing.hpp"
+#include "pbr/GBuffer.hpp"
+#include "pbr/GpuProfiler.hpp"
+#include "pbr/PbrRenderSystem.hpp"
+#include "pbr/RenderGraph.hpp"
+#include "pbr/Scene.hpp"
+#include "pbr/memory/TransientAllocator.hpp"
+
 #include "imgui.h"
 
 #include <chrono>
@@ -14,13 +22,61 @@ public:
 
 private:
   bool _open = DEFAULT_OPEN;
+  pbr::Scene const* _scene = nullptr;
+  pbr::PbrRenderSystem* _renderSystem = nullptr;
+  pbr::FrameRing const* _frameRing = nullptr;
+  pbr::GBuffer const* _gBuffer = nullptr;
+  pbr::TransientAllocator const* _transientAllocator = nullptr;
+  pbr::RenderGraph const* _renderGraph = nullptr;
+  pbr::GpuProfiler const* _gpuProfiler = nullptr;
 
 public:
   PerformanceOverlay() = default;
 
+  [[nodiscard]]
+  auto getScene() const noexcept -> pbr::Scene const*;
+  auto setScene(pbr::Scene const* scene) noexcept -> void;
+
+  [[nodiscard]]
+  auto getRenderSystem() const noexcept -> pbr::PbrRenderSystem*;
+  /**
+   * @note The overlay also toggles the gpu driven path, the depth pre-pass and the tiled
+   * lighting of the render system.
+   */
+  auto setRenderSystem(pbr::PbrRenderSystem* renderSystem) noexcept -> void;
+
+  [[nodiscard]]
+  auto getFrameRing() const noexcept -> pbr::FrameRing const*;
+  auto setFrameRing(pbr::FrameRing const* frameRing) noexcept -> void;
+
+  [[nodiscard]]
+  auto getGBuffer() const noexcept -> pbr::GBuffer const*;
+  auto setGBuffer(pbr::GBuffer const* gBuffer) noexcept -> void;
+
+  [[nodiscard]]
+  auto getTransientAllocator() const noexcept -> pbr::TransientAllocator const*;
+  auto setTransientAllocator(pbr::TransientAllocator const* transientAllocator) noexcept
+      -> void;
+
+  [[nodiscard]]
+  auto getRenderGraph() const noexcept -> pbr::RenderGraph const*;
+  auto setRenderGraph(pbr::RenderGraph const* renderGraph) noexcept -> void;
+
+  [[nodiscard]]
+  auto getGpuProfiler() const noexcept -> pbr::GpuProfiler const*;
+  auto setGpuProfiler(pbr::GpuProfiler const* gpuProfiler) noexcept -> void;
+
   auto render(std::chrono::nanoseconds deltaTime) -> void;
 
 private:
+  auto renderFrameStats() const -> void;
+  auto renderGBufferStats() const -> void;
+  auto renderTransientStats() const -> void;
+  auto renderGraphStats() const -> void;
+  auto renderGpuTimings() const -> void;
+  auto renderDrawStats() -> void;
+  auto renderOverdrawStats() -> void;
+  auto renderLightingStats() -> void;
   [[nodiscard]]
   static auto calculateOverlayPosition() -> ImVec2;
   [[nodiscard]]
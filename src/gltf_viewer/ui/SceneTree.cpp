@@ -15,7 +15,7 @@ auto app::ui::SceneTree::getScene() const noexcept -> pbr::Scene* { return _scen
 
 auto app::ui::SceneTree::setScene(pbr::Scene* scene) noexcept -> void {
   _scene = scene;
-  _selectedNode = nullptr;
+  _selectedNode.reset();
 }
 
 auto app::ui::SceneTree::render([[maybe_unused]] std::chrono::nanoseconds deltaTime)
@@ -44,30 +44,30 @@ auto app::ui::SceneTree::renderTree() -> void {
   if (_scene == nullptr) {
     ImGui::TextColored({1.0, 1.0, 0.0, 1.0}, "No scene found!");
   } else {
-    for (auto& node : _scene->getTopLevelNodes()) {
+    for (auto const node : _scene->iterateTopLevelNodes()) {
       renderNode(node);
     }
   }
 }
 
-auto app::ui::SceneTree::renderNode(pbr::Node& node) -> void {
+auto app::ui::SceneTree::renderNode(pbr::Node node) -> void {
   ImGuiTreeNodeFlags nodeFlags = ImGuiTreeNodeFlags_OpenOnArrow;
-  if (node.getChildren().empty()) {
+  if (!node.hasChildren()) {
     nodeFlags |= ImGuiTreeNodeFlags_Leaf;
   }
-  if (&node == _selectedNode) {
+  if (node.getHandle() == _selectedNode) {
     nodeFlags |= ImGuiTreeNodeFlags_Selected;
   }
 
   auto const isNodeOpen = ImGui::TreeNodeEx(node.getName().c_str(), nodeFlags);
 
   if (ImGui::IsItemClicked()) {
-    _selectedNode = &node;
+    _selectedNode = node.getHandle();
   }
 
   if (isNodeOpen) {
-    for (auto& node : node.getChildren()) {
-      renderNode(node);
+    for (auto const child : node.iterateChildren()) {
+      renderNode(child);
     }
 
     ImGui::TreePop();
@@ -75,37 +75,54 @@ auto app::ui::SceneTree::renderNode(pbr::Node& node) -> void {
 }
 
 auto app::ui::SceneTree::renderNodeView() -> void {
-  if (_selectedNode == nullptr) {
+  if (_selectedNode.has_value() && !_scene->isValid(*_selectedNode)) {
+    _selectedNode.reset();
+  }
+
+  if (!_selectedNode.has_value()) {
     ImGui::TextColored({1.0, 1.0, 0.0, 1.0}, "No node selected!");
   } else {
-    auto& node = *_selectedNode;
+    auto node = _scene->getNode(*_selectedNode);
 
     ImGui::Text("%s", node.getName().c_str());
     ImGui::Separator();
 
-    node.setTransform(renderTransform(node.getTransform()));
+    // Only write back actual edits, setting the transform marks the whole subtree dirty.
+    auto transform = node.getTransform();
+    if (renderTransform(transform)) {
+      node.setTransform(transform);
+    }
+
+    if (node.getCamera() != nullptr) {
+      auto isActive = _scene->getActiveCameraNode() == node.getHandle();
+      if (ImGui::Checkbox("Active camera", &isActive) && isActive) {
+        _scene->setActiveCamera(node.getHandle());
+      }
+    }
   }
 }
 
-auto app::ui::SceneTree::renderTransform(pbr::Transform transform) -> pbr::Transform {
+auto app::ui::SceneTree::renderTransform(pbr::Transform& transform) -> bool {
+  auto changed = false;
   if (ImGui::CollapsingHeader("Transform")) {
     ImGui::Indent(15.0f);
 
     renderRotationFormatCombo();
 
-    ImGui::DragFloat3("Position", &transform.position.x);
+    changed |= ImGui::DragFloat3("Position", &transform.position.x);
     constexpr auto rotationSliderFlags =
         ImGuiSliderFlags_WrapAround | ImGuiSliderFlags_AlwaysClamp;
     switch (_rotationFormat) {
       using enum RotationFormat;
     case Quaternion:
-      ImGui::DragFloat4("Rotation", &transform.rotation.x, 0.05f);
+      changed |= ImGui::DragFloat4("Rotation", &transform.rotation.x, 0.05f);
       break;
     case EulerAnglesRad: {
       auto eulerAngles = glm::eulerAngles(transform.rotation);
       if (ImGui::DragFloat3("Rotation", &eulerAngles.x, 0.05f, -glm::half_pi<float>(),
                             glm::half_pi<float>(), "%.3f", rotationSliderFlags)) {
         transform.rotation = glm::quat(eulerAngles);
+        changed = true;
       }
       break;
     }
@@ -124,15 +141,16 @@ auto app::ui::SceneTree::renderTransform(pbr::Transform transform) -> pbr::Trans
             glm::radians(eulerAnglesDeg.z),
         };
         transform.rotation = glm::quat(eulerAnglesRad);
+        changed = true;
       }
       break;
     }
     }
 
-    ImGui::DragFloat3("Scale", &transform.scale.x, 0.1f, 0.001f, 0.0f);
+    changed |= ImGui::DragFloat3("Scale", &transform.scale.x, 0.1f, 0.001f, 0.0f);
     ImGui::Indent(0.0f);
   }
-  return transform;
+  return changed;
 }
 
 auto app::ui::SceneTree::renderRotationFormatCombo() -> void {
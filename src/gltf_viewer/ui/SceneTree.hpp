@@ -4,6 +4,7 @@
 
 #include <chrono>
 #include <cstdint>
+#include <optional>
 #include <utility>
 
 namespace app::ui {
@@ -21,8 +22,7 @@ class SceneTree {
 
   bool _open = DEFAULT_OPEN;
   pbr::Scene* _scene = nullptr;
-  // This is very bad, dont use a pointer in the future (maybe index).
-  pbr::Node* _selectedNode = nullptr;
+  std::optional<pbr::NodeHandle> _selectedNode = std::nullopt;
 
   RotationFormat _rotationFormat = DEFAULT_ROTATION_FORMAT;
 
@@ -35,10 +35,14 @@ public:
   auto render(std::chrono::nanoseconds deltaTime) -> void;
 
 private:
-  auto renderNode(pbr::Node& node) -> void;
+  auto renderNode(pbr::Node node) -> void;
   auto renderTree() -> void;
   auto renderNodeView() -> void;
-  auto renderTransform(pbr::Transform transform) -> pbr::Transform;
+  /**
+   * Renders editors for the transform.
+   * @returns Whether the transform was changed.
+   */
+  auto renderTransform(pbr::Transform& transform) -> bool;
   auto renderRotationFormatCombo() -> void;
 };
 } // namespace app::ui
@@ -0,0 +1,24 @@
+#pragma once
+
+namespace pbr::core {
+/**
+ * Optional device features, each one is enabled on the device only when supported.
+ */
+struct DeviceFeatures {
+  /// Indirect draws with a draw count larger than one.
+  bool multiDrawIndirect {};
+  /// Indirect draws with a non zero first instance.
+  bool drawIndirectFirstInstance {};
+  /// Indirect draws that read their draw count from a buffer (Vulkan 1.2).
+  bool drawIndirectCount {};
+  /**
+   * Partially bound, update after bind and non uniformly indexed arrays of sampled images
+   * of runtime size (Vulkan 1.2).
+   */
+  bool descriptorIndexing {};
+  /// Occlusion queries that count samples instead of only reporting any.
+  bool occlusionQueryPrecise {};
+  /// Occlusion queries that stay active while secondary command buffers execute.
+  bool inheritedQueries {};
+};
+} // namespace pbr::core
@@ -1,11 +1,11 @@
 #include "pbr/core/GpuHandle.hpp"
 
 #include "pbr/Vulkan.hpp"
+#include "pbr/core/DeviceFeatures.hpp"
 #include "pbr/core/GpuHandleCreateInfo.hpp"
 #include "pbr/core/PhysicalDeviceProperties.hpp"
 
 #include <array>
-#include <cassert>
 #include <cstdint>
 #include <optional>
 #include <ranges>
@@ -42,7 +42,8 @@ createInstance(pbr::core::GpuHandleCreateInfo const& info) -> vk::UniqueInstance
 constexpr auto findPhysicalDevice(vk::Instance const instance,
                                   pbr::core::GpuHandleCreateInfo const& info)
     -> pbr::core::PhysicalDeviceProperties {
-  assert(info.presentPredicate != nullptr && "info.presentPredicate cannot be null");
+  // Headless devices render offscreen, so any graphics queue will do.
+  auto const presentable = static_cast<bool>(info.presentPredicate);
 
   for (auto const [deviceIdx, physicalDevice] :
        instance.enumeratePhysicalDevices() | std::views::enumerate) {
@@ -52,7 +53,8 @@ constexpr auto findPhysicalDevice(vk::Instance const instance,
          physicalDevice.getQueueFamilyProperties() | std::views::enumerate) {
       bool const isGraphics {queueFamilyProp.queueFlags & vk::QueueFlagBits::eGraphics};
       bool const isTransfer {queueFamilyProp.queueFlags & vk::QueueFlagBits::eTransfer};
-      auto const isPresent = info.presentPredicate(instance, physicalDevice, idx);
+      auto const isPresent =
+          !presentable || info.presentPredicate(instance, physicalDevice, idx);
 
       if (isGraphics && isTransfer && isPresent) {
         graphicsTransferPresentQueueIndex.emplace(idx);
@@ -63,6 +65,7 @@ constexpr auto findPhysicalDevice(vk::Instance const instance,
       return {
           .physicalDeviceIndex = static_cast<std::uint32_t>(deviceIdx),
           .graphicsTransferPresentQueue = *graphicsTransferPresentQueueIndex,
+          .presentable = presentable,
       };
     }
   }
@@ -70,24 +73,64 @@ constexpr auto findPhysicalDevice(vk::Instance const instance,
   throw std::runtime_error("Could not find a suitable physical device");
 }
 [[nodiscard]]
+constexpr auto queryDeviceFeatures(vk::PhysicalDevice const physicalDevice)
+    -> pbr::core::DeviceFeatures {
+  auto const features =
+      physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2,
+                                  vk::PhysicalDeviceVulkan12Features>();
+  auto const& core = features.get<vk::PhysicalDeviceFeatures2>().features;
+  auto const& vulkan12 = features.get<vk::PhysicalDeviceVulkan12Features>();
+  return {
+      .multiDrawIndirect = core.multiDrawIndirect == vk::True,
+      .drawIndirectFirstInstance = core.drawIndirectFirstInstance == vk::True,
+      .drawIndirectCount = vulkan12.drawIndirectCount == vk::True,
+      .descriptorIndexing =
+          vulkan12.runtimeDescriptorArray == vk::True
+          && vulkan12.descriptorBindingPartiallyBound == vk::True
+          && vulkan12.descriptorBindingSampledImageUpdateAfterBind == vk::True
+          && vulkan12.shaderSampledImageArrayNonUniformIndexing == vk::True,
+      .occlusionQueryPrecise = core.occlusionQueryPrecise == vk::True,
+      .inheritedQueries = core.inheritedQueries == vk::True,
+  };
+}
+[[nodiscard]]
 constexpr auto
 createDevice(vk::PhysicalDevice const physicalDevice,
-             pbr::core::PhysicalDeviceProperties deviceProps) -> vk::UniqueDevice {
+             pbr::core::PhysicalDeviceProperties deviceProps,
+             pbr::core::DeviceFeatures features) -> vk::UniqueDevice {
   constexpr auto QUEUE_PRIORITY = 1.0f;
   vk::DeviceQueueCreateInfo const queueInfo {
       .queueFamilyIndex = deviceProps.graphicsTransferPresentQueue,
       .queueCount = 1,
       .pQueuePriorities = &QUEUE_PRIORITY,
   };
-  auto const deviceInfo =
-      vk::DeviceCreateInfo {}.setQueueCreateInfos(queueInfo).setPEnabledExtensionNames(
-          constants::DEVICE_EXTENSIONS);
+  auto deviceInfo = vk::DeviceCreateInfo {}.setQueueCreateInfos(queueInfo);
+  if (deviceProps.presentable) {
+    deviceInfo.setPEnabledExtensionNames(constants::DEVICE_EXTENSIONS);
+  }
   vk::PhysicalDeviceSynchronization2Features const sync2 {.synchronization2 = vk::True};
   vk::PhysicalDeviceDynamicRenderingFeatures const dynRendering {.dynamicRendering =
                                                                      vk::True};
+  vk::PhysicalDeviceFeatures2 const coreFeatures {
+      .features {
+          .multiDrawIndirect = features.multiDrawIndirect ? vk::True : vk::False,
+          .drawIndirectFirstInstance =
+              features.drawIndirectFirstInstance ? vk::True : vk::False,
+          .occlusionQueryPrecise = features.occlusionQueryPrecise ? vk::True : vk::False,
+          .inheritedQueries = features.inheritedQueries ? vk::True : vk::False,
+      },
+  };
+  auto const descriptorIndexing = features.descriptorIndexing ? vk::True : vk::False;
+  vk::PhysicalDeviceVulkan12Features const vulkan12 {
+      .drawIndirectCount = features.drawIndirectCount ? vk::True : vk::False,
+      .shaderSampledImageArrayNonUniformIndexing = descriptorIndexing,
+      .descriptorBindingSampledImageUpdateAfterBind = descriptorIndexing,
+      .descriptorBindingPartiallyBound = descriptorIndexing,
+      .runtimeDescriptorArray = descriptorIndexing,
+  };
 
   return physicalDevice.createDeviceUnique(
-      vk::StructureChain {deviceInfo, sync2, dynRendering}.get());
+      vk::StructureChain {deviceInfo, sync2, dynRendering, coreFeatures, vulkan12}.get());
 }
 } // namespace
 
@@ -96,6 +139,7 @@ pbr::core::GpuHandle::GpuHandle(GpuHandleCreateInfo const& info)
     , _physicalDeviceProperties(::findPhysicalDevice(_instance, info))
     , _physicalDevice(_instance->enumeratePhysicalDevices().at(
           _physicalDeviceProperties.physicalDeviceIndex))
-    , _device(::createDevice(_physicalDevice, _physicalDeviceProperties))
+    , _deviceFeatures(::queryDeviceFeatures(_physicalDevice))
+    , _device(::createDevice(_physicalDevice, _physicalDeviceProperties, _deviceFeatures))
     , _queue(
           _device->getQueue(_physicalDeviceProperties.graphicsTransferPresentQueue, 0)) {}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "pbr/Vulkan.hpp"
+#include "pbr/core/DeviceFeatures.hpp"
 #include "pbr/core/GpuHandleCreateInfo.hpp"
 #include "pbr/core/PhysicalDeviceProperties.hpp"
 
@@ -14,6 +15,7 @@ class GpuHandle {
   vk::UniqueInstance _instance;
   PhysicalDeviceProperties _physicalDeviceProperties;
   vk::PhysicalDevice _physicalDevice;
+  DeviceFeatures _deviceFeatures;
   vk::UniqueDevice _device;
   vk::Queue _queue;
 
@@ -31,6 +33,12 @@ public:
   [[nodiscard]]
   constexpr auto getPhysicalDevice() const noexcept -> vk::PhysicalDevice;
 
+  /**
+   * @returns The optional features that are enabled on the device.
+   */
+  [[nodiscard]]
+  constexpr auto getDeviceFeatures() const noexcept -> DeviceFeatures;
+
   [[nodiscard]]
   constexpr auto getDevice() const noexcept -> vk::Device;
 
@@ -59,6 +67,10 @@ constexpr auto
 pbr::core::GpuHandle::getPhysicalDevice() const noexcept -> vk::PhysicalDevice {
   return _physicalDevice;
 }
+constexpr auto pbr::core::GpuHandle::getDeviceFeatures() const noexcept
+    -> DeviceFeatures {
+  return _deviceFeatures;
+}
 constexpr auto pbr::core::GpuHandle::getDevice() const noexcept -> vk::Device {
   return _device.get();
 }
@@ -18,7 +18,8 @@ struct GpuHandleCreateInfo {
   std::span<char const* const> extensions {};
   /// The predicate that returns whether the passed in physical device has support for
   /// presentation for the platform.
-  /// @note This predicate is REQUIRED.
+  /// @note Without a predicate the device is headless, it can only render offscreen and
+  /// has no swapchain support.
   QueueFamilyPresentPredicate presentPredicate {};
   /// Value indicating whether validation layers should be enabled for the instance or
   /// not.
@@ -9,7 +9,10 @@ namespace pbr::core {
 struct PhysicalDeviceProperties {
   /// The index of the physical device in the instance.
   std::uint32_t physicalDeviceIndex;
-  /// The index of the queue that has graphics, transfer and present support.
+  /// The index of the queue that has graphics, transfer and present support, headless
+  /// devices only need graphics and transfer support.
   std::uint32_t graphicsTransferPresentQueue;
+  /// Whether the device was created with swapchain support.
+  bool presentable;
 };
 } // namespace pbr::core
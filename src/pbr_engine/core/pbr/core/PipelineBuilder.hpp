@@ -45,7 +45,13 @@ public:
   template <Vertex T> constexpr auto addVertexBinding() -> PipelineBuilder&;
   constexpr auto
   enableBackFaceCulling(vk::FrontFace frontFace = {}) noexcept -> PipelineBuilder&;
-  constexpr auto enableDepthTesting(vk::Format format) noexcept -> PipelineBuilder&;
+  /**
+   * @param depthWrite Passes that test against the depth of an earlier pass leave it as
+   * it is.
+   */
+  constexpr auto enableDepthTesting(vk::Format format,
+                                    vk::CompareOp compareOp = vk::CompareOp::eLess,
+                                    bool depthWrite = true) noexcept -> PipelineBuilder&;
   constexpr auto addOutputFormat(
       vk::Format format,
       vk::PipelineColorBlendAttachmentState blend = {
@@ -95,13 +101,14 @@ constexpr auto pbr::core::PipelineBuilder::enableBackFaceCulling(
   return *this;
 }
 
-constexpr auto pbr::core::PipelineBuilder::enableDepthTesting(vk::Format format) noexcept
+constexpr auto pbr::core::PipelineBuilder::enableDepthTesting(
+    vk::Format format, vk::CompareOp compareOp, bool depthWrite) noexcept
     -> PipelineBuilder& {
   _renderInfo.setDepthAttachmentFormat(format);
   _depthStencil = vk::PipelineDepthStencilStateCreateInfo {
       .depthTestEnable = vk::True,
-      .depthWriteEnable = vk::True,
-      .depthCompareOp = vk::CompareOp::eLess,
+      .depthWriteEnable = depthWrite ? vk::True : vk::False,
+      .depthCompareOp = compareOp,
   };
   return *this;
 }
@@ -47,6 +47,8 @@ pbr::core::Swapchain::Swapchain(SharedGpuHandle gpu, vk::SurfaceKHR const surfac
     , _format(::chooseFormat(_gpu->getPhysicalDevice().getSurfaceFormatsKHR(surface)))
     , _presentMode(::choosePresentMode(
           _gpu->getPhysicalDevice().getSurfacePresentModesKHR(surface))) {
+  assert(_gpu->getPhysicalDeviceProperties().presentable
+         && "a headless device has no swapchain support");
   auto const surfaceCaps = _gpu->getPhysicalDevice().getSurfaceCapabilitiesKHR(surface);
   _extent =
       pbr::utils::clamp(extent, surfaceCaps.minImageExtent, surfaceCaps.maxImageExtent);
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <glm/common.hpp>
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+#include <glm/geometric.hpp>
+
+namespace pbr {
+/**
+ * Axis aligned box, empty boxes have a min above their max.
+ */
+struct BoundingBox {
+  glm::vec3 min {};
+  glm::vec3 max {};
+};
+/**
+ * @returns The smallest box enclosing both boxes.
+ */
+[[nodiscard]]
+constexpr auto merge(BoundingBox const& first, BoundingBox const& second) noexcept
+    -> BoundingBox;
+/**
+ * Transforms the corners of a box and encloses them in a new axis aligned box.
+ */
+[[nodiscard]]
+constexpr auto transformBoundingBox(glm::mat4x4 const& model,
+                                    BoundingBox const& box) noexcept -> BoundingBox;
+/**
+ * @returns The sphere through the corners of the box, the radius is stored in w.
+ */
+[[nodiscard]]
+constexpr auto makeBoundingSphere(BoundingBox const& box) noexcept -> glm::vec4;
+} // namespace pbr
+
+/* IMPLEMENTATIONS */
+
+constexpr auto pbr::merge(BoundingBox const& first, BoundingBox const& second) noexcept
+    -> BoundingBox {
+  return {
+      .min = glm::min(first.min, second.min),
+      .max = glm::max(first.max, second.max),
+  };
+}
+
+constexpr auto pbr::transformBoundingBox(glm::mat4x4 const& model,
+                                         BoundingBox const& box) noexcept
+    -> BoundingBox {
+  // The extent along an axis is the extents weighted by the absolute row of the matrix.
+  auto const center = (box.min + box.max) * 0.5f;
+  auto const extent = (box.max - box.min) * 0.5f;
+  auto const worldCenter = glm::vec3(model * glm::vec4(center, 1.0f));
+  auto const worldExtent = (glm::abs(glm::vec3(model[0])) * extent.x)
+                           + (glm::abs(glm::vec3(model[1])) * extent.y)
+                           + (glm::abs(glm::vec3(model[2])) * extent.z);
+  return {
+      .min = worldCenter - worldExtent,
+      .max = worldCenter + worldExtent,
+  };
+}
+
+constexpr auto pbr::makeBoundingSphere(BoundingBox const& box) noexcept -> glm::vec4 {
+  return {(box.min + box.max) * 0.5f, glm::distance(box.min, box.max) * 0.5f};
+}
@@ -16,6 +16,7 @@ public:
 
   [[nodiscard]]
   constexpr auto map() const -> Allocation::Mapping;
+  constexpr auto invalidate() const -> void;
 
   [[nodiscard]]
   constexpr auto getBuffer() const noexcept -> vk::Buffer;
@@ -34,6 +35,8 @@ constexpr auto pbr::Buffer::map() const -> Allocation::Mapping {
   return _allocation.map();
 }
 
+constexpr auto pbr::Buffer::invalidate() const -> void { _allocation.invalidate(); }
+
 constexpr auto pbr::Buffer::getBuffer() const noexcept -> vk::Buffer {
   return _buffer.get();
 }
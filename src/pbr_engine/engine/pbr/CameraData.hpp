@@ -5,15 +5,19 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 
 #include "glm/ext/matrix_float4x4.hpp"
+#include "glm/ext/vector_float2.hpp"
 #include "glm/ext/vector_float3.hpp"
 #include "glm/ext/vector_float4.hpp"
 #include <glm/ext/matrix_clip_space.hpp>
 #include <glm/ext/matrix_transform.hpp>
+#include <glm/matrix.hpp>
 
 namespace pbr {
 struct alignas(sizeof(glm::vec4)) CameraData {
   glm::mat4x4 view {};
   glm::mat4x4 proj {};
+  /// Reconstructs world positions from the depth buffer.
+  glm::mat4x4 invViewProj {};
   glm::vec3 position {};
 };
 static_assert(UniformValue<CameraData>,
@@ -24,10 +28,40 @@ constexpr auto makeCameraData(glm::vec3 position, glm::vec3 target, float fov,
                               float aspect) noexcept -> CameraData {
   static constexpr auto ZNEAR = 0.01f;
   static constexpr auto ZFAR = 1024.0f;
+  auto const view = glm::lookAtRH(position, target, {0.0f, -1.0f, 0.0f});
+  auto const proj = glm::perspectiveRH_NO(fov, aspect, ZNEAR, ZFAR);
   return {
-      .view = glm::lookAtRH(position, target, {0.0f, -1.0f, 0.0f}),
-      .proj = glm::perspectiveRH_NO(fov, aspect, ZNEAR, ZFAR),
+      .view = view,
+      .proj = proj,
+      .invViewProj = glm::inverse(proj * view),
       .position = position,
   };
 }
+/**
+ * Narrows the projection of the camera to a region of its image, so the image can be
+ * rendered in tiles with the same view.
+ * @param offset The first pixel of the region, the region may reach past the image.
+ * @param extent The pixels of the region.
+ * @param imageExtent The pixels of the whole image.
+ */
+[[nodiscard]]
+constexpr auto makeTileCameraData(CameraData const& camera, glm::vec2 offset,
+                                  glm::vec2 extent, glm::vec2 imageExtent) noexcept
+    -> CameraData {
+  // Scales the clip space of the region to the whole clip space and centers it.
+  auto const scale = imageExtent / extent;
+  auto const center = (2.0f * offset + extent) / imageExtent - 1.0f;
+  glm::mat4x4 crop(1.0f);
+  crop[0][0] = scale.x;
+  crop[1][1] = scale.y;
+  crop[3][0] = -center.x * scale.x;
+  crop[3][1] = -center.y * scale.y;
+  auto const proj = crop * camera.proj;
+  return {
+      .view = camera.view,
+      .proj = proj,
+      .invViewProj = glm::inverse(proj * camera.view),
+      .position = camera.position,
+  };
+}
 } // namespace pbr
@@ -7,37 +7,81 @@
 #include "pbr/core/GpuHandle.hpp"
 #include "pbr/memory/IAllocator.hpp"
 
+#include <cassert>
+#include <cstdint>
 #include <utility>
+#include <vector>
 
 namespace pbr {
-class CameraUniform : public Uniform<CameraData> {
-  vk::UniqueDescriptorSet _descriptorSet;
+/**
+ * Camera with a uniform buffer and descriptor set for every frame in flight.
+ *
+ * set only changes the host copy, update copies it into the uniform of a frame so frames
+ * still executing on the gpu keep reading their own data.
+ */
+class CameraUniform {
+  struct Frame {
+    Uniform<CameraData> uniform;
+    vk::UniqueDescriptorSet descSet;
+  };
+
+  CameraData _data;
+  std::vector<Frame> _frames;
 
 public:
+  /**
+   * @param descSets One descriptor set for every frame in flight.
+   */
   CameraUniform(core::GpuHandle const& gpu, IAllocator& allocator,
-                vk::UniqueDescriptorSet descSet, CameraData init = {})
-      : Uniform(allocator, init), _descriptorSet(std::move(descSet)) {
-    vk::DescriptorBufferInfo const bufferInfo {
-        .buffer = getUniformBuffer().getBuffer(),
-        .range = sizeof(CameraData),
-    };
-    gpu.getDevice().updateDescriptorSets(
-        vk::WriteDescriptorSet {
-            .dstSet = _descriptorSet.get(),
-            .descriptorType = vk::DescriptorType::eUniformBuffer,
-        }
-            .setBufferInfo(bufferInfo),
-        {});
+                std::vector<vk::UniqueDescriptorSet> descSets, CameraData init = {})
+      : _data(init) {
+    assert(!descSets.empty());
+    _frames.reserve(descSets.size());
+    for (auto& descSet : descSets) {
+      auto& frame = _frames.emplace_back(Uniform(allocator, init), std::move(descSet));
+      vk::DescriptorBufferInfo const bufferInfo {
+          .buffer = frame.uniform.getUniformBuffer().getBuffer(),
+          .range = sizeof(CameraData),
+      };
+      gpu.getDevice().updateDescriptorSets(
+          vk::WriteDescriptorSet {
+              .dstSet = frame.descSet.get(),
+              .descriptorType = vk::DescriptorType::eUniformBuffer,
+          }
+              .setBufferInfo(bufferInfo),
+          {});
+    }
   }
 
   [[nodiscard]]
-  constexpr auto getDescriptorSet() const noexcept -> vk::DescriptorSet;
+  constexpr auto get() const noexcept -> CameraData;
+  constexpr auto set(CameraData data) noexcept -> void;
+
+  /**
+   * Copies the camera data into the uniform of the frame.
+   * @note The gpu must not be executing the previous use of the frame.
+   */
+  constexpr auto update(std::uint32_t frameIndex) -> void;
+
+  [[nodiscard]]
+  constexpr auto getDescriptorSet(std::uint32_t frameIndex) const noexcept
+      -> vk::DescriptorSet;
 };
 } // namespace pbr
 
 /* IMPLEMENTATIONS */
 
-constexpr auto
-pbr::CameraUniform::getDescriptorSet() const noexcept -> vk::DescriptorSet {
-  return _descriptorSet.get();
+constexpr auto pbr::CameraUniform::get() const noexcept -> CameraData { return _data; }
+
+constexpr auto pbr::CameraUniform::set(CameraData const data) noexcept -> void {
+  _data = data;
+}
+
+constexpr auto pbr::CameraUniform::update(std::uint32_t const frameIndex) -> void {
+  _frames[frameIndex % _frames.size()].uniform.set(_data);
+}
+
+constexpr auto pbr::CameraUniform::getDescriptorSet(
+    std::uint32_t const frameIndex) const noexcept -> vk::DescriptorSet {
+  return _frames[frameIndex % _frames.size()].descSet.get();
 }
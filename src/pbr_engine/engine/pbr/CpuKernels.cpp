@@ -0,0 +1,47 @@
+#include "pbr/CpuKernels.hpp"
+
+#if defined(PBR_AVX2_KERNELS) && !defined(__GNUC__)
+#include <immintrin.h>
+#include <intrin.h>
+
+#include <array>
+#endif
+
+namespace {
+[[nodiscard]]
+auto isAvx2Supported() noexcept -> bool {
+#if defined(PBR_AVX2_KERNELS) && defined(__GNUC__)
+  // Also checks whether the os saves the AVX registers.
+  return __builtin_cpu_supports("avx2") != 0;
+#elif defined(PBR_AVX2_KERNELS)
+  static constexpr int OSXSAVE = 1 << 27;
+  static constexpr int AVX = 1 << 28;
+  static constexpr int AVX2 = 1 << 5;
+  // The os has to save the xmm and ymm registers on context switches.
+  static constexpr unsigned long long YMM_STATE = 0b110;
+  std::array<int, 4> registers {};
+  __cpuid(registers.data(), 0);
+  if (registers[0] < 7) {
+    return false;
+  }
+  __cpuid(registers.data(), 1);
+  if ((registers[2] & (OSXSAVE | AVX)) != (OSXSAVE | AVX)
+      || (_xgetbv(0) & YMM_STATE) != YMM_STATE) {
+    return false;
+  }
+  __cpuidex(registers.data(), 7, 0);
+  return (registers[1] & AVX2) != 0;
+#else
+  return false;
+#endif
+}
+} // namespace
+
+auto pbr::getBestCpuKernels() noexcept -> CpuKernels {
+  static auto const kernels = ::isAvx2Supported() ? CpuKernels::Avx2 : CpuKernels::Scalar;
+  return kernels;
+}
+
+auto pbr::getSupportedCpuKernels(CpuKernels const kernels) noexcept -> CpuKernels {
+  return kernels == CpuKernels::Avx2 ? pbr::getBestCpuKernels() : CpuKernels::Scalar;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+/// The AVX2 kernels are compiled next to the scalar ones and picked at runtime.
+#define PBR_AVX2_KERNELS
+#if defined(__GNUC__)
+#define PBR_TARGET_AVX2 [[gnu::target("avx2")]]
+#else
+// MSVC compiles the intrinsics of every instruction set without any flags.
+#define PBR_TARGET_AVX2
+#endif
+#endif
+
+namespace pbr {
+/**
+ * The instruction sets the cpu side culling kernels are written for.
+ */
+enum struct CpuKernels : std::uint8_t {
+  /// Lane by lane, left to the compiler to vectorize.
+  Scalar,
+  /// 8 lanes at a time, only on x86 cpus supporting AVX2.
+  Avx2,
+};
+/**
+ * @returns The widest kernels the cpu running the engine supports.
+ */
+[[nodiscard]]
+auto getBestCpuKernels() noexcept -> CpuKernels;
+/**
+ * @returns The kernels if the cpu supports them, the scalar ones otherwise.
+ */
+[[nodiscard]]
+auto getSupportedCpuKernels(CpuKernels kernels) noexcept -> CpuKernels;
+} // namespace pbr
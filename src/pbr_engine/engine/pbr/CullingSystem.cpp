@@ -0,0 +1,582 @@
+#include "pbr/CullingSystem.hpp"
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/core/GpuHandle.hpp"
+
+#include "pbr/DescriptorSetAllocator.hpp"
+#include "pbr/DrawList.hpp"
+#include "pbr/Frustum.hpp"
+#include "pbr/GrowableBuffer.hpp"
+#include "pbr/memory/AllocationInfo.hpp"
+#include "pbr/memory/IAllocator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+
+namespace constants {
+static constexpr std::uint32_t LOCAL_SIZE = 64;
+static constexpr std::uint32_t BINDING_COUNT = 9;
+/// The bindings after these are only read by the occlusion shader.
+static constexpr std::uint32_t FRUSTUM_BINDING_COUNT = 7;
+static constexpr std::uint32_t CULL_INSTANCES_PASS = 0;
+static constexpr std::uint32_t WRITE_COMMANDS_PASS = 1;
+static constexpr std::uint32_t CULL_OCCLUDED_PASS = 2;
+static constexpr std::uint32_t CULL_VISIBLE_PASS = 3;
+static constexpr vk::DeviceSize DRAW_COMMAND_STRIDE =
+    sizeof(vk::DrawIndexedIndirectCommand);
+} // namespace constants
+
+namespace {
+[[nodiscard]]
+constexpr auto createDescriptorSetLayout(pbr::core::GpuHandle const& gpu)
+    -> vk::UniqueDescriptorSetLayout {
+  std::array<vk::DescriptorSetLayoutBinding, constants::BINDING_COUNT> bindings {};
+  for (auto const [index, binding] : std::views::enumerate(bindings)) {
+    binding = {
+        .binding = static_cast<std::uint32_t>(index),
+        .descriptorType = vk::DescriptorType::eStorageBuffer,
+        .descriptorCount = 1,
+        .stageFlags = vk::ShaderStageFlagBits::eCompute,
+    };
+  }
+  return gpu.getDevice().createDescriptorSetLayoutUnique(
+      vk::DescriptorSetLayoutCreateInfo {}.setBindings(bindings));
+}
+[[nodiscard]]
+constexpr auto createPipelineLayout(pbr::core::GpuHandle const& gpu,
+                                    std::span<vk::DescriptorSetLayout const> setLayouts)
+    -> vk::UniquePipelineLayout {
+  vk::PushConstantRange const pushConstants {
+      .stageFlags = vk::ShaderStageFlagBits::eCompute,
+      .size = sizeof(pbr::CullingSystem::PushConstants),
+  };
+  return gpu.getDevice().createPipelineLayoutUnique(
+      vk::PipelineLayoutCreateInfo {}.setSetLayouts(setLayouts).setPushConstantRanges(
+          pushConstants));
+}
+[[nodiscard]]
+constexpr auto createPipeline(pbr::core::GpuHandle const& gpu, vk::PipelineLayout layout,
+                              vk::PipelineShaderStageCreateInfo shader)
+    -> vk::UniquePipeline {
+  auto [result, pipeline] =
+      gpu.getDevice().createComputePipelineUnique(nullptr, {
+                                                               .stage = shader,
+                                                               .layout = layout,
+                                                           });
+  assert(result == vk::Result::eSuccess);
+  return std::move(pipeline);
+}
+[[nodiscard]]
+constexpr auto createDescriptorPool(pbr::core::GpuHandle const& gpu,
+                                    std::uint32_t setCount) -> vk::UniqueDescriptorPool {
+  vk::DescriptorPoolSize const size {
+      .type = vk::DescriptorType::eStorageBuffer,
+      .descriptorCount = constants::BINDING_COUNT * setCount,
+  };
+  return gpu.getDevice().createDescriptorPoolUnique(vk::DescriptorPoolCreateInfo {
+      .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+      .maxSets = setCount,
+  }
+                                                        .setPoolSizes(size));
+}
+[[nodiscard]]
+constexpr auto makeHostBuffer() -> pbr::GrowableBuffer {
+  return {
+      vk::BufferUsageFlagBits::eStorageBuffer,
+      {
+          .preference = pbr::AllocationPreference::Host,
+          .ableToBeMapped = true,
+          .persistentlyMapped = true,
+      },
+  };
+}
+[[nodiscard]]
+constexpr auto makeDeviceBuffer(vk::BufferUsageFlags usage) -> pbr::GrowableBuffer {
+  return {vk::BufferUsageFlagBits::eStorageBuffer | usage, {}};
+}
+[[nodiscard]]
+constexpr auto makeVisibilityBuffer() -> pbr::GrowableBuffer {
+  // Grown buffers are copied from the previous one.
+  return ::makeDeviceBuffer(vk::BufferUsageFlagBits::eTransferSrc
+                            | vk::BufferUsageFlagBits::eTransferDst);
+}
+[[nodiscard]]
+constexpr auto getDispatchSize(std::uint32_t count) noexcept -> std::uint32_t {
+  return (count + constants::LOCAL_SIZE - 1) / constants::LOCAL_SIZE;
+}
+constexpr auto computeBarrier(vk::CommandBuffer cmdBuffer,
+                              vk::PipelineStageFlags2 srcStage,
+                              vk::AccessFlags2 srcAccess,
+                              vk::PipelineStageFlags2 dstStage,
+                              vk::AccessFlags2 dstAccess) -> void {
+  vk::MemoryBarrier2 const barrier {
+      .srcStageMask = srcStage,
+      .srcAccessMask = srcAccess,
+      .dstStageMask = dstStage,
+      .dstAccessMask = dstAccess,
+  };
+  cmdBuffer.pipelineBarrier2(vk::DependencyInfo {}.setMemoryBarriers(barrier));
+}
+} // namespace
+
+pbr::CullingSystem::CullingSystem(core::SharedGpuHandle gpu,
+                                  std::shared_ptr<IAllocator> allocator,
+                                  vk::PipelineShaderStageCreateInfo shader,
+                                  MaterialBinding materialBinding,
+                                  std::uint32_t const frameCount,
+                                  vk::PipelineShaderStageCreateInfo occlusionShader,
+                                  vk::DescriptorSetLayout depthPyramidSetLayout)
+    : _gpu(std::move(gpu))
+    , _allocator(std::move(allocator))
+    , _materialBinding(materialBinding)
+    , _descLayout(::createDescriptorSetLayout(*_gpu))
+    , _layout(::createPipelineLayout(*_gpu, std::array {_descLayout.get()}))
+    , _pipeline(::createPipeline(*_gpu, _layout.get(), shader))
+    , _descPool(::createDescriptorPool(*_gpu, frameCount))
+    , _visibilityBuffer(::makeVisibilityBuffer()) {
+  if (occlusionShader.module) {
+    _occlusionLayout = ::createPipelineLayout(
+        *_gpu, std::array {_descLayout.get(), depthPyramidSetLayout});
+    _occlusionPipeline = ::createPipeline(*_gpu, _occlusionLayout.get(), occlusionShader);
+  }
+
+  auto descSets = DescriptorSetAllocator(_gpu, _descPool.get(), _descLayout.get())
+                      .allocate(frameCount);
+  _frames.reserve(frameCount);
+  for (auto& descSet : descSets) {
+    _frames.push_back({
+        .descSet = std::move(descSet),
+        .cullInstanceBuffer = ::makeHostBuffer(),
+        .batchBuffer = ::makeHostBuffer(),
+        .instanceCountBuffer = ::makeDeviceBuffer(vk::BufferUsageFlagBits::eTransferDst),
+        .visibleInstanceBuffer = ::makeDeviceBuffer({}),
+        .drawCommandBuffer = ::makeDeviceBuffer(vk::BufferUsageFlagBits::eIndirectBuffer),
+        .runCountBuffer = ::makeDeviceBuffer(vk::BufferUsageFlagBits::eIndirectBuffer
+                                             | vk::BufferUsageFlagBits::eTransferDst),
+        .viewBuffer = ::makeHostBuffer(),
+    });
+  }
+}
+
+auto pbr::CullingSystem::isSupported(core::GpuHandle const& gpu) noexcept -> bool {
+  auto const features = gpu.getDeviceFeatures();
+  return features.multiDrawIndirect && features.drawIndirectFirstInstance
+         && features.drawIndirectCount;
+}
+
+auto pbr::CullingSystem::VisibilityKeyHash::operator()(
+    VisibilityKey const& key) const noexcept -> std::size_t {
+  auto const primitive =
+      (static_cast<std::uint64_t>(key.handle.slot) << 32) | key.primitiveIndex;
+  // Mixes the generation in with the golden ratio, reused slots rarely collide.
+  return std::hash<std::uint64_t> {}(
+      primitive ^ (key.handle.generation * 0x9e3779b97f4a7c15ULL));
+}
+
+auto pbr::CullingSystem::isOcclusionCullingSupported() const noexcept -> bool {
+  return static_cast<bool>(_occlusionPipeline);
+}
+
+auto pbr::CullingSystem::recordCulling(vk::CommandBuffer cmdBuffer,
+                                       std::uint32_t const frameIndex,
+                                       DrawList const& drawList,
+                                       vk::Buffer instanceBuffer,
+                                       glm::mat4x4 const& viewProj,
+                                       glm::vec3 const cameraPosition,
+                                       vk::DescriptorSet depthPyramidSet) -> void {
+  _frameIndex = frameIndex % static_cast<std::uint32_t>(_frames.size());
+  auto& frame = _frames[_frameIndex];
+  _depthPyramidSet = isOcclusionCullingSupported() ? depthPyramidSet : nullptr;
+  _planes = pbr::extractFrustumPlanes(viewProj);
+  _cameraPosition = cameraPosition;
+  prepareBatches(drawList);
+  if (_cullInstances.empty()) {
+    return;
+  }
+
+  // The previous use of the frame has finished with the buffer it retired.
+  frame.retiredVisibilityBuffer.reset();
+  if (_depthPyramidSet) {
+    reserveVisibilities(cmdBuffer, frame);
+  }
+  // Sets keep the visibilities of an earlier occlusion culling, the shader ignores them.
+  auto const visibilityBuffer =
+      _depthPyramidSet ? _visibilityBuffer.getBuffer() : frame.visibilityBuffer;
+  if (reserveBuffers(frame) || instanceBuffer != frame.instanceBuffer
+      || visibilityBuffer != frame.visibilityBuffer) {
+    frame.instanceBuffer = instanceBuffer;
+    frame.visibilityBuffer = visibilityBuffer;
+    writeDescriptorSet(frame);
+  }
+  std::memcpy(frame.cullInstanceBuffer.map().get(), _cullInstances.data(),
+              _cullInstances.size() * sizeof(CullInstance));
+  std::memcpy(frame.batchBuffer.map().get(), _batches.data(),
+              _batches.size() * sizeof(Batch));
+  if (_depthPyramidSet) {
+    std::memcpy(frame.viewBuffer.map().get(), &viewProj, sizeof(viewProj));
+  }
+
+  // The previous use of the frame has finished reading the counts.
+  recordPasses(cmdBuffer, frame, constants::CULL_INSTANCES_PASS);
+}
+
+auto pbr::CullingSystem::recordOcclusionCulling(vk::CommandBuffer cmdBuffer,
+                                                bool const keepEveryVisible) -> void {
+  if (_cullInstances.empty() || !_depthPyramidSet) {
+    return;
+  }
+
+  // The draws of the first phase have to be done with the counts and the instances.
+  ::computeBarrier(cmdBuffer,
+                   vk::PipelineStageFlagBits2::eDrawIndirect
+                       | vk::PipelineStageFlagBits2::eVertexShader,
+                   vk::AccessFlagBits2::eIndirectCommandRead
+                       | vk::AccessFlagBits2::eShaderStorageRead,
+                   vk::PipelineStageFlagBits2::eTransfer
+                       | vk::PipelineStageFlagBits2::eComputeShader,
+                   vk::AccessFlagBits2::eTransferWrite
+                       | vk::AccessFlagBits2::eShaderStorageWrite);
+  recordPasses(cmdBuffer, _frames[_frameIndex],
+               keepEveryVisible ? constants::CULL_VISIBLE_PASS
+                                : constants::CULL_OCCLUDED_PASS);
+}
+
+auto pbr::CullingSystem::recordDraws(vk::CommandBuffer cmdBuffer,
+                                     vk::PipelineLayout layout, vk::Pipeline pipeline,
+                                     bool const bindMaterials) const -> void {
+  if (_cullInstances.empty()) {
+    return;
+  }
+
+  auto const& frame = _frames[_frameIndex];
+  cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+  Material const* lastMaterial = nullptr;
+  Mesh const* lastMesh = nullptr;
+  for (auto const [index, run] : std::views::enumerate(_runs)) {
+    if (bindMaterials && _materialBinding == MaterialBinding::PerMaterial
+        && run.material != lastMaterial) {
+      cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout, 1,
+                                   run.material->getDescriptorSet(), {});
+      lastMaterial = run.material;
+    }
+    if (run.mesh != lastMesh) {
+      cmdBuffer.bindVertexBuffers(0, run.mesh->getVertexBuffer().getBuffer(), {0});
+      cmdBuffer.bindIndexBuffer(run.mesh->getIndexBuffer().getBuffer(), 0,
+                                vk::IndexType::eUint16);
+      lastMesh = run.mesh;
+    }
+
+    cmdBuffer.drawIndexedIndirectCount(
+        frame.drawCommandBuffer.getBuffer(),
+        run.firstBatch * constants::DRAW_COMMAND_STRIDE, frame.runCountBuffer.getBuffer(),
+        index * sizeof(std::uint32_t), run.batchCount, constants::DRAW_COMMAND_STRIDE);
+  }
+}
+
+auto pbr::CullingSystem::getVisibleInstanceBuffer() const noexcept -> vk::Buffer {
+  return _frames[_frameIndex].visibleInstanceBuffer.getBuffer();
+}
+
+auto pbr::CullingSystem::isMeshletCulling() const noexcept -> bool {
+  return _meshletCulling;
+}
+
+auto pbr::CullingSystem::setMeshletCulling(bool const meshletCulling) noexcept -> void {
+  _meshletCulling = meshletCulling;
+}
+
+auto pbr::CullingSystem::getStats() const noexcept -> CullingStats { return _stats; }
+
+auto pbr::CullingSystem::prepareBatches(DrawList const& drawList) -> void {
+  _cullInstances.clear();
+  _batches.clear();
+  _runs.clear();
+
+  // The instances of the draw list are laid out in the order of its items.
+  auto const items = drawList.getItems();
+  std::uint32_t meshletInstances = 0;
+  if (_depthPyramidSet) {
+    ++_visibilityCulling;
+  }
+  for (auto const& batch : drawList.getBatches()) {
+    // Bindless materials do not need to be bound so they never break a run.
+    auto const* const material = _materialBinding == MaterialBinding::PerMaterial
+                                     ? batch.primitive->material.get()
+                                     : nullptr;
+    if (_runs.empty() || _runs.back().material != material
+        || _runs.back().mesh != batch.mesh) {
+      _runs.push_back({
+          .material = material,
+          .mesh = batch.mesh,
+          .firstBatch = static_cast<std::uint32_t>(_batches.size()),
+          .batchCount = 0,
+      });
+    }
+
+    auto const& meshlets = batch.primitive->meshlets;
+    auto const slotCount = 1 + static_cast<std::uint32_t>(meshlets.size());
+    // Only occlusion culling reads the visibilities.
+    _instanceSlots.assign(batch.instanceCount, 0);
+    if (_depthPyramidSet) {
+      for (auto instance = 0u; instance < batch.instanceCount; ++instance) {
+        _instanceSlots[instance] =
+            getVisibilitySlots(items[batch.firstInstance + instance], slotCount);
+      }
+    }
+
+    // The visible instances of a batch are stored in the range of its cull instances.
+    auto const addBatch = [&](std::uint32_t const indexCount,
+                              std::uint32_t const firstIndex,
+                              glm::vec4 const boundingSphere, glm::vec4 const cone,
+                              std::uint32_t const slot) {
+      ++_runs.back().batchCount;
+      auto const batchIndex = static_cast<std::uint32_t>(_batches.size());
+      _batches.push_back({
+          .indexCount = indexCount,
+          .firstIndex = firstIndex,
+          .vertexOffset = static_cast<std::int32_t>(batch.primitive->firstVertex),
+          .firstInstance = static_cast<std::uint32_t>(_cullInstances.size()),
+          .run = static_cast<std::uint32_t>(_runs.size() - 1),
+          .runFirstBatch = _runs.back().firstBatch,
+      });
+      for (auto instance = 0u; instance < batch.instanceCount; ++instance) {
+        _cullInstances.push_back({
+            .boundingSphere = boundingSphere,
+            .cone = cone,
+            .batch = batchIndex,
+            .instance = batch.firstInstance + instance,
+            .visibility = _instanceSlots[instance] + slot,
+            .padding = {},
+        });
+      }
+    };
+    if (_meshletCulling && !meshlets.empty()) {
+      for (auto const [index, meshlet] : std::views::enumerate(meshlets)) {
+        addBatch(meshlet.indexCount, meshlet.firstIndex, meshlet.boundingSphere,
+                 meshlet.cone, 1 + static_cast<std::uint32_t>(index));
+      }
+      meshletInstances +=
+          static_cast<std::uint32_t>(meshlets.size()) * batch.instanceCount;
+    } else {
+      addBatch(batch.primitive->indexCount, batch.primitive->firstIndex,
+               batch.primitive->boundingSphere, {0.0f, 0.0f, 0.0f, 1.0f}, 0);
+    }
+  }
+  if (_depthPyramidSet) {
+    releaseVisibilities();
+  }
+
+  _stats = {
+      .instances = static_cast<std::uint32_t>(_cullInstances.size()),
+      .batches = static_cast<std::uint32_t>(_batches.size()),
+      .meshletInstances = meshletInstances,
+      .indirectDraws = static_cast<std::uint32_t>(_runs.size()),
+  };
+}
+
+auto pbr::CullingSystem::getVisibilitySlots(DrawItem const& item,
+                                            std::uint32_t const slotCount)
+    -> std::uint32_t {
+  auto [range, inserted] = _visibilityRanges.try_emplace(
+      VisibilityKey {.handle = item.handle, .primitiveIndex = item.primitiveIndex});
+  // The node may draw another mesh now, which needs a range of its own.
+  if (!inserted && range->second.count != slotCount) {
+    releaseVisibilities(range->second);
+    inserted = true;
+  }
+  if (inserted) {
+    auto& freeRanges = _freeVisibilityRanges[slotCount];
+    if (freeRanges.empty()) {
+      range->second = {.first = _visibilitySlotCount, .count = slotCount, .culling = {}};
+      _visibilitySlotCount += slotCount;
+    } else {
+      range->second = {.first = freeRanges.back(), .count = slotCount, .culling = {}};
+      freeRanges.pop_back();
+      _staleVisibilityRanges.push_back(range->second);
+    }
+  }
+  range->second.culling = _visibilityCulling;
+  return range->second.first;
+}
+
+auto pbr::CullingSystem::releaseVisibilities() -> void {
+  std::erase_if(_visibilityRanges, [this](auto const& entry) {
+    if (entry.second.culling == _visibilityCulling) {
+      return false;
+    }
+    releaseVisibilities(entry.second);
+    return true;
+  });
+}
+
+auto pbr::CullingSystem::releaseVisibilities(VisibilityRange const range) -> void {
+  // Ranges are only reused by primitives with as many slots, so the buffer stops growing
+  // once every mesh had as many instances as it ever has at once.
+  _freeVisibilityRanges[range.count].push_back(range.first);
+}
+
+auto pbr::CullingSystem::reserveBuffers(Frame& frame) -> bool {
+  auto const instanceCount = static_cast<vk::DeviceSize>(_cullInstances.size());
+  auto const batchCount = static_cast<vk::DeviceSize>(_batches.size());
+  auto const runCount = static_cast<vk::DeviceSize>(_runs.size());
+
+  // Every buffer has to be reserved, so none of these can short circuit.
+  std::array const grew {
+      isOcclusionCullingSupported()
+          && frame.viewBuffer.reserve(*_allocator, sizeof(glm::mat4x4)),
+      frame.cullInstanceBuffer.reserve(*_allocator, instanceCount * sizeof(CullInstance)),
+      frame.batchBuffer.reserve(*_allocator, batchCount * sizeof(Batch)),
+      frame.instanceCountBuffer.reserve(*_allocator, batchCount * sizeof(std::uint32_t)),
+      frame.visibleInstanceBuffer.reserve(*_allocator,
+                                          instanceCount * sizeof(std::uint32_t)),
+      frame.drawCommandBuffer.reserve(*_allocator,
+                                      batchCount * constants::DRAW_COMMAND_STRIDE),
+      frame.runCountBuffer.reserve(*_allocator, runCount * sizeof(std::uint32_t)),
+  };
+  return std::ranges::contains(grew, true);
+}
+
+auto pbr::CullingSystem::reserveVisibilities(vk::CommandBuffer cmdBuffer, Frame& frame)
+    -> void {
+  // The culling of the previous frame writes the visibilities read by this one.
+  ::computeBarrier(cmdBuffer, vk::PipelineStageFlagBits2::eComputeShader,
+                   vk::AccessFlagBits2::eShaderStorageWrite,
+                   vk::PipelineStageFlagBits2::eTransfer
+                       | vk::PipelineStageFlagBits2::eComputeShader,
+                   vk::AccessFlagBits2::eTransferRead
+                       | vk::AccessFlagBits2::eShaderStorageRead
+                       | vk::AccessFlagBits2::eShaderStorageWrite);
+
+  auto const size =
+      static_cast<vk::DeviceSize>(_visibilitySlotCount) * sizeof(std::uint32_t);
+  if (!_visibilityBuffer.getBuffer() || _visibilityBuffer.getCapacity() < size) {
+    // Earlier frames in flight may still use the old buffer, this frame keeps it alive
+    // until it is used again instead of waiting for them.
+    auto retired = std::exchange(_visibilityBuffer, ::makeVisibilityBuffer());
+    _visibilityBuffer.reserve(*_allocator, size);
+    vk::DeviceSize kept = 0;
+    if (retired.getBuffer()) {
+      kept = retired.getCapacity();
+      cmdBuffer.copyBuffer(retired.getBuffer(), _visibilityBuffer.getBuffer(),
+                           vk::BufferCopy {.size = kept});
+      frame.retiredVisibilityBuffer.emplace(std::move(retired));
+    }
+    // New slots were never drawn, so the second phase tests them. The barrier after the
+    // counts are cleared makes the copy visible to the culling.
+    cmdBuffer.fillBuffer(_visibilityBuffer.getBuffer(), kept, vk::WholeSize, 0);
+    if (kept != 0 && !_staleVisibilityRanges.empty()) {
+      ::computeBarrier(cmdBuffer, vk::PipelineStageFlagBits2::eTransfer,
+                       vk::AccessFlagBits2::eTransferWrite,
+                       vk::PipelineStageFlagBits2::eTransfer,
+                       vk::AccessFlagBits2::eTransferWrite);
+    }
+  }
+  // Reused slots still hold the visibilities of the primitive that released them.
+  for (auto const range : _staleVisibilityRanges) {
+    cmdBuffer.fillBuffer(_visibilityBuffer.getBuffer(),
+                         static_cast<vk::DeviceSize>(range.first) * sizeof(std::uint32_t),
+                         static_cast<vk::DeviceSize>(range.count) * sizeof(std::uint32_t),
+                         0);
+  }
+  _staleVisibilityRanges.clear();
+}
+
+auto pbr::CullingSystem::writeDescriptorSet(Frame const& frame) -> void {
+  std::array const buffers {
+      frame.instanceBuffer,
+      frame.cullInstanceBuffer.getBuffer(),
+      frame.batchBuffer.getBuffer(),
+      frame.instanceCountBuffer.getBuffer(),
+      frame.visibleInstanceBuffer.getBuffer(),
+      frame.drawCommandBuffer.getBuffer(),
+      frame.runCountBuffer.getBuffer(),
+      frame.visibilityBuffer,
+      frame.viewBuffer.getBuffer(),
+  };
+  std::array<vk::DescriptorBufferInfo, constants::BINDING_COUNT> bufferInfos {};
+  std::array<vk::WriteDescriptorSet, constants::BINDING_COUNT> writes {};
+  for (auto const [index, buffer] : std::views::enumerate(buffers)) {
+    bufferInfos[index] = {
+        .buffer = buffer,
+        .range = vk::WholeSize,
+    };
+    writes[index] = vk::WriteDescriptorSet {
+        .dstSet = frame.descSet.get(),
+        .dstBinding = static_cast<std::uint32_t>(index),
+        .descriptorType = vk::DescriptorType::eStorageBuffer,
+    }
+                        .setBufferInfo(bufferInfos[index]);
+  }
+  // The bindings of the occlusion shader are left unwritten until it is used.
+  auto const writeCount = frame.visibilityBuffer ? constants::BINDING_COUNT
+                                                 : constants::FRUSTUM_BINDING_COUNT;
+  // The previous use of the frame has finished so the set is not in use.
+  _gpu->getDevice().updateDescriptorSets(std::span(writes).first(writeCount), {});
+}
+
+auto pbr::CullingSystem::recordPasses(vk::CommandBuffer cmdBuffer, Frame const& frame,
+                                      std::uint32_t const cullPass) const -> void {
+  cmdBuffer.fillBuffer(frame.instanceCountBuffer.getBuffer(), 0, vk::WholeSize, 0);
+  cmdBuffer.fillBuffer(frame.runCountBuffer.getBuffer(), 0, vk::WholeSize, 0);
+  ::computeBarrier(cmdBuffer, vk::PipelineStageFlagBits2::eTransfer,
+                   vk::AccessFlagBits2::eTransferWrite,
+                   vk::PipelineStageFlagBits2::eComputeShader,
+                   vk::AccessFlagBits2::eShaderStorageRead
+                       | vk::AccessFlagBits2::eShaderStorageWrite);
+
+  auto const layout = _depthPyramidSet ? _occlusionLayout.get() : _layout.get();
+  cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute,
+                         _depthPyramidSet ? _occlusionPipeline.get() : _pipeline.get());
+  if (_depthPyramidSet) {
+    cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, layout, 0,
+                                 std::array {frame.descSet.get(), _depthPyramidSet}, {});
+  } else {
+    cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, layout, 0,
+                                 frame.descSet.get(), {});
+  }
+
+  PushConstants pushConstants {
+      .planes = _planes,
+      .cameraPosition = {_cameraPosition, 1.0f},
+      .pass = cullPass,
+      .count = static_cast<std::uint32_t>(_cullInstances.size()),
+  };
+  cmdBuffer.pushConstants(layout, vk::ShaderStageFlagBits::eCompute, 0,
+                          sizeof(PushConstants), &pushConstants);
+  cmdBuffer.dispatch(::getDispatchSize(pushConstants.count), 1, 1);
+
+  ::computeBarrier(cmdBuffer, vk::PipelineStageFlagBits2::eComputeShader,
+                   vk::AccessFlagBits2::eShaderStorageWrite,
+                   vk::PipelineStageFlagBits2::eComputeShader,
+                   vk::AccessFlagBits2::eShaderStorageRead
+                       | vk::AccessFlagBits2::eShaderStorageWrite);
+
+  pushConstants.pass = constants::WRITE_COMMANDS_PASS;
+  pushConstants.count = static_cast<std::uint32_t>(_batches.size());
+  cmdBuffer.pushConstants(layout, vk::ShaderStageFlagBits::eCompute, 0,
+                          sizeof(PushConstants), &pushConstants);
+  cmdBuffer.dispatch(::getDispatchSize(pushConstants.count), 1, 1);
+
+  ::computeBarrier(cmdBuffer, vk::PipelineStageFlagBits2::eComputeShader,
+                   vk::AccessFlagBits2::eShaderStorageWrite,
+                   vk::PipelineStageFlagBits2::eDrawIndirect
+                       | vk::PipelineStageFlagBits2::eVertexShader,
+                   vk::AccessFlagBits2::eIndirectCommandRead
+                       | vk::AccessFlagBits2::eShaderStorageRead);
+}
@@ -0,0 +1,292 @@
+#pragma once
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/core/GpuHandle.hpp"
+
+#include "pbr/DrawList.hpp"
+#include "pbr/Frustum.hpp"
+#include "pbr/GrowableBuffer.hpp"
+#include "pbr/Material.hpp"
+#include "pbr/Mesh.hpp"
+#include "pbr/Scene.hpp"
+#include "pbr/memory/IAllocator.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+
+namespace pbr {
+/**
+ * Counters describing the work recorded by the last CullingSystem::recordCulling call.
+ */
+struct CullingStats {
+  std::uint32_t instances {};
+  std::uint32_t batches {};
+  /// Instances of meshlets, every one of them is also counted as an instance.
+  std::uint32_t meshletInstances {};
+  /// The number of drawIndexedIndirectCount calls needed to draw the batches.
+  std::uint32_t indirectDraws {};
+};
+/**
+ * Frustum culls the instances of a DrawList on the gpu and draws the visible ones with
+ * indirect draws.
+ *
+ * A first compute pass tests the bounding sphere of every instance and appends the
+ * visible ones to the instance range of their batch. A second pass writes a compacted
+ * VkDrawIndexedIndirectCommand for every batch with visible instances, so the geometry
+ * pass never looks at culled batches.
+ *
+ * Batches sharing a material and a mesh form a run which is drawn by a single
+ * drawIndexedIndirectCount, every mesh owns its own vertex and index buffers so a run is
+ * the largest range that can be drawn without rebinding. With bindless materials runs
+ * only break between meshes.
+ *
+ * With meshlet culling every meshlet of a primitive becomes a batch of its own, which is
+ * culled against the frustum and by its normal cone for every instance.
+ *
+ * Occlusion culling splits this into two phases. The first one only draws the instances
+ * that were visible at the end of the previous frame, their depth is reduced into a
+ * DepthPyramidSystem pyramid and the second phase tests every instance against it. The
+ * newly visible instances are drawn on top and the result is kept for the next frame.
+ * Visibilities are kept by node, primitive, level of detail and meshlet, so they survive
+ * the draw list being culled and sorted differently every frame.
+ */
+class CullingSystem {
+public:
+  /// Mirrors CullInstance of the culling shader.
+  struct CullInstance {
+    glm::vec4 boundingSphere;
+    /// See Meshlet::cone, instances of whole primitives are never backfacing.
+    glm::vec4 cone;
+    std::uint32_t batch;
+    /// The instance of the draw list the bounds are transformed by.
+    std::uint32_t instance;
+    /// The slot of the visibility buffer, it stays the same across frames.
+    std::uint32_t visibility;
+    std::uint32_t padding;
+  };
+  /// Mirrors Batch of the culling shader.
+  struct Batch {
+    std::uint32_t indexCount;
+    std::uint32_t firstIndex;
+    std::int32_t vertexOffset;
+    std::uint32_t firstInstance;
+    std::uint32_t run;
+    std::uint32_t runFirstBatch;
+  };
+  struct PushConstants {
+    FrustumPlanes planes;
+    /// The position of the camera in xyz, w is unused.
+    glm::vec4 cameraPosition;
+    std::uint32_t pass;
+    std::uint32_t count;
+  };
+
+private:
+  /// A primitive of a node at a level of detail.
+  struct VisibilityKey {
+    NodeHandle handle;
+    std::uint32_t primitiveIndex;
+
+    [[nodiscard]]
+    constexpr auto operator==(VisibilityKey const&) const noexcept -> bool = default;
+  };
+  struct VisibilityKeyHash {
+    [[nodiscard]]
+    auto operator()(VisibilityKey const& key) const noexcept -> std::size_t;
+  };
+  /// The visibility slots of a primitive of a node, the first one is for the whole
+  /// primitive and every meshlet has one after it.
+  struct VisibilityRange {
+    std::uint32_t first;
+    std::uint32_t count;
+    /// The last occlusion culling that drew the primitive.
+    std::uint32_t culling;
+  };
+  struct Run {
+    Material const* material;
+    Mesh const* mesh;
+    std::uint32_t firstBatch;
+    std::uint32_t batchCount;
+  };
+  /// Buffers written while culling, every frame in flight has its own.
+  struct Frame {
+    vk::UniqueDescriptorSet descSet;
+    GrowableBuffer cullInstanceBuffer;
+    GrowableBuffer batchBuffer;
+    GrowableBuffer instanceCountBuffer;
+    GrowableBuffer visibleInstanceBuffer;
+    GrowableBuffer drawCommandBuffer;
+    GrowableBuffer runCountBuffer;
+    /// The view projection the occlusion test projects the bounds with.
+    GrowableBuffer viewBuffer;
+    /// The buffers the descriptor set was last written with.
+    vk::Buffer instanceBuffer {};
+    vk::Buffer visibilityBuffer {};
+    /// The visibility buffer this frame grew out of, earlier frames in flight may still
+    /// use it until the frame is used again.
+    std::optional<GrowableBuffer> retiredVisibilityBuffer = std::nullopt;
+  };
+
+  core::SharedGpuHandle _gpu;
+  std::shared_ptr<IAllocator> _allocator;
+  MaterialBinding _materialBinding;
+
+  vk::UniqueDescriptorSetLayout _descLayout;
+  vk::UniquePipelineLayout _layout;
+  vk::UniquePipeline _pipeline;
+  vk::UniqueDescriptorPool _descPool;
+
+  vk::UniquePipelineLayout _occlusionLayout;
+  vk::UniquePipeline _occlusionPipeline;
+  /// Whether every instance was visible, shared by the frames in flight so every frame
+  /// reads the result of the one before it.
+  GrowableBuffer _visibilityBuffer;
+  std::unordered_map<VisibilityKey, VisibilityRange, VisibilityKeyHash> _visibilityRanges;
+  /// The first slots of released ranges by their slot counts.
+  std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> _freeVisibilityRanges;
+  /// Reused ranges which still hold the visibilities of their previous primitive.
+  std::vector<VisibilityRange> _staleVisibilityRanges;
+  std::uint32_t _visibilitySlotCount = 0;
+  std::uint32_t _visibilityCulling = 0;
+  /// The pyramid of the last culling, it is only set when occlusion culling.
+  vk::DescriptorSet _depthPyramidSet {};
+  FrustumPlanes _planes {};
+  glm::vec3 _cameraPosition {};
+  bool _meshletCulling = false;
+
+  std::vector<Frame> _frames;
+  /// The frame that was culled last, its buffers are used by recordDraws.
+  std::uint32_t _frameIndex = 0;
+
+  std::vector<CullInstance> _cullInstances;
+  /// The first visibility slot of every instance of the batch being prepared.
+  std::vector<std::uint32_t> _instanceSlots;
+  std::vector<Batch> _batches;
+  std::vector<Run> _runs;
+  CullingStats _stats {};
+
+public:
+  /**
+   * @param frameCount The number of frames in flight.
+   * @param occlusionShader Optional, the culling shader compiled for occlusion culling.
+   * @param depthPyramidSetLayout The layout of the pyramid the occlusion shader reads.
+   */
+  CullingSystem(core::SharedGpuHandle gpu, std::shared_ptr<IAllocator> allocator,
+                vk::PipelineShaderStageCreateInfo shader,
+                MaterialBinding materialBinding = MaterialBinding::PerMaterial,
+                std::uint32_t frameCount = 1,
+                vk::PipelineShaderStageCreateInfo occlusionShader = {},
+                vk::DescriptorSetLayout depthPyramidSetLayout = {});
+
+  /**
+   * @returns Whether the device supports every feature needed by the culling system.
+   */
+  [[nodiscard]]
+  static auto isSupported(core::GpuHandle const& gpu) noexcept -> bool;
+
+  /**
+   * @returns Whether the occlusion pipeline was created, this needs its shader.
+   */
+  [[nodiscard]]
+  auto isOcclusionCullingSupported() const noexcept -> bool;
+
+  /**
+   * Records the culling passes of the draw list, this has to be recorded outside of a
+   * render pass.
+   * @param frameIndex Selects the buffers of the frame, the gpu must be done with their
+   * previous use.
+   * @param instanceBuffer The buffer holding the instances of the draw list.
+   * @param cameraPosition The world space position meshlets are tested for facing away
+   * from.
+   * @param depthPyramidSet Optional, culls in two phases and this phase only keeps the
+   * instances visible in the previous frame. The pyramid is read by the second phase.
+   * @note Visibilities are kept for every node, primitive and meshlet in the draw list,
+   * ones that were not in the previous one start out as not visible.
+   */
+  auto recordCulling(vk::CommandBuffer cmdBuffer, std::uint32_t frameIndex,
+                     DrawList const& drawList, vk::Buffer instanceBuffer,
+                     glm::mat4x4 const& viewProj, glm::vec3 cameraPosition,
+                     vk::DescriptorSet depthPyramidSet = {}) -> void;
+
+  /**
+   * Records the second phase of occlusion culling, which replaces the draws of the first
+   * one. This has to be recorded outside of a render pass after the draws of the first
+   * phase and the pyramid built from their depth.
+   * @param keepEveryVisible Draws every visible instance instead of only the ones the
+   * first phase did not draw, for passes that need all of them.
+   * @note Does nothing unless recordCulling was given a pyramid.
+   */
+  auto recordOcclusionCulling(vk::CommandBuffer cmdBuffer, bool keepEveryVisible = false)
+      -> void;
+
+  /**
+   * Records the indirect draws of the last culled draw list.
+   * @param bindMaterials Pipelines that only write depth do not need the materials.
+   * @note Materials are bound to set 1 unless they are bindless and the instances have to
+   * be readable through getVisibleInstanceBuffer.
+   */
+  auto recordDraws(vk::CommandBuffer cmdBuffer, vk::PipelineLayout layout,
+                   vk::Pipeline pipeline, bool bindMaterials = true) const -> void;
+
+  /**
+   * @returns The buffer mapping gl_InstanceIndex of the indirect draws to the instances.
+   */
+  [[nodiscard]]
+  auto getVisibleInstanceBuffer() const noexcept -> vk::Buffer;
+
+  [[nodiscard]]
+  auto isMeshletCulling() const noexcept -> bool;
+
+  /**
+   * Switches between culling the primitives with meshlets meshlet by meshlet and culling
+   * every primitive as a whole.
+   */
+  auto setMeshletCulling(bool meshletCulling) noexcept -> void;
+
+  [[nodiscard]]
+  auto getStats() const noexcept -> CullingStats;
+
+private:
+  /**
+   * Converts the batches of the draw list into their gpu representation and runs.
+   */
+  auto prepareBatches(DrawList const& drawList) -> void;
+  /**
+   * @returns The first visibility slot of the item, followed by slotCount - 1 more.
+   */
+  [[nodiscard]]
+  auto getVisibilitySlots(DrawItem const& item, std::uint32_t slotCount) -> std::uint32_t;
+  /**
+   * Releases the ranges of every primitive that was not in the draw list, their nodes
+   * may have been removed.
+   */
+  auto releaseVisibilities() -> void;
+  auto releaseVisibilities(VisibilityRange range) -> void;
+  /**
+   * Makes sure every buffer of the frame fits the prepared batches.
+   * @returns Whether any buffer was reallocated.
+   */
+  auto reserveBuffers(Frame& frame) -> bool;
+  /**
+   * Makes sure every visibility slot fits and clears the reused ones, a grown buffer
+   * keeps the visibilities of the previous one and the old buffer is kept alive by the
+   * frame.
+   */
+  auto reserveVisibilities(vk::CommandBuffer cmdBuffer, Frame& frame) -> void;
+  auto writeDescriptorSet(Frame const& frame) -> void;
+  /**
+   * Records the pass culling the instances with the pass writing the draw commands.
+   */
+  auto recordPasses(vk::CommandBuffer cmdBuffer, Frame const& frame,
+                    std::uint32_t cullPass) const -> void;
+};
+} // namespace pbr
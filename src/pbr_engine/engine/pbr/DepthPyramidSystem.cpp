@@ -0,0 +1,284 @@
+#include "pbr/DepthPyramidSystem.hpp"
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/core/GpuHandle.hpp"
+
+#include "pbr/DescriptorSetAllocator.hpp"
+#include "pbr/GBuffer.hpp"
+#include "pbr/Image.hpp"
+#include "pbr/memory/IAllocator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace constants {
+static constexpr std::uint32_t INPUT_BINDING = 0;
+static constexpr std::uint32_t OUTPUT_BINDING = 1;
+} // namespace constants
+
+namespace {
+[[nodiscard]]
+constexpr auto createSampler(pbr::core::GpuHandle const& gpu) -> vk::UniqueSampler {
+  // Texels are fetched, so the sampler only has to reach every level.
+  return gpu.getDevice().createSamplerUnique({
+      .magFilter = vk::Filter::eNearest,
+      .minFilter = vk::Filter::eNearest,
+      .mipmapMode = vk::SamplerMipmapMode::eNearest,
+      .addressModeU = vk::SamplerAddressMode::eClampToEdge,
+      .addressModeV = vk::SamplerAddressMode::eClampToEdge,
+      .addressModeW = vk::SamplerAddressMode::eClampToEdge,
+      .maxLod = vk::LodClampNone,
+  });
+}
+[[nodiscard]]
+constexpr auto createLevelSetLayout(pbr::core::GpuHandle const& gpu, vk::Sampler sampler)
+    -> vk::UniqueDescriptorSetLayout {
+  std::array const bindings {
+      vk::DescriptorSetLayoutBinding {
+          .binding = constants::INPUT_BINDING,
+          .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+          .descriptorCount = 1,
+          .stageFlags = vk::ShaderStageFlagBits::eCompute,
+          .pImmutableSamplers = &sampler,
+      },
+      vk::DescriptorSetLayoutBinding {
+          .binding = constants::OUTPUT_BINDING,
+          .descriptorType = vk::DescriptorType::eStorageImage,
+          .descriptorCount = 1,
+          .stageFlags = vk::ShaderStageFlagBits::eCompute,
+      },
+  };
+  return gpu.getDevice().createDescriptorSetLayoutUnique(
+      vk::DescriptorSetLayoutCreateInfo {}.setBindings(bindings));
+}
+[[nodiscard]]
+constexpr auto createReadSetLayout(pbr::core::GpuHandle const& gpu, vk::Sampler sampler)
+    -> vk::UniqueDescriptorSetLayout {
+  vk::DescriptorSetLayoutBinding const binding {
+      .binding = 0,
+      .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+      .descriptorCount = 1,
+      .stageFlags = vk::ShaderStageFlagBits::eCompute,
+      .pImmutableSamplers = &sampler,
+  };
+  return gpu.getDevice().createDescriptorSetLayoutUnique(
+      vk::DescriptorSetLayoutCreateInfo {}.setBindings(binding));
+}
+[[nodiscard]]
+constexpr auto createPipelineLayout(pbr::core::GpuHandle const& gpu,
+                                    vk::DescriptorSetLayout descLayout)
+    -> vk::UniquePipelineLayout {
+  return gpu.getDevice().createPipelineLayoutUnique(
+      vk::PipelineLayoutCreateInfo {}.setSetLayouts(descLayout));
+}
+[[nodiscard]]
+constexpr auto createPipeline(pbr::core::GpuHandle const& gpu, vk::PipelineLayout layout,
+                              vk::PipelineShaderStageCreateInfo shader)
+    -> vk::UniquePipeline {
+  auto [result, pipeline] = gpu.getDevice().createComputePipelineUnique(
+      nullptr, {
+                   .stage = shader,
+                   .layout = layout,
+               });
+  assert(result == vk::Result::eSuccess);
+  return std::move(pipeline);
+}
+[[nodiscard]]
+constexpr auto createDescriptorPool(pbr::core::GpuHandle const& gpu)
+    -> vk::UniqueDescriptorPool {
+  // A set for every level and the one reading the whole pyramid.
+  static constexpr auto SET_COUNT = pbr::DepthPyramidSystem::MAX_LEVELS + 1;
+  std::array const sizes {
+      vk::DescriptorPoolSize {
+          .type = vk::DescriptorType::eCombinedImageSampler,
+          .descriptorCount = SET_COUNT,
+      },
+      vk::DescriptorPoolSize {
+          .type = vk::DescriptorType::eStorageImage,
+          .descriptorCount = pbr::DepthPyramidSystem::MAX_LEVELS,
+      },
+  };
+  return gpu.getDevice().createDescriptorPoolUnique(vk::DescriptorPoolCreateInfo {
+      .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+      .maxSets = SET_COUNT,
+  }
+                                                        .setPoolSizes(sizes));
+}
+[[nodiscard]]
+constexpr auto createView(pbr::core::GpuHandle const& gpu, vk::Image image,
+                          std::uint32_t baseLevel, std::uint32_t levelCount)
+    -> vk::UniqueImageView {
+  return gpu.getDevice().createImageViewUnique({
+      .image = image,
+      .viewType = vk::ImageViewType::e2D,
+      .format = pbr::DepthPyramidSystem::FORMAT,
+      .subresourceRange {
+          .aspectMask = vk::ImageAspectFlagBits::eColor,
+          .baseMipLevel = baseLevel,
+          .levelCount = levelCount,
+          .layerCount = 1,
+      },
+  });
+}
+constexpr auto computeBarrier(vk::CommandBuffer cmdBuffer) -> void {
+  vk::MemoryBarrier2 const barrier {
+      .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+      .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+      .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+      .dstAccessMask = vk::AccessFlagBits2::eShaderSampledRead,
+  };
+  cmdBuffer.pipelineBarrier2(vk::DependencyInfo {}.setMemoryBarriers(barrier));
+}
+} // namespace
+
+pbr::DepthPyramidSystem::DepthPyramidSystem(core::SharedGpuHandle gpu,
+                                            vk::PipelineShaderStageCreateInfo shader)
+    : _gpu(std::move(gpu))
+    , _sampler(::createSampler(*_gpu))
+    , _levelSetLayout(::createLevelSetLayout(*_gpu, _sampler.get()))
+    , _readSetLayout(::createReadSetLayout(*_gpu, _sampler.get()))
+    , _layout(::createPipelineLayout(*_gpu, _levelSetLayout.get()))
+    , _pipeline(::createPipeline(*_gpu, _layout.get(), shader))
+    , _descPool(::createDescriptorPool(*_gpu)) {}
+
+auto pbr::DepthPyramidSystem::update(IAllocator& allocator, GBuffer const& gBuffer)
+    -> void {
+  auto const depth = gBuffer.getDepth().getImageView();
+  if (_pyramid.has_value() && _pyramid->depth == depth) {
+    return;
+  }
+  // The sets of the previous pyramid go back to the pool first.
+  _pyramid.reset();
+
+  auto const extent = getExtent(gBuffer.getExtent());
+  auto const levelCount = getLevelCount(extent);
+  Image image = allocator.allocateImage(
+      {
+          .imageType = vk::ImageType::e2D,
+          .format = FORMAT,
+          .extent {
+              .width = extent.width,
+              .height = extent.height,
+              .depth = 1,
+          },
+          .mipLevels = levelCount,
+          .arrayLayers = 1,
+          .usage = vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled,
+      },
+      {});
+
+  std::vector<vk::UniqueImageView> levelViews;
+  levelViews.reserve(levelCount);
+  for (auto level = 0u; level < levelCount; ++level) {
+    levelViews.push_back(::createView(*_gpu, image.getImage(), level, 1));
+  }
+  auto view = ::createView(*_gpu, image.getImage(), 0, levelCount);
+
+  auto& pyramid = _pyramid.emplace(Pyramid {
+      .image = std::move(image),
+      .extent = extent,
+      .depth = depth,
+      .view = std::move(view),
+      .levelViews = std::move(levelViews),
+      .levelSets = DescriptorSetAllocator(_gpu, _descPool.get(), _levelSetLayout.get())
+                       .allocate(levelCount),
+      .readSet = DescriptorSetAllocator(_gpu, _descPool.get(), _readSetLayout.get())
+                     .allocate(),
+  });
+  writeDescriptorSets(pyramid);
+}
+
+auto pbr::DepthPyramidSystem::record(vk::CommandBuffer cmdBuffer) const -> void {
+  auto const& pyramid = *_pyramid;
+  auto const levelCount = static_cast<std::uint32_t>(pyramid.levelViews.size());
+
+  // The previous contents are rebuilt, the culling of an earlier frame may still read
+  // them.
+  vk::ImageMemoryBarrier2 const imageBarrier {
+      .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+      .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+      .dstAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+      .newLayout = vk::ImageLayout::eGeneral,
+      .image = pyramid.image.getImage(),
+      .subresourceRange {
+          .aspectMask = vk::ImageAspectFlagBits::eColor,
+          .levelCount = levelCount,
+          .layerCount = 1,
+      },
+  };
+  cmdBuffer.pipelineBarrier2(vk::DependencyInfo {}.setImageMemoryBarriers(imageBarrier));
+
+  cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, _pipeline.get());
+  for (auto level = 0u; level < levelCount; ++level) {
+    cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, _layout.get(), 0,
+                                 pyramid.levelSets[level].get(), {});
+    auto const width = std::max(pyramid.extent.width >> level, 1u);
+    auto const height = std::max(pyramid.extent.height >> level, 1u);
+    cmdBuffer.dispatch((width + LOCAL_SIZE - 1) / LOCAL_SIZE,
+                       (height + LOCAL_SIZE - 1) / LOCAL_SIZE, 1);
+    // The next level or the culling reads the written level.
+    ::computeBarrier(cmdBuffer);
+  }
+}
+
+auto pbr::DepthPyramidSystem::getDescriptorSetLayout() const noexcept
+    -> vk::DescriptorSetLayout {
+  return _readSetLayout.get();
+}
+
+auto pbr::DepthPyramidSystem::getDescriptorSet() const noexcept -> vk::DescriptorSet {
+  return _pyramid->readSet.get();
+}
+
+auto pbr::DepthPyramidSystem::writeDescriptorSets(Pyramid const& pyramid) const -> void {
+  auto const levelCount = pyramid.levelViews.size();
+  // The infos are referenced by the writes, so they must not reallocate.
+  std::vector<vk::DescriptorImageInfo> imageInfos;
+  imageInfos.reserve((levelCount * 2) + 1);
+  std::vector<vk::WriteDescriptorSet> writes;
+  writes.reserve((levelCount * 2) + 1);
+
+  for (auto level = 0uz; level < levelCount; ++level) {
+    auto const descSet = pyramid.levelSets[level].get();
+    // The first level reduces the depth, every other one the level before it.
+    imageInfos.push_back({
+        .imageView =
+            level == 0 ? pyramid.depth : pyramid.levelViews[level - 1].get(),
+        .imageLayout = level == 0 ? vk::ImageLayout::eShaderReadOnlyOptimal
+                                  : vk::ImageLayout::eGeneral,
+    });
+    writes.push_back(vk::WriteDescriptorSet {
+        .dstSet = descSet,
+        .dstBinding = constants::INPUT_BINDING,
+        .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+    }
+                         .setImageInfo(imageInfos.back()));
+    imageInfos.push_back({
+        .imageView = pyramid.levelViews[level].get(),
+        .imageLayout = vk::ImageLayout::eGeneral,
+    });
+    writes.push_back(vk::WriteDescriptorSet {
+        .dstSet = descSet,
+        .dstBinding = constants::OUTPUT_BINDING,
+        .descriptorType = vk::DescriptorType::eStorageImage,
+    }
+                         .setImageInfo(imageInfos.back()));
+  }
+
+  imageInfos.push_back({
+      .imageView = pyramid.view.get(),
+      .imageLayout = vk::ImageLayout::eGeneral,
+  });
+  writes.push_back(vk::WriteDescriptorSet {
+      .dstSet = pyramid.readSet.get(),
+      .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+  }
+                       .setImageInfo(imageInfos.back()));
+
+  _gpu->getDevice().updateDescriptorSets(writes, {});
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/core/GpuHandle.hpp"
+
+#include "pbr/GBuffer.hpp"
+#include "pbr/Image.hpp"
+#include "pbr/memory/IAllocator.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include <glm/common.hpp>
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/vector_float2.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+
+namespace pbr {
+/**
+ * The part of the screen covered by a bounding volume and its nearest depth.
+ */
+struct ScreenBounds {
+  /// Corners of the covered rectangle from 0 to 1, clamped to the screen.
+  glm::vec2 min;
+  glm::vec2 max;
+  float depth;
+};
+/**
+ * Projects the box enclosing a sphere onto the screen.
+ * @param sphere The world space center of the sphere in xyz and its radius in w.
+ * @returns The bounds or nothing if the box reaches behind the camera.
+ * @note Mirrors the occlusion test of the culling shader.
+ */
+[[nodiscard]]
+constexpr auto projectSphere(glm::mat4x4 const& viewProj, glm::vec4 sphere) noexcept
+    -> std::optional<ScreenBounds>;
+/**
+ * Builds a hierarchical depth buffer from the depth of a g-buffer in a compute pass.
+ *
+ * The first level has half the size of the depth and every further level halves the one
+ * before it down to a single texel. Every texel holds the farthest depth of the texels it
+ * covers, so a bounding volume is hidden if its nearest depth is behind the few texels of
+ * the level matching its size on the screen.
+ */
+class DepthPyramidSystem {
+public:
+  static constexpr auto FORMAT = vk::Format::eR32Sfloat;
+  /// Width and height of the workgroups of the shader.
+  static constexpr std::uint32_t LOCAL_SIZE = 8;
+  /// Enough for a 65536 pixel wide depth buffer.
+  static constexpr std::uint32_t MAX_LEVELS = 16;
+
+private:
+  struct Pyramid {
+    Image image;
+    vk::Extent2D extent;
+    /// The depth the pyramid was built for.
+    vk::ImageView depth;
+    /// View of every level, read by the culling shader.
+    vk::UniqueImageView view;
+    std::vector<vk::UniqueImageView> levelViews;
+    /// Reads the depth or the level before and writes a level.
+    std::vector<vk::UniqueDescriptorSet> levelSets;
+    vk::UniqueDescriptorSet readSet;
+  };
+
+  core::SharedGpuHandle _gpu;
+
+  vk::UniqueSampler _sampler;
+  vk::UniqueDescriptorSetLayout _levelSetLayout;
+  vk::UniqueDescriptorSetLayout _readSetLayout;
+  vk::UniquePipelineLayout _layout;
+  vk::UniquePipeline _pipeline;
+  vk::UniqueDescriptorPool _descPool;
+
+  std::optional<Pyramid> _pyramid = std::nullopt;
+
+public:
+  DepthPyramidSystem(core::SharedGpuHandle gpu, vk::PipelineShaderStageCreateInfo shader);
+
+  /**
+   * @returns The size of the first level of the pyramid of a depth buffer.
+   */
+  [[nodiscard]]
+  static constexpr auto getExtent(vk::Extent2D depthExtent) noexcept -> vk::Extent2D;
+  /**
+   * @returns The number of levels down to a single texel.
+   */
+  [[nodiscard]]
+  static constexpr auto getLevelCount(vk::Extent2D extent) noexcept -> std::uint32_t;
+
+  /**
+   * Makes sure the pyramid matches the depth of the g-buffer, this has to be called
+   * before the descriptor set is bound.
+   * @note The pyramid is shared by every frame in flight, like the g-buffer the gpu has
+   * to be done with it when the g-buffer changes.
+   */
+  auto update(IAllocator& allocator, GBuffer const& gBuffer) -> void;
+
+  /**
+   * Records the passes building the pyramid, this has to be recorded outside of a render
+   * pass.
+   * @note The depth of the g-buffer has to be readable by the compute stage, the pyramid
+   * is left readable by the compute stage.
+   */
+  auto record(vk::CommandBuffer cmdBuffer) const -> void;
+
+  /**
+   * @returns The layout of the set holding the pyramid as a combined image sampler at
+   * binding 0.
+   */
+  [[nodiscard]]
+  auto getDescriptorSetLayout() const noexcept -> vk::DescriptorSetLayout;
+  /**
+   * @note The pyramid has to be updated.
+   */
+  [[nodiscard]]
+  auto getDescriptorSet() const noexcept -> vk::DescriptorSet;
+
+private:
+  auto writeDescriptorSets(Pyramid const& pyramid) const -> void;
+};
+} // namespace pbr
+
+/* IMPLEMENTATIONS */
+
+constexpr auto pbr::projectSphere(glm::mat4x4 const& viewProj,
+                                  glm::vec4 const sphere) noexcept
+    -> std::optional<ScreenBounds> {
+  glm::vec3 minNdc {1e30f};
+  glm::vec3 maxNdc {-1e30f};
+  for (auto corner = 0u; corner < 8; ++corner) {
+    glm::vec3 const offset {
+        (corner & 1u) != 0 ? sphere.w : -sphere.w,
+        (corner & 2u) != 0 ? sphere.w : -sphere.w,
+        (corner & 4u) != 0 ? sphere.w : -sphere.w,
+    };
+    auto const clip = viewProj * glm::vec4(glm::vec3(sphere) + offset, 1.0f);
+    if (clip.w <= 0.0f) {
+      return std::nullopt;
+    }
+    auto const ndc = glm::vec3(clip) / clip.w;
+    minNdc = glm::min(minNdc, ndc);
+    maxNdc = glm::max(maxNdc, ndc);
+  }
+  return ScreenBounds {
+      .min = glm::clamp((glm::vec2(minNdc) * 0.5f) + 0.5f, 0.0f, 1.0f),
+      .max = glm::clamp((glm::vec2(maxNdc) * 0.5f) + 0.5f, 0.0f, 1.0f),
+      .depth = minNdc.z,
+  };
+}
+
+constexpr auto pbr::DepthPyramidSystem::getExtent(vk::Extent2D const depthExtent) noexcept
+    -> vk::Extent2D {
+  return {
+      .width = std::max(depthExtent.width / 2, 1u),
+      .height = std::max(depthExtent.height / 2, 1u),
+  };
+}
+
+constexpr auto pbr::DepthPyramidSystem::getLevelCount(vk::Extent2D const extent) noexcept
+    -> std::uint32_t {
+  return std::min(static_cast<std::uint32_t>(
+                      std::bit_width(std::max(extent.width, extent.height))),
+                  MAX_LEVELS);
+}
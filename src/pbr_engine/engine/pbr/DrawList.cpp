@@ -0,0 +1,225 @@
+#include "pbr/DrawList.hpp"
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/InstanceData.hpp"
+#include "pbr/Lod.hpp"
+#include "pbr/Material.hpp"
+#include "pbr/Mesh.hpp"
+#include "pbr/Scene.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace constants {
+static constexpr std::uint32_t RADIX_BITS = 8;
+static constexpr std::uint32_t RADIX_BUCKETS = 1u << RADIX_BITS;
+static constexpr std::uint32_t RADIX_PASSES = 64 / RADIX_BITS;
+/// Low bits of the primitive field of a key holding the level of detail.
+static constexpr std::uint32_t LOD_BITS = 3;
+} // namespace constants
+
+namespace {
+/**
+ * @returns The id of the key, new keys get the next free id.
+ */
+[[nodiscard]]
+auto getId(auto& ids, auto const& key) -> std::uint32_t {
+  return ids.try_emplace(key, static_cast<std::uint32_t>(ids.size())).first->second;
+}
+} // namespace
+
+auto pbr::sortDrawItems(std::vector<DrawItem>& items, std::vector<DrawItem>& scratch)
+    -> void {
+  scratch.resize(items.size());
+
+  for (auto pass = 0u; pass < constants::RADIX_PASSES; ++pass) {
+    auto const shift = pass * constants::RADIX_BITS;
+    auto const digit = [shift](DrawItem const& item) {
+      return static_cast<std::size_t>(item.key >> shift)
+             & (constants::RADIX_BUCKETS - 1);
+    };
+
+    std::array<std::size_t, constants::RADIX_BUCKETS> offsets {};
+    for (auto const& item : items) {
+      ++offsets[digit(item)];
+    }
+    // Most of the key bits are the same for every item, those passes would only copy.
+    if (std::ranges::contains(offsets, items.size())) {
+      continue;
+    }
+
+    std::size_t sum = 0;
+    for (auto& offset : offsets) {
+      sum += std::exchange(offset, sum);
+    }
+    for (auto const& item : items) {
+      scratch[offsets[digit(item)]++] = item;
+    }
+    std::swap(items, scratch);
+  }
+}
+
+auto pbr::DrawList::build(Scene const& scene, vk::Pipeline pipeline,
+                         std::span<std::uint8_t const> const visibleNodes,
+                         std::optional<LodSelection> const& lodSelection) -> void {
+  _items.clear();
+
+  auto const pipelineId = ::getId(_pipelineIds, static_cast<VkPipeline>(pipeline));
+  auto const worldMatrices = scene.getWorldMatrices();
+  auto const normalMatrices = scene.getNormalMatrices();
+  auto const handles = scene.getHandles();
+  for (auto const [node, mesh] : std::views::enumerate(scene.getMeshes())) {
+    if (!mesh || (!visibleNodes.empty() && visibleNodes[node] == 0)) {
+      continue;
+    }
+    auto const meshId = ::getId(_meshIds, mesh.get());
+    for (auto const [index, primitive] : std::views::enumerate(mesh->getPrimitives())) {
+      auto const materialId = ::getId(_materialIds, primitive.material.get());
+      auto const level =
+          lodSelection.has_value()
+              ? pbr::selectLod(primitive, worldMatrices[node], *lodSelection)
+              : 0u;
+      // Every level of detail is its own primitive to the batches.
+      auto const lodPrimitive =
+          (static_cast<std::uint32_t>(index) << constants::LOD_BITS) | level;
+      _items.push_back({
+          .key = pbr::makeDrawKey(pipelineId, materialId, meshId, lodPrimitive),
+          .node = static_cast<std::uint32_t>(node),
+          .handle = handles[node],
+          .primitiveIndex = lodPrimitive,
+          .pipeline = pipeline,
+          .mesh = mesh.get(),
+          .primitive = level == 0 ? &primitive : &primitive.lods[level - 1],
+      });
+    }
+  }
+
+  pbr::sortDrawItems(_items, _scratch);
+
+  _batches.clear();
+  _instances.clear();
+  for (auto const& item : _items) {
+    // The ids in the key can wrap around, so the state itself is compared.
+    if (_batches.empty() || _batches.back().pipeline != item.pipeline
+        || _batches.back().mesh != item.mesh
+        || _batches.back().primitive != item.primitive) {
+      _batches.push_back({
+          .pipeline = item.pipeline,
+          .mesh = item.mesh,
+          .primitive = item.primitive,
+          .firstInstance = static_cast<std::uint32_t>(_instances.size()),
+          .instanceCount = 0,
+      });
+    }
+    ++_batches.back().instanceCount;
+    _instances.push_back({
+        .model = worldMatrices[item.node],
+        .normalModel = normalMatrices[item.node],
+        .material = item.primitive->material->getBindlessIndex(),
+        .padding = {},
+    });
+  }
+}
+
+auto pbr::DrawList::record(vk::CommandBuffer cmdBuffer, vk::PipelineLayout layout,
+                          MaterialBinding const materialBinding) -> void {
+  _stats = recordBatches(cmdBuffer, layout, materialBinding, 0, _batches.size());
+}
+
+auto pbr::DrawList::recordBatches(vk::CommandBuffer cmdBuffer, vk::PipelineLayout layout,
+                                  MaterialBinding const materialBinding,
+                                  std::size_t const firstBatch,
+                                  std::size_t const batchCount) const -> DrawListStats {
+  auto const batches = std::span(_batches).subspan(firstBatch, batchCount);
+  DrawListStats stats {
+      .draws = static_cast<std::uint32_t>(batches.size()),
+  };
+
+  vk::Pipeline lastPipeline {};
+  Material const* lastMaterial = nullptr;
+  Mesh const* lastMesh = nullptr;
+  for (auto const& batch : batches) {
+    stats.instances += batch.instanceCount;
+    stats.triangles += (batch.primitive->indexCount / 3) * batch.instanceCount;
+    if (batch.pipeline != lastPipeline) {
+      cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, batch.pipeline);
+      lastPipeline = batch.pipeline;
+      ++stats.pipelineBinds;
+    }
+    if (materialBinding == MaterialBinding::PerMaterial
+        && batch.primitive->material.get() != lastMaterial) {
+      cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout, 1,
+                                   batch.primitive->material->getDescriptorSet(), {});
+      lastMaterial = batch.primitive->material.get();
+      ++stats.materialBinds;
+    }
+    if (batch.mesh != lastMesh) {
+      cmdBuffer.bindVertexBuffers(0, batch.mesh->getVertexBuffer().getBuffer(), {0});
+      cmdBuffer.bindIndexBuffer(batch.mesh->getIndexBuffer().getBuffer(), 0,
+                                vk::IndexType::eUint16);
+      lastMesh = batch.mesh;
+      ++stats.meshBinds;
+    }
+
+    cmdBuffer.drawIndexed(batch.primitive->indexCount, batch.instanceCount,
+                          batch.primitive->firstIndex,
+                          static_cast<std::int32_t>(batch.primitive->firstVertex),
+                          batch.firstInstance);
+  }
+
+  // Bindless materials are never bound per draw, so they would not be bound per instance
+  // either.
+  auto const bindsPerInstance = materialBinding == MaterialBinding::PerMaterial ? 3u : 2u;
+  stats.bindsAvoided = (stats.instances * bindsPerInstance) - stats.pipelineBinds
+                       - stats.materialBinds - stats.meshBinds;
+  return stats;
+}
+
+auto pbr::DrawList::recordDepth(vk::CommandBuffer cmdBuffer,
+                               vk::Pipeline pipeline) const -> void {
+  if (_batches.empty()) {
+    return;
+  }
+
+  cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+  Mesh const* lastMesh = nullptr;
+  for (auto const& batch : _batches) {
+    if (batch.mesh != lastMesh) {
+      cmdBuffer.bindVertexBuffers(0, batch.mesh->getVertexBuffer().getBuffer(), {0});
+      cmdBuffer.bindIndexBuffer(batch.mesh->getIndexBuffer().getBuffer(), 0,
+                                vk::IndexType::eUint16);
+      lastMesh = batch.mesh;
+    }
+
+    cmdBuffer.drawIndexed(batch.primitive->indexCount, batch.instanceCount,
+                          batch.primitive->firstIndex,
+                          static_cast<std::int32_t>(batch.primitive->firstVertex),
+                          batch.firstInstance);
+  }
+}
+
+auto pbr::DrawList::setStats(DrawListStats const stats) noexcept -> void {
+  _stats = stats;
+}
+
+auto pbr::DrawList::getItems() const noexcept -> std::span<DrawItem const> {
+  return _items;
+}
+
+auto pbr::DrawList::getBatches() const noexcept -> std::span<DrawBatch const> {
+  return _batches;
+}
+
+auto pbr::DrawList::getInstances() const noexcept -> std::span<InstanceData const> {
+  return _instances;
+}
+
+auto pbr::DrawList::getStats() const noexcept -> DrawListStats { return _stats; }
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/InstanceData.hpp"
+#include "pbr/Lod.hpp"
+#include "pbr/Material.hpp"
+#include "pbr/Mesh.hpp"
+#include "pbr/Scene.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace pbr {
+/**
+ * How the materials of draws are bound to set 1.
+ */
+enum struct MaterialBinding : std::uint8_t {
+  /// Every material binds its own descriptor set.
+  PerMaterial,
+  /// A MaterialRegistry set is bound once and materials are indexed per instance.
+  Bindless,
+};
+/**
+ * A single primitive draw of a scene node.
+ */
+struct DrawItem {
+  /// Sort key, see makeDrawKey.
+  std::uint64_t key;
+  /// Dense index of the node inside the scene.
+  std::uint32_t node;
+  /// Stays the same when the scene is compacted, unlike the dense index.
+  NodeHandle handle;
+  /// Index of the primitive inside the mesh, the low bits hold the level of detail.
+  std::uint32_t primitiveIndex;
+  vk::Pipeline pipeline;
+  Mesh const* mesh;
+  PrimitiveSpan const* primitive;
+};
+/**
+ * Consecutive instances of the same primitive drawn with a single instanced draw.
+ */
+struct DrawBatch {
+  vk::Pipeline pipeline;
+  Mesh const* mesh;
+  PrimitiveSpan const* primitive;
+  std::uint32_t firstInstance;
+  std::uint32_t instanceCount;
+};
+/**
+ * Counters describing the commands recorded for a DrawList.
+ */
+struct DrawListStats {
+  std::uint32_t draws {};
+  std::uint32_t instances {};
+  std::uint32_t pipelineBinds {};
+  std::uint32_t materialBinds {};
+  std::uint32_t meshBinds {};
+  std::uint32_t triangles {};
+  /// Binds skipped compared to binding everything the material binding binds per draw
+  /// for every instance.
+  std::uint32_t bindsAvoided {};
+
+  /**
+   * Accumulates the counters of separately recorded ranges of a draw list.
+   */
+  constexpr auto operator+=(DrawListStats const& other) noexcept -> DrawListStats&;
+};
+/**
+ * Builds the sort key of a draw, items with equal state end up next to each other.
+ *
+ * From the most significant bit the key holds 8 bits of pipeline id, 20 bits of material
+ * id, 24 bits of mesh id and 12 bits of primitive index. Ids wider than their field wrap
+ * around which only worsens the grouping.
+ */
+[[nodiscard]]
+constexpr auto makeDrawKey(std::uint32_t pipelineId, std::uint32_t materialId,
+                           std::uint32_t meshId, std::uint32_t primitive) noexcept
+    -> std::uint64_t;
+/**
+ * Stable LSD radix sort of the items by their key.
+ * @param scratch Storage reused between sorts, it is resized to the item count.
+ */
+auto sortDrawItems(std::vector<DrawItem>& items, std::vector<DrawItem>& scratch) -> void;
+/**
+ * Sorted list of draws compiled from a Scene that records with minimal state changes.
+ *
+ * Nodes that draw the same primitive with the same pipeline are merged into one instanced
+ * draw, their transforms are laid out as InstanceData in the order of the batches.
+ */
+class DrawList {
+  std::vector<DrawItem> _items;
+  std::vector<DrawItem> _scratch;
+  std::vector<DrawBatch> _batches;
+  std::vector<InstanceData> _instances;
+  // Ids are persistent so keys stay the same between frames. They are never released,
+  // a reused address only ends up sharing an id which does not affect correctness.
+  std::unordered_map<VkPipeline, std::uint32_t> _pipelineIds;
+  std::unordered_map<Material const*, std::uint32_t> _materialIds;
+  std::unordered_map<Mesh const*, std::uint32_t> _meshIds;
+  DrawListStats _stats {};
+
+public:
+  /**
+   * Collects every primitive of the scene, sorts them by state and merges them into
+   * instanced batches.
+   * @param visibleNodes Optional, one entry per node and nodes whose entry is 0 are not
+   * drawn.
+   * @param lodSelection Optional, primitives are drawn with the level of detail picked
+   * by selectLod instead of their full triangles.
+   */
+  auto build(Scene const& scene, vk::Pipeline pipeline,
+             std::span<std::uint8_t const> visibleNodes = {},
+             std::optional<LodSelection> const& lodSelection = std::nullopt) -> void;
+
+  /**
+   * Records the batches, only binding state that differs from the previous batch.
+   * @note Materials are bound to set 1 and the instances returned by getInstances have to
+   * be readable by the pipeline through gl_InstanceIndex. With bindless materials nothing
+   * is bound to set 1.
+   */
+  auto record(vk::CommandBuffer cmdBuffer, vk::PipelineLayout layout,
+              MaterialBinding materialBinding = MaterialBinding::PerMaterial) -> void;
+
+  /**
+   * Records batchCount batches starting at firstBatch like record does.
+   * @returns Counters of the recorded range.
+   * @note This does not modify the draw list, so disjoint ranges can be recorded into
+   * different command buffers concurrently. The pipeline is always bound by the first
+   * batch of the range.
+   */
+  auto recordBatches(vk::CommandBuffer cmdBuffer, vk::PipelineLayout layout,
+                     MaterialBinding materialBinding, std::size_t firstBatch,
+                     std::size_t batchCount) const -> DrawListStats;
+
+  /**
+   * Records every batch with pipeline instead of their own and without binding
+   * materials, for passes that only write depth.
+   * @note This does not change the counters returned by getStats.
+   */
+  auto recordDepth(vk::CommandBuffer cmdBuffer, vk::Pipeline pipeline) const -> void;
+
+  /**
+   * Sets the counters returned by getStats, used when ranges were recorded separately.
+   */
+  auto setStats(DrawListStats stats) noexcept -> void;
+
+  [[nodiscard]]
+  auto getItems() const noexcept -> std::span<DrawItem const>;
+
+  [[nodiscard]]
+  auto getBatches() const noexcept -> std::span<DrawBatch const>;
+
+  [[nodiscard]]
+  auto getInstances() const noexcept -> std::span<InstanceData const>;
+
+  [[nodiscard]]
+  auto getStats() const noexcept -> DrawListStats;
+};
+} // namespace pbr
+
+/* IMPLEMENTATIONS */
+
+constexpr auto pbr::DrawListStats::operator+=(DrawListStats const& other) noexcept
+    -> DrawListStats& {
+  draws += other.draws;
+  instances += other.instances;
+  pipelineBinds += other.pipelineBinds;
+  materialBinds += other.materialBinds;
+  meshBinds += other.meshBinds;
+  triangles += other.triangles;
+  bindsAvoided += other.bindsAvoided;
+  return *this;
+}
+
+constexpr auto pbr::makeDrawKey(std::uint32_t pipelineId, std::uint32_t materialId,
+                                std::uint32_t meshId, std::uint32_t primitive) noexcept
+    -> std::uint64_t {
+  constexpr std::uint64_t pipelineMask = (1u << 8u) - 1u;
+  constexpr std::uint64_t materialMask = (1u << 20u) - 1u;
+  constexpr std::uint64_t meshMask = (1u << 24u) - 1u;
+  constexpr std::uint64_t primitiveMask = (1u << 12u) - 1u;
+  return ((pipelineId & pipelineMask) << 56u) | ((materialId & materialMask) << 36u)
+         | ((meshId & meshMask) << 12u) | (primitive & primitiveMask);
+}
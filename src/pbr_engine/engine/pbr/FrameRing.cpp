@@ -0,0 +1,119 @@
+#include "pbr/FrameRing.hpp"
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/core/GpuHandle.hpp"
+
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <ranges>
+#include <utility>
+#include <vector>
+
+namespace {
+[[nodiscard]]
+auto createFrames(pbr::core::GpuHandle const& gpu, vk::CommandPool cmdPool,
+                  std::uint32_t frameCount) -> std::vector<pbr::FrameContext> {
+  auto cmdBuffers = gpu.getDevice().allocateCommandBuffersUnique({
+      .commandPool = cmdPool,
+      .commandBufferCount = frameCount,
+  });
+
+  std::vector<pbr::FrameContext> frames;
+  frames.reserve(frameCount);
+  for (auto const [index, cmdBuffer] : std::views::enumerate(cmdBuffers)) {
+    frames.push_back({
+        .index = static_cast<std::uint32_t>(index),
+        .cmdBuffer = std::move(cmdBuffer),
+        .imageAvailable = gpu.getDevice().createSemaphoreUnique({}),
+        .renderDone = gpu.getDevice().createSemaphoreUnique({}),
+        // The first use of a slot must not wait.
+        .inFlight = gpu.getDevice().createFenceUnique(
+            {.flags = vk::FenceCreateFlagBits::eSignaled}),
+    });
+  }
+  return frames;
+}
+} // namespace
+
+pbr::FrameRing::FrameRing(core::SharedGpuHandle gpu, std::uint32_t const frameCount)
+    : _gpu(std::move(gpu))
+    , _cmdPool(_gpu->getDevice().createCommandPoolUnique({
+          .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+          .queueFamilyIndex =
+              _gpu->getPhysicalDeviceProperties().graphicsTransferPresentQueue,
+      }))
+    , _frames(::createFrames(*_gpu, _cmdPool.get(), frameCount)) {
+  assert(frameCount > 0);
+}
+
+pbr::FrameRing::~FrameRing() noexcept {
+  if (_gpu) {
+    waitIdle();
+  }
+}
+
+auto pbr::FrameRing::beginFrame() -> FrameContext& {
+  auto& frame = _frames[_current];
+
+  _stats.framesInFlight = 0;
+  for (auto const& other : _frames) {
+    if (&other != &frame
+        && _gpu->getDevice().getFenceStatus(other.inFlight.get())
+               == vk::Result::eNotReady) {
+      ++_stats.framesInFlight;
+    }
+  }
+
+  auto const waitStart = std::chrono::steady_clock::now();
+  [[maybe_unused]]
+  auto const result = _gpu->getDevice().waitForFences(
+      frame.inFlight.get(), vk::True, std::numeric_limits<std::uint64_t>::max());
+  assert(result == vk::Result::eSuccess);
+  _stats.fenceWait = std::chrono::steady_clock::now() - waitStart;
+
+  frame.cmdBuffer->reset();
+  return frame;
+}
+
+auto pbr::FrameRing::submit(FrameContext const& frame,
+                            vk::PipelineStageFlags const waitDstStageMask) -> void {
+  assert(frame.index == _current);
+  // The fence is only reset here, a frame that is never submitted must not block the
+  // slot forever.
+  _gpu->getDevice().resetFences(frame.inFlight.get());
+  _gpu->getQueue().submit(vk::SubmitInfo {}
+                              .setWaitSemaphores(frame.imageAvailable.get())
+                              .setWaitDstStageMask(waitDstStageMask)
+                              .setCommandBuffers(frame.cmdBuffer.get())
+                              .setSignalSemaphores(frame.renderDone.get()),
+                          frame.inFlight.get());
+
+  _current = (_current + 1) % getFrameCount();
+}
+
+auto pbr::FrameRing::submit(FrameContext const& frame) -> void {
+  assert(frame.index == _current);
+  _gpu->getDevice().resetFences(frame.inFlight.get());
+  _gpu->getQueue().submit(vk::SubmitInfo {}.setCommandBuffers(frame.cmdBuffer.get()),
+                          frame.inFlight.get());
+
+  _current = (_current + 1) % getFrameCount();
+}
+
+auto pbr::FrameRing::waitIdle() const -> void {
+  for (auto const& frame : _frames) {
+    [[maybe_unused]]
+    auto const result = _gpu->getDevice().waitForFences(
+        frame.inFlight.get(), vk::True, std::numeric_limits<std::uint64_t>::max());
+    assert(result == vk::Result::eSuccess);
+  }
+}
+
+auto pbr::FrameRing::getFrameCount() const noexcept -> std::uint32_t {
+  return static_cast<std::uint32_t>(_frames.size());
+}
+
+auto pbr::FrameRing::getStats() const noexcept -> FrameRingStats { return _stats; }
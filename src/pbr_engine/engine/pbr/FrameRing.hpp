@@ -0,0 +1,91 @@
+#pragma once
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/core/GpuHandle.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace pbr {
+/**
+ * Command buffer and synchronization objects of a single frame in flight.
+ */
+struct FrameContext {
+  /// The slot of the frame in the ring, per frame resources are selected with it.
+  std::uint32_t index;
+  vk::UniqueCommandBuffer cmdBuffer;
+  /// Signaled once the swapchain image of the frame is available.
+  vk::UniqueSemaphore imageAvailable;
+  /// Signaled once the frame is rendered and can be presented.
+  vk::UniqueSemaphore renderDone;
+  /// Signaled once the gpu has finished executing the frame.
+  vk::UniqueFence inFlight;
+};
+/**
+ * Describes how much the cpu and the gpu overlapped when the last frame began.
+ */
+struct FrameRingStats {
+  /// The number of previous frames the gpu was still executing.
+  std::uint32_t framesInFlight {};
+  /// The time the cpu waited for the slot of the frame to become available.
+  std::chrono::nanoseconds fenceWait {};
+};
+/**
+ * Ring of frame contexts, the cpu records a frame while the gpu still executes the
+ * previous ones.
+ *
+ * Resources the cpu writes every frame have to be duplicated per frame and selected with
+ * FrameContext::index, a slot is only handed out again once the gpu is done with it.
+ */
+class FrameRing {
+  core::SharedGpuHandle _gpu;
+  vk::UniqueCommandPool _cmdPool;
+  std::vector<FrameContext> _frames;
+  std::uint32_t _current = 0;
+  FrameRingStats _stats {};
+
+public:
+  /**
+   * @param frameCount The number of frames that can be in flight at once.
+   */
+  FrameRing(core::SharedGpuHandle gpu, std::uint32_t frameCount);
+
+  FrameRing(const FrameRing&) = delete;
+  auto operator=(const FrameRing&) -> FrameRing& = delete;
+
+  FrameRing(FrameRing&&) = default;
+  auto operator=(FrameRing&&) -> FrameRing& = default;
+
+  ~FrameRing() noexcept;
+
+  /**
+   * Waits until the gpu has finished the frame that last used the next slot.
+   * @returns The context of the next frame, its command buffer is reset.
+   */
+  auto beginFrame() -> FrameContext&;
+  /**
+   * Submits the command buffer of the frame and moves on to the next slot.
+   * @param waitDstStageMask The stages that have to wait for the swapchain image.
+   */
+  auto submit(FrameContext const& frame, vk::PipelineStageFlags waitDstStageMask)
+      -> void;
+  /**
+   * Submits the command buffer of a frame rendered offscreen, it neither waits for a
+   * swapchain image nor signals that it can be presented.
+   */
+  auto submit(FrameContext const& frame) -> void;
+  /**
+   * Waits until every submitted frame has finished, after this resources shared between
+   * frames can be replaced.
+   */
+  auto waitIdle() const -> void;
+
+  [[nodiscard]]
+  auto getFrameCount() const noexcept -> std::uint32_t;
+
+  [[nodiscard]]
+  auto getStats() const noexcept -> FrameRingStats;
+};
+} // namespace pbr
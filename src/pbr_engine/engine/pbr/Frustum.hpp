@@ -0,0 +1,101 @@
+#pragma once
+
+#include "pbr/BoundingBox.hpp"
+
+#include <algorithm>
+#include <array>
+
+#include <glm/common.hpp>
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+#include <glm/geometric.hpp>
+#include <glm/matrix.hpp>
+
+namespace pbr {
+/**
+ * The left, right, bottom, top, near and far planes of a frustum. Each plane is stored
+ * as a normalized normal pointing inside in xyz and the distance in w.
+ */
+using FrustumPlanes = std::array<glm::vec4, 6>;
+/**
+ * Extracts the world space frustum planes of a view projection matrix.
+ * @note The near plane is the one of a -w..w clip space depth, for a 0..w depth this is
+ * conservative.
+ */
+[[nodiscard]]
+constexpr auto extractFrustumPlanes(glm::mat4x4 const& viewProj) noexcept
+    -> FrustumPlanes;
+/**
+ * @param sphere The center of the sphere in xyz and its radius in w.
+ * @returns Whether the sphere is at least partially inside the frustum.
+ */
+[[nodiscard]]
+constexpr auto isSphereInFrustum(FrustumPlanes const& planes, glm::vec4 sphere) noexcept
+    -> bool;
+/**
+ * @returns Whether the box is at least partially inside the frustum.
+ * @note Boxes near the edges of the frustum that are outside of it but not behind any
+ * single plane are reported as inside.
+ */
+[[nodiscard]]
+constexpr auto isBoxInFrustum(FrustumPlanes const& planes,
+                              BoundingBox const& box) noexcept -> bool;
+/**
+ * Moves a sphere into the space of a model matrix, the radius is scaled by the largest
+ * scale of the matrix.
+ * @note Mirrors the culling shader.
+ */
+[[nodiscard]]
+constexpr auto transformSphere(glm::mat4x4 const& model, glm::vec4 sphere) noexcept
+    -> glm::vec4;
+} // namespace pbr
+
+/* IMPLEMENTATIONS */
+
+constexpr auto pbr::extractFrustumPlanes(glm::mat4x4 const& viewProj) noexcept
+    -> FrustumPlanes {
+  auto const rows = glm::transpose(viewProj);
+  FrustumPlanes planes {
+      rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1],
+      rows[3] - rows[1], rows[3] + rows[2], rows[3] - rows[2],
+  };
+  for (auto& plane : planes) {
+    plane /= glm::length(glm::vec3(plane));
+  }
+  return planes;
+}
+
+constexpr auto pbr::isSphereInFrustum(FrustumPlanes const& planes,
+                                      glm::vec4 const sphere) noexcept -> bool {
+  for (auto const& plane : planes) {
+    if (glm::dot(glm::vec3(plane), glm::vec3(sphere)) + plane.w < -sphere.w) {
+      return false;
+    }
+  }
+  return true;
+}
+
+constexpr auto pbr::isBoxInFrustum(FrustumPlanes const& planes,
+                                   BoundingBox const& box) noexcept -> bool {
+  auto const center = (box.min + box.max) * 0.5f;
+  auto const extent = (box.max - box.min) * 0.5f;
+  for (auto const& plane : planes) {
+    // The distance of the corner furthest along the normal.
+    auto const distance = glm::dot(glm::vec3(plane), center) + plane.w
+                          + glm::dot(glm::abs(glm::vec3(plane)), extent);
+    if (distance < 0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+constexpr auto pbr::transformSphere(glm::mat4x4 const& model,
+                                    glm::vec4 const sphere) noexcept -> glm::vec4 {
+  auto const center = glm::vec3(model * glm::vec4(glm::vec3(sphere), 1.0f));
+  auto const scale = std::max({glm::length(glm::vec3(model[0])),
+                               glm::length(glm::vec3(model[1])),
+                               glm::length(glm::vec3(model[2]))});
+  return {center, sphere.w * scale};
+}
@@ -0,0 +1,206 @@
+#include "pbr/FrustumCuller.hpp"
+
+#include "pbr/BoundingBox.hpp"
+#include "pbr/CpuKernels.hpp"
+#include "pbr/Frustum.hpp"
+#include "pbr/Scene.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ranges>
+#include <span>
+#include <vector>
+
+#include <glm/common.hpp>
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/vector_float3.hpp>
+
+#ifdef PBR_AVX2_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace {
+/**
+ * The LANES boxes starting at the same index of every component.
+ */
+struct Lanes {
+  std::array<float const*, 3> centers;
+  std::array<float const*, 3> extents;
+  std::uint8_t* visible;
+
+  [[nodiscard]]
+  constexpr auto offset(std::size_t const first) const noexcept -> Lanes {
+    return {
+        .centers = {centers[0] + first, centers[1] + first, centers[2] + first},
+        .extents = {extents[0] + first, extents[1] + first, extents[2] + first},
+        .visible = visible + first,
+    };
+  }
+};
+/**
+ * Tests count boxes, a multiple of LANES, lane by lane.
+ * @note Sums in the same order as isBoxInFrustum.
+ */
+auto testBoxesScalar(pbr::FrustumPlanes const& planes, Lanes const boxes,
+                     std::size_t const count) noexcept -> void {
+  for (auto first = 0uz; first < count; first += pbr::FrustumCuller::LANES) {
+    auto const lanes = boxes.offset(first);
+    std::array<bool, pbr::FrustumCuller::LANES> inside {};
+    inside.fill(true);
+    // Every plane is applied to all lanes at once, so the compiler can vectorize it.
+    for (auto const& plane : planes) {
+      auto const normal = glm::vec3(plane);
+      auto const absNormal = glm::abs(normal);
+      for (auto lane = 0uz; lane < pbr::FrustumCuller::LANES; ++lane) {
+        auto const center = (normal.x * lanes.centers[0][lane])
+                            + (normal.y * lanes.centers[1][lane])
+                            + (normal.z * lanes.centers[2][lane]);
+        auto const extent = (absNormal.x * lanes.extents[0][lane])
+                            + (absNormal.y * lanes.extents[1][lane])
+                            + (absNormal.z * lanes.extents[2][lane]);
+        inside[lane] = inside[lane] && (center + plane.w + extent) >= 0.0f;
+      }
+    }
+    for (auto lane = 0uz; lane < pbr::FrustumCuller::LANES; ++lane) {
+      lanes.visible[lane] = inside[lane] ? 1 : 0;
+    }
+  }
+}
+#ifdef PBR_AVX2_KERNELS
+// Lambdas are not compiled for the target of the function around them, so the AVX2
+// kernels only call functions of their own target.
+[[nodiscard]]
+PBR_TARGET_AVX2
+auto dotAvx2(glm::vec3 const weights, std::array<__m256, 3> const& values) noexcept
+    -> __m256 {
+  auto const x = _mm256_mul_ps(_mm256_set1_ps(weights.x), values[0]);
+  auto const y = _mm256_mul_ps(_mm256_set1_ps(weights.y), values[1]);
+  auto const z = _mm256_mul_ps(_mm256_set1_ps(weights.z), values[2]);
+  return _mm256_add_ps(_mm256_add_ps(x, y), z);
+}
+/**
+ * Tests count boxes, a multiple of LANES, LANES at a time.
+ * @note Sums in the same order as isBoxInFrustum.
+ */
+PBR_TARGET_AVX2
+auto testBoxesAvx2(pbr::FrustumPlanes const& planes, Lanes const boxes,
+                   std::size_t const count) noexcept -> void {
+  for (auto first = 0uz; first < count; first += pbr::FrustumCuller::LANES) {
+    auto const lanes = boxes.offset(first);
+    std::array<__m256, 3> center {};
+    std::array<__m256, 3> extent {};
+    for (auto axis = 0uz; axis < 3; ++axis) {
+      center[axis] = _mm256_loadu_ps(lanes.centers[axis]);
+      extent[axis] = _mm256_loadu_ps(lanes.extents[axis]);
+    }
+
+    auto inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (auto const& plane : planes) {
+      auto const normal = glm::vec3(plane);
+      auto const distance = _mm256_add_ps(
+          _mm256_add_ps(::dotAvx2(normal, center), _mm256_set1_ps(plane.w)),
+          ::dotAvx2(glm::abs(normal), extent));
+      inside = _mm256_and_ps(inside,
+                             _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_GE_OQ));
+    }
+    auto const mask = static_cast<std::uint32_t>(_mm256_movemask_ps(inside));
+    for (auto lane = 0u; lane < pbr::FrustumCuller::LANES; ++lane) {
+      lanes.visible[lane] = static_cast<std::uint8_t>((mask >> lane) & 1u);
+    }
+  }
+}
+#endif
+} // namespace
+
+pbr::FrustumCuller::FrustumCuller(CpuKernels const kernels) noexcept
+    : _kernels(pbr::getSupportedCpuKernels(kernels)) {}
+
+auto pbr::FrustumCuller::getKernels() const noexcept -> CpuKernels { return _kernels; }
+
+auto pbr::FrustumCuller::cull(FrustumPlanes const& planes,
+                              std::span<BoundingBox const> const boxes)
+    -> std::span<std::uint8_t const> {
+  clearBoxes();
+  for (auto const& box : boxes) {
+    addBox(box);
+  }
+  testBoxes(planes);
+  return std::span(_visibleBoxes).first(_boxCount);
+}
+
+auto pbr::FrustumCuller::cull(Scene const& scene, glm::mat4x4 const& viewProj)
+    -> std::span<std::uint8_t const> {
+  auto const meshes = scene.getMeshes();
+  auto const worldMatrices = scene.getWorldMatrices();
+
+  clearBoxes();
+  _nodes.clear();
+  for (auto const [node, mesh] : std::views::enumerate(meshes)) {
+    if (mesh) {
+      addBox(pbr::transformBoundingBox(worldMatrices[node], mesh->getBoundingBox()));
+      _nodes.push_back(static_cast<std::uint32_t>(node));
+    }
+  }
+  testBoxes(pbr::extractFrustumPlanes(viewProj));
+
+  _visibleNodes.assign(meshes.size(), 1);
+  _stats = {};
+  for (auto const [node, visible] : std::views::zip(_nodes, _visibleBoxes)) {
+    _visibleNodes[node] = visible;
+    if (visible != 0) {
+      ++_stats.visibleNodes;
+    } else {
+      ++_stats.culledNodes;
+    }
+  }
+  return _visibleNodes;
+}
+
+auto pbr::FrustumCuller::getStats() const noexcept -> FrustumCullingStats {
+  return _stats;
+}
+
+auto pbr::FrustumCuller::clearBoxes() noexcept -> void {
+  for (auto& components : _centers) {
+    components.clear();
+  }
+  for (auto& components : _extents) {
+    components.clear();
+  }
+  _boxCount = 0;
+}
+
+auto pbr::FrustumCuller::addBox(BoundingBox const& box) -> void {
+  auto const center = (box.min + box.max) * 0.5f;
+  auto const extent = (box.max - box.min) * 0.5f;
+  for (auto axis = 0; axis < 3; ++axis) {
+    _centers[axis].push_back(center[axis]);
+    _extents[axis].push_back(extent[axis]);
+  }
+  ++_boxCount;
+}
+
+auto pbr::FrustumCuller::testBoxes(FrustumPlanes const& planes) -> void {
+  auto const paddedCount = ((_boxCount + LANES - 1) / LANES) * LANES;
+  for (auto& components : _centers) {
+    components.resize(paddedCount);
+  }
+  for (auto& components : _extents) {
+    components.resize(paddedCount);
+  }
+  _visibleBoxes.resize(paddedCount);
+
+  Lanes const boxes {
+      .centers = {_centers[0].data(), _centers[1].data(), _centers[2].data()},
+      .extents = {_extents[0].data(), _extents[1].data(), _extents[2].data()},
+      .visible = _visibleBoxes.data(),
+  };
+#ifdef PBR_AVX2_KERNELS
+  if (_kernels == CpuKernels::Avx2) {
+    ::testBoxesAvx2(planes, boxes, paddedCount);
+    return;
+  }
+#endif
+  ::testBoxesScalar(planes, boxes, paddedCount);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "pbr/BoundingBox.hpp"
+#include "pbr/CpuKernels.hpp"
+#include "pbr/Frustum.hpp"
+#include "pbr/Scene.hpp"
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/ext/matrix_float4x4.hpp>
+
+namespace pbr {
+/**
+ * Counters describing the work done by the last FrustumCuller::cull call.
+ */
+struct FrustumCullingStats {
+  std::uint32_t visibleNodes {};
+  std::uint32_t culledNodes {};
+};
+/**
+ * Culls the nodes of a scene outside of the view frustum on the cpu, so their draws are
+ * never recorded.
+ *
+ * The world space boxes are stored as one array per component of their centers and
+ * extents, so they are tested 8 at a time with AVX2 on cpus supporting it. The scalar
+ * kernel gives the same results as isBoxInFrustum.
+ */
+class FrustumCuller {
+public:
+  /// Boxes tested at once, the width of an AVX register.
+  static constexpr std::uint32_t LANES = 8;
+
+private:
+  CpuKernels _kernels;
+  /// Centers and half extents of the boxes, padded to a multiple of LANES.
+  std::array<std::vector<float>, 3> _centers;
+  std::array<std::vector<float>, 3> _extents;
+  std::uint32_t _boxCount = 0;
+  std::vector<std::uint8_t> _visibleBoxes;
+  /// The node of every box.
+  std::vector<std::uint32_t> _nodes;
+  std::vector<std::uint8_t> _visibleNodes;
+  FrustumCullingStats _stats {};
+
+public:
+  /**
+   * @param kernels Falls back to the scalar kernels if the cpu does not support them.
+   */
+  explicit FrustumCuller(CpuKernels kernels = pbr::getBestCpuKernels()) noexcept;
+
+  [[nodiscard]]
+  auto getKernels() const noexcept -> CpuKernels;
+
+  /**
+   * Tests boxes against the planes.
+   * @returns One entry per box that is 0 if the box is outside, it stays valid until the
+   * next call.
+   */
+  auto cull(FrustumPlanes const& planes, std::span<BoundingBox const> boxes)
+      -> std::span<std::uint8_t const>;
+
+  /**
+   * Tests the world space box of every node with a mesh against the frustum.
+   * @returns One entry per node of the scene that is 0 if the node is outside, it stays
+   * valid until the next call.
+   */
+  auto cull(Scene const& scene, glm::mat4x4 const& viewProj)
+      -> std::span<std::uint8_t const>;
+
+  [[nodiscard]]
+  auto getStats() const noexcept -> FrustumCullingStats;
+
+private:
+  auto clearBoxes() noexcept -> void;
+  auto addBox(BoundingBox const& box) -> void;
+  /**
+   * Fills the visible boxes, the padding is tested as well.
+   */
+  auto testBoxes(FrustumPlanes const& planes) -> void;
+};
+} // namespace pbr
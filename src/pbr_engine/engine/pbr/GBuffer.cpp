@@ -5,91 +5,102 @@
 
 #include "pbr/core/GpuHandle.hpp"
 #include "pbr/memory/IAllocator.hpp"
-#include <array>
+
+#include <cstdint>
+#include <ranges>
 #include <utility>
+#include <vector>
+
+namespace constants {
+/// Comes after the color attachments and the sampler they share.
+static constexpr std::uint32_t DEPTH_BINDING = 4;
+} // namespace constants
 
 namespace {
 [[nodiscard]]
-constexpr auto
-allocateImage2D(pbr::core::GpuHandle const& gpu, pbr::IAllocator& allocator,
-                vk::Extent2D extent, vk::Format format,
-                vk::ImageAspectFlags aspect = vk::ImageAspectFlagBits::eColor,
-                vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eColorAttachment)
-    -> pbr::Image2D {
+constexpr auto makeImageInfo(vk::Extent2D const extent, vk::Format const format,
+                             vk::ImageUsageFlags const usage) noexcept
+    -> vk::ImageCreateInfo {
   return {
-      gpu,
-      format,
-      aspect,
-      allocator.allocateImage(
-          {
-              .imageType = vk::ImageType::e2D,
-              .format = format,
-              .extent {
-                  .width = extent.width,
-                  .height = extent.height,
-                  .depth = 1,
-              },
-              .mipLevels = 1,
-              .arrayLayers = 1,
-              .usage = usage | vk::ImageUsageFlagBits::eSampled,
-          },
-          {}),
+      .imageType = vk::ImageType::e2D,
+      .format = format,
+      .extent {
+          .width = extent.width,
+          .height = extent.height,
+          .depth = 1,
+      },
+      .mipLevels = 1,
+      .arrayLayers = 1,
+      .usage = usage | vk::ImageUsageFlagBits::eSampled,
   };
 }
+[[nodiscard]]
+auto allocateColorAttachments(pbr::core::GpuHandle const& gpu, pbr::IAllocator& allocator,
+                              vk::Extent2D extent, pbr::GBufferLayout layout)
+    -> std::vector<pbr::Image2D> {
+  std::vector<pbr::Image2D> images;
+  // The depth comes after the color attachments.
+  auto const colorCount = pbr::GBuffer::getColorFormats(layout).size();
+  for (auto const& info :
+       pbr::GBuffer::getImageInfos(extent, layout) | std::views::take(colorCount)) {
+    images.emplace_back(gpu, info.format, vk::ImageAspectFlagBits::eColor,
+                        allocator.allocateImage(info, {}));
+  }
+  return images;
+}
 } // namespace
 
+auto pbr::GBuffer::getImageInfos(vk::Extent2D const extent, GBufferLayout const layout)
+    -> std::vector<vk::ImageCreateInfo> {
+  std::vector<vk::ImageCreateInfo> infos;
+  for (auto const format : getColorFormats(layout)) {
+    infos.push_back(
+        ::makeImageInfo(extent, format, vk::ImageUsageFlagBits::eColorAttachment));
+  }
+  infos.push_back(::makeImageInfo(extent, DEPTH_FORMAT,
+                                  vk::ImageUsageFlagBits::eDepthStencilAttachment));
+  return infos;
+}
+
 pbr::GBuffer::GBuffer(core::GpuHandle const& gpu, IAllocator& allocator,
-                      vk::UniqueDescriptorSet descSet, vk::Extent2D extent)
-    : _positions(::allocateImage2D(gpu, allocator, extent, POSITIONS_FORMAT))
-    , _normals(::allocateImage2D(gpu, allocator, extent, NORMALS_FORMAT))
-    , _albedo(::allocateImage2D(gpu, allocator, extent, ALBEDO_FORMAT))
-    , _depth(::allocateImage2D(gpu, allocator, extent, DEPTH_FORMAT,
-                               vk::ImageAspectFlagBits::eDepth,
-                               vk::ImageUsageFlagBits::eDepthStencilAttachment))
+                      vk::UniqueDescriptorSet descSet, vk::Extent2D extent,
+                      GBufferLayout const layout)
+    : _layout(layout)
+    , _colorAttachments(::allocateColorAttachments(gpu, allocator, extent, layout))
+    , _depth(gpu, DEPTH_FORMAT, vk::ImageAspectFlagBits::eDepth,
+             allocator.allocateImage(getImageInfos(extent, layout).back(), {}))
     , _extent(extent)
     , _descSet(std::move(descSet)) {
-  vk::DescriptorImageInfo const positionsInfo {
-      .imageView = _positions.getImageView(),
-      .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
-  };
-  vk::DescriptorImageInfo const normalsInfo {
-      .imageView = _normals.getImageView(),
-      .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
-  };
-  vk::DescriptorImageInfo const albedoInfo {
-      .imageView = _albedo.getImageView(),
-      .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
-  };
-  vk::DescriptorImageInfo const depthInfo {
+  // The infos are referenced by the writes, so they must not reallocate.
+  std::vector<vk::DescriptorImageInfo> imageInfos;
+  imageInfos.reserve(_colorAttachments.size() + 1);
+  std::vector<vk::WriteDescriptorSet> writes;
+  writes.reserve(_colorAttachments.size() + 1);
+
+  // Bindings the layout has no image for are left unwritten, its lighting shader does not
+  // access them.
+  auto binding = getFirstBinding(layout);
+  for (auto const& image : _colorAttachments) {
+    imageInfos.push_back({
+        .imageView = image.getImageView(),
+        .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+    });
+    writes.push_back(vk::WriteDescriptorSet {
+        .dstSet = _descSet,
+        .dstBinding = binding++,
+        .descriptorType = vk::DescriptorType::eSampledImage,
+    }
+                         .setImageInfo(imageInfos.back()));
+  }
+  imageInfos.push_back({
       .imageView = _depth.getImageView(),
       .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
-  };
-  gpu.getDevice().updateDescriptorSets(
-      std::array {
-          vk::WriteDescriptorSet {
-              .dstSet = _descSet,
-              .dstBinding = 0,
-              .descriptorType = vk::DescriptorType::eSampledImage,
-          }
-              .setImageInfo(positionsInfo),
-          vk::WriteDescriptorSet {
-              .dstSet = _descSet,
-              .dstBinding = 1,
-              .descriptorType = vk::DescriptorType::eSampledImage,
-          }
-              .setImageInfo(normalsInfo),
-          vk::WriteDescriptorSet {
-              .dstSet = _descSet,
-              .dstBinding = 2,
-              .descriptorType = vk::DescriptorType::eSampledImage,
-          }
-              .setImageInfo(albedoInfo),
-          vk::WriteDescriptorSet {
-              .dstSet = _descSet,
-              .dstBinding = 4,
-              .descriptorType = vk::DescriptorType::eCombinedImageSampler,
-          }
-              .setImageInfo(depthInfo),
-      },
-      {});
+  });
+  writes.push_back(vk::WriteDescriptorSet {
+      .dstSet = _descSet,
+      .dstBinding = constants::DEPTH_BINDING,
+      .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+  }
+                       .setImageInfo(imageInfos.back()));
+  gpu.getDevice().updateDescriptorSets(writes, {});
 }
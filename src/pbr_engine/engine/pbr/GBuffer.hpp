@@ -7,32 +7,88 @@
 #include "pbr/Image2D.hpp"
 #include "pbr/memory/IAllocator.hpp"
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
 namespace pbr {
+/**
+ * Describes which images the geometry pass writes and in which formats.
+ */
+enum struct GBufferLayout : std::uint8_t {
+  /// Positions, normals and albedo in 16 bit channels.
+  Wide,
+  /// Octahedral normals and srgb albedo, positions are reconstructed from the depth.
+  Compact,
+};
 class GBuffer {
 public:
-  static constexpr auto POSITIONS_FORMAT = vk::Format::eR16G16B16A16Sfloat;
-  static constexpr auto NORMALS_FORMAT = vk::Format::eR16G16B16A16Sfloat;
-  static constexpr auto ALBEDO_FORMAT = vk::Format::eR16G16B16A16Unorm;
   static constexpr auto DEPTH_FORMAT = vk::Format::eD32Sfloat;
+  /// Positions, normals and albedo, in the order they are bound.
+  static constexpr std::array WIDE_FORMATS {
+      vk::Format::eR16G16B16A16Sfloat,
+      vk::Format::eR16G16B16A16Sfloat,
+      vk::Format::eR16G16B16A16Unorm,
+  };
+  /// Octahedral normals and albedo, in the order they are bound.
+  static constexpr std::array COMPACT_FORMATS {
+      vk::Format::eR16G16Snorm,
+      vk::Format::eR8G8B8A8Srgb,
+  };
+  static constexpr auto MAX_COLOR_ATTACHMENTS = WIDE_FORMATS.size();
 
 private:
-  Image2D _positions;
-  Image2D _normals;
-  Image2D _albedo;
+  GBufferLayout _layout;
+  std::vector<Image2D> _colorAttachments;
   Image2D _depth;
   vk::Extent2D _extent;
   vk::UniqueDescriptorSet _descSet;
 
 public:
-  GBuffer(core::GpuHandle const& gpu, IAllocator& allocator, vk::UniqueDescriptorSet descSet,
-                   vk::Extent2D extent);
+  GBuffer(core::GpuHandle const& gpu, IAllocator& allocator,
+          vk::UniqueDescriptorSet descSet, vk::Extent2D extent,
+          GBufferLayout layout = GBufferLayout::Wide);
 
+  /**
+   * @returns The formats of the color attachments of the layout.
+   */
+  [[nodiscard]]
+  static constexpr auto getColorFormats(GBufferLayout layout) noexcept
+      -> std::span<vk::Format const>;
+  /**
+   * @returns The images of the layout, the color attachments in the order of
+   * getColorFormats followed by the depth.
+   */
+  [[nodiscard]]
+  static auto getImageInfos(vk::Extent2D extent, GBufferLayout layout)
+      -> std::vector<vk::ImageCreateInfo>;
+  /**
+   * @returns The binding of the first color attachment in the descriptor set, the compact
+   * layout has no positions so it starts at the normals.
+   */
+  [[nodiscard]]
+  static constexpr auto getFirstBinding(GBufferLayout layout) noexcept -> std::uint32_t;
+  /**
+   * @returns The bytes the geometry pass writes for every pixel, depth included.
+   */
   [[nodiscard]]
-  constexpr auto getPositions() const noexcept -> Image2D const&;
+  static constexpr auto getBytesPerPixel(GBufferLayout layout) noexcept -> std::uint32_t;
+  /**
+   * @returns The bytes the geometry pass writes for every frame, depth included.
+   */
   [[nodiscard]]
-  constexpr auto getNormals() const noexcept -> Image2D const&;
+  static constexpr auto getBytesPerFrame(GBufferLayout layout,
+                                         vk::Extent2D extent) noexcept -> std::size_t;
+
+  [[nodiscard]]
+  constexpr auto getLayout() const noexcept -> GBufferLayout;
+  /**
+   * @returns The color attachments in the order of getColorFormats.
+   */
   [[nodiscard]]
-  constexpr auto getAlbedo() const noexcept -> Image2D const&;
+  constexpr auto getColorAttachments() const noexcept -> std::span<Image2D const>;
   [[nodiscard]]
   constexpr auto getDepth() const noexcept -> Image2D const&;
   [[nodiscard]]
@@ -43,14 +99,41 @@ public:
 } // namespace pbr
 
 /* IMPLEMENTATIONS */
-constexpr auto pbr::GBuffer::getPositions() const noexcept -> Image2D const& {
-  return _positions;
+constexpr auto pbr::GBuffer::getColorFormats(GBufferLayout const layout) noexcept
+    -> std::span<vk::Format const> {
+  switch (layout) {
+  case GBufferLayout::Wide:
+    return WIDE_FORMATS;
+  case GBufferLayout::Compact:
+    return COMPACT_FORMATS;
+  }
+  return {};
+}
+constexpr auto pbr::GBuffer::getFirstBinding(GBufferLayout const layout) noexcept
+    -> std::uint32_t {
+  return static_cast<std::uint32_t>(MAX_COLOR_ATTACHMENTS
+                                    - getColorFormats(layout).size());
+}
+constexpr auto pbr::GBuffer::getBytesPerPixel(GBufferLayout const layout) noexcept
+    -> std::uint32_t {
+  std::uint32_t bytes = vk::blockSize(DEPTH_FORMAT);
+  for (auto const format : getColorFormats(layout)) {
+    bytes += vk::blockSize(format);
+  }
+  return bytes;
+}
+constexpr auto pbr::GBuffer::getBytesPerFrame(GBufferLayout const layout,
+                                              vk::Extent2D const extent) noexcept
+    -> std::size_t {
+  return static_cast<std::size_t>(extent.width) * extent.height
+         * getBytesPerPixel(layout);
 }
-constexpr auto pbr::GBuffer::getNormals() const noexcept -> Image2D const& {
-  return _normals;
+constexpr auto pbr::GBuffer::getLayout() const noexcept -> GBufferLayout {
+  return _layout;
 }
-constexpr auto pbr::GBuffer::getAlbedo() const noexcept -> Image2D const& {
-  return _albedo;
+constexpr auto pbr::GBuffer::getColorAttachments() const noexcept
+    -> std::span<Image2D const> {
+  return _colorAttachments;
 }
 constexpr auto pbr::GBuffer::getDepth() const noexcept -> Image2D const& {
   return _depth;
@@ -0,0 +1,185 @@
+#include "pbr/GpuProfiler.hpp"
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/core/GpuHandle.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <numeric>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+[[nodiscard]]
+auto getTimestampValidBits(pbr::core::GpuHandle const& gpu) -> std::uint32_t {
+  auto const families = gpu.getPhysicalDevice().getQueueFamilyProperties();
+  return families[gpu.getPhysicalDeviceProperties().graphicsTransferPresentQueue]
+      .timestampValidBits;
+}
+[[nodiscard]]
+constexpr auto getTimestampMask(std::uint32_t const validBits) noexcept -> std::uint64_t {
+  return validBits >= 64 ? ~std::uint64_t {0} : (std::uint64_t {1} << validBits) - 1;
+}
+[[nodiscard]]
+auto createQueryPool(pbr::core::GpuHandle const& gpu, std::uint32_t const frameCount)
+    -> vk::UniqueQueryPool {
+  if (::getTimestampValidBits(gpu) == 0) {
+    return {};
+  }
+  // Every pass has a timestamp at its start and at its end.
+  return gpu.getDevice().createQueryPoolUnique({
+      .queryType = vk::QueryType::eTimestamp,
+      .queryCount = pbr::GpuProfiler::MAX_PASSES * 2 * frameCount,
+  });
+}
+} // namespace
+
+auto pbr::GpuTimings::addFrame(std::span<GpuPassSample const> passes,
+                               std::chrono::nanoseconds const frameDuration) -> void {
+  _passes.clear();
+  for (auto const& pass : passes) {
+    auto history = std::ranges::find(_histories, pass.name, &History::name);
+    if (history == _histories.end()) {
+      _histories.push_back({.name = std::string(pass.name)});
+      history = std::prev(_histories.end());
+    }
+    _passes.push_back(addSample(*history, pass.duration));
+  }
+  _frame = addSample(_frameHistory, frameDuration);
+}
+
+auto pbr::GpuTimings::getPasses() const noexcept -> std::span<GpuPassTiming const> {
+  return _passes;
+}
+
+auto pbr::GpuTimings::getFrame() const noexcept -> GpuPassTiming const& {
+  return _frame;
+}
+
+auto pbr::GpuTimings::addSample(History& history,
+                                std::chrono::nanoseconds const duration)
+    -> GpuPassTiming {
+  history.samples[history.sampleCount % HISTORY] = duration;
+  ++history.sampleCount;
+
+  auto const samples =
+      std::span(history.samples).first(std::min(history.sampleCount, HISTORY));
+  return {
+      .name = history.name,
+      .last = duration,
+      .average = std::reduce(samples.begin(), samples.end())
+                 / static_cast<std::int64_t>(samples.size()),
+      .max = std::ranges::max(samples),
+  };
+}
+
+pbr::GpuProfiler::GpuProfiler(core::SharedGpuHandle gpu, std::uint32_t const frameCount)
+    : _gpu(std::move(gpu))
+    , _queryPool(::createQueryPool(*_gpu, frameCount))
+    , _timestampPeriod(
+          _gpu->getPhysicalDevice().getProperties().limits.timestampPeriod)
+    , _timestampMask(::getTimestampMask(::getTimestampValidBits(*_gpu)))
+    , _frames(frameCount) {}
+
+auto pbr::GpuProfiler::beginFrame(vk::CommandBuffer cmdBuffer,
+                                  std::uint32_t const frameIndex) -> void {
+  if (!_queryPool) {
+    return;
+  }
+
+  _frameIndex = frameIndex;
+  auto& frame = _frames[_frameIndex];
+  // The queries are only reset by the frames that record passes into them.
+  if (!frame.passes.empty()) {
+    readQueries(frame);
+  }
+  frame.passes.clear();
+  frame.passOpen = false;
+  cmdBuffer.resetQueryPool(_queryPool.get(), getFirstQuery(), MAX_PASSES * 2);
+}
+
+auto pbr::GpuProfiler::beginPass(vk::CommandBuffer cmdBuffer,
+                                 std::string_view const name) -> void {
+  auto& frame = _frames[_frameIndex];
+  if (!_queryPool || frame.passes.size() == MAX_PASSES) {
+    return;
+  }
+
+  assert(!frame.passOpen);
+  // Waiting for every previous command leaves the barriers before the pass out of it.
+  cmdBuffer.writeTimestamp2(
+      vk::PipelineStageFlagBits2::eAllCommands, _queryPool.get(),
+      getFirstQuery() + (static_cast<std::uint32_t>(frame.passes.size()) * 2));
+  frame.passes.emplace_back(name);
+  frame.passOpen = true;
+}
+
+auto pbr::GpuProfiler::endPass(vk::CommandBuffer cmdBuffer) -> void {
+  auto& frame = _frames[_frameIndex];
+  if (!_queryPool || !frame.passOpen) {
+    return;
+  }
+
+  cmdBuffer.writeTimestamp2(
+      vk::PipelineStageFlagBits2::eAllCommands, _queryPool.get(),
+      getFirstQuery() + (static_cast<std::uint32_t>(frame.passes.size()) * 2) - 1);
+  frame.passOpen = false;
+}
+
+auto pbr::GpuProfiler::isSupported() const noexcept -> bool {
+  return static_cast<bool>(_queryPool);
+}
+
+auto pbr::GpuProfiler::getTimings() const noexcept -> GpuTimings const& {
+  return _timings;
+}
+
+auto pbr::GpuProfiler::readQueries(Frame const& frame) -> void {
+  // Every query is followed by its availability, a pass that was left open leaves its
+  // end unavailable.
+  auto const queryCount = static_cast<std::uint32_t>(frame.passes.size()) * 2;
+  _results.resize(static_cast<std::size_t>(queryCount) * 2);
+  [[maybe_unused]]
+  auto const result = _gpu->getDevice().getQueryPoolResults(
+      _queryPool.get(), getFirstQuery(), queryCount,
+      _results.size() * sizeof(std::uint64_t), _results.data(), sizeof(std::uint64_t) * 2,
+      vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability);
+  assert(result == vk::Result::eSuccess || result == vk::Result::eNotReady);
+
+  auto const toDuration = [this](std::uint64_t const begin, std::uint64_t const end) {
+    return std::chrono::nanoseconds(static_cast<std::int64_t>(
+        static_cast<double>((end - begin) & _timestampMask) * _timestampPeriod));
+  };
+  _samples.clear();
+  std::optional<std::uint64_t> frameBegin;
+  std::uint64_t frameEnd = 0;
+  for (auto const [pass, name] : frame.passes | std::views::enumerate) {
+    auto const begin = static_cast<std::size_t>(pass) * 4;
+    if (_results[begin + 1] == 0 || _results[begin + 3] == 0) {
+      continue;
+    }
+    _samples.push_back({
+        .name = name,
+        .duration = toDuration(_results[begin], _results[begin + 2]),
+    });
+    frameBegin = frameBegin.value_or(_results[begin]);
+    frameEnd = _results[begin + 2];
+  }
+  if (frameBegin.has_value()) {
+    _timings.addFrame(_samples, toDuration(*frameBegin, frameEnd));
+  }
+}
+
+auto pbr::GpuProfiler::getFirstQuery() const noexcept -> std::uint32_t {
+  return _frameIndex * MAX_PASSES * 2;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/core/GpuHandle.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pbr {
+/**
+ * The gpu time of a pass in one frame.
+ */
+struct GpuPassSample {
+  std::string_view name;
+  std::chrono::nanoseconds duration;
+};
+struct GpuPassTiming {
+  std::string name;
+  std::chrono::nanoseconds last {};
+  /// Over the last frames the pass ran in.
+  std::chrono::nanoseconds average {};
+  std::chrono::nanoseconds max {};
+};
+/**
+ * The rolling gpu times of the passes, by their names.
+ */
+class GpuTimings {
+public:
+  /// The frames the averages are taken over.
+  static constexpr std::uint32_t HISTORY = 64;
+
+private:
+  struct History {
+    std::string name;
+    std::array<std::chrono::nanoseconds, HISTORY> samples {};
+    std::uint32_t sampleCount = 0;
+  };
+
+  std::vector<History> _histories;
+  History _frameHistory {.name = "frame"};
+  /// The passes of the last frame in their order.
+  std::vector<GpuPassTiming> _passes;
+  GpuPassTiming _frame;
+
+public:
+  /**
+   * @param passes The passes of a frame in the order they ran, passes that did not run
+   * keep their history.
+   * @param frameDuration From the start of the first pass to the end of the last.
+   */
+  auto addFrame(std::span<GpuPassSample const> passes,
+                std::chrono::nanoseconds frameDuration) -> void;
+
+  /**
+   * @returns The passes of the last frame that was added.
+   */
+  [[nodiscard]]
+  auto getPasses() const noexcept -> std::span<GpuPassTiming const>;
+  [[nodiscard]]
+  auto getFrame() const noexcept -> GpuPassTiming const&;
+
+private:
+  [[nodiscard]]
+  static auto addSample(History& history,
+                        std::chrono::nanoseconds duration) -> GpuPassTiming;
+};
+/**
+ * Measures the gpu time of every pass with timestamp queries.
+ *
+ * Every frame in flight has its own queries, they are read when its frame slot is
+ * recorded again. The fence of the slot was waited on by then, so reading them never
+ * waits for the gpu and the timings lag behind by the frames in flight.
+ */
+class GpuProfiler {
+  struct Frame {
+    std::vector<std::string> passes;
+    /// Whether the pass of the last query is still open.
+    bool passOpen = false;
+  };
+
+  core::SharedGpuHandle _gpu;
+  /// Null if the queue does not support timestamps.
+  vk::UniqueQueryPool _queryPool;
+  /// The nanoseconds of a timestamp tick.
+  double _timestampPeriod;
+  std::uint64_t _timestampMask;
+  std::vector<Frame> _frames;
+  std::uint32_t _frameIndex = 0;
+  std::vector<std::uint64_t> _results;
+  std::vector<GpuPassSample> _samples;
+  GpuTimings _timings;
+
+public:
+  /// Passes after these are not timed.
+  static constexpr std::uint32_t MAX_PASSES = 32;
+
+  GpuProfiler(core::SharedGpuHandle gpu, std::uint32_t frameCount);
+
+  /**
+   * Reads the queries of the frame slot and resets them.
+   * @note Has to be recorded before any pass of the frame, outside of rendering.
+   */
+  auto beginFrame(vk::CommandBuffer cmdBuffer, std::uint32_t frameIndex) -> void;
+  auto beginPass(vk::CommandBuffer cmdBuffer, std::string_view name) -> void;
+  auto endPass(vk::CommandBuffer cmdBuffer) -> void;
+
+  [[nodiscard]]
+  auto isSupported() const noexcept -> bool;
+  [[nodiscard]]
+  auto getTimings() const noexcept -> GpuTimings const&;
+
+private:
+  auto readQueries(Frame const& frame) -> void;
+  [[nodiscard]]
+  auto getFirstQuery() const noexcept -> std::uint32_t;
+};
+} // namespace pbr
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/Buffer.hpp"
+#include "pbr/memory/AllocationInfo.hpp"
+#include "pbr/memory/IAllocator.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <optional>
+
+namespace pbr {
+/**
+ * Buffer that gets reallocated with a power of two size when more space is needed.
+ * @note The contents are not preserved when the buffer grows.
+ */
+class GrowableBuffer {
+public:
+  static constexpr vk::DeviceSize MIN_CAPACITY = 256;
+
+private:
+  vk::BufferUsageFlags _usage;
+  AllocationInfo _allocationInfo;
+  std::optional<Buffer> _buffer = std::nullopt;
+  vk::DeviceSize _capacity {};
+
+public:
+  constexpr GrowableBuffer(vk::BufferUsageFlags usage,
+                           AllocationInfo allocationInfo) noexcept;
+
+  /**
+   * Makes sure the buffer can hold at least size bytes.
+   * @returns Whether a new buffer was allocated, descriptors that referenced the previous
+   * buffer have to be rewritten.
+   */
+  constexpr auto reserve(IAllocator& allocator, vk::DeviceSize size) -> bool;
+
+  /**
+   * @returns The buffer or a null handle if nothing was reserved yet.
+   */
+  [[nodiscard]]
+  constexpr auto getBuffer() const noexcept -> vk::Buffer;
+
+  [[nodiscard]]
+  constexpr auto getCapacity() const noexcept -> vk::DeviceSize;
+
+  /**
+   * @note The buffer has to be reserved and mappable.
+   */
+  [[nodiscard]]
+  constexpr auto map() const -> Allocation::Mapping;
+};
+} // namespace pbr
+
+/* IMPLEMENTATIONS */
+
+constexpr pbr::GrowableBuffer::GrowableBuffer(vk::BufferUsageFlags usage,
+                                              AllocationInfo allocationInfo) noexcept
+    : _usage(usage), _allocationInfo(allocationInfo) {}
+
+constexpr auto pbr::GrowableBuffer::reserve(IAllocator& allocator, vk::DeviceSize size)
+    -> bool {
+  if (_buffer.has_value() && _capacity >= size) {
+    return false;
+  }
+  _capacity = std::bit_ceil(std::max(size, MIN_CAPACITY));
+  _buffer.emplace(allocator.allocateBuffer(
+      {
+          .size = _capacity,
+          .usage = _usage,
+      },
+      _allocationInfo));
+  return true;
+}
+
+constexpr auto pbr::GrowableBuffer::getBuffer() const noexcept -> vk::Buffer {
+  return _buffer.has_value() ? _buffer->getBuffer() : vk::Buffer {};
+}
+
+constexpr auto pbr::GrowableBuffer::getCapacity() const noexcept -> vk::DeviceSize {
+  return _capacity;
+}
+
+constexpr auto pbr::GrowableBuffer::map() const -> Allocation::Mapping {
+  return _buffer->map();
+}
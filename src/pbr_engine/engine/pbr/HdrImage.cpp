@@ -7,56 +7,72 @@
 
 #include "pbr/Image2D.hpp"
 #include "pbr/memory/IAllocator.hpp"
+
+#include <cassert>
+#include <cstdint>
 #include <utility>
+#include <vector>
+
+auto pbr::HdrImage::getImageInfo(vk::Extent2D const extent) noexcept
+    -> vk::ImageCreateInfo {
+  return {
+      .imageType = vk::ImageType::e2D,
+      .format = PbrRenderSystem::LIGHTING_PASS_OUTPUT_FORMAT,
+      .extent {
+          .width = extent.width,
+          .height = extent.height,
+          .depth = 1,
+      },
+      .mipLevels = 1,
+      .arrayLayers = 1,
+      // Offline renders copy the image out before it is tonemapped.
+      .usage = vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eColorAttachment
+               | vk::ImageUsageFlagBits::eTransferSrc,
+  };
+}
 
 pbr::HdrImage::HdrImage(core::SharedGpuHandle gpu, IAllocator& allocator,
-                        vk::UniqueDescriptorSet descSet, vk::Extent2D extent)
+                        std::vector<vk::UniqueDescriptorSet> descSets,
+                        vk::Extent2D extent)
     : _gpu(std::move(gpu))
     , _image(*_gpu, PbrRenderSystem::LIGHTING_PASS_OUTPUT_FORMAT,
              vk::ImageAspectFlagBits::eColor,
-             allocator.allocateImage(
-                 {
-                     .imageType = vk::ImageType::e2D,
-                     .format = PbrRenderSystem::LIGHTING_PASS_OUTPUT_FORMAT,
-                     .extent {
-                         .width = extent.width,
-                         .height = extent.height,
-                         .depth = 1,
-                     },
-                     .mipLevels = 1,
-                     .arrayLayers = 1,
-                     .usage = vk::ImageUsageFlagBits::eStorage
-                              | vk::ImageUsageFlagBits::eColorAttachment,
-                 },
-                 {}))
-    , _extent(extent)
-    , _descSet(std::move(descSet)) {
+             allocator.allocateImage(getImageInfo(extent), {}))
+    , _extent(extent) {
+  assert(!descSets.empty());
   vk::DescriptorImageInfo const hdrImageInfo {
       .imageView = _image.getImageView(),
       .imageLayout = vk::ImageLayout::eGeneral,
   };
-  _gpu->getDevice().updateDescriptorSets(
-      vk::WriteDescriptorSet {
-          .dstSet = _descSet.get(),
-          .descriptorType = vk::DescriptorType::eStorageImage,
-      }
-          .setImageInfo(hdrImageInfo),
-      {});
+  _frames.reserve(descSets.size());
+  for (auto& descSet : descSets) {
+    _gpu->getDevice().updateDescriptorSets(
+        vk::WriteDescriptorSet {
+            .dstSet = descSet.get(),
+            .descriptorType = vk::DescriptorType::eStorageImage,
+        }
+            .setImageInfo(hdrImageInfo),
+        {});
+    _frames.push_back({.descSet = std::move(descSet), .outputImage = nullptr});
+  }
 }
 
-auto pbr::HdrImage::updateOutputTexture(vk::Image image, vk::ImageView imageView) -> void {
-  if(_outputImage == image) {
+auto pbr::HdrImage::updateOutputTexture(std::uint32_t const frameIndex, vk::Image image,
+                                        vk::ImageView imageView) -> void {
+  // Only the set of this frame is written, the others may still be in use.
+  auto& frame = _frames[frameIndex % _frames.size()];
+  if (frame.outputImage == image) {
     return;
   }
 
-  _outputImage = image;
+  frame.outputImage = image;
   vk::DescriptorImageInfo const imageInfo {
       .imageView = imageView,
       .imageLayout = vk::ImageLayout::eGeneral,
   };
   _gpu->getDevice().updateDescriptorSets(
       vk::WriteDescriptorSet {
-          .dstSet = _descSet.get(),
+          .dstSet = frame.descSet.get(),
           .dstBinding = 1,
           .descriptorType = vk::DescriptorType::eStorageImage,
       }
@@ -7,28 +7,47 @@
 #include "pbr/Image2D.hpp"
 #include "pbr/memory/IAllocator.hpp"
 
+#include <cstdint>
+#include <vector>
+
 namespace pbr {
 class HdrImage {
+  /// The output of every frame in flight is written through its own descriptor set.
+  struct Frame {
+    vk::UniqueDescriptorSet descSet;
+    vk::Image outputImage;
+  };
+
   core::SharedGpuHandle _gpu;
   Image2D _image;
   vk::Extent2D _extent;
-  vk::UniqueDescriptorSet _descSet;
-  vk::Image _outputImage;
+  std::vector<Frame> _frames;
 
 public:
+  /**
+   * @param descSets One descriptor set for every frame in flight.
+   */
   HdrImage(core::SharedGpuHandle gpu, IAllocator& allocator,
-           vk::UniqueDescriptorSet descSet, vk::Extent2D extent);
+           std::vector<vk::UniqueDescriptorSet> descSets, vk::Extent2D extent);
+
+  /**
+   * @returns The image the lighting pass writes at the extent.
+   */
+  [[nodiscard]]
+  static auto getImageInfo(vk::Extent2D extent) noexcept -> vk::ImageCreateInfo;
 
-  auto updateOutputTexture(vk::Image image, vk::ImageView imageView) -> void;
+  auto updateOutputTexture(std::uint32_t frameIndex, vk::Image image,
+                           vk::ImageView imageView) -> void;
 
   [[nodiscard]]
   constexpr auto getImage() const noexcept -> Image2D const&;
   [[nodiscard]]
   constexpr auto getExtent() const noexcept -> vk::Extent2D;
   [[nodiscard]]
-  constexpr auto getDescriptorSet() const noexcept -> vk::DescriptorSet;
+  constexpr auto getDescriptorSet(std::uint32_t frameIndex) const noexcept
+      -> vk::DescriptorSet;
   [[nodiscard]]
-  constexpr auto getOutputImage() const noexcept -> vk::Image;
+  constexpr auto getOutputImage(std::uint32_t frameIndex) const noexcept -> vk::Image;
 };
 } // namespace pbr
 
@@ -40,9 +59,11 @@ constexpr auto pbr::HdrImage::getImage() const noexcept -> Image2D const& {
 constexpr auto pbr::HdrImage::getExtent() const noexcept -> vk::Extent2D {
   return _extent;
 }
-constexpr auto pbr::HdrImage::getDescriptorSet() const noexcept -> vk::DescriptorSet {
-  return _descSet.get();
+constexpr auto pbr::HdrImage::getDescriptorSet(
+    std::uint32_t const frameIndex) const noexcept -> vk::DescriptorSet {
+  return _frames[frameIndex % _frames.size()].descSet.get();
 }
-constexpr auto pbr::HdrImage::getOutputImage() const noexcept -> vk::Image {
-  return _outputImage;
+constexpr auto pbr::HdrImage::getOutputImage(
+    std::uint32_t const frameIndex) const noexcept -> vk::Image {
+  return _frames[frameIndex % _frames.size()].outputImage;
 }
@@ -0,0 +1,488 @@
+#include "pbr/ImageEncoder.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <initializer_list>
+#include <iterator>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace constants {
+constexpr static std::array<std::uint8_t, 8> PNG_SIGNATURE {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a};
+constexpr static std::uint32_t PNG_CHANNELS = 4;
+constexpr static std::uint8_t PNG_RGBA = 6;
+constexpr static std::uint8_t PAETH_FILTER = 4;
+/// Deflate, 32 KiB window, no preset dictionary, the fastest compression level.
+constexpr static std::array<std::uint8_t, 2> ZLIB_HEADER {0x78, 0x01};
+
+constexpr static auto WINDOW_SIZE = 32768uz;
+constexpr static auto MIN_MATCH = 3uz;
+constexpr static auto MAX_MATCH = 258uz;
+constexpr static std::uint32_t HASH_BITS = 15;
+/// Bounds the candidates tried for every match, longer chains barely shrink renders.
+constexpr static std::uint32_t MAX_CHAIN = 32;
+constexpr static std::uint32_t END_OF_BLOCK = 256;
+/// The length of an empty stored block and its complement.
+constexpr static std::array<std::uint8_t, 4> SYNC_FLUSH {0x00, 0x00, 0xff, 0xff};
+constexpr static std::array<std::uint16_t, 29> LENGTH_BASES {
+    3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr static std::array<std::uint8_t, 29> LENGTH_EXTRA_BITS {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+    2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr static std::array<std::uint16_t, 30> DISTANCE_BASES {
+    1,    2,    3,    4,    5,    7,    9,    13,    17,    25,
+    33,   49,   65,   97,   129,  193,  257,  385,   513,   769,
+    1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+constexpr static std::array<std::uint8_t, 30> DISTANCE_EXTRA_BITS {
+    0, 0, 0, 0, 1, 1, 2, 2, 3,  3,  4,  4,  5,  5,  6,
+    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+constexpr static std::array<std::uint8_t, 4> EXR_MAGIC {0x76, 0x2f, 0x31, 0x01};
+constexpr static std::uint32_t EXR_VERSION = 2;
+constexpr static std::uint32_t EXR_HALF = 1;
+constexpr static std::uint32_t HALF_SIZE = 2;
+/// Exr stores the channels of a scanline sorted by name, rgba pixels are read backwards.
+constexpr static std::array<std::string_view, 4> EXR_CHANNELS {"A", "B", "G", "R"};
+} // namespace constants
+
+namespace {
+constexpr auto CRC_TABLE = [] {
+  std::array<std::uint32_t, 256> table {};
+  for (auto i = 0u; i < table.size(); ++i) {
+    auto crc = i;
+    for (auto bit = 0; bit < 8; ++bit) {
+      crc = (crc & 1u) != 0 ? 0xedb88320u ^ (crc >> 1) : crc >> 1;
+    }
+    table[i] = crc;
+  }
+  return table;
+}();
+
+auto appendByte(std::vector<std::byte>& output, std::uint32_t const value) -> void {
+  output.push_back(static_cast<std::byte>(value & 0xffu));
+}
+auto appendBytes(std::vector<std::byte>& output, std::span<std::uint8_t const> bytes)
+    -> void {
+  for (auto const byte : bytes) {
+    ::appendByte(output, byte);
+  }
+}
+auto appendBigEndian(std::vector<std::byte>& output, std::uint32_t const value)
+    -> void {
+  for (auto shift = 24; shift >= 0; shift -= 8) {
+    ::appendByte(output, value >> shift);
+  }
+}
+auto appendLittleEndian(std::vector<std::byte>& output, std::uint64_t const value,
+                        std::uint32_t const size = 4) -> void {
+  for (auto i = 0u; i < size; ++i) {
+    ::appendByte(output, static_cast<std::uint32_t>(value >> (i * 8)));
+  }
+}
+auto appendString(std::vector<std::byte>& output, std::string_view const string)
+    -> void {
+  for (auto const character : string) {
+    ::appendByte(output, static_cast<std::uint8_t>(character));
+  }
+  ::appendByte(output, 0);
+}
+
+/**
+ * Packs bits starting at the least significant bit of every byte, as deflate does.
+ */
+class BitWriter {
+  std::vector<std::byte>* _output;
+  std::uint32_t _bits = 0;
+  std::uint32_t _count = 0;
+
+public:
+  explicit BitWriter(std::vector<std::byte>& output) noexcept : _output(&output) {}
+
+  auto write(std::uint32_t const value, std::uint32_t const count) -> void {
+    _bits |= value << _count;
+    _count += count;
+    while (_count >= 8) {
+      ::appendByte(*_output, _bits);
+      _bits >>= 8;
+      _count -= 8;
+    }
+  }
+  /**
+   * Huffman codes are packed starting at their most significant bit.
+   */
+  auto writeCode(std::uint32_t const code, std::uint32_t const length) -> void {
+    auto reversed = 0u;
+    for (auto i = 0u; i < length; ++i) {
+      reversed |= ((code >> i) & 1u) << (length - 1 - i);
+    }
+    write(reversed, length);
+  }
+  auto flush() -> void {
+    if (_count > 0) {
+      ::appendByte(*_output, _bits);
+    }
+    _bits = 0;
+    _count = 0;
+  }
+};
+
+auto writeFixedSymbol(BitWriter& writer, std::uint32_t const symbol) -> void {
+  if (symbol < 144) {
+    writer.writeCode(0x30 + symbol, 8);
+  } else if (symbol < 256) {
+    writer.writeCode(0x190 + symbol - 144, 9);
+  } else if (symbol < 280) {
+    writer.writeCode(symbol - 256, 7);
+  } else {
+    writer.writeCode(0xc0 + symbol - 280, 8);
+  }
+}
+/**
+ * @returns The index of the last base that is not greater than the value.
+ */
+[[nodiscard]]
+auto findBase(std::span<std::uint16_t const> bases, std::size_t const value) noexcept
+    -> std::uint32_t {
+  return static_cast<std::uint32_t>(std::ranges::upper_bound(bases, value)
+                                    - bases.begin() - 1);
+}
+auto writeMatch(BitWriter& writer, std::size_t const length, std::size_t const distance)
+    -> void {
+  auto const lengthCode = ::findBase(constants::LENGTH_BASES, length);
+  ::writeFixedSymbol(writer, 257 + lengthCode);
+  writer.write(static_cast<std::uint32_t>(length - constants::LENGTH_BASES[lengthCode]),
+               constants::LENGTH_EXTRA_BITS[lengthCode]);
+  // Distances have fixed 5 bit codes.
+  auto const distanceCode = ::findBase(constants::DISTANCE_BASES, distance);
+  writer.writeCode(distanceCode, 5);
+  writer.write(
+      static_cast<std::uint32_t>(distance - constants::DISTANCE_BASES[distanceCode]),
+      constants::DISTANCE_EXTRA_BITS[distanceCode]);
+}
+
+[[nodiscard]]
+auto hashAt(std::span<std::uint8_t const> data, std::size_t const position) noexcept
+    -> std::uint32_t {
+  auto const value = static_cast<std::uint32_t>(data[position])
+                     | static_cast<std::uint32_t>(data[position + 1]) << 8
+                     | static_cast<std::uint32_t>(data[position + 2]) << 16;
+  return (value * 2654435761u) >> (32 - constants::HASH_BITS);
+}
+/**
+ * Compresses the data into a deflate block with the fixed huffman codes, repeats are
+ * found through hash chains of the positions of every 3 byte prefix.
+ * @param final Whether the block ends the stream, otherwise the stream is flushed to a
+ * byte boundary so it can be continued.
+ */
+auto deflate(std::vector<std::byte>& output, std::span<std::uint8_t const> data,
+             bool const final) -> void {
+  BitWriter writer(output);
+  writer.write(final ? 1 : 0, 1);
+  writer.write(1, 2);
+
+  std::vector<std::int64_t> heads(1uz << constants::HASH_BITS, -1);
+  std::vector<std::int64_t> previous(constants::WINDOW_SIZE, -1);
+  auto const insert = [&](std::size_t const position) {
+    if (position + constants::MIN_MATCH <= data.size()) {
+      auto& head = heads[::hashAt(data, position)];
+      previous[position % constants::WINDOW_SIZE] = head;
+      head = static_cast<std::int64_t>(position);
+    }
+  };
+
+  auto position = 0uz;
+  while (position < data.size()) {
+    auto bestLength = 0uz;
+    auto bestDistance = 0uz;
+    if (position + constants::MIN_MATCH <= data.size()) {
+      auto const maxLength = std::min(constants::MAX_MATCH, data.size() - position);
+      auto candidate = heads[::hashAt(data, position)];
+      for (auto chain = 0u; chain < constants::MAX_CHAIN && candidate >= 0; ++chain) {
+        auto const start = static_cast<std::size_t>(candidate);
+        if (position - start > constants::WINDOW_SIZE) {
+          break;
+        }
+        auto length = 0uz;
+        while (length < maxLength && data[start + length] == data[position + length]) {
+          ++length;
+        }
+        if (length > bestLength) {
+          bestLength = length;
+          bestDistance = position - start;
+          if (length == maxLength) {
+            break;
+          }
+        }
+        candidate = previous[start % constants::WINDOW_SIZE];
+      }
+    }
+
+    if (bestLength >= constants::MIN_MATCH) {
+      ::writeMatch(writer, bestLength, bestDistance);
+      for (auto i = 0uz; i < bestLength; ++i) {
+        insert(position + i);
+      }
+      position += bestLength;
+    } else {
+      ::writeFixedSymbol(writer, data[position]);
+      insert(position);
+      ++position;
+    }
+  }
+  ::writeFixedSymbol(writer, constants::END_OF_BLOCK);
+  if (!final) {
+    // An empty stored block, its length starts at a byte boundary.
+    writer.write(0, 3);
+    writer.flush();
+    ::appendBytes(output, constants::SYNC_FLUSH);
+  }
+  writer.flush();
+}
+
+[[nodiscard]]
+constexpr auto paethPredictor(std::int32_t const left, std::int32_t const up,
+                              std::int32_t const upLeft) noexcept -> std::int32_t {
+  auto const estimate = left + up - upLeft;
+  auto const toLeft = std::abs(estimate - left);
+  auto const toUp = std::abs(estimate - up);
+  auto const toUpLeft = std::abs(estimate - upLeft);
+  if (toLeft <= toUp && toLeft <= toUpLeft) {
+    return left;
+  }
+  return toUp <= toUpLeft ? up : upLeft;
+}
+/**
+ * @param previousRow The row above the first one, empty for the first row of the image.
+ * @returns The rows filtered with the Paeth predictor, each prefixed with its filter.
+ */
+[[nodiscard]]
+auto filterRows(std::span<std::byte const> pixels, std::size_t const rowSize,
+                std::span<std::byte const> previousRow) -> std::vector<std::uint8_t> {
+  auto const rowCount = pixels.size() / rowSize;
+  std::vector<std::uint8_t> filtered;
+  filtered.reserve((rowSize + 1) * rowCount);
+  auto const at = [&](std::size_t const row, std::size_t const column) -> std::int32_t {
+    if (row > 0) {
+      return std::to_integer<std::int32_t>(pixels[(row - 1) * rowSize + column]);
+    }
+    return previousRow.empty() ? 0 : std::to_integer<std::int32_t>(previousRow[column]);
+  };
+  // Rows are indexed from the previous row, so row 0 is the one above the pixels.
+  for (auto row = 1uz; row <= rowCount; ++row) {
+    filtered.push_back(constants::PAETH_FILTER);
+    for (auto column = 0uz; column < rowSize; ++column) {
+      auto const hasLeft = column >= constants::PNG_CHANNELS;
+      auto const left = hasLeft ? at(row, column - constants::PNG_CHANNELS) : 0;
+      auto const up = at(row - 1, column);
+      auto const upLeft = hasLeft ? at(row - 1, column - constants::PNG_CHANNELS) : 0;
+      auto const predicted = ::paethPredictor(left, up, upLeft);
+      filtered.push_back(static_cast<std::uint8_t>(at(row, column) - predicted));
+    }
+  }
+  return filtered;
+}
+
+auto appendChunk(std::vector<std::byte>& output, std::string_view const type,
+                 std::span<std::byte const> data) -> void {
+  ::appendBigEndian(output, static_cast<std::uint32_t>(data.size()));
+  auto const typeStart = output.size();
+  for (auto const character : type) {
+    ::appendByte(output, static_cast<std::uint8_t>(character));
+  }
+  output.insert(output.end(), data.begin(), data.end());
+  ::appendBigEndian(output,
+                    pbr::crc32(std::span(output).subspan(typeStart, type.size()
+                                                                        + data.size())));
+}
+
+auto appendAttribute(std::vector<std::byte>& output, std::string_view const name,
+                     std::string_view const type, std::span<std::byte const> value)
+    -> void {
+  ::appendString(output, name);
+  ::appendString(output, type);
+  ::appendLittleEndian(output, value.size());
+  output.insert(output.end(), value.begin(), value.end());
+}
+} // namespace
+
+pbr::PngEncoder::PngEncoder(std::uint32_t const width, std::uint32_t const height)
+    : _width(width), _height(height) {}
+
+auto pbr::PngEncoder::begin() const -> std::vector<std::byte> {
+  std::vector<std::byte> output;
+  ::appendBytes(output, constants::PNG_SIGNATURE);
+
+  std::vector<std::byte> header;
+  ::appendBigEndian(header, _width);
+  ::appendBigEndian(header, _height);
+  // 8 bits per channel, deflate, adaptive filtering, no interlacing.
+  ::appendBytes(header, std::array<std::uint8_t, 5> {8, constants::PNG_RGBA, 0, 0, 0});
+  ::appendChunk(output, "IHDR", header);
+  return output;
+}
+
+auto pbr::PngEncoder::encodeRows(std::span<std::byte const> const pixels)
+    -> std::vector<std::byte> {
+  auto const rowSize = static_cast<std::size_t>(_width) * constants::PNG_CHANNELS;
+  auto const rowCount = static_cast<std::uint32_t>(pixels.size() / rowSize);
+  assert(rowCount > 0 && pixels.size() % rowSize == 0);
+  assert(_encodedRows + rowCount <= _height);
+  auto const first = _encodedRows == 0;
+  _encodedRows += rowCount;
+
+  auto const filtered = ::filterRows(pixels, rowSize, _previousRow);
+  auto const filteredBytes = std::as_bytes(std::span(filtered));
+  _adler = pbr::adler32(filteredBytes, _adler);
+  _previousRow.assign(pixels.end() - static_cast<std::ptrdiff_t>(rowSize), pixels.end());
+
+  // The rows of every call continue the zlib stream of the previous ones.
+  std::vector<std::byte> stream;
+  stream.reserve(filtered.size() / 2);
+  if (first) {
+    ::appendBytes(stream, constants::ZLIB_HEADER);
+  }
+  ::deflate(stream, filtered, isFinished());
+  if (isFinished()) {
+    ::appendBigEndian(stream, _adler);
+  }
+
+  std::vector<std::byte> output;
+  ::appendChunk(output, "IDAT", stream);
+  if (isFinished()) {
+    ::appendChunk(output, "IEND", {});
+  }
+  return output;
+}
+
+pbr::ExrEncoder::ExrEncoder(std::uint32_t const width, std::uint32_t const height)
+    : _width(width), _height(height) {}
+
+auto pbr::ExrEncoder::begin() const -> std::vector<std::byte> {
+  std::vector<std::byte> output;
+  ::appendBytes(output, constants::EXR_MAGIC);
+  ::appendLittleEndian(output, constants::EXR_VERSION);
+
+  std::vector<std::byte> channels;
+  for (auto const name : constants::EXR_CHANNELS) {
+    ::appendString(channels, name);
+    ::appendLittleEndian(channels, constants::EXR_HALF);
+    // Not linear, reserved bytes and no subsampling.
+    ::appendLittleEndian(channels, 0);
+    ::appendLittleEndian(channels, 1);
+    ::appendLittleEndian(channels, 1);
+  }
+  ::appendByte(channels, 0);
+  ::appendAttribute(output, "channels", "chlist", channels);
+  ::appendAttribute(output, "compression", "compression",
+                    std::array {std::byte {0}});
+
+  std::vector<std::byte> window;
+  for (auto const value : {0u, 0u, _width - 1, _height - 1}) {
+    ::appendLittleEndian(window, value);
+  }
+  ::appendAttribute(output, "dataWindow", "box2i", window);
+  ::appendAttribute(output, "displayWindow", "box2i", window);
+  ::appendAttribute(output, "lineOrder", "lineOrder", std::array {std::byte {0}});
+
+  std::vector<std::byte> one;
+  ::appendLittleEndian(one, std::bit_cast<std::uint32_t>(1.0f));
+  ::appendAttribute(output, "pixelAspectRatio", "float", one);
+  ::appendAttribute(output, "screenWindowCenter", "v2f", std::array<std::byte, 8> {});
+  ::appendAttribute(output, "screenWindowWidth", "float", one);
+  ::appendByte(output, 0);
+
+  // Every scanline is its own block of the same size, found through a table of offsets.
+  auto const blockSize = 8 + getLineSize();
+  auto const firstBlock = output.size() + static_cast<std::size_t>(_height) * 8;
+  for (auto y = 0uz; y < _height; ++y) {
+    ::appendLittleEndian(output, firstBlock + y * blockSize, 8);
+  }
+  return output;
+}
+
+auto pbr::ExrEncoder::encodeRows(std::span<std::byte const> const pixels)
+    -> std::vector<std::byte> {
+  auto const channelCount = static_cast<std::uint32_t>(constants::EXR_CHANNELS.size());
+  auto const lineSize = getLineSize();
+  auto const rowCount = static_cast<std::uint32_t>(pixels.size() / lineSize);
+  assert(pixels.size() % lineSize == 0);
+  assert(_encodedRows + rowCount <= _height);
+
+  std::vector<std::byte> output;
+  output.reserve((8 + lineSize) * rowCount);
+  for (auto row = 0uz; row < rowCount; ++row) {
+    ::appendLittleEndian(output, _encodedRows + row);
+    ::appendLittleEndian(output, lineSize);
+    auto const line = pixels.subspan(row * lineSize, lineSize);
+    for (auto channel = channelCount; channel-- > 0;) {
+      for (auto x = 0uz; x < _width; ++x) {
+        auto const offset = (x * channelCount + channel) * constants::HALF_SIZE;
+        auto const half = line.subspan(offset, constants::HALF_SIZE);
+        output.insert(output.end(), half.begin(), half.end());
+      }
+    }
+  }
+  _encodedRows += rowCount;
+  return output;
+}
+
+auto pbr::ExrEncoder::getLineSize() const noexcept -> std::size_t {
+  return static_cast<std::size_t>(_width) * constants::EXR_CHANNELS.size()
+         * constants::HALF_SIZE;
+}
+
+auto pbr::encodePng(std::span<std::byte const> const pixels, std::uint32_t const width,
+                    std::uint32_t const height) -> std::vector<std::byte> {
+  PngEncoder encoder(width, height);
+  auto output = encoder.begin();
+  auto const rows = encoder.encodeRows(
+      pixels.first(static_cast<std::size_t>(width) * height * constants::PNG_CHANNELS));
+  output.insert(output.end(), rows.begin(), rows.end());
+  return output;
+}
+
+auto pbr::encodeExr(std::span<std::byte const> const pixels, std::uint32_t const width,
+                    std::uint32_t const height) -> std::vector<std::byte> {
+  ExrEncoder encoder(width, height);
+  auto output = encoder.begin();
+  auto const rows = encoder.encodeRows(pixels.first(encoder.getLineSize() * height));
+  output.insert(output.end(), rows.begin(), rows.end());
+  return output;
+}
+
+auto pbr::crc32(std::span<std::byte const> const bytes, std::uint32_t const crc) noexcept
+    -> std::uint32_t {
+  auto value = ~crc;
+  for (auto const byte : bytes) {
+    auto const index = (value ^ std::to_integer<std::uint32_t>(byte)) & 0xffu;
+    value = ::CRC_TABLE[index] ^ (value >> 8);
+  }
+  return ~value;
+}
+
+auto pbr::adler32(std::span<std::byte const> const bytes,
+                  std::uint32_t const adler) noexcept -> std::uint32_t {
+  static constexpr std::uint32_t MODULUS = 65521;
+  // The largest run of bytes whose sums can not overflow before taking the modulus.
+  static constexpr auto RUN_SIZE = 5552uz;
+  auto a = adler & 0xffffu;
+  auto b = adler >> 16;
+  for (auto start = 0uz; start < bytes.size(); start += RUN_SIZE) {
+    auto const run = bytes.subspan(start, std::min(RUN_SIZE, bytes.size() - start));
+    for (auto const byte : run) {
+      a += std::to_integer<std::uint32_t>(byte);
+      b += a;
+    }
+    a %= MODULUS;
+    b %= MODULUS;
+  }
+  return (b << 16) | a;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace pbr {
+/**
+ * Encodes tightly packed rgba8 pixels as a png a band of rows at a time, so an image
+ * does not have to be in memory at once.
+ *
+ * Rows are filtered with the Paeth predictor and deflated with the fixed huffman codes,
+ * which compresses rendered images well without building code tables per block. Every
+ * band is deflated on its own and written as an IDAT chunk continuing a single zlib
+ * stream.
+ */
+class PngEncoder {
+  std::uint32_t _width;
+  std::uint32_t _height;
+  std::uint32_t _encodedRows = 0;
+  /// Filters the first row of the next band.
+  std::vector<std::byte> _previousRow;
+  std::uint32_t _adler = 1;
+
+public:
+  PngEncoder(std::uint32_t width, std::uint32_t height);
+
+  /**
+   * @returns The signature and the header chunk.
+   */
+  [[nodiscard]]
+  auto begin() const -> std::vector<std::byte>;
+  /**
+   * @param pixels Whole rows following the rows of the previous call.
+   * @returns The chunks of the rows, the last rows of the image end the file.
+   */
+  [[nodiscard]]
+  auto encodeRows(std::span<std::byte const> pixels) -> std::vector<std::byte>;
+
+  [[nodiscard]]
+  constexpr auto isFinished() const noexcept -> bool;
+};
+/**
+ * Encodes tightly packed rgba16 half float pixels as an uncompressed scanline exr, a band
+ * of rows at a time.
+ */
+class ExrEncoder {
+  std::uint32_t _width;
+  std::uint32_t _height;
+  std::uint32_t _encodedRows = 0;
+
+public:
+  ExrEncoder(std::uint32_t width, std::uint32_t height);
+
+  /**
+   * @returns The header and the offsets of the scanlines.
+   */
+  [[nodiscard]]
+  auto begin() const -> std::vector<std::byte>;
+  /**
+   * @param pixels Whole rows following the rows of the previous call.
+   */
+  [[nodiscard]]
+  auto encodeRows(std::span<std::byte const> pixels) -> std::vector<std::byte>;
+
+  [[nodiscard]]
+  auto getLineSize() const noexcept -> std::size_t;
+};
+/**
+ * Encodes tightly packed rgba8 pixels as a png in one go.
+ */
+[[nodiscard]]
+auto encodePng(std::span<std::byte const> pixels, std::uint32_t width,
+               std::uint32_t height) -> std::vector<std::byte>;
+/**
+ * Encodes tightly packed rgba16 half float pixels as an exr in one go.
+ */
+[[nodiscard]]
+auto encodeExr(std::span<std::byte const> pixels, std::uint32_t width,
+               std::uint32_t height) -> std::vector<std::byte>;
+/**
+ * @returns The crc32 png chunks and zip files end with.
+ */
+[[nodiscard]]
+auto crc32(std::span<std::byte const> bytes, std::uint32_t crc = 0) noexcept
+    -> std::uint32_t;
+/**
+ * @param adler The checksum of the preceding bytes, to checksum data in parts.
+ * @returns The adler32 checksum zlib streams end with.
+ */
+[[nodiscard]]
+auto adler32(std::span<std::byte const> bytes, std::uint32_t adler = 1) noexcept
+    -> std::uint32_t;
+} // namespace pbr
+
+/* IMPLEMENTATIONS */
+
+constexpr auto pbr::PngEncoder::isFinished() const noexcept -> bool {
+  return _encodedRows == _height;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <glm/ext/matrix_float3x4.hpp>
+#include <glm/ext/matrix_float4x4.hpp>
+
+namespace pbr {
+/**
+ * Per instance data read by the geometry pass from a storage buffer.
+ */
+struct InstanceData {
+  glm::mat4x4 model;
+  // This has to be a 3x4 matrix because of glsl alignment rules
+  glm::mat3x4 normalModel;
+  /// Bindless index of the material, see MaterialRegistry.
+  std::uint32_t material;
+  std::array<std::uint32_t, 3> padding;
+};
+} // namespace pbr
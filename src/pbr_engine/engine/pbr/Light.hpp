@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <glm/ext/vector_float3.hpp>
+#include <glm/gtc/constants.hpp>
+
+namespace pbr {
+/**
+ * The punctual light types of KHR_lights_punctual, mirrors the lighting shaders.
+ */
+enum struct LightType : std::uint32_t {
+  Point,
+  Spot,
+  Directional,
+};
+/**
+ * Punctual light, it is positioned and oriented by the node it is attached to.
+ *
+ * Spot and directional lights shine down the -z axis of their node.
+ */
+struct Light {
+  LightType type = LightType::Point;
+  glm::vec3 color {1.0f};
+  float intensity = 1.0f;
+  /// Beyond this distance the light has no influence, which bounds the tiles it lights.
+  /// Directional lights ignore it.
+  float range = 10.0f;
+  /// Spot lights have full intensity within the inner cone and fade out to the outer one.
+  float innerConeAngle = 0.0f;
+  float outerConeAngle = glm::quarter_pi<float>();
+};
+/**
+ * World space light read by the lighting shaders from a storage buffer.
+ * @note Padded to the std430 array stride.
+ */
+struct LightData {
+  glm::vec3 position;
+  float range;
+  glm::vec3 color;
+  float intensity;
+  glm::vec3 direction;
+  LightType type;
+  float cosInnerCone;
+  float cosOuterCone;
+  std::array<float, 2> padding {};
+
+  [[nodiscard]]
+  constexpr auto operator==(LightData const&) const noexcept -> bool = default;
+};
+static_assert(sizeof(LightData) == 64);
+} // namespace pbr
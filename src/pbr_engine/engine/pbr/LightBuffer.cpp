@@ -0,0 +1,69 @@
+#include "pbr/LightBuffer.hpp"
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/GrowableBuffer.hpp"
+#include "pbr/Light.hpp"
+#include "pbr/memory/AllocationInfo.hpp"
+#include "pbr/memory/IAllocator.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <ranges>
+#include <span>
+#include <vector>
+
+pbr::LightBuffer::LightBuffer()
+    : _buffer(vk::BufferUsageFlagBits::eStorageBuffer,
+              {
+                  .preference = AllocationPreference::Host,
+                  .ableToBeMapped = true,
+                  .persistentlyMapped = true,
+              }) {}
+
+auto pbr::LightBuffer::update(IAllocator& allocator, std::span<LightData const> lights)
+    -> bool {
+  auto const grown = _buffer.reserve(allocator, lights.size_bytes());
+  if (grown) {
+    // The new buffer holds nothing.
+    _uploaded.clear();
+  }
+
+  auto const mapping = _buffer.map();
+  std::span const destination(static_cast<LightData*>(mapping.get()),
+                              _buffer.getCapacity() / sizeof(LightData));
+  _stats = {
+      .lights = static_cast<std::uint32_t>(lights.size()),
+      .rewrittenLights = writeChanged(lights, _uploaded, destination),
+  };
+  return grown;
+}
+
+auto pbr::LightBuffer::writeChanged(std::span<LightData const> lights,
+                                    std::vector<LightData>& uploaded,
+                                    std::span<LightData> destination) -> std::uint32_t {
+  assert(destination.size() >= lights.size());
+  std::uint32_t written = 0;
+  for (auto const [index, light] : std::views::enumerate(lights)) {
+    auto const i = static_cast<std::size_t>(index);
+    // Writes go to uncached memory, comparing against the copy is cheaper.
+    if (i < uploaded.size() && uploaded[i] == light) {
+      continue;
+    }
+    destination[i] = light;
+    ++written;
+  }
+  uploaded.assign(lights.begin(), lights.end());
+  return written;
+}
+
+auto pbr::LightBuffer::getBuffer() const noexcept -> vk::Buffer {
+  return _buffer.getBuffer();
+}
+
+auto pbr::LightBuffer::getCount() const noexcept -> std::uint32_t {
+  return _stats.lights;
+}
+
+auto pbr::LightBuffer::getStats() const noexcept -> LightBufferStats { return _stats; }
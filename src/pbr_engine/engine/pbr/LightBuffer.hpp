@@ -0,0 +1,67 @@
+#pragma once
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/GrowableBuffer.hpp"
+#include "pbr/Light.hpp"
+#include "pbr/memory/IAllocator.hpp"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace pbr {
+/**
+ * Counters describing the last LightBuffer::update call.
+ */
+struct LightBufferStats {
+  std::uint32_t lights {};
+  /// Lights that differed from the previous contents of the buffer.
+  std::uint32_t rewrittenLights {};
+};
+/**
+ * Persistently mapped storage buffer holding the lights of a frame.
+ *
+ * The buffer remembers what it holds, so an update only writes the lights that changed
+ * since the last update of the same buffer. Every frame in flight needs its own.
+ */
+class LightBuffer {
+  GrowableBuffer _buffer;
+  /// The contents of the buffer.
+  std::vector<LightData> _uploaded;
+  LightBufferStats _stats {};
+
+public:
+  LightBuffer();
+
+  /**
+   * Writes the lights which differ from the contents of the buffer, growing it if needed.
+   * @returns Whether a new buffer was allocated, descriptors that referenced the previous
+   * buffer have to be rewritten.
+   * @note The gpu must be done with the previous contents of the buffer.
+   */
+  auto update(IAllocator& allocator, std::span<LightData const> lights) -> bool;
+
+  /**
+   * Copies the lights that differ from uploaded to destination and makes uploaded match
+   * lights.
+   * @param destination Has to have room for every light.
+   * @returns The number of lights copied.
+   */
+  static auto writeChanged(std::span<LightData const> lights,
+                           std::vector<LightData>& uploaded,
+                           std::span<LightData> destination) -> std::uint32_t;
+
+  /**
+   * @returns The buffer, it always exists after the first update even without lights.
+   */
+  [[nodiscard]]
+  auto getBuffer() const noexcept -> vk::Buffer;
+
+  [[nodiscard]]
+  auto getCount() const noexcept -> std::uint32_t;
+
+  [[nodiscard]]
+  auto getStats() const noexcept -> LightBufferStats;
+};
+} // namespace pbr
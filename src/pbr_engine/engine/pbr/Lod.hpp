@@ -0,0 +1,74 @@
+#pragma once
+
+#include "pbr/CameraData.hpp"
+#include "pbr/Frustum.hpp"
+#include "pbr/Mesh.hpp"
+
+#include <cmath>
+#include <cstdint>
+
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/geometric.hpp>
+
+namespace pbr {
+/**
+ * What selectLod needs to know about the camera.
+ */
+struct LodSelection {
+  glm::vec3 cameraPosition {};
+  /// Pixels covered by one unit of world space at a distance of one unit.
+  float pixelsPerUnit {};
+  /// The largest error of a level of detail on screen in pixels.
+  float maxPixelError = 1.0f;
+};
+/**
+ * @param viewportHeight The height of the rendered image in pixels.
+ */
+[[nodiscard]]
+constexpr auto makeLodSelection(CameraData const& camera, float viewportHeight,
+                                float maxPixelError = 1.0f) noexcept -> LodSelection;
+/**
+ * Picks the coarsest level of detail of a primitive whose error projected at the closest
+ * point of its world space sphere stays within the max pixel error.
+ * @returns 0 for the primitive itself and otherwise one past the index into its lods.
+ */
+[[nodiscard]]
+constexpr auto selectLod(PrimitiveSpan const& primitive, glm::mat4x4 const& model,
+                         LodSelection const& selection) noexcept -> std::uint32_t;
+} // namespace pbr
+
+/* IMPLEMENTATIONS */
+
+constexpr auto pbr::makeLodSelection(CameraData const& camera,
+                                     float const viewportHeight,
+                                     float const maxPixelError) noexcept -> LodSelection {
+  // proj[1][1] is the cotangent of half the vertical field of view.
+  return {
+      .cameraPosition = camera.position,
+      .pixelsPerUnit = std::abs(camera.proj[1][1]) * viewportHeight * 0.5f,
+      .maxPixelError = maxPixelError,
+  };
+}
+
+constexpr auto pbr::selectLod(PrimitiveSpan const& primitive, glm::mat4x4 const& model,
+                              LodSelection const& selection) noexcept -> std::uint32_t {
+  auto const sphere = pbr::transformSphere(model, primitive.boundingSphere);
+  auto const distance =
+      glm::distance(selection.cameraPosition, glm::vec3(sphere)) - sphere.w;
+  if (distance <= 0.0f || primitive.boundingSphere.w <= 0.0f) {
+    return 0;
+  }
+
+  // The errors are in mesh space and scale like the radius of the sphere.
+  auto const scale = sphere.w / primitive.boundingSphere.w;
+  auto const pixelsPerError = scale * selection.pixelsPerUnit / distance;
+  std::uint32_t level = 0;
+  for (auto const& lod : primitive.lods) {
+    if (lod.error * pixelsPerError > selection.maxPixelError) {
+      break;
+    }
+    ++level;
+  }
+  return level;
+}
@@ -19,24 +19,36 @@ pbr::Material::Material(core::GpuHandle const& gpu, Uniform<MaterialData> matDat
     , _normalTexture(std::move(normalTexture))
     , _normalSampler(std::move(normalSampler))
     , _descriptorSet(std::move(descSet)) {
-  writeDescriptorSet(gpu);
+  if (_descriptorSet) {
+    writeDescriptorSet(gpu);
+  }
 }
 
-auto pbr::Material::writeDescriptorSet(core::GpuHandle const& gpu) -> void {
-  vk::DescriptorBufferInfo const bufferInfo {
-      .buffer = _materialData.getUniformBuffer().getBuffer(),
-      .range = sizeof(MaterialData),
-  };
-  vk::DescriptorImageInfo const colorImageInfo {
+auto pbr::Material::getData() const -> MaterialData { return _materialData.get(); }
+
+auto pbr::Material::getColorTexture() const noexcept -> vk::DescriptorImageInfo {
+  return {
       .sampler = _colorSampler->get(),
       .imageView = _colorTexture->getImageView(),
       .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
   };
-  vk::DescriptorImageInfo const normalImageInfo {
+}
+
+auto pbr::Material::getNormalTexture() const noexcept -> vk::DescriptorImageInfo {
+  return {
       .sampler = _normalSampler->get(),
       .imageView = _normalTexture->getImageView(),
       .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
   };
+}
+
+auto pbr::Material::writeDescriptorSet(core::GpuHandle const& gpu) -> void {
+  vk::DescriptorBufferInfo const bufferInfo {
+      .buffer = _materialData.getUniformBuffer().getBuffer(),
+      .range = sizeof(MaterialData),
+  };
+  auto const colorImageInfo = getColorTexture();
+  auto const normalImageInfo = getNormalTexture();
   gpu.getDevice().updateDescriptorSets(
       {
           vk::WriteDescriptorSet {
@@ -7,6 +7,7 @@
 #include "pbr/Image2D.hpp"
 #include "pbr/Uniform.hpp"
 
+#include <cstdint>
 #include <glm/ext/vector_float4.hpp>
 #include <memory>
 
@@ -15,6 +16,12 @@ struct MaterialData {
   glm::vec4 color {};
 };
 
+/**
+ * Surface description of a primitive.
+ *
+ * A material is either bound through its own descriptor set or through the descriptors of
+ * a MaterialRegistry, in which case it is addressed by its bindless index.
+ */
 class Material {
   Uniform<MaterialData> _materialData;
   std::shared_ptr<Image2D> _colorTexture;
@@ -22,8 +29,13 @@ class Material {
   std::shared_ptr<Image2D> _normalTexture;
   std::shared_ptr<vk::UniqueSampler> _normalSampler;
   vk::UniqueDescriptorSet _descriptorSet;
+  std::uint32_t _bindlessIndex {};
 
 public:
+  /**
+   * @param descSet The descriptor set of the material, this can be null for materials
+   * that are only used through a MaterialRegistry.
+   */
   Material(core::GpuHandle const& gpu, Uniform<MaterialData> matData,
            std::shared_ptr<Image2D> colorTexture,
            std::shared_ptr<vk::UniqueSampler> colorSampler,
@@ -33,11 +45,29 @@ public:
 
   /* GETTERS */
 
+  [[nodiscard]]
+  auto getData() const -> MaterialData;
+
+  [[nodiscard]]
+  auto getColorTexture() const noexcept -> vk::DescriptorImageInfo;
+
+  [[nodiscard]]
+  auto getNormalTexture() const noexcept -> vk::DescriptorImageInfo;
+
   [[nodiscard]]
   constexpr auto getDescriptorSet() const noexcept -> vk::DescriptorSet;
 
+  /**
+   * @returns The index of the material inside its MaterialRegistry, materials that were
+   * never registered have index 0.
+   */
+  [[nodiscard]]
+  constexpr auto getBindlessIndex() const noexcept -> std::uint32_t;
+
 private:
   auto writeDescriptorSet(core::GpuHandle const& gpu) -> void;
+
+  friend class MaterialRegistry;
 };
 } // namespace pbr
 
@@ -46,3 +76,7 @@ private:
 constexpr auto pbr::Material::getDescriptorSet() const noexcept -> vk::DescriptorSet {
   return _descriptorSet.get();
 }
+
+constexpr auto pbr::Material::getBindlessIndex() const noexcept -> std::uint32_t {
+  return _bindlessIndex;
+}
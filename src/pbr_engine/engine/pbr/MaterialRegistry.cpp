@@ -0,0 +1,168 @@
+#include "pbr/MaterialRegistry.hpp"
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/core/GpuHandle.hpp"
+
+#include "pbr/Buffer.hpp"
+#include "pbr/DescriptorSetAllocator.hpp"
+#include "pbr/Material.hpp"
+#include "pbr/memory/AllocationInfo.hpp"
+#include "pbr/memory/IAllocator.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ranges>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+[[nodiscard]]
+constexpr auto createDescriptorSetLayout(pbr::core::GpuHandle const& gpu)
+    -> vk::UniqueDescriptorSetLayout {
+  std::array const bindings {
+      vk::DescriptorSetLayoutBinding {
+          .binding = 0,
+          .descriptorType = vk::DescriptorType::eStorageBuffer,
+          .descriptorCount = 1,
+          .stageFlags = vk::ShaderStageFlagBits::eFragment,
+      },
+      vk::DescriptorSetLayoutBinding {
+          .binding = 1,
+          .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+          .descriptorCount = pbr::MaterialRegistry::MAX_TEXTURES,
+          .stageFlags = vk::ShaderStageFlagBits::eFragment,
+      },
+  };
+  // Slots of unused materials are never written and textures get written while the set
+  // is bound by frames in flight.
+  std::array<vk::DescriptorBindingFlags, bindings.size()> const bindingFlags {
+      vk::DescriptorBindingFlags {},
+      vk::DescriptorBindingFlagBits::ePartiallyBound
+          | vk::DescriptorBindingFlagBits::eUpdateAfterBind,
+  };
+  return gpu.getDevice().createDescriptorSetLayoutUnique(
+      vk::StructureChain {
+          vk::DescriptorSetLayoutCreateInfo {
+              .flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool,
+          }
+              .setBindings(bindings),
+          vk::DescriptorSetLayoutBindingFlagsCreateInfo {}.setBindingFlags(bindingFlags),
+      }
+          .get());
+}
+[[nodiscard]]
+constexpr auto createDescriptorPool(pbr::core::GpuHandle const& gpu)
+    -> vk::UniqueDescriptorPool {
+  std::array const sizes {
+      vk::DescriptorPoolSize {
+          .type = vk::DescriptorType::eStorageBuffer,
+          .descriptorCount = 1,
+      },
+      vk::DescriptorPoolSize {
+          .type = vk::DescriptorType::eCombinedImageSampler,
+          .descriptorCount = pbr::MaterialRegistry::MAX_TEXTURES,
+      },
+  };
+  return gpu.getDevice().createDescriptorPoolUnique(vk::DescriptorPoolCreateInfo {
+      .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet
+               | vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind,
+      .maxSets = 1,
+  }
+                                                        .setPoolSizes(sizes));
+}
+[[nodiscard]]
+constexpr auto allocateMaterialBuffer(pbr::IAllocator& allocator) -> pbr::Buffer {
+  return allocator.allocateBuffer(
+      {
+          .size = pbr::MaterialRegistry::MAX_MATERIALS
+                  * sizeof(pbr::MaterialRegistry::GpuMaterial),
+          .usage = vk::BufferUsageFlagBits::eStorageBuffer,
+      },
+      {
+          .preference = pbr::AllocationPreference::Host,
+          .ableToBeMapped = true,
+          .persistentlyMapped = true,
+      });
+}
+} // namespace
+
+pbr::MaterialRegistry::MaterialRegistry(core::SharedGpuHandle gpu, IAllocator& allocator)
+    : _gpu(std::move(gpu))
+    , _descLayout(::createDescriptorSetLayout(*_gpu))
+    , _descPool(::createDescriptorPool(*_gpu))
+    , _descSet(
+          DescriptorSetAllocator(_gpu, _descPool.get(), _descLayout.get()).allocate())
+    , _materialBuffer(::allocateMaterialBuffer(allocator)) {
+  vk::DescriptorBufferInfo const bufferInfo {
+      .buffer = _materialBuffer.getBuffer(),
+      .range = vk::WholeSize,
+  };
+  _gpu->getDevice().updateDescriptorSets(
+      vk::WriteDescriptorSet {
+          .dstSet = _descSet.get(),
+          .dstBinding = 0,
+          .descriptorType = vk::DescriptorType::eStorageBuffer,
+      }
+          .setBufferInfo(bufferInfo),
+      {});
+}
+
+auto pbr::MaterialRegistry::isSupported(core::GpuHandle const& gpu) noexcept -> bool {
+  return gpu.getDeviceFeatures().descriptorIndexing;
+}
+
+auto pbr::MaterialRegistry::registerMaterial(std::shared_ptr<Material> const& material)
+    -> std::uint32_t {
+  auto const slot = findFreeSlot();
+  _materials[slot] = material;
+  material->_bindlessIndex = slot;
+
+  auto const firstTexture = slot * TEXTURES_PER_MATERIAL;
+  std::array const textures {material->getColorTexture(), material->getNormalTexture()};
+  _gpu->getDevice().updateDescriptorSets(
+      vk::WriteDescriptorSet {
+          .dstSet = _descSet.get(),
+          .dstBinding = 1,
+          .dstArrayElement = firstTexture,
+          .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+      }
+          .setImageInfo(textures),
+      {});
+
+  GpuMaterial const gpuMaterial {
+      .color = material->getData().color,
+      .colorTexture = firstTexture,
+      .normalTexture = firstTexture + 1,
+      .padding = {},
+  };
+  auto const mapping = _materialBuffer.map();
+  std::memcpy(static_cast<GpuMaterial*>(mapping.get()) + slot, &gpuMaterial,
+              sizeof(GpuMaterial));
+
+  return slot;
+}
+
+auto pbr::MaterialRegistry::getDescriptorSetLayout() const noexcept
+    -> vk::DescriptorSetLayout {
+  return _descLayout.get();
+}
+
+auto pbr::MaterialRegistry::getDescriptorSet() const noexcept -> vk::DescriptorSet {
+  return _descSet.get();
+}
+
+auto pbr::MaterialRegistry::findFreeSlot() -> std::uint32_t {
+  if (_materials.size() < MAX_MATERIALS) {
+    _materials.emplace_back();
+    return static_cast<std::uint32_t>(_materials.size() - 1);
+  }
+  for (auto const [slot, material] : std::views::enumerate(_materials)) {
+    if (material.expired()) {
+      return static_cast<std::uint32_t>(slot);
+    }
+  }
+  throw std::runtime_error("Material registry is full");
+}
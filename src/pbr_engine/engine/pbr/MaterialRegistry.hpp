@@ -0,0 +1,83 @@
+#pragma once
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/core/GpuHandle.hpp"
+
+#include "pbr/Buffer.hpp"
+#include "pbr/Material.hpp"
+#include "pbr/memory/IAllocator.hpp"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/ext/vector_float4.hpp>
+
+namespace pbr {
+/**
+ * Bindless storage of materials.
+ *
+ * Every registered material gets a slot in a single material storage buffer and its
+ * textures are written into one global texture array, so the geometry pass binds a
+ * single descriptor set per frame and the shaders index it by the bindless index of the
+ * material.
+ */
+class MaterialRegistry {
+public:
+  static constexpr std::uint32_t MAX_MATERIALS = 4096;
+  static constexpr std::uint32_t TEXTURES_PER_MATERIAL = 2;
+  static constexpr std::uint32_t MAX_TEXTURES = MAX_MATERIALS * TEXTURES_PER_MATERIAL;
+
+  /// Mirrors Material of the bindless geometry pass shader.
+  struct GpuMaterial {
+    glm::vec4 color;
+    std::uint32_t colorTexture;
+    std::uint32_t normalTexture;
+    std::array<std::uint32_t, 2> padding;
+  };
+
+private:
+  core::SharedGpuHandle _gpu;
+
+  vk::UniqueDescriptorSetLayout _descLayout;
+  vk::UniqueDescriptorPool _descPool;
+  vk::UniqueDescriptorSet _descSet;
+  Buffer _materialBuffer;
+
+  /// Material of every used slot, slots of expired materials get reused.
+  std::vector<std::weak_ptr<Material>> _materials;
+
+public:
+  MaterialRegistry(core::SharedGpuHandle gpu, IAllocator& allocator);
+
+  /**
+   * @returns Whether the device supports the descriptor indexing the registry needs.
+   */
+  [[nodiscard]]
+  static auto isSupported(core::GpuHandle const& gpu) noexcept -> bool;
+
+  /**
+   * Writes the material and its textures into a free slot and stores the slot as the
+   * bindless index of the material.
+   * @note This can be called while the descriptor set is in use.
+   * @throws std::runtime_error If every slot is used by a live material.
+   */
+  auto registerMaterial(std::shared_ptr<Material> const& material) -> std::uint32_t;
+
+  /**
+   * @returns The layout of the set holding the material buffer in binding 0 and the
+   * texture array in binding 1.
+   */
+  [[nodiscard]]
+  auto getDescriptorSetLayout() const noexcept -> vk::DescriptorSetLayout;
+
+  [[nodiscard]]
+  auto getDescriptorSet() const noexcept -> vk::DescriptorSet;
+
+private:
+  [[nodiscard]]
+  auto findFreeSlot() -> std::uint32_t;
+};
+} // namespace pbr
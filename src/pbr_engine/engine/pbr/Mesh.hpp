@@ -1,14 +1,30 @@
 #pragma once
 
+#include "pbr/BoundingBox.hpp"
 #include "pbr/Buffer.hpp"
 #include "pbr/Material.hpp"
+#include "pbr/Meshlet.hpp"
 
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <span>
+#include <utility>
 #include <vector>
 
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+#include <glm/geometric.hpp>
+
 namespace pbr {
+/**
+ * Cpu side triangles of a mesh that hide the geometry behind them, rasterized by the
+ * SoftwareOcclusionCuller.
+ */
+struct OccluderMesh {
+  std::vector<glm::vec3> positions;
+  std::vector<std::uint32_t> indices;
+};
 /**
   * Describes a primitive inside a vertex and index buffers.
 */
@@ -18,6 +34,18 @@ struct PrimitiveSpan {
   std::uint32_t vertexCount;
   std::uint32_t firstIndex;
   std::uint32_t indexCount;
+  /// Sphere in mesh space enclosing every vertex, the radius is stored in w.
+  glm::vec4 boundingSphere {};
+  /// Box in mesh space enclosing every vertex.
+  BoundingBox boundingBox {};
+  /// How far the surface of a level of detail moved in mesh space, 0 for the original.
+  float error {};
+  /// Simplified index ranges of the same vertices from the finest to the coarsest, they
+  /// share the vertices and bounds of this primitive.
+  std::vector<PrimitiveSpan> lods {};
+  /// Ranges of the indices culled on their own, they cover every index of the primitive
+  /// or are empty.
+  std::vector<Meshlet> meshlets {};
 };
 /**
  * Represents a single mesh or a collection of primitives. (Modelled of gltf)
@@ -26,6 +54,9 @@ class Mesh {
   Buffer _vertexBuffer;
   Buffer _indexBuffer;
   std::vector<PrimitiveSpan> _primitives;
+  BoundingBox _boundingBox {};
+  glm::vec4 _boundingSphere {};
+  std::shared_ptr<OccluderMesh const> _occluder {};
 
 public:
   constexpr Mesh(Buffer vertexBuffer, Buffer indexBuffer,
@@ -39,6 +70,30 @@ public:
 
   [[nodiscard]]
   constexpr auto getPrimitives() const noexcept -> std::span<PrimitiveSpan const>;
+
+  /**
+   * @returns The box in mesh space enclosing the boxes of every primitive.
+   */
+  [[nodiscard]]
+  constexpr auto getBoundingBox() const noexcept -> BoundingBox const&;
+
+  /**
+   * @returns The sphere in mesh space enclosing the spheres of every primitive, the
+   * radius is stored in w.
+   */
+  [[nodiscard]]
+  constexpr auto getBoundingSphere() const noexcept -> glm::vec4;
+
+  /**
+   * @returns The triangles used when this mesh occludes others or a nullptr if it does
+   * not occlude anything.
+   */
+  [[nodiscard]]
+  constexpr auto getOccluder() const noexcept
+      -> std::shared_ptr<OccluderMesh const> const&;
+
+  constexpr auto setOccluder(std::shared_ptr<OccluderMesh const> occluder) noexcept
+      -> void;
 };
 }
 
@@ -48,7 +103,23 @@ constexpr pbr::Mesh::Mesh(Buffer vertexBuffer, Buffer indexBuffer,
                 std::vector<PrimitiveSpan> primitives) noexcept
     : _vertexBuffer(std::move(vertexBuffer))
     , _indexBuffer(std::move(indexBuffer))
-    , _primitives(std::move(primitives)) {}
+    , _primitives(std::move(primitives)) {
+  if (_primitives.empty()) {
+    return;
+  }
+
+  _boundingBox = _primitives.front().boundingBox;
+  for (auto const& primitive : _primitives) {
+    _boundingBox = pbr::merge(_boundingBox, primitive.boundingBox);
+  }
+  auto const center = (_boundingBox.min + _boundingBox.max) * 0.5f;
+  auto radius = 0.0f;
+  for (auto const& primitive : _primitives) {
+    radius = std::max(radius, glm::distance(center, glm::vec3(primitive.boundingSphere))
+                                  + primitive.boundingSphere.w);
+  }
+  _boundingSphere = {center, radius};
+}
 
 constexpr auto pbr::Mesh::getVertexBuffer() const noexcept -> Buffer const& {
   return _vertexBuffer;
@@ -61,3 +132,21 @@ constexpr auto pbr::Mesh::getIndexBuffer() const noexcept -> Buffer const& {
 constexpr auto pbr::Mesh::getPrimitives() const noexcept -> std::span<PrimitiveSpan const> {
   return _primitives;
 }
+
+constexpr auto pbr::Mesh::getBoundingBox() const noexcept -> BoundingBox const& {
+  return _boundingBox;
+}
+
+constexpr auto pbr::Mesh::getBoundingSphere() const noexcept -> glm::vec4 {
+  return _boundingSphere;
+}
+
+constexpr auto pbr::Mesh::getOccluder() const noexcept
+    -> std::shared_ptr<OccluderMesh const> const& {
+  return _occluder;
+}
+
+constexpr auto
+pbr::Mesh::setOccluder(std::shared_ptr<OccluderMesh const> occluder) noexcept -> void {
+  _occluder = std::move(occluder);
+}
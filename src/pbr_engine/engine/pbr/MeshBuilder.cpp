@@ -1,18 +1,68 @@
 #include "pbr/MeshBuilder.hpp"
 
+#include "pbr/BoundingBox.hpp"
 #include "pbr/Mesh.hpp"
+#include "pbr/MeshSimplifier.hpp"
+#include "pbr/Meshlet.hpp"
 #include "pbr/MeshVertex.hpp"
 
 #include <algorithm>
 #include <cstddef>
+#include <limits>
+#include <ranges>
+#include <span>
 #include <utility>
 #include <vector>
 
+#include <glm/common.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+#include <glm/geometric.hpp>
+
+auto pbr::computeBoundingBox(std::span<MeshVertex const> vertices) noexcept
+    -> BoundingBox {
+  BoundingBox box {
+      .min = glm::vec3(std::numeric_limits<float>::max()),
+      .max = glm::vec3(std::numeric_limits<float>::lowest()),
+  };
+  for (auto const& vertex : vertices) {
+    box.min = glm::min(box.min, vertex.position);
+    box.max = glm::max(box.max, vertex.position);
+  }
+  return box;
+}
+
+auto pbr::computeBoundingSphere(std::span<MeshVertex const> vertices) noexcept
+    -> glm::vec4 {
+  if (vertices.empty()) {
+    return {};
+  }
+
+  auto const box = pbr::computeBoundingBox(vertices);
+  auto const center = (box.min + box.max) * 0.5f;
+  auto radius = 0.0f;
+  for (auto const& vertex : vertices) {
+    radius = std::max(radius, glm::distance(center, vertex.position));
+  }
+  return {center, radius};
+}
+
 auto pbr::MeshBuilder::addPrimitive(Primitive primitive) -> MeshBuilder& {
   _primitives.emplace_back(std::move(primitive));
   return *this;
 }
 
+auto pbr::MeshBuilder::setLodCount(std::uint32_t const lodCount) noexcept
+    -> MeshBuilder& {
+  _lodCount = std::min(lodCount, MAX_LOD_COUNT);
+  return *this;
+}
+
+auto pbr::MeshBuilder::setMeshlets(bool const meshlets) noexcept -> MeshBuilder& {
+  _meshlets = meshlets;
+  return *this;
+}
+
 auto pbr::MeshBuilder::build() const -> BuiltMesh {
   std::vector<MeshVertex> vertices;
   vertices.reserve(std::ranges::fold_left(
@@ -31,25 +81,93 @@ auto pbr::MeshBuilder::build() const -> BuiltMesh {
   std::uint32_t currentIndex {};
   for (auto const& primitive : _primitives) {
     vertices.insert(vertices.end(), primitive.vertices.begin(), primitive.vertices.end());
-    indices.insert(indices.end(), primitive.indices.begin(), primitive.indices.end());
+    MeshletIndices meshlets;
+    if (_meshlets && primitive.indices.size() / 3 > MAX_MESHLET_TRIANGLES) {
+      meshlets = pbr::buildMeshlets(primitive.vertices, primitive.indices);
+      for (auto& meshlet : meshlets.meshlets) {
+        meshlet.firstIndex += currentIndex;
+      }
+      indices.insert(indices.end(), meshlets.indices.begin(), meshlets.indices.end());
+    } else {
+      indices.insert(indices.end(), primitive.indices.begin(), primitive.indices.end());
+    }
     auto const vertexCount = static_cast<std::uint32_t>(primitive.vertices.size());
     auto const indexCount = static_cast<std::uint32_t>(primitive.indices.size());
 
+    // Known bounds spare the passes over the vertices.
+    auto const boundingBox = primitive.boundingBox.has_value()
+                                 ? *primitive.boundingBox
+                                 : pbr::computeBoundingBox(primitive.vertices);
     primitives.push_back({
         .material = primitive.material,
         .firstVertex = currentVertex,
         .vertexCount = vertexCount,
         .firstIndex = currentIndex,
         .indexCount = indexCount,
+        .boundingSphere = primitive.boundingBox.has_value()
+                              ? pbr::makeBoundingSphere(boundingBox)
+                              : pbr::computeBoundingSphere(primitive.vertices),
+        .boundingBox = boundingBox,
+        .meshlets = std::move(meshlets.meshlets),
     });
 
     currentVertex += vertexCount;
     currentIndex += indexCount;
   }
 
+  // Every level simplifies the previous one, so their errors add up.
+  for (auto const [primitive, built] : std::views::zip(_primitives, primitives)) {
+    std::vector<std::uint16_t> previous = primitive.indices;
+    auto error = 0.0f;
+    for (auto level = 0u; level < _lodCount; ++level) {
+      auto const targetIndexCount = (previous.size() / 6) * 3;
+      if (targetIndexCount < 3) {
+        break;
+      }
+      auto simplified =
+          pbr::simplifyIndices(primitive.vertices, previous, targetIndexCount);
+      if (simplified.indices.size() * 5 > previous.size() * 4) {
+        break;
+      }
+
+      error += simplified.error;
+      auto const indexCount = static_cast<std::uint32_t>(simplified.indices.size());
+      built.lods.push_back({
+          .material = built.material,
+          .firstVertex = built.firstVertex,
+          .vertexCount = built.vertexCount,
+          .firstIndex = currentIndex,
+          .indexCount = indexCount,
+          .boundingSphere = built.boundingSphere,
+          .boundingBox = built.boundingBox,
+          .error = error,
+      });
+      indices.insert(indices.end(), simplified.indices.begin(), simplified.indices.end());
+      currentIndex += indexCount;
+      previous = std::move(simplified.indices);
+    }
+  }
+
   return {
       .vertices = std::move(vertices),
       .indices = std::move(indices),
       .primitives = std::move(primitives),
   };
 }
+
+auto pbr::makeOccluderMesh(MeshBuilder::BuiltMesh const& mesh) -> OccluderMesh {
+  OccluderMesh occluder;
+  occluder.positions.reserve(mesh.vertices.size());
+  for (auto const& vertex : mesh.vertices) {
+    occluder.positions.push_back(vertex.position);
+  }
+  occluder.indices.reserve(mesh.indices.size());
+  for (auto const& primitive : mesh.primitives) {
+    auto const indices =
+        std::span(mesh.indices).subspan(primitive.firstIndex, primitive.indexCount);
+    for (auto const index : indices) {
+      occluder.indices.push_back(primitive.firstVertex + index);
+    }
+  }
+  return occluder;
+}
@@ -1,21 +1,41 @@
 #pragma once
 
+#include "pbr/BoundingBox.hpp"
 #include "pbr/Material.hpp"
 #include "pbr/Mesh.hpp"
 #include "pbr/MeshVertex.hpp"
 
 #include <cstdint>
 #include <memory>
+#include <optional>
+#include <span>
 #include <utility>
 #include <vector>
 
+#include <glm/ext/vector_float4.hpp>
+
 namespace pbr {
+/**
+ * @returns The box enclosing all the vertices or an empty box without vertices.
+ */
+[[nodiscard]]
+auto computeBoundingBox(std::span<MeshVertex const> vertices) noexcept -> BoundingBox;
+/**
+ * Computes a sphere enclosing all the vertices centered on their bounding box.
+ * @returns The center of the sphere in xyz and its radius in w.
+ */
+[[nodiscard]]
+auto computeBoundingSphere(std::span<MeshVertex const> vertices) noexcept -> glm::vec4;
+
 class MeshBuilder {
 public:
   struct Primitive {
     std::shared_ptr<Material> material {};
     std::vector<MeshVertex> vertices {};
     std::vector<std::uint16_t> indices {};
+    /// Optional, known bounds of the vertices like the min and max of a gltf accessor.
+    /// The bounds are computed from the vertices without it.
+    std::optional<BoundingBox> boundingBox {};
   };
   struct BuiltMesh {
     std::vector<MeshVertex> vertices;
@@ -23,8 +43,13 @@ public:
     std::vector<PrimitiveSpan> primitives;
   };
 
+  /// The most levels of detail built for a primitive.
+  static constexpr std::uint32_t MAX_LOD_COUNT = 4;
+
 private:
   std::vector<Primitive> _primitives {};
+  std::uint32_t _lodCount = 0;
+  bool _meshlets = false;
 
 public:
   MeshBuilder() = default;
@@ -33,9 +58,29 @@ public:
   constexpr auto addPrimitive(std::vector<MeshVertex> vertices,
                               std::vector<std::uint16_t> indices) -> MeshBuilder&;
 
+  /**
+   * Builds up to lodCount levels of detail for every primitive, each with about half the
+   * triangles of the previous one. Their indices are placed after the indices of every
+   * primitive and a chain stops early once simplifying barely removes triangles.
+   * @note The count is clamped to MAX_LOD_COUNT.
+   */
+  auto setLodCount(std::uint32_t lodCount) noexcept -> MeshBuilder&;
+
+  /**
+   * Splits primitives too large for a single meshlet into meshlets, their indices are
+   * reordered so every meshlet is a range of them.
+   */
+  auto setMeshlets(bool meshlets) noexcept -> MeshBuilder&;
+
   [[nodiscard]]
   auto build() const -> BuiltMesh;
 };
+/**
+ * Copies the positions and triangles of every primitive of a built mesh, the indices
+ * are offset by the first vertex of their primitive.
+ */
+[[nodiscard]]
+auto makeOccluderMesh(MeshBuilder::BuiltMesh const& mesh) -> OccluderMesh;
 } // namespace pbr
 
 /* IMPLEMENTATIONS */
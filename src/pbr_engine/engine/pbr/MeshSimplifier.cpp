@@ -0,0 +1,273 @@
+#include "pbr/MeshSimplifier.hpp"
+
+#include "pbr/MeshVertex.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <ranges>
+#include <span>
+#include <tuple>
+#include <vector>
+
+#include <glm/ext/vector_double3.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/geometric.hpp>
+
+namespace {
+/**
+ * The sum of the squared distances to a set of planes as a symmetric 4x4 matrix.
+ */
+struct Quadric {
+  /// aa, ab, ac, ad, bb, bc, bd, cc, cd and dd of the planes ax + by + cz + d.
+  std::array<double, 10> terms {};
+
+  constexpr auto operator+=(Quadric const& other) noexcept -> Quadric& {
+    for (auto const [term, otherTerm] : std::views::zip(terms, other.terms)) {
+      term += otherTerm;
+    }
+    return *this;
+  }
+
+  [[nodiscard]]
+  constexpr auto evaluate(glm::vec3 const point) const noexcept -> double {
+    auto const [aa, ab, ac, ad, bb, bc, bd, cc, cd, dd] = terms;
+    auto const x = static_cast<double>(point.x);
+    auto const y = static_cast<double>(point.y);
+    auto const z = static_cast<double>(point.z);
+    return (aa * x * x) + (2.0 * ab * x * y) + (2.0 * ac * x * z) + (2.0 * ad * x)
+           + (bb * y * y) + (2.0 * bc * y * z) + (2.0 * bd * y) + (cc * z * z)
+           + (2.0 * cd * z) + dd;
+  }
+};
+[[nodiscard]]
+constexpr auto makePlaneQuadric(glm::dvec3 const normal, double const distance) noexcept
+    -> Quadric {
+  auto const a = normal.x;
+  auto const b = normal.y;
+  auto const c = normal.z;
+  auto const d = distance;
+  return {{a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d}};
+}
+/**
+ * Moving from onto to, the cost is the quadric error at the position of to.
+ */
+struct Collapse {
+  double cost;
+  std::uint16_t from;
+  std::uint16_t to;
+};
+[[nodiscard]]
+constexpr auto getNormal(glm::vec3 const a, glm::vec3 const b, glm::vec3 const c) noexcept
+    -> glm::vec3 {
+  return glm::cross(b - a, c - a);
+}
+/**
+ * Locks every vertex that shares its position with another vertex.
+ */
+auto lockSeams(std::span<pbr::MeshVertex const> vertices,
+               std::vector<std::uint8_t>& locked) -> void {
+  std::vector<std::uint16_t> order(vertices.size());
+  std::ranges::iota(order, std::uint16_t {0});
+  auto const getKey = [&](std::uint16_t const vertex) {
+    auto const& position = vertices[vertex].position;
+    return std::tuple(position.x, position.y, position.z);
+  };
+  std::ranges::sort(order, {}, getKey);
+  for (auto const [first, second] : order | std::views::pairwise) {
+    if (getKey(first) == getKey(second)) {
+      locked[first] = 1;
+      locked[second] = 1;
+    }
+  }
+}
+/**
+ * Locks both vertices of every edge that only belongs to a single triangle.
+ */
+auto lockBorders(std::span<std::uint16_t const> indices,
+                 std::vector<std::uint8_t>& locked) -> void {
+  std::vector<std::uint32_t> edges;
+  edges.reserve(indices.size());
+  for (auto triangle = 0uz; triangle + 2 < indices.size(); triangle += 3) {
+    for (auto corner = 0uz; corner < 3; ++corner) {
+      auto const a = indices[triangle + corner];
+      auto const b = indices[triangle + ((corner + 1) % 3)];
+      edges.push_back((static_cast<std::uint32_t>(std::min(a, b)) << 16u)
+                      | std::max(a, b));
+    }
+  }
+  std::ranges::sort(edges);
+  for (auto const run : edges | std::views::chunk_by(std::ranges::equal_to {})) {
+    if (std::ranges::distance(run) == 1) {
+      locked[run.front() >> 16u] = 1;
+      locked[run.front() & 0xFFFFu] = 1;
+    }
+  }
+}
+/**
+ * Lists the triangles around every vertex, the triangles of a vertex start at its offset
+ * and end at the offset of the next vertex.
+ */
+auto buildAdjacency(std::span<std::uint16_t const> indices, std::size_t const vertexCount,
+                    std::vector<std::uint32_t>& offsets,
+                    std::vector<std::uint32_t>& triangles) -> void {
+  offsets.assign(vertexCount + 1, 0);
+  for (auto const index : indices) {
+    ++offsets[index + 1uz];
+  }
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+  auto cursors = offsets;
+  triangles.resize(indices.size());
+  for (auto const [corner, index] : std::views::enumerate(indices)) {
+    triangles[cursors[index]++] = static_cast<std::uint32_t>(corner / 3);
+  }
+}
+/**
+ * @returns Whether moving from onto to turns any of the triangles around from over.
+ */
+[[nodiscard]]
+auto isFlipping(std::span<pbr::MeshVertex const> vertices,
+                std::span<std::uint16_t const> indices,
+                std::span<std::uint32_t const> triangles, std::uint16_t const from,
+                std::uint16_t const to) -> bool {
+  for (auto const triangle : triangles) {
+    auto const corners = indices.subspan(triangle * 3uz, 3);
+    // Triangles along the edge are removed.
+    if (std::ranges::contains(corners, to)) {
+      continue;
+    }
+    std::array<glm::vec3, 3> original {};
+    std::array<glm::vec3, 3> moved {};
+    for (auto corner = 0uz; corner < 3; ++corner) {
+      original[corner] = vertices[corners[corner]].position;
+      moved[corner] = vertices[corners[corner] == from ? to : corners[corner]].position;
+    }
+    if (glm::dot(::getNormal(original[0], original[1], original[2]),
+                 ::getNormal(moved[0], moved[1], moved[2]))
+        <= 0.0f) {
+      return true;
+    }
+  }
+  return false;
+}
+} // namespace
+
+auto pbr::simplifyIndices(std::span<MeshVertex const> const vertices,
+                          std::span<std::uint16_t const> const indices,
+                          std::size_t const targetIndexCount) -> SimplifiedIndices {
+  SimplifiedIndices result {
+      .indices = {indices.begin(), indices.end()},
+      .error = 0.0f,
+  };
+
+  std::vector<std::uint8_t> locked(vertices.size(), 0);
+  ::lockSeams(vertices, locked);
+  ::lockBorders(indices, locked);
+
+  std::vector<Quadric> quadrics(vertices.size());
+  for (auto triangle = 0uz; triangle + 2 < indices.size(); triangle += 3) {
+    auto const corners = indices.subspan(triangle, 3);
+    auto const normal = glm::dvec3(::getNormal(vertices[corners[0]].position,
+                                               vertices[corners[1]].position,
+                                               vertices[corners[2]].position));
+    auto const length = glm::length(normal);
+    if (length == 0.0) {
+      continue;
+    }
+    auto const unitNormal = normal / length;
+    auto const quadric = ::makePlaneQuadric(
+        unitNormal, -glm::dot(unitNormal, glm::dvec3(vertices[corners[0]].position)));
+    for (auto const corner : corners) {
+      quadrics[corner] += quadric;
+    }
+  }
+
+  std::vector<std::uint32_t> offsets;
+  std::vector<std::uint32_t> adjacency;
+  std::vector<Collapse> candidates;
+  std::vector<std::uint16_t> collapses(vertices.size());
+  std::vector<std::uint8_t> touched(vertices.size());
+  // Every pass collapses edges that do not share a triangle, so the collapses of a pass
+  // cannot invalidate the flip test of each other.
+  while (result.indices.size() > targetIndexCount) {
+    auto& current = result.indices;
+    ::buildAdjacency(current, vertices.size(), offsets, adjacency);
+
+    candidates.clear();
+    for (auto triangle = 0uz; triangle + 2 < current.size(); triangle += 3) {
+      for (auto corner = 0uz; corner < 3; ++corner) {
+        auto const a = current[triangle + corner];
+        auto const b = current[triangle + ((corner + 1) % 3)];
+        for (auto const [from, to] : {std::pair(a, b), std::pair(b, a)}) {
+          if (locked[from] == 0) {
+            auto quadric = quadrics[from];
+            quadric += quadrics[to];
+            candidates.push_back({
+                .cost = quadric.evaluate(vertices[to].position),
+                .from = from,
+                .to = to,
+            });
+          }
+        }
+      }
+    }
+    std::ranges::sort(candidates, {}, &Collapse::cost);
+
+    std::ranges::iota(collapses, std::uint16_t {0});
+    std::ranges::fill(touched, 0);
+    auto const excessTriangles = (current.size() - targetIndexCount + 2) / 3;
+    auto removedTriangles = 0uz;
+    for (auto const& candidate : candidates) {
+      if (removedTriangles >= excessTriangles) {
+        break;
+      }
+      if (touched[candidate.from] != 0 || touched[candidate.to] != 0) {
+        continue;
+      }
+      auto const first = offsets[candidate.from];
+      auto const around =
+          std::span(adjacency).subspan(first, offsets[candidate.from + 1uz] - first);
+      if (::isFlipping(vertices, current, around, candidate.from, candidate.to)) {
+        continue;
+      }
+
+      collapses[candidate.from] = candidate.to;
+      quadrics[candidate.to] += quadrics[candidate.from];
+      result.error = std::max(
+          result.error, static_cast<float>(std::sqrt(std::max(candidate.cost, 0.0))));
+      for (auto const triangle : around) {
+        auto const corners = std::span(current).subspan(triangle * 3uz, 3);
+        if (std::ranges::contains(corners, candidate.to)) {
+          ++removedTriangles;
+        }
+        for (auto const corner : corners) {
+          touched[corner] = 1;
+        }
+      }
+    }
+    if (removedTriangles == 0) {
+      break;
+    }
+
+    auto written = 0uz;
+    for (auto triangle = 0uz; triangle + 2 < current.size(); triangle += 3) {
+      std::array const corners {
+          collapses[current[triangle]],
+          collapses[current[triangle + 1]],
+          collapses[current[triangle + 2]],
+      };
+      if (corners[0] != corners[1] && corners[1] != corners[2]
+          && corners[2] != corners[0]) {
+        std::ranges::copy(corners,
+                          current.begin() + static_cast<std::ptrdiff_t>(written));
+        written += 3;
+      }
+    }
+    current.resize(written);
+  }
+  return result;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "pbr/MeshVertex.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace pbr {
+struct SimplifiedIndices {
+  std::vector<std::uint16_t> indices;
+  /// Upper bound of the distance the surface moved, in the space of the vertices.
+  float error;
+};
+/**
+ * Removes triangles by collapsing edges in the order of their quadric error until at
+ * most targetIndexCount indices are left or no edge can be collapsed.
+ *
+ * Every vertex is kept where it is and only the indices change, so the result can be
+ * drawn with the same vertices. Vertices on open edges and vertices sharing their
+ * position with another vertex, like on seams of the texture coordinates, never move so
+ * borders and seams do not crack. Collapses that would flip a triangle are skipped.
+ */
+[[nodiscard]]
+auto simplifyIndices(std::span<MeshVertex const> vertices,
+                     std::span<std::uint16_t const> indices, std::size_t targetIndexCount)
+    -> SimplifiedIndices;
+} // namespace pbr
@@ -0,0 +1,172 @@
+#include "pbr/Meshlet.hpp"
+
+#include "pbr/MeshVertex.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <ranges>
+#include <span>
+#include <vector>
+
+#include <glm/common.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+#include <glm/geometric.hpp>
+
+namespace constants {
+/// Cones whose triangles face further apart than this are never culled.
+static constexpr auto MIN_CONE_DOT = 0.1f;
+} // namespace constants
+
+namespace {
+/**
+ * Computes the bounds of the triangles of a meshlet.
+ */
+[[nodiscard]]
+auto makeMeshlet(std::span<pbr::MeshVertex const> vertices,
+                 std::span<std::uint16_t const> indices,
+                 std::uint32_t const firstIndex) -> pbr::Meshlet {
+  auto min = glm::vec3(std::numeric_limits<float>::max());
+  auto max = glm::vec3(std::numeric_limits<float>::lowest());
+  auto normalSum = glm::vec3(0.0f);
+  for (auto const triangle : indices | std::views::chunk(3)) {
+    auto const& a = vertices[triangle[0]].position;
+    auto const& b = vertices[triangle[1]].position;
+    auto const& c = vertices[triangle[2]].position;
+    for (auto const& position : {a, b, c}) {
+      min = glm::min(min, position);
+      max = glm::max(max, position);
+    }
+    auto const normal = glm::cross(b - a, c - a);
+    if (auto const length = glm::length(normal); length > 0.0f) {
+      normalSum += normal / length;
+    }
+  }
+
+  auto const center = (min + max) * 0.5f;
+  auto radius = 0.0f;
+  for (auto const index : indices) {
+    radius = std::max(radius, glm::distance(center, vertices[index].position));
+  }
+
+  pbr::Meshlet meshlet {
+      .boundingSphere = {center, radius},
+      .cone = {0.0f, 0.0f, 0.0f, 1.0f},
+      .firstIndex = firstIndex,
+      .indexCount = static_cast<std::uint32_t>(indices.size()),
+  };
+  auto const normalLength = glm::length(normalSum);
+  if (normalLength == 0.0f) {
+    return meshlet;
+  }
+
+  auto const axis = normalSum / normalLength;
+  auto minDot = 1.0f;
+  for (auto const triangle : indices | std::views::chunk(3)) {
+    auto const& a = vertices[triangle[0]].position;
+    auto const normal = glm::cross(vertices[triangle[1]].position - a,
+                                   vertices[triangle[2]].position - a);
+    if (auto const length = glm::length(normal); length > 0.0f) {
+      minDot = std::min(minDot, glm::dot(normal / length, axis));
+    }
+  }
+  if (minDot > constants::MIN_CONE_DOT) {
+    meshlet.cone = {axis, std::sqrt(1.0f - (minDot * minDot))};
+  }
+  return meshlet;
+}
+} // namespace
+
+auto pbr::buildMeshlets(std::span<MeshVertex const> const vertices,
+                        std::span<std::uint16_t const> const indices) -> MeshletIndices {
+  auto const triangleCount = indices.size() / 3;
+  MeshletIndices result;
+  result.indices.reserve(triangleCount * 3);
+
+  // The triangles around every vertex, see the simplifier.
+  std::vector<std::uint32_t> offsets(vertices.size() + 1, 0);
+  for (auto const index : indices.first(triangleCount * 3)) {
+    ++offsets[index + 1uz];
+  }
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  std::vector<std::uint32_t> adjacency(triangleCount * 3);
+  auto cursors = offsets;
+  for (auto const [corner, index] :
+       std::views::enumerate(indices.first(triangleCount * 3))) {
+    adjacency[cursors[index]++] = static_cast<std::uint32_t>(corner / 3);
+  }
+
+  std::vector<std::uint8_t> usedTriangles(triangleCount, 0);
+  std::vector<std::uint8_t> meshletVertices(vertices.size(), 0);
+  std::vector<std::uint16_t> addedVertices;
+  std::vector<std::uint32_t> candidates;
+  auto const getNewVertexCount = [&](std::size_t const triangle) {
+    return std::ranges::count_if(indices.subspan(triangle * 3, 3),
+                                 [&](auto const index) {
+                                   return meshletVertices[index] == 0;
+                                 });
+  };
+
+  auto seed = 0uz;
+  while (true) {
+    while (seed < triangleCount && usedTriangles[seed] != 0) {
+      ++seed;
+    }
+    if (seed == triangleCount) {
+      break;
+    }
+
+    auto const firstIndex = static_cast<std::uint32_t>(result.indices.size());
+    auto triangle = seed;
+    auto meshletTriangles = 0u;
+    while (true) {
+      usedTriangles[triangle] = 1;
+      ++meshletTriangles;
+      for (auto const index : indices.subspan(triangle * 3, 3)) {
+        result.indices.push_back(index);
+        if (meshletVertices[index] == 0) {
+          meshletVertices[index] = 1;
+          addedVertices.push_back(index);
+          auto const around = std::span(adjacency).subspan(
+              offsets[index], offsets[index + 1uz] - offsets[index]);
+          candidates.insert(candidates.end(), around.begin(), around.end());
+        }
+      }
+      if (meshletTriangles == MAX_MESHLET_TRIANGLES) {
+        break;
+      }
+
+      std::erase_if(candidates, [&](auto const candidate) {
+        return usedTriangles[candidate] != 0;
+      });
+      auto best = triangleCount;
+      std::ptrdiff_t bestNewVertices = 4;
+      for (auto const candidate : candidates) {
+        auto const newVertices = getNewVertexCount(candidate);
+        if (newVertices < bestNewVertices
+            && addedVertices.size() + static_cast<std::size_t>(newVertices)
+                   <= MAX_MESHLET_VERTICES) {
+          best = candidate;
+          bestNewVertices = newVertices;
+        }
+      }
+      if (best == triangleCount) {
+        break;
+      }
+      triangle = best;
+    }
+
+    result.meshlets.push_back(::makeMeshlet(
+        vertices, std::span(result.indices).subspan(firstIndex), firstIndex));
+    for (auto const index : addedVertices) {
+      meshletVertices[index] = 0;
+    }
+    addedVertices.clear();
+    candidates.clear();
+  }
+  return result;
+}
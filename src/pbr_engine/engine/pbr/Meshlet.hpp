@@ -0,0 +1,69 @@
+#pragma once
+
+#include "pbr/MeshVertex.hpp"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+#include <glm/geometric.hpp>
+
+namespace pbr {
+/**
+ * A cluster of neighbouring triangles of a primitive culled on its own.
+ */
+struct Meshlet {
+  /// Sphere in mesh space enclosing the triangles, the radius is stored in w.
+  glm::vec4 boundingSphere {};
+  /// The average normal of the triangles in xyz and the sine of the angle between it and
+  /// the normal furthest from it in w. A w of 1 never culls the meshlet.
+  glm::vec4 cone {};
+  std::uint32_t firstIndex {};
+  std::uint32_t indexCount {};
+};
+/**
+ * The triangles of a primitive reordered so every meshlet is a range of them.
+ */
+struct MeshletIndices {
+  std::vector<std::uint16_t> indices;
+  /// The first index of every meshlet is relative to the start of the indices.
+  std::vector<Meshlet> meshlets;
+};
+/**
+ * Most vertices and triangles of a meshlet, the sizes preferred by mesh shading hardware.
+ */
+constexpr std::uint32_t MAX_MESHLET_VERTICES = 64;
+constexpr std::uint32_t MAX_MESHLET_TRIANGLES = 124;
+/**
+ * Splits the triangles into meshlets of at most MAX_MESHLET_VERTICES vertices and
+ * MAX_MESHLET_TRIANGLES triangles.
+ *
+ * A meshlet grows from a triangle by adding the neighbouring triangle that brings in the
+ * fewest new vertices and starts over at the next unused triangle once nothing
+ * neighbouring fits, so the meshlets stay compact and their cones narrow.
+ */
+[[nodiscard]]
+auto buildMeshlets(std::span<MeshVertex const> vertices,
+                   std::span<std::uint16_t const> indices) -> MeshletIndices;
+/**
+ * @param sphere The world space sphere of the meshlet, the radius is stored in w.
+ * @param cone The cone of the meshlet with its axis in world space.
+ * @returns Whether every triangle of the meshlet faces away from the camera.
+ * @note Mirrors the culling shader.
+ */
+[[nodiscard]]
+constexpr auto isMeshletBackfacing(glm::vec4 sphere, glm::vec4 cone,
+                                   glm::vec3 cameraPosition) noexcept -> bool;
+} // namespace pbr
+
+/* IMPLEMENTATIONS */
+
+constexpr auto pbr::isMeshletBackfacing(glm::vec4 const sphere, glm::vec4 const cone,
+                                        glm::vec3 const cameraPosition) noexcept
+    -> bool {
+  auto const toCenter = glm::vec3(sphere) - cameraPosition;
+  return glm::dot(toCenter, glm::vec3(cone))
+         >= (cone.w * glm::length(toCenter)) + sphere.w;
+}
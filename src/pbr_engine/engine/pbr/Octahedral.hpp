@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glm/common.hpp>
+#include <glm/ext/vector_float2.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/geometric.hpp>
+
+namespace pbr {
+/**
+ * Folds the lower half of the octahedron over the diagonals of the square onto its
+ * corners, the fold is its own inverse.
+ */
+[[nodiscard]]
+constexpr auto octWrap(glm::vec2 point) noexcept -> glm::vec2;
+/**
+ * Maps a unit vector onto an octahedron unfolded into the -1..1 square, so it can be
+ * stored in two channels.
+ * @note Mirrors octEncode of Octahedral.lib.glsl.
+ */
+[[nodiscard]]
+constexpr auto octEncode(glm::vec3 normal) noexcept -> glm::vec2;
+/**
+ * @returns The unit vector of a point of the unfolded octahedron.
+ * @note Mirrors octDecode of Octahedral.lib.glsl.
+ */
+[[nodiscard]]
+constexpr auto octDecode(glm::vec2 encoded) noexcept -> glm::vec3;
+} // namespace pbr
+
+/* IMPLEMENTATIONS */
+
+constexpr auto pbr::octWrap(glm::vec2 const point) noexcept -> glm::vec2 {
+  glm::vec2 const signs(point.x >= 0.0f ? 1.0f : -1.0f, point.y >= 0.0f ? 1.0f : -1.0f);
+  return (1.0f - glm::abs(glm::vec2(point.y, point.x))) * signs;
+}
+
+constexpr auto pbr::octEncode(glm::vec3 const normal) noexcept -> glm::vec2 {
+  auto const projected =
+      glm::vec2(normal) / (glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z));
+  return normal.z >= 0.0f ? projected : octWrap(projected);
+}
+
+constexpr auto pbr::octDecode(glm::vec2 const encoded) noexcept -> glm::vec3 {
+  auto const z = 1.0f - glm::abs(encoded.x) - glm::abs(encoded.y);
+  return glm::normalize(glm::vec3(z >= 0.0f ? encoded : octWrap(encoded), z));
+}
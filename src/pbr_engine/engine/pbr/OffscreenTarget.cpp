@@ -0,0 +1,30 @@
+#include "pbr/OffscreenTarget.hpp"
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/core/GpuHandle.hpp"
+
+#include "pbr/Image2D.hpp"
+#include "pbr/memory/IAllocator.hpp"
+
+pbr::OffscreenTarget::OffscreenTarget(core::GpuHandle const& gpu, IAllocator& allocator,
+                                      vk::Extent2D const extent)
+    : _image(gpu, FORMAT, vk::ImageAspectFlagBits::eColor,
+             allocator.allocateImage(getImageInfo(extent), {}))
+    , _extent(extent) {}
+
+auto pbr::OffscreenTarget::getImageInfo(vk::Extent2D const extent) noexcept
+    -> vk::ImageCreateInfo {
+  return {
+      .imageType = vk::ImageType::e2D,
+      .format = FORMAT,
+      .extent {
+          .width = extent.width,
+          .height = extent.height,
+          .depth = 1,
+      },
+      .mipLevels = 1,
+      .arrayLayers = 1,
+      .usage = vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eTransferSrc,
+  };
+}
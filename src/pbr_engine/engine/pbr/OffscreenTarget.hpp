@@ -0,0 +1,56 @@
+#pragma once
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/core/GpuHandle.hpp"
+
+#include "pbr/Image2D.hpp"
+#include "pbr/memory/IAllocator.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pbr {
+/**
+ * An image the tonemapper writes instead of a swapchain image, for rendering without a
+ * surface. Its pixels are copied out through a ReadbackRing.
+ */
+class OffscreenTarget {
+public:
+  /// Matches the output of the tonemapper, which applies the gamma itself.
+  static constexpr auto FORMAT = vk::Format::eR8G8B8A8Unorm;
+  static constexpr std::uint32_t BYTES_PER_PIXEL = 4;
+
+private:
+  Image2D _image;
+  vk::Extent2D _extent;
+
+public:
+  OffscreenTarget(core::GpuHandle const& gpu, IAllocator& allocator, vk::Extent2D extent);
+
+  [[nodiscard]]
+  static auto getImageInfo(vk::Extent2D extent) noexcept -> vk::ImageCreateInfo;
+
+  [[nodiscard]]
+  constexpr auto getImage() const noexcept -> Image2D const&;
+  [[nodiscard]]
+  constexpr auto getExtent() const noexcept -> vk::Extent2D;
+  /**
+   * @returns The bytes of the tightly packed pixels.
+   */
+  [[nodiscard]]
+  constexpr auto getByteSize() const noexcept -> std::size_t;
+};
+} // namespace pbr
+
+/* IMPLEMENTATIONS */
+
+constexpr auto pbr::OffscreenTarget::getImage() const noexcept -> Image2D const& {
+  return _image;
+}
+constexpr auto pbr::OffscreenTarget::getExtent() const noexcept -> vk::Extent2D {
+  return _extent;
+}
+constexpr auto pbr::OffscreenTarget::getByteSize() const noexcept -> std::size_t {
+  return static_cast<std::size_t>(_extent.width) * _extent.height * BYTES_PER_PIXEL;
+}
@@ -5,22 +5,55 @@
 #include "pbr/core/GpuHandle.hpp"
 #include "pbr/core/PipelineBuilder.hpp"
 
+#include "pbr/CullingSystem.hpp"
+#include "pbr/DepthPyramidSystem.hpp"
+#include "pbr/DescriptorSetAllocator.hpp"
+#include "pbr/DrawList.hpp"
+#include "pbr/FrustumCuller.hpp"
 #include "pbr/GBuffer.hpp"
+#include "pbr/GrowableBuffer.hpp"
 #include "pbr/Image2D.hpp"
+#include "pbr/InstanceData.hpp"
+#include "pbr/Light.hpp"
+#include "pbr/LightBuffer.hpp"
+#include "pbr/Lod.hpp"
+#include "pbr/MaterialRegistry.hpp"
 #include "pbr/MeshVertex.hpp"
-#include "pbr/ModelPushConstant.hpp"
+#include "pbr/RenderGraph.hpp"
 #include "pbr/Scene.hpp"
+#include "pbr/SoftwareOcclusionCuller.hpp"
+#include "pbr/ThreadPool.hpp"
+#include "pbr/TiledLightingSystem.hpp"
+#include "pbr/memory/AllocationInfo.hpp"
 #include "pbr/memory/IAllocator.hpp"
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <ranges>
 #include <span>
+#include <tuple>
 #include <utility>
+#include <vector>
 
 namespace constants {
 static constexpr std::uint32_t MAX_G_BUFFER_DESCRIPTOR_SETS = 30;
-}
+static constexpr vk::DeviceSize MIN_INSTANCE_CAPACITY = 1024;
+static constexpr std::uint32_t INSTANCE_SET_BINDING_COUNT = 2;
+/// Chunks smaller than this are not worth the overhead of a secondary command buffer.
+static constexpr std::uint32_t MIN_BATCHES_PER_CHUNK = 64;
+/// The g-buffer is read by the lighting pass or by the tiled lighting pass.
+static constexpr auto G_BUFFER_STAGES =
+    vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute;
+/// Occlusion queries of a frame slot, one for the depth pre-pass and the geometry pass.
+static constexpr std::uint32_t OVERDRAW_QUERY_COUNT = 2;
+static constexpr std::uint32_t DEPTH_QUERY = 0;
+static constexpr std::uint32_t G_BUFFER_QUERY = 1;
+} // namespace constants
 
 namespace {
 [[nodiscard]]
@@ -65,6 +98,52 @@ constexpr auto createMaterialDescriptorSetLayout(pbr::core::GpuHandle const& gpu
       vk::DescriptorSetLayoutCreateInfo {}.setBindings(bindings));
 }
 [[nodiscard]]
+constexpr auto createInstanceDescriptorSetLayout(pbr::core::GpuHandle const& gpu)
+    -> vk::UniqueDescriptorSetLayout {
+  std::array const bindings {
+      vk::DescriptorSetLayoutBinding {
+          .binding = 0,
+          .descriptorType = vk::DescriptorType::eStorageBuffer,
+          .descriptorCount = 1,
+          .stageFlags = vk::ShaderStageFlagBits::eVertex,
+      },
+      // Visible instances of the gpu driven path.
+      vk::DescriptorSetLayoutBinding {
+          .binding = 1,
+          .descriptorType = vk::DescriptorType::eStorageBuffer,
+          .descriptorCount = 1,
+          .stageFlags = vk::ShaderStageFlagBits::eVertex,
+      },
+  };
+  return gpu.getDevice().createDescriptorSetLayoutUnique(
+      vk::DescriptorSetLayoutCreateInfo {}.setBindings(bindings));
+}
+[[nodiscard]]
+constexpr auto createInstanceDescriptorPool(pbr::core::GpuHandle const& gpu,
+                                            std::uint32_t setCount)
+    -> vk::UniqueDescriptorPool {
+  vk::DescriptorPoolSize const size {
+      .type = vk::DescriptorType::eStorageBuffer,
+      .descriptorCount = constants::INSTANCE_SET_BINDING_COUNT * setCount,
+  };
+  return gpu.getDevice().createDescriptorPoolUnique(vk::DescriptorPoolCreateInfo {
+      .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+      .maxSets = setCount,
+  }
+                                                        .setPoolSizes(size));
+}
+[[nodiscard]]
+constexpr auto createMaterialRegistry(pbr::core::SharedGpuHandle const& gpu,
+                                      pbr::IAllocator& allocator,
+                                      pbr::PbrRenderSystemCreateInfo const& info)
+    -> std::optional<pbr::MaterialRegistry> {
+  if (!info.geometryBindlessFragmentShader.module
+      || !pbr::MaterialRegistry::isSupported(*gpu)) {
+    return std::nullopt;
+  }
+  return std::make_optional<pbr::MaterialRegistry>(gpu, allocator);
+}
+[[nodiscard]]
 constexpr auto createGBufferSampler(pbr::core::GpuHandle const& gpu)
     -> vk::UniqueSampler {
   return gpu.getDevice().createSamplerUnique({
@@ -95,32 +174,32 @@ constexpr auto createGBufferDescriptorSetLayout(pbr::core::GpuHandle const& gpu,
           .binding = 0,
           .descriptorType = vk::DescriptorType::eSampledImage,
           .descriptorCount = 1,
-          .stageFlags = vk::ShaderStageFlagBits::eFragment,
+          .stageFlags = constants::G_BUFFER_STAGES,
       },
       vk::DescriptorSetLayoutBinding {
           .binding = 1,
           .descriptorType = vk::DescriptorType::eSampledImage,
           .descriptorCount = 1,
-          .stageFlags = vk::ShaderStageFlagBits::eFragment,
+          .stageFlags = constants::G_BUFFER_STAGES,
       },
       vk::DescriptorSetLayoutBinding {
           .binding = 2,
           .descriptorType = vk::DescriptorType::eSampledImage,
           .descriptorCount = 1,
-          .stageFlags = vk::ShaderStageFlagBits::eFragment,
+          .stageFlags = constants::G_BUFFER_STAGES,
       },
       vk::DescriptorSetLayoutBinding {
           .binding = 3,
           .descriptorType = vk::DescriptorType::eSampler,
           .descriptorCount = 1,
-          .stageFlags = vk::ShaderStageFlagBits::eFragment,
+          .stageFlags = constants::G_BUFFER_STAGES,
           .pImmutableSamplers = &gBufferSampler,
       },
       vk::DescriptorSetLayoutBinding {
           .binding = 4,
           .descriptorType = vk::DescriptorType::eCombinedImageSampler,
           .descriptorCount = 1,
-          .stageFlags = vk::ShaderStageFlagBits::eFragment,
+          .stageFlags = constants::G_BUFFER_STAGES,
           .pImmutableSamplers = &depthSampler,
       },
   };
@@ -156,13 +235,8 @@ constexpr auto
 createGeometryPipelineLayout(pbr::core::GpuHandle const& gpu,
                              std::span<vk::DescriptorSetLayout const> descLayouts)
     -> vk::UniquePipelineLayout {
-  vk::PushConstantRange const pcRange {
-      .stageFlags = vk::ShaderStageFlagBits::eVertex,
-      .size = sizeof(pbr::ModelPushConstant),
-  };
-  return gpu.getDevice().createPipelineLayoutUnique(vk::PipelineLayoutCreateInfo {}
-                                                        .setSetLayouts(descLayouts)
-                                                        .setPushConstantRanges(pcRange));
+  return gpu.getDevice().createPipelineLayoutUnique(
+      vk::PipelineLayoutCreateInfo {}.setSetLayouts(descLayouts));
 }
 [[nodiscard]]
 constexpr auto
@@ -172,18 +246,72 @@ createLightingPipelineLayout(pbr::core::GpuHandle const& gpu,
   return gpu.getDevice().createPipelineLayoutUnique(
       vk::PipelineLayoutCreateInfo {}.setSetLayouts(descLayouts));
 }
+/**
+ * @param afterDepthPrepass Only shades the fragments whose depth matches the depth left
+ * by the depth pre-pass.
+ */
 [[nodiscard]]
-constexpr auto buildGeometryPipeline(pbr::PbrRenderSystemCreateInfo info)
+constexpr auto buildGeometryPipeline(vk::PipelineShaderStageCreateInfo vertexShader,
+                                     vk::PipelineShaderStageCreateInfo fragmentShader,
+                                     pbr::GBufferLayout layout,
+                                     bool afterDepthPrepass = false)
     -> pbr::core::PipelineBuilder {
-  return pbr::core::PipelineBuilder()
-      .addStage(info.geometryVertexShader)
-      .addStage(info.geometryFragmentShader)
+  pbr::core::PipelineBuilder builder;
+  builder.addStage(vertexShader)
+      .addStage(fragmentShader)
+      .addVertexBinding<pbr::MeshVertex>();
+  for (auto const format : pbr::GBuffer::getColorFormats(layout)) {
+    builder.addOutputFormat(format);
+  }
+  if (afterDepthPrepass) {
+    builder.enableDepthTesting(pbr::GBuffer::DEPTH_FORMAT, vk::CompareOp::eEqual, false);
+  } else {
+    builder.enableDepthTesting(pbr::GBuffer::DEPTH_FORMAT);
+  }
+  builder.enableBackFaceCulling(vk::FrontFace::eClockwise);
+  return builder;
+}
+[[nodiscard]]
+constexpr auto buildDepthPrepassPipeline(vk::PipelineShaderStageCreateInfo vertexShader)
+    -> pbr::core::PipelineBuilder {
+  pbr::core::PipelineBuilder builder;
+  builder.addStage(vertexShader)
       .addVertexBinding<pbr::MeshVertex>()
-      .addOutputFormat(pbr::GBuffer::POSITIONS_FORMAT)
-      .addOutputFormat(pbr::GBuffer::NORMALS_FORMAT)
-      .addOutputFormat(pbr::GBuffer::ALBEDO_FORMAT)
       .enableDepthTesting(pbr::GBuffer::DEPTH_FORMAT)
       .enableBackFaceCulling(vk::FrontFace::eClockwise);
+  return builder;
+}
+/**
+ * @returns The depth pre-pass pipeline and the geometry pipeline that draws after it.
+ */
+[[nodiscard]]
+constexpr auto
+createDepthPrepassPipelines(pbr::core::GpuHandle const& gpu, vk::PipelineLayout layout,
+                            vk::PipelineShaderStageCreateInfo prepassVertexShader,
+                            vk::PipelineShaderStageCreateInfo vertexShader,
+                            vk::PipelineShaderStageCreateInfo fragmentShader,
+                            pbr::GBufferLayout gBufferLayout)
+    -> std::pair<vk::UniquePipeline, vk::UniquePipeline> {
+  auto prepassBuilder = ::buildDepthPrepassPipeline(prepassVertexShader);
+  auto geometryBuilder =
+      ::buildGeometryPipeline(vertexShader, fragmentShader, gBufferLayout, true);
+  auto [result, pipelines] = gpu.getDevice().createGraphicsPipelinesUnique(
+      nullptr, std::array {prepassBuilder.build(layout), geometryBuilder.build(layout)});
+  assert(result == vk::Result::eSuccess);
+  assert(pipelines.size() == 2);
+  return std::make_pair(std::move(pipelines.front()), std::move(pipelines.back()));
+}
+[[nodiscard]]
+constexpr auto createOverdrawQueryPool(pbr::core::GpuHandle const& gpu,
+                                       std::uint32_t frameCount) -> vk::UniqueQueryPool {
+  // Imprecise occlusion queries may only report whether anything passed.
+  if (!gpu.getDeviceFeatures().occlusionQueryPrecise) {
+    return {};
+  }
+  return gpu.getDevice().createQueryPoolUnique({
+      .queryType = vk::QueryType::eOcclusion,
+      .queryCount = constants::OVERDRAW_QUERY_COUNT * frameCount,
+  });
 }
 [[nodiscard]]
 constexpr auto buildLightingPipeline(pbr::PbrRenderSystemCreateInfo info)
@@ -193,139 +321,44 @@ constexpr auto buildLightingPipeline(pbr::PbrRenderSystemCreateInfo info)
       .addStage(info.lightingFragmentShader)
       .addOutputFormat(pbr::PbrRenderSystem::LIGHTING_PASS_OUTPUT_FORMAT);
 }
-[[nodiscard]]
-constexpr auto getToColorAttachmentBarrier(vk::Image image) -> vk::ImageMemoryBarrier2 {
-  return {
-      .srcStageMask = vk::PipelineStageFlagBits2::eTopOfPipe,
-      // .srcAccessMask = vk::AccessFlagBits2::eShaderSampledRead,
-      .dstStageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput,
-      .dstAccessMask = vk::AccessFlagBits2::eColorAttachmentWrite,
-      // .oldLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
-      .newLayout = vk::ImageLayout::eColorAttachmentOptimal,
-      .image = image,
-      .subresourceRange {
-          .aspectMask = vk::ImageAspectFlagBits::eColor,
-          .levelCount = 1,
-          .layerCount = 1,
-      },
-  };
-}
-[[nodiscard]]
-constexpr auto getToDepthAttachmentBarrier(vk::Image image) -> vk::ImageMemoryBarrier2 {
-  return {
-      .srcStageMask = vk::PipelineStageFlagBits2::eTopOfPipe,
-      // .srcAccessMask = vk::AccessFlagBits2::eShaderSampledRead,
-      .dstStageMask = vk::PipelineStageFlagBits2::eLateFragmentTests,
-      .dstAccessMask = vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
-      // .oldLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
-      .newLayout = vk::ImageLayout::eDepthAttachmentOptimal,
-      .image = image,
-      .subresourceRange {
-          .aspectMask = vk::ImageAspectFlagBits::eDepth,
-          .levelCount = 1,
-          .layerCount = 1,
-      },
-  };
-}
-[[nodiscard]]
-constexpr auto getToColorReadBarrier(vk::Image image) -> vk::ImageMemoryBarrier2 {
-  return {
-      .srcStageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput,
-      .srcAccessMask = vk::AccessFlagBits2::eColorAttachmentWrite,
-      .dstStageMask = vk::PipelineStageFlagBits2::eFragmentShader,
-      .dstAccessMask = vk::AccessFlagBits2::eShaderSampledRead,
-      .oldLayout = vk::ImageLayout::eColorAttachmentOptimal,
-      .newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
-      .image = image,
-      .subresourceRange {
-          .aspectMask = vk::ImageAspectFlagBits::eColor,
-          .levelCount = 1,
-          .layerCount = 1,
-      },
-  };
-}
-[[nodiscard]]
-constexpr auto getToDepthReadBarrier(vk::Image image) -> vk::ImageMemoryBarrier2 {
-  return {
-      .srcStageMask = vk::PipelineStageFlagBits2::eLateFragmentTests,
-      .srcAccessMask = vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
-      .dstStageMask = vk::PipelineStageFlagBits2::eFragmentShader,
-      .dstAccessMask = vk::AccessFlagBits2::eShaderSampledRead,
-      .oldLayout = vk::ImageLayout::eDepthAttachmentOptimal,
-      .newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
-      .image = image,
-      .subresourceRange {
-          .aspectMask = vk::ImageAspectFlagBits::eDepth,
-          .levelCount = 1,
-          .layerCount = 1,
-      },
-  };
-}
-constexpr auto switchGBufferToAttachment(vk::CommandBuffer cmdBuffer,
-                                         pbr::GBuffer const& gBuffer) -> void {
-  std::array const imageBarriers {
-      ::getToColorAttachmentBarrier(gBuffer.getPositions().getImage()),
-      ::getToColorAttachmentBarrier(gBuffer.getNormals().getImage()),
-      ::getToColorAttachmentBarrier(gBuffer.getAlbedo().getImage()),
-      ::getToDepthAttachmentBarrier(gBuffer.getDepth().getImage()),
-  };
-  cmdBuffer.pipelineBarrier2(vk::DependencyInfo {
-      .dependencyFlags = vk::DependencyFlagBits::eByRegion,
-  }
-                                 .setImageMemoryBarriers(imageBarriers));
-}
-constexpr auto switchGBufferToSampled(vk::CommandBuffer cmdBuffer,
-                                      pbr::GBuffer const& gBuffer) -> void {
-  std::array const imageBarriers {
-      ::getToColorReadBarrier(gBuffer.getPositions().getImage()),
-      ::getToColorReadBarrier(gBuffer.getNormals().getImage()),
-      ::getToColorReadBarrier(gBuffer.getAlbedo().getImage()),
-      ::getToDepthReadBarrier(gBuffer.getDepth().getImage()),
-  };
-  cmdBuffer.pipelineBarrier2(vk::DependencyInfo {
-      .dependencyFlags = vk::DependencyFlagBits::eByRegion,
-  }
-                                 .setImageMemoryBarriers(imageBarriers));
-}
-constexpr auto switchRenderTargetToAttachment(vk::CommandBuffer cmdBuffer,
-                                              pbr::Image2D const& renderTarget) -> void {
-  vk::ImageMemoryBarrier2 const imageBarrier {
-      .srcStageMask = vk::PipelineStageFlagBits2::eTopOfPipe,
-      .dstStageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput,
-      .dstAccessMask = vk::AccessFlagBits2::eColorAttachmentWrite,
-      .newLayout = vk::ImageLayout::eColorAttachmentOptimal,
-      .image = renderTarget.getImage(),
-      .subresourceRange {
-          .aspectMask = vk::ImageAspectFlagBits::eColor,
-          .levelCount = 1,
-          .layerCount = 1,
-      },
-  };
-  cmdBuffer.pipelineBarrier2(vk::DependencyInfo {
-      .dependencyFlags = vk::DependencyFlagBits::eByRegion,
-  }
-                                 .setImageMemoryBarriers(imageBarrier));
-}
 } // namespace
 
 pbr::PbrRenderSystem::PbrRenderSystem(core::SharedGpuHandle gpu,
-                                      PbrRenderSystemCreateInfo info)
+                                      std::shared_ptr<IAllocator> allocator,
+                                      PbrRenderSystemCreateInfo info,
+                                      std::shared_ptr<ThreadPool> threadPool)
     : _gpu(std::move(gpu))
+    , _allocator(std::move(allocator))
+    , _threadPool(std::move(threadPool))
+    , _gBufferLayout(info.gBufferLayout)
     , _sceneDescSetLayout(::createSceneDescriptorSetLayout(*_gpu))
     , _materialDescSetLayout(::createMaterialDescriptorSetLayout(*_gpu))
     , _gBufferSampler(::createGBufferSampler(*_gpu))
     , _depthSampler(::createDepthSampler(*_gpu))
     , _gBufferDescSetLayout(::createGBufferDescriptorSetLayout(
           *_gpu, _gBufferSampler.get(), _depthSampler.get()))
+    , _instanceDescSetLayout(::createInstanceDescriptorSetLayout(*_gpu))
     , _gBufferDescriptorPool(
           ::createGBufferDescriptorPool(*_gpu, constants::MAX_G_BUFFER_DESCRIPTOR_SETS))
+    , _instanceDescriptorPool(
+          ::createInstanceDescriptorPool(*_gpu, info.framesInFlight))
+    , _materialRegistry(::createMaterialRegistry(_gpu, *_allocator, info))
     , _geometryLayout(::createGeometryPipelineLayout(
-          *_gpu, std::array {_sceneDescSetLayout.get(), _materialDescSetLayout.get()}))
+          *_gpu,
+          std::array {_sceneDescSetLayout.get(),
+                      _materialRegistry ? _materialRegistry->getDescriptorSetLayout()
+                                        : _materialDescSetLayout.get(),
+                      _instanceDescSetLayout.get()}))
     , _geometryPipeline()
     , _lightingLayout(::createLightingPipelineLayout(
           *_gpu, std::array {_sceneDescSetLayout.get(), _gBufferDescSetLayout.get()}))
     , _lightingPipeline() {
-  auto geometryBuilder = ::buildGeometryPipeline(info);
+  auto const geometryFragmentShader = _materialRegistry
+                                          ? info.geometryBindlessFragmentShader
+                                          : info.geometryFragmentShader;
+  auto geometryBuilder =
+      ::buildGeometryPipeline(info.geometryVertexShader, geometryFragmentShader,
+                              _gBufferLayout);
   auto const geometryInfo = geometryBuilder.build(_geometryLayout.get());
   auto lightingBuilder = ::buildLightingPipeline(info);
   auto const lightingInfo = lightingBuilder.build(_lightingLayout.get());
@@ -337,6 +370,92 @@ pbr::PbrRenderSystem::PbrRenderSystem(core::SharedGpuHandle gpu,
 
   _geometryPipeline = std::move(pipelines.front());
   _lightingPipeline = std::move(pipelines.back());
+
+  if (info.geometryIndirectVertexShader.module && info.cullingComputeShader.module
+      && CullingSystem::isSupported(*_gpu)) {
+    auto indirectBuilder = ::buildGeometryPipeline(
+        info.geometryIndirectVertexShader, geometryFragmentShader, _gBufferLayout);
+    auto [indirectResult, indirectPipeline] =
+        _gpu->getDevice().createGraphicsPipelineUnique(
+            nullptr, indirectBuilder.build(_geometryLayout.get()));
+    assert(indirectResult == vk::Result::eSuccess);
+
+    _geometryIndirectPipeline = std::move(indirectPipeline);
+    if (info.depthPyramidComputeShader.module
+        && info.occlusionCullingComputeShader.module) {
+      _depthPyramidSystem.emplace(_gpu, info.depthPyramidComputeShader);
+    }
+    _cullingSystem.emplace(
+        _gpu, _allocator, info.cullingComputeShader, getMaterialBinding(),
+        info.framesInFlight,
+        _depthPyramidSystem ? info.occlusionCullingComputeShader
+                            : vk::PipelineShaderStageCreateInfo {},
+        _depthPyramidSystem ? _depthPyramidSystem->getDescriptorSetLayout() : nullptr);
+  }
+
+  if (info.tiledLightingComputeShader.module) {
+    _tiledLightingSystem.emplace(_gpu, *_allocator, info.tiledLightingComputeShader,
+                                 _gBufferDescSetLayout.get(), info.framesInFlight);
+  }
+
+  if (info.depthPrepassVertexShader.module) {
+    std::tie(_depthPrepassPipeline, _geometryEqualPipeline) =
+        ::createDepthPrepassPipelines(*_gpu, _geometryLayout.get(),
+                                      info.depthPrepassVertexShader,
+                                      info.geometryVertexShader, geometryFragmentShader,
+                                      _gBufferLayout);
+  }
+  if (info.depthPrepassIndirectVertexShader.module && _cullingSystem.has_value()) {
+    std::tie(_depthPrepassIndirectPipeline, _geometryIndirectEqualPipeline) =
+        ::createDepthPrepassPipelines(*_gpu, _geometryLayout.get(),
+                                      info.depthPrepassIndirectVertexShader,
+                                      info.geometryIndirectVertexShader,
+                                      geometryFragmentShader, _gBufferLayout);
+  }
+  _overdrawQueryPool = ::createOverdrawQueryPool(*_gpu, info.framesInFlight);
+
+  auto instanceDescSets =
+      DescriptorSetAllocator(_gpu, _instanceDescriptorPool.get(),
+                             _instanceDescSetLayout.get())
+          .allocate(info.framesInFlight);
+  _frames.reserve(info.framesInFlight);
+  for (auto& instanceDescSet : instanceDescSets) {
+    _frames.push_back({
+        .instanceBuffer {
+            vk::BufferUsageFlagBits::eStorageBuffer,
+            {
+                .preference = AllocationPreference::Host,
+                .ableToBeMapped = true,
+                .persistentlyMapped = true,
+            },
+        },
+        .instanceDescSet = std::move(instanceDescSet),
+        .visibleInstanceBuffer = nullptr,
+        .recordingContexts = {},
+        .lightBuffer = {},
+    });
+  }
+
+  // The thread waiting for the workers records a chunk as well.
+  auto const contextCount = _threadPool ? _threadPool->getThreadCount() + 1 : 0u;
+  for (auto& frame : _frames) {
+    for (auto i = 0u; i < contextCount; ++i) {
+      auto cmdPool = _gpu->getDevice().createCommandPoolUnique({
+          .flags = vk::CommandPoolCreateFlagBits::eTransient,
+          .queueFamilyIndex =
+              _gpu->getPhysicalDeviceProperties().graphicsTransferPresentQueue,
+      });
+      auto cmdBuffers = _gpu->getDevice().allocateCommandBuffersUnique({
+          .commandPool = cmdPool.get(),
+          .level = vk::CommandBufferLevel::eSecondary,
+          .commandBufferCount = 1,
+      });
+      frame.recordingContexts.push_back({
+          .cmdPool = std::move(cmdPool),
+          .cmdBuffer = std::move(cmdBuffers.front()),
+      });
+    }
+  }
 }
 
 auto pbr::PbrRenderSystem::allocateGBuffer(IAllocator& allocator, vk::Extent2D extent)
@@ -351,61 +470,517 @@ auto pbr::PbrRenderSystem::allocateGBuffer(IAllocator& allocator, vk::Extent2D e
                       .setSetLayouts(_gBufferDescSetLayout.get()))
               .front()),
       extent,
+      _gBufferLayout,
   };
 }
 
-auto pbr::PbrRenderSystem::render(vk::CommandBuffer cmdBuffer, Scene const& scene,
-                                  GBuffer const& gBuffer, Image2D const& renderTarget,
-                                  vk::Extent2D renderExtent) -> void {
-  ::switchGBufferToAttachment(cmdBuffer, gBuffer);
-  recordGeometryPass(cmdBuffer, scene, gBuffer);
-  ::switchGBufferToSampled(cmdBuffer, gBuffer);
-  ::switchRenderTargetToAttachment(cmdBuffer, renderTarget);
-  recordLightingPass(cmdBuffer, scene, gBuffer, renderTarget, {.extent = renderExtent});
+auto pbr::PbrRenderSystem::getGBufferLayout() const noexcept -> GBufferLayout {
+  return _gBufferLayout;
+}
+
+auto pbr::PbrRenderSystem::getDrawListStats() const noexcept -> DrawListStats {
+  return _drawList.getStats();
+}
+
+auto pbr::PbrRenderSystem::getMaterialRegistry() noexcept -> MaterialRegistry* {
+  return _materialRegistry ? &*_materialRegistry : nullptr;
+}
+
+auto pbr::PbrRenderSystem::isGpuDrivenSupported() const noexcept -> bool {
+  return _cullingSystem.has_value();
+}
+
+auto pbr::PbrRenderSystem::isGpuDriven() const noexcept -> bool { return _gpuDriven; }
+
+auto pbr::PbrRenderSystem::setGpuDriven(bool const gpuDriven) noexcept -> void {
+  _gpuDriven = gpuDriven;
 }
 
-auto pbr::PbrRenderSystem::recordGeometryPass(vk::CommandBuffer cmdBuffer,
-                                              Scene const& scene, GBuffer const& gBuffer)
+auto pbr::PbrRenderSystem::getCullingStats() const noexcept -> CullingStats {
+  return _cullingSystem->getStats();
+}
+
+auto pbr::PbrRenderSystem::isOcclusionCullingSupported() const noexcept -> bool {
+  return _cullingSystem.has_value() && _cullingSystem->isOcclusionCullingSupported();
+}
+
+auto pbr::PbrRenderSystem::isOcclusionCulling() const noexcept -> bool {
+  return _occlusionCulling;
+}
+
+auto pbr::PbrRenderSystem::setOcclusionCulling(bool const occlusionCulling) noexcept
     -> void {
-  std::array const attachments {
-      vk::RenderingAttachmentInfo {
-          .imageView = gBuffer.getPositions().getImageView(),
-          .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
-          .loadOp = vk::AttachmentLoadOp::eClear,
-          .storeOp = vk::AttachmentStoreOp::eStore,
-          .clearValue {
-              .color {
-                  .float32 = {{0.0f, 0.0f, 0.0f, 0.0f}},
-              },
-          },
-      },
-      vk::RenderingAttachmentInfo {
-          .imageView = gBuffer.getNormals().getImageView(),
-          .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
-          .loadOp = vk::AttachmentLoadOp::eClear,
-          .storeOp = vk::AttachmentStoreOp::eStore,
-          .clearValue {
-              .color {
-                  .float32 = {{0.0f, 0.0f, 0.0f, 0.0f}},
-              },
-          },
-      },
-      vk::RenderingAttachmentInfo {
-          .imageView = gBuffer.getAlbedo().getImageView(),
-          .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
-          .loadOp = vk::AttachmentLoadOp::eClear,
-          .storeOp = vk::AttachmentStoreOp::eStore,
-          .clearValue {
-              .color {
-                  .float32 = {{0.0f, 0.0f, 0.0f, 0.0f}},
-              },
+  _occlusionCulling = occlusionCulling;
+}
+
+auto pbr::PbrRenderSystem::isMeshletCulling() const noexcept -> bool {
+  return _cullingSystem->isMeshletCulling();
+}
+
+auto pbr::PbrRenderSystem::setMeshletCulling(bool const meshletCulling) noexcept
+    -> void {
+  _cullingSystem->setMeshletCulling(meshletCulling);
+}
+
+auto pbr::PbrRenderSystem::isFrustumCulling() const noexcept -> bool {
+  return _frustumCulling;
+}
+
+auto pbr::PbrRenderSystem::setFrustumCulling(bool const frustumCulling) noexcept
+    -> void {
+  _frustumCulling = frustumCulling;
+}
+
+auto pbr::PbrRenderSystem::getFrustumCullingStats() const noexcept
+    -> FrustumCullingStats {
+  return _frustumCuller.getStats();
+}
+
+auto pbr::PbrRenderSystem::isSoftwareOcclusionCulling() const noexcept -> bool {
+  return _softwareOcclusionCulling;
+}
+
+auto pbr::PbrRenderSystem::setSoftwareOcclusionCulling(
+    bool const softwareOcclusionCulling) noexcept -> void {
+  _softwareOcclusionCulling = softwareOcclusionCulling;
+}
+
+auto pbr::PbrRenderSystem::getSoftwareOcclusionStats() const noexcept
+    -> SoftwareOcclusionStats {
+  return _softwareOcclusionCuller.getStats();
+}
+
+auto pbr::PbrRenderSystem::isLods() const noexcept -> bool { return _lods; }
+
+auto pbr::PbrRenderSystem::setLods(bool const lods) noexcept -> void { _lods = lods; }
+
+auto pbr::PbrRenderSystem::isTiledLightingSupported() const noexcept -> bool {
+  return _tiledLightingSystem.has_value();
+}
+
+auto pbr::PbrRenderSystem::isTiledLighting() const noexcept -> bool {
+  return _tiledLighting;
+}
+
+auto pbr::PbrRenderSystem::setTiledLighting(bool const tiledLighting) noexcept -> void {
+  _tiledLighting = tiledLighting;
+}
+
+auto pbr::PbrRenderSystem::getTiledLightingStats() const noexcept -> TiledLightingStats {
+  return _tiledLightingSystem->getStats();
+}
+
+auto pbr::PbrRenderSystem::isDepthPrepassSupported() const noexcept -> bool {
+  return static_cast<bool>(_depthPrepassPipeline);
+}
+
+auto pbr::PbrRenderSystem::isDepthPrepass() const noexcept -> bool {
+  return _depthPrepass;
+}
+
+auto pbr::PbrRenderSystem::setDepthPrepass(bool const depthPrepass) noexcept -> void {
+  _depthPrepass = depthPrepass;
+}
+
+auto pbr::PbrRenderSystem::isOverdrawQuerySupported() const noexcept -> bool {
+  return static_cast<bool>(_overdrawQueryPool);
+}
+
+auto pbr::PbrRenderSystem::getOverdrawStats() const noexcept -> OverdrawStats {
+  return _overdrawStats;
+}
+
+auto pbr::PbrRenderSystem::getLightBufferStats() const noexcept -> LightBufferStats {
+  return getFrame().lightBuffer.getStats();
+}
+
+auto pbr::PbrRenderSystem::getMaterialBinding() const noexcept -> MaterialBinding {
+  return _materialRegistry ? MaterialBinding::Bindless : MaterialBinding::PerMaterial;
+}
+
+auto pbr::PbrRenderSystem::getFrame() noexcept -> FrameResources& {
+  return _frames[_frameIndex];
+}
+
+auto pbr::PbrRenderSystem::getFrame() const noexcept -> FrameResources const& {
+  return _frames[_frameIndex];
+}
+
+auto pbr::PbrRenderSystem::uploadInstances() -> void {
+  auto const instances = _drawList.getInstances();
+  auto& frame = getFrame();
+
+  auto const capacity = std::max(constants::MIN_INSTANCE_CAPACITY,
+                                 static_cast<vk::DeviceSize>(instances.size()));
+  if (frame.instanceBuffer.reserve(*_allocator, capacity * sizeof(InstanceData))) {
+    // The previous use of the frame has finished so the set is not in use.
+    vk::DescriptorBufferInfo const bufferInfo {
+        .buffer = frame.instanceBuffer.getBuffer(),
+        .range = vk::WholeSize,
+    };
+    _gpu->getDevice().updateDescriptorSets(
+        vk::WriteDescriptorSet {
+            .dstSet = frame.instanceDescSet.get(),
+            .descriptorType = vk::DescriptorType::eStorageBuffer,
+        }
+            .setBufferInfo(bufferInfo),
+        {});
+  }
+
+  if (!instances.empty()) {
+    auto const mapping = frame.instanceBuffer.map();
+    std::memcpy(mapping.get(), instances.data(), instances.size_bytes());
+  }
+}
+
+auto pbr::PbrRenderSystem::updateVisibleInstances() -> void {
+  auto const buffer = _cullingSystem->getVisibleInstanceBuffer();
+  auto& frame = getFrame();
+  // Nothing was culled yet, the binding is only read by the indirect draws.
+  if (!buffer || buffer == frame.visibleInstanceBuffer) {
+    return;
+  }
+  frame.visibleInstanceBuffer = buffer;
+
+  // The previous use of the frame has finished so the set is not in use.
+  vk::DescriptorBufferInfo const bufferInfo {
+      .buffer = buffer,
+      .range = vk::WholeSize,
+  };
+  _gpu->getDevice().updateDescriptorSets(
+      vk::WriteDescriptorSet {
+          .dstSet = frame.instanceDescSet.get(),
+          .dstBinding = 1,
+          .descriptorType = vk::DescriptorType::eStorageBuffer,
+      }
+          .setBufferInfo(bufferInfo),
+      {});
+}
+
+auto pbr::PbrRenderSystem::render(RenderGraph& graph, std::uint32_t const frameIndex,
+                                  Scene const& scene, GBuffer const& gBuffer,
+                                  Image2D const& renderTarget,
+                                  vk::Extent2D renderExtent) -> void {
+  _frameIndex = frameIndex % static_cast<std::uint32_t>(_frames.size());
+
+  // Culling is recorded outside of the geometry pass and needs a camera to cull against.
+  auto* const camera = scene.getActiveCamera();
+  if (camera != nullptr) {
+    camera->update(_frameIndex);
+  }
+  auto const gpuDriven = _gpuDriven && _cullingSystem.has_value() && camera != nullptr;
+  auto const& depthPrepassPipeline =
+      gpuDriven ? _depthPrepassIndirectPipeline : _depthPrepassPipeline;
+  auto const depthPrepass = _depthPrepass && depthPrepassPipeline;
+  auto const occlusionCulling =
+      gpuDriven && _occlusionCulling && _cullingSystem->isOcclusionCullingSupported();
+
+  // Hidden nodes are dropped before anything about them is recorded or uploaded.
+  std::span<std::uint8_t const> visibleNodes {};
+  std::optional<LodSelection> lodSelection = std::nullopt;
+  if (camera != nullptr) {
+    auto const cameraData = camera->get();
+    auto const viewProj = cameraData.proj * cameraData.view;
+    if (_frustumCulling) {
+      visibleNodes = _frustumCuller.cull(scene, viewProj);
+    }
+    if (_softwareOcclusionCulling) {
+      visibleNodes = _softwareOcclusionCuller.cull(scene, viewProj, _threadPool.get(),
+                                                   visibleNodes);
+    }
+    if (_lods) {
+      lodSelection = pbr::makeLodSelection(cameraData,
+                                           static_cast<float>(renderExtent.height));
+    }
+  }
+  _drawList.build(scene,
+                  depthPrepass ? _geometryEqualPipeline.get() : _geometryPipeline.get(),
+                  visibleNodes, lodSelection);
+  uploadInstances();
+
+  // Every image is fully rewritten, nothing of the previous frame is kept.
+  GBufferImages images {};
+  for (auto const& image : gBuffer.getColorAttachments()) {
+    images.colors.push_back(graph.importImage(
+        image.getImage(), vk::ImageAspectFlagBits::eColor, ImageContents::Discard));
+  }
+  images.depth = graph.importImage(gBuffer.getDepth().getImage(),
+                                   vk::ImageAspectFlagBits::eDepth,
+                                   ImageContents::Discard);
+  auto const target = graph.importImage(
+      renderTarget.getImage(), vk::ImageAspectFlagBits::eColor, ImageContents::Discard);
+
+  if (_overdrawQueryPool) {
+    graph.addPass("overdraw queries", [this](vk::CommandBuffer const cmdBuffer) {
+      readOverdrawQueries(cmdBuffer);
+    }).setSideEffects();
+  }
+  if (gpuDriven) {
+    if (occlusionCulling) {
+      _depthPyramidSystem->update(*_allocator, gBuffer);
+    }
+    // The culled draws are read through buffers the culling system owns.
+    graph
+        .addPass("culling",
+                 [this, cameraData = camera->get(),
+                  occlusionCulling](vk::CommandBuffer const cmdBuffer) {
+                   _cullingSystem->recordCulling(
+                       cmdBuffer, _frameIndex, _drawList,
+                       getFrame().instanceBuffer.getBuffer(),
+                       cameraData.proj * cameraData.view, cameraData.position,
+                       occlusionCulling ? _depthPyramidSystem->getDescriptorSet()
+                                        : nullptr);
+                   updateVisibleInstances();
+                 })
+        .setSideEffects();
+  }
+
+  // The second phase of occlusion culling runs in whichever pass comes first.
+  if (depthPrepass) {
+    addDepthPrepass(graph, scene, gBuffer, images, gpuDriven, occlusionCulling);
+  }
+  addGeometryPass(graph, scene, gBuffer, images, gpuDriven, depthPrepass,
+                  occlusionCulling && !depthPrepass);
+
+  auto const tiledLighting =
+      _tiledLighting && _tiledLightingSystem.has_value() && camera != nullptr;
+  if (tiledLighting) {
+    scene.collectLights(_lights);
+    getFrame().lightBuffer.update(*_allocator, _lights);
+    auto pass = graph.addPass(
+        "tiled lighting", [this, camera, &gBuffer, &renderTarget,
+                           renderExtent](vk::CommandBuffer const cmdBuffer) {
+          _tiledLightingSystem->record(cmdBuffer, _frameIndex, getFrame().lightBuffer,
+                                       camera->get(), gBuffer, renderTarget,
+                                       renderExtent);
+        });
+    for (auto const color : images.colors) {
+      pass.read(color, usages::COMPUTE_SAMPLED_READ);
+    }
+    pass.read(images.depth, usages::COMPUTE_SAMPLED_READ)
+        .write(target, usages::COMPUTE_STORAGE_WRITE);
+  } else {
+    auto pass = graph.addPass(
+        "lighting", [this, &scene, &gBuffer, &renderTarget,
+                     renderExtent](vk::CommandBuffer const cmdBuffer) {
+          recordLightingPass(cmdBuffer, scene, gBuffer, renderTarget,
+                             {.extent = renderExtent});
+        });
+    for (auto const color : images.colors) {
+      pass.read(color, usages::FRAGMENT_SAMPLED_READ);
+    }
+    pass.read(images.depth, usages::FRAGMENT_SAMPLED_READ)
+        .write(target, usages::COLOR_ATTACHMENT_WRITE);
+  }
+}
+
+auto pbr::PbrRenderSystem::readOverdrawQueries(vk::CommandBuffer cmdBuffer) -> void {
+  if (!_overdrawQueryPool) {
+    return;
+  }
+
+  auto& frame = getFrame();
+  auto const firstQuery = _frameIndex * constants::OVERDRAW_QUERY_COUNT;
+  if (frame.overdrawQueriesReset) {
+    // Every query is followed by its availability, queries of passes that were not
+    // recorded stay unavailable.
+    std::array<std::uint64_t, constants::OVERDRAW_QUERY_COUNT * 2> results {};
+    [[maybe_unused]]
+    auto const result = _gpu->getDevice().getQueryPoolResults(
+        _overdrawQueryPool.get(), firstQuery, constants::OVERDRAW_QUERY_COUNT,
+        sizeof(results), results.data(), sizeof(std::uint64_t) * 2,
+        vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability);
+    assert(result == vk::Result::eSuccess || result == vk::Result::eNotReady);
+    auto const getSamples = [&](std::uint32_t const query) {
+      return results[(query * 2) + 1] != 0 ? results[query * 2] : 0;
+    };
+    _overdrawStats = {
+        .depthSamples = getSamples(constants::DEPTH_QUERY),
+        .gBufferSamples = getSamples(constants::G_BUFFER_QUERY),
+    };
+  }
+
+  cmdBuffer.resetQueryPool(_overdrawQueryPool.get(), firstQuery,
+                           constants::OVERDRAW_QUERY_COUNT);
+  frame.overdrawQueriesReset = true;
+}
+
+auto pbr::PbrRenderSystem::beginOverdrawQuery(vk::CommandBuffer cmdBuffer,
+                                              std::uint32_t const query) const -> void {
+  if (_overdrawQueryPool) {
+    cmdBuffer.beginQuery(_overdrawQueryPool.get(),
+                         (_frameIndex * constants::OVERDRAW_QUERY_COUNT) + query,
+                         vk::QueryControlFlagBits::ePrecise);
+  }
+}
+
+auto pbr::PbrRenderSystem::endOverdrawQuery(vk::CommandBuffer cmdBuffer,
+                                            std::uint32_t const query) const -> void {
+  if (_overdrawQueryPool) {
+    cmdBuffer.endQuery(_overdrawQueryPool.get(),
+                       (_frameIndex * constants::OVERDRAW_QUERY_COUNT) + query);
+  }
+}
+
+auto pbr::PbrRenderSystem::addOcclusionCulling(RenderGraph& graph,
+                                               GBufferImages const& images,
+                                               bool const keepEveryVisible) -> void {
+  // The pyramid and the culled draws are owned by the systems, which synchronize them.
+  graph
+      .addPass("occlusion culling",
+               [this, keepEveryVisible](vk::CommandBuffer const cmdBuffer) {
+                 _depthPyramidSystem->record(cmdBuffer);
+                 _cullingSystem->recordOcclusionCulling(cmdBuffer, keepEveryVisible);
+               })
+      .read(images.depth, usages::COMPUTE_SAMPLED_READ)
+      .setSideEffects();
+}
+
+auto pbr::PbrRenderSystem::addDepthPrepass(RenderGraph& graph, Scene const& scene,
+                                           GBuffer const& gBuffer,
+                                           GBufferImages const& images,
+                                           bool const gpuDriven,
+                                           bool const occlusionCulling) -> void {
+  // The query spans every pass that draws depth, it is counting every sample that
+  // passed.
+  graph
+      .addPass("depth prepass",
+               [this, &scene, &gBuffer, gpuDriven,
+                occlusionCulling](vk::CommandBuffer const cmdBuffer) {
+                 beginOverdrawQuery(cmdBuffer, constants::DEPTH_QUERY);
+                 recordDepthDraws(cmdBuffer, scene, gBuffer, gpuDriven,
+                                  vk::AttachmentLoadOp::eClear);
+                 if (!occlusionCulling) {
+                   endOverdrawQuery(cmdBuffer, constants::DEPTH_QUERY);
+                 }
+               })
+      .write(images.depth, usages::DEPTH_ATTACHMENT_WRITE);
+  if (!occlusionCulling) {
+    return;
+  }
+
+  // The geometry pass is not culled again, so it needs every visible instance. The
+  // instances drawn twice fail the depth test the second time.
+  addOcclusionCulling(graph, images, true);
+  graph
+      .addPass("depth prepass late",
+               [this, &scene, &gBuffer, gpuDriven](vk::CommandBuffer const cmdBuffer) {
+                 recordDepthDraws(cmdBuffer, scene, gBuffer, gpuDriven,
+                                  vk::AttachmentLoadOp::eLoad);
+                 endOverdrawQuery(cmdBuffer, constants::DEPTH_QUERY);
+               })
+      .write(images.depth, usages::DEPTH_ATTACHMENT_LOAD);
+}
+
+auto pbr::PbrRenderSystem::recordDepthDraws(vk::CommandBuffer cmdBuffer,
+                                            Scene const& scene, GBuffer const& gBuffer,
+                                            bool const gpuDriven,
+                                            vk::AttachmentLoadOp const loadOp) -> void {
+  vk::RenderingAttachmentInfo const depthAttachment {
+      .imageView = gBuffer.getDepth().getImageView(),
+      .imageLayout = vk::ImageLayout::eDepthAttachmentOptimal,
+      .loadOp = loadOp,
+      .storeOp = vk::AttachmentStoreOp::eStore,
+      .clearValue {
+          .depthStencil {
+              .depth = 1.0f,
           },
       },
   };
+  cmdBuffer.beginRendering(vk::RenderingInfo {
+      .renderArea {
+          .extent = gBuffer.getExtent(),
+      },
+      .layerCount = 1,
+      .pDepthAttachment = &depthAttachment,
+  });
+
+  bindGeometryState(cmdBuffer, scene, gBuffer.getExtent());
+  if (gpuDriven) {
+    _cullingSystem->recordDraws(cmdBuffer, _geometryLayout.get(),
+                                _depthPrepassIndirectPipeline.get(), false);
+  } else {
+    _drawList.recordDepth(cmdBuffer, _depthPrepassPipeline.get());
+  }
+
+  cmdBuffer.endRendering();
+}
+
+auto pbr::PbrRenderSystem::addGeometryPass(RenderGraph& graph, Scene const& scene,
+                                           GBuffer const& gBuffer,
+                                           GBufferImages const& images,
+                                           bool const gpuDriven, bool const depthPrepass,
+                                           bool const occlusionCulling) -> void {
+  auto const chunkCount = gpuDriven ? 1 : getRecordingChunkCount();
+  auto const queried = isGeometryPassQueryable(chunkCount);
+  auto pass = graph.addPass(
+      "geometry", [this, &scene, &gBuffer, gpuDriven, depthPrepass, chunkCount, queried,
+                   occlusionCulling](vk::CommandBuffer const cmdBuffer) {
+        if (queried) {
+          beginOverdrawQuery(cmdBuffer, constants::G_BUFFER_QUERY);
+        }
+        recordGeometryDraws(cmdBuffer, scene, gBuffer, gpuDriven, depthPrepass,
+                            chunkCount, false);
+        if (queried && !occlusionCulling) {
+          endOverdrawQuery(cmdBuffer, constants::G_BUFFER_QUERY);
+        }
+      });
+  for (auto const color : images.colors) {
+    pass.write(color, usages::COLOR_ATTACHMENT_WRITE);
+  }
+  // The depth pre-pass already wrote the depth tested against.
+  pass.write(images.depth, depthPrepass ? usages::DEPTH_ATTACHMENT_LOAD
+                                        : usages::DEPTH_ATTACHMENT_WRITE);
+  if (!occlusionCulling) {
+    return;
+  }
+
+  // The instances hidden in the previous frame are drawn on top of the first phase.
+  addOcclusionCulling(graph, images, false);
+  auto latePass = graph.addPass(
+      "geometry late", [this, &scene, &gBuffer, gpuDriven, depthPrepass, chunkCount,
+                        queried](vk::CommandBuffer const cmdBuffer) {
+        recordGeometryDraws(cmdBuffer, scene, gBuffer, gpuDriven, depthPrepass,
+                            chunkCount, true);
+        if (queried) {
+          endOverdrawQuery(cmdBuffer, constants::G_BUFFER_QUERY);
+        }
+      });
+  for (auto const color : images.colors) {
+    latePass.write(color, usages::COLOR_ATTACHMENT_LOAD);
+  }
+  latePass.write(images.depth, usages::DEPTH_ATTACHMENT_LOAD);
+}
+
+auto pbr::PbrRenderSystem::recordGeometryDraws(vk::CommandBuffer cmdBuffer,
+                                               Scene const& scene, GBuffer const& gBuffer,
+                                               bool const gpuDriven,
+                                               bool const depthPrepass,
+                                               std::uint32_t const chunkCount,
+                                               bool const loadAttachments) -> void {
+  auto const colorLoadOp =
+      loadAttachments ? vk::AttachmentLoadOp::eLoad : vk::AttachmentLoadOp::eClear;
+  std::array<vk::RenderingAttachmentInfo, GBuffer::MAX_COLOR_ATTACHMENTS> attachments {};
+  auto const colorAttachments = gBuffer.getColorAttachments();
+  for (auto const [attachment, image] : std::views::zip(attachments, colorAttachments)) {
+    attachment = {
+        .imageView = image.getImageView(),
+        .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
+        .loadOp = colorLoadOp,
+        .storeOp = vk::AttachmentStoreOp::eStore,
+        .clearValue {
+            .color {
+                .float32 = {{0.0f, 0.0f, 0.0f, 0.0f}},
+            },
+        },
+    };
+  }
+  auto const usedAttachments = std::span(attachments).first(colorAttachments.size());
   vk::RenderingAttachmentInfo const depthAttachment {
       .imageView = gBuffer.getDepth().getImageView(),
       .imageLayout = vk::ImageLayout::eDepthAttachmentOptimal,
-      .loadOp = vk::AttachmentLoadOp::eClear,
+      .loadOp = loadAttachments || depthPrepass ? vk::AttachmentLoadOp::eLoad
+                                                : vk::AttachmentLoadOp::eClear,
       .storeOp = vk::AttachmentStoreOp::eStore,
       .clearValue {
           .depthStencil {
@@ -414,55 +989,120 @@ auto pbr::PbrRenderSystem::recordGeometryPass(vk::CommandBuffer cmdBuffer,
       },
   };
   cmdBuffer.beginRendering(vk::RenderingInfo {
+      .flags = chunkCount > 1 ? vk::RenderingFlagBits::eContentsSecondaryCommandBuffers
+                              : vk::RenderingFlags {},
       .renderArea {
           .extent = gBuffer.getExtent(),
       },
       .layerCount = 1,
       .pDepthAttachment = &depthAttachment,
   }
-                               .setColorAttachments(attachments));
+                               .setColorAttachments(usedAttachments));
+
+  if (chunkCount > 1) {
+    recordGeometryChunks(cmdBuffer, scene, gBuffer.getExtent(), chunkCount);
+  } else {
+    bindGeometryState(cmdBuffer, scene, gBuffer.getExtent());
+    if (gpuDriven) {
+      _cullingSystem->recordDraws(cmdBuffer, _geometryLayout.get(),
+                                  depthPrepass ? _geometryIndirectEqualPipeline.get()
+                                               : _geometryIndirectPipeline.get());
+    } else {
+      _drawList.record(cmdBuffer, _geometryLayout.get(), getMaterialBinding());
+    }
+  }
+
+  cmdBuffer.endRendering();
+}
 
-  cmdBuffer.setScissor(0, vk::Rect2D {.extent = gBuffer.getExtent()});
+auto pbr::PbrRenderSystem::bindGeometryState(vk::CommandBuffer cmdBuffer,
+                                             Scene const& scene,
+                                             vk::Extent2D extent) const -> void {
+  cmdBuffer.setScissor(0, vk::Rect2D {.extent = extent});
   cmdBuffer.setViewport(0, vk::Viewport {
-                               .width = static_cast<float>(gBuffer.getExtent().width),
-                               .height = static_cast<float>(gBuffer.getExtent().height),
+                               .width = static_cast<float>(extent.width),
+                               .height = static_cast<float>(extent.height),
                                .maxDepth = 1.0f,
                            });
-  cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, _geometryPipeline.get());
-
-  auto const camera = scene.findCamera();
+  if (auto const* const camera = scene.getActiveCamera(); camera != nullptr) {
+    cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, _geometryLayout.get(),
+                                 0, camera->getDescriptorSet(_frameIndex), {});
+  }
 
-  if (camera) {
+  cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, _geometryLayout.get(), 2,
+                               getFrame().instanceDescSet.get(), {});
+  if (_materialRegistry) {
     cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, _geometryLayout.get(),
-                                 0, camera.value()->getDescriptorSet(), {});
+                                 1, _materialRegistry->getDescriptorSet(), {});
   }
+}
 
-  for (auto const& node : scene.iterateAllNodes()) {
-    auto const& mesh = node.getMesh();
-    if (mesh) {
+auto pbr::PbrRenderSystem::getRecordingChunkCount() const noexcept -> std::uint32_t {
+  auto const batchCount = static_cast<std::uint32_t>(_drawList.getBatches().size());
+  auto const chunkCount = (batchCount + constants::MIN_BATCHES_PER_CHUNK - 1)
+                          / constants::MIN_BATCHES_PER_CHUNK;
+  return std::min(chunkCount,
+                  static_cast<std::uint32_t>(getFrame().recordingContexts.size()));
+}
 
-      auto const transform = node.getTransform();
-      auto const pushConst = pbr::makeModelPushConstant(
-          transform.position, transform.rotation, transform.scale);
-      cmdBuffer.pushConstants<ModelPushConstant>(
-          _geometryLayout.get(), vk::ShaderStageFlagBits::eVertex, 0, pushConst);
+auto pbr::PbrRenderSystem::recordGeometryChunks(vk::CommandBuffer cmdBuffer,
+                                                Scene const& scene, vk::Extent2D extent,
+                                                std::uint32_t chunkCount) -> void {
+  auto const colorFormats = GBuffer::getColorFormats(_gBufferLayout);
+  // The occlusion query of the geometry pass stays active in the secondaries.
+  auto const queried = _overdrawQueryPool && isGeometryPassQueryable(chunkCount);
+  vk::StructureChain const inheritance {
+      vk::CommandBufferInheritanceInfo {
+          .occlusionQueryEnable = queried ? vk::True : vk::False,
+          .queryFlags = queried ? vk::QueryControlFlagBits::ePrecise
+                                : vk::QueryControlFlags {},
+      },
+      vk::CommandBufferInheritanceRenderingInfo {
+          .depthAttachmentFormat = GBuffer::DEPTH_FORMAT,
+          .rasterizationSamples = vk::SampleCountFlagBits::e1,
+      }
+          .setColorAttachmentFormats(colorFormats),
+  };
 
-      cmdBuffer.bindVertexBuffers(0, mesh->getVertexBuffer().getBuffer(), {0});
-      cmdBuffer.bindIndexBuffer(mesh->getIndexBuffer().getBuffer(), 0,
-                                vk::IndexType::eUint16);
+  auto const batchCount = _drawList.getBatches().size();
+  auto const chunkSize = (batchCount + chunkCount - 1) / chunkCount;
+  auto const& recordingContexts = getFrame().recordingContexts;
+  _chunkStats.assign(chunkCount, {});
+  _threadPool->parallelFor(chunkCount, [&](std::uint32_t const chunk) {
+    auto const& context = recordingContexts[chunk];
+    // The previous use of the frame has finished so the buffer is not in use.
+    _gpu->getDevice().resetCommandPool(context.cmdPool.get());
 
-      for (auto const& primitive : mesh->getPrimitives()) {
-        cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
-                                     _geometryLayout.get(), 1,
-                                     primitive.material->getDescriptorSet(), {});
-        cmdBuffer.drawIndexed(primitive.indexCount, 1, primitive.firstIndex,
-                              static_cast<std::int32_t>(primitive.firstVertex), 0);
-      }
-    }
+    auto const secondary = context.cmdBuffer.get();
+    secondary.begin(vk::CommandBufferBeginInfo {
+        .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit
+                 | vk::CommandBufferUsageFlagBits::eRenderPassContinue,
+        .pInheritanceInfo = &inheritance.get<vk::CommandBufferInheritanceInfo>(),
+    });
+    bindGeometryState(secondary, scene, extent);
+    auto const firstBatch = std::min(chunk * chunkSize, batchCount);
+    _chunkStats[chunk] =
+        _drawList.recordBatches(secondary, _geometryLayout.get(), getMaterialBinding(),
+                                firstBatch, std::min(chunkSize, batchCount - firstBatch));
+    secondary.end();
+  });
+
+  DrawListStats stats {};
+  _secondaryCmdBuffers.clear();
+  for (auto const [context, chunkStats] :
+       std::views::zip(recordingContexts, _chunkStats)) {
+    stats += chunkStats;
+    _secondaryCmdBuffers.push_back(context.cmdBuffer.get());
   }
+  _drawList.setStats(stats);
+  cmdBuffer.executeCommands(_secondaryCmdBuffers);
+}
 
-  cmdBuffer.endRendering();
+auto pbr::PbrRenderSystem::isGeometryPassQueryable(
+    std::uint32_t const chunkCount) const noexcept -> bool {
+  return chunkCount <= 1 || _gpu->getDeviceFeatures().inheritedQueries;
 }
+
 auto pbr::PbrRenderSystem::recordLightingPass(vk::CommandBuffer cmdBuffer,
                                               Scene const& scene, GBuffer const& gBuffer,
                                               Image2D const& renderTo,
@@ -486,16 +1126,14 @@ auto pbr::PbrRenderSystem::recordLightingPass(vk::CommandBuffer cmdBuffer,
 
   cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, _lightingPipeline.get());
 
-  auto const camera = scene.findCamera();
-
-  if (camera) {
-    std::array const descSets {camera.value()->getDescriptorSet(),
+  if (auto const* const camera = scene.getActiveCamera(); camera != nullptr) {
+    std::array const descSets {camera->getDescriptorSet(_frameIndex),
                                gBuffer.getDescriptorSet()};
     cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, _lightingLayout.get(),
                                  0, descSets, {});
 
     cmdBuffer.draw(3, 1, 0, 0);
-
-    cmdBuffer.endRendering();
   }
+
+  cmdBuffer.endRendering();
 }
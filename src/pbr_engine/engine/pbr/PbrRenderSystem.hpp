@@ -4,51 +4,425 @@
 
 #include "pbr/core/GpuHandle.hpp"
 
+#include "pbr/CullingSystem.hpp"
+#include "pbr/DepthPyramidSystem.hpp"
+#include "pbr/DrawList.hpp"
+#include "pbr/FrustumCuller.hpp"
 #include "pbr/GBuffer.hpp"
+#include "pbr/GrowableBuffer.hpp"
 #include "pbr/Image2D.hpp"
+#include "pbr/Light.hpp"
+#include "pbr/LightBuffer.hpp"
+#include "pbr/MaterialRegistry.hpp"
+#include "pbr/RenderGraph.hpp"
 #include "pbr/Scene.hpp"
+#include "pbr/SoftwareOcclusionCuller.hpp"
+#include "pbr/ThreadPool.hpp"
+#include "pbr/TiledLightingSystem.hpp"
 #include "pbr/memory/IAllocator.hpp"
 
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
 namespace pbr {
+/**
+ * Samples counted by occlusion queries while the last frame of a slot was rendered.
+ */
+struct OverdrawStats {
+  /// Samples that passed the depth test of the depth pre-pass, every one of them would
+  /// have written the g-buffer without it.
+  std::uint64_t depthSamples {};
+  /// Samples that wrote the g-buffer.
+  std::uint64_t gBufferSamples {};
+};
 struct PbrRenderSystemCreateInfo {
   vk::PipelineShaderStageCreateInfo geometryVertexShader {};
   vk::PipelineShaderStageCreateInfo geometryFragmentShader {};
   vk::PipelineShaderStageCreateInfo lightingVertexShader {};
   vk::PipelineShaderStageCreateInfo lightingFragmentShader {};
+  /// Optional, the gpu driven path is only available when both of these are set.
+  vk::PipelineShaderStageCreateInfo geometryIndirectVertexShader {};
+  vk::PipelineShaderStageCreateInfo cullingComputeShader {};
+  /// Optional, materials are bindless if this is set and descriptor indexing is
+  /// supported.
+  vk::PipelineShaderStageCreateInfo geometryBindlessFragmentShader {};
+  /// Optional, shades the scene lights in tiles, has to be compiled for the g-buffer
+  /// layout.
+  vk::PipelineShaderStageCreateInfo tiledLightingComputeShader {};
+  /// Optional, position only shaders of the depth pre-pass, the indirect one is needed
+  /// on the gpu driven path.
+  vk::PipelineShaderStageCreateInfo depthPrepassVertexShader {};
+  vk::PipelineShaderStageCreateInfo depthPrepassIndirectVertexShader {};
+  /// Optional, occlusion culling on the gpu driven path needs both of these.
+  vk::PipelineShaderStageCreateInfo depthPyramidComputeShader {};
+  vk::PipelineShaderStageCreateInfo occlusionCullingComputeShader {};
+  /// The number of frames recorded while the previous ones still execute.
+  std::uint32_t framesInFlight = 1;
+  /// The geometry and lighting fragment shaders have to be compiled for the layout.
+  GBufferLayout gBufferLayout = GBufferLayout::Wide;
 };
 class PbrRenderSystem {
 public:
   static constexpr auto LIGHTING_PASS_OUTPUT_FORMAT = vk::Format::eR16G16B16A16Sfloat;
 
 private:
+  /**
+   * Command pool and secondary command buffer of a single recording thread.
+   */
+  struct RecordingContext {
+    vk::UniqueCommandPool cmdPool;
+    vk::UniqueCommandBuffer cmdBuffer;
+  };
+  /**
+   * Resources written while recording a frame, every frame in flight has its own.
+   */
+  struct FrameResources {
+    GrowableBuffer instanceBuffer;
+    vk::UniqueDescriptorSet instanceDescSet;
+    /// The visible instance buffer the instance set was last written with.
+    vk::Buffer visibleInstanceBuffer {};
+    std::vector<RecordingContext> recordingContexts;
+    LightBuffer lightBuffer;
+    /// Query results can only be read once the queries have been reset.
+    bool overdrawQueriesReset = false;
+  };
+  /**
+   * The render graph handles of the g-buffer attachments.
+   */
+  struct GBufferImages {
+    std::vector<ImageHandle> colors;
+    ImageHandle depth {};
+  };
+
   core::SharedGpuHandle _gpu;
+  std::shared_ptr<IAllocator> _allocator;
+  std::shared_ptr<ThreadPool> _threadPool;
+  GBufferLayout _gBufferLayout;
 
   vk::UniqueDescriptorSetLayout _sceneDescSetLayout;
   vk::UniqueDescriptorSetLayout _materialDescSetLayout;
   vk::UniqueSampler _gBufferSampler;
   vk::UniqueSampler _depthSampler;
   vk::UniqueDescriptorSetLayout _gBufferDescSetLayout;
+  vk::UniqueDescriptorSetLayout _instanceDescSetLayout;
 
   vk::UniqueDescriptorPool _gBufferDescriptorPool;
+  vk::UniqueDescriptorPool _instanceDescriptorPool;
+
+  std::optional<MaterialRegistry> _materialRegistry;
 
   vk::UniquePipelineLayout _geometryLayout;
   vk::UniquePipeline _geometryPipeline;
+  vk::UniquePipeline _geometryIndirectPipeline;
 
   vk::UniquePipelineLayout _lightingLayout;
   vk::UniquePipeline _lightingPipeline;
 
+  vk::UniquePipeline _depthPrepassPipeline;
+  vk::UniquePipeline _depthPrepassIndirectPipeline;
+  /// Geometry pipelines that only shade the fragments left by the depth pre-pass.
+  vk::UniquePipeline _geometryEqualPipeline;
+  vk::UniquePipeline _geometryIndirectEqualPipeline;
+  bool _depthPrepass = false;
+  /// Counts the samples of the depth pre-pass and the geometry pass of every frame slot.
+  vk::UniqueQueryPool _overdrawQueryPool;
+  OverdrawStats _overdrawStats {};
+
+  DrawList _drawList;
+
+  std::optional<CullingSystem> _cullingSystem = std::nullopt;
+  bool _gpuDriven = false;
+
+  std::optional<DepthPyramidSystem> _depthPyramidSystem = std::nullopt;
+  bool _occlusionCulling = false;
+
+  FrustumCuller _frustumCuller;
+  bool _frustumCulling = true;
+
+  SoftwareOcclusionCuller _softwareOcclusionCuller;
+  bool _softwareOcclusionCulling = false;
+
+  bool _lods = true;
+
+  std::optional<TiledLightingSystem> _tiledLightingSystem = std::nullopt;
+  bool _tiledLighting = false;
+  /// The lights of the scene collected for the tiled lighting pass.
+  std::vector<LightData> _lights;
+
+  std::vector<FrameResources> _frames;
+  /// The frame that is being recorded.
+  std::uint32_t _frameIndex = 0;
+  std::vector<DrawListStats> _chunkStats;
+  std::vector<vk::CommandBuffer> _secondaryCmdBuffers;
+
 public:
-  PbrRenderSystem(core::SharedGpuHandle gpu, PbrRenderSystemCreateInfo info);
+  /**
+   * @param allocator The allocator used for the per frame instance buffers.
+   * @param threadPool Optional, the draws of large scenes are recorded by its threads
+   * into secondary command buffers.
+   */
+  PbrRenderSystem(core::SharedGpuHandle gpu, std::shared_ptr<IAllocator> allocator,
+                  PbrRenderSystemCreateInfo info,
+                  std::shared_ptr<ThreadPool> threadPool = nullptr);
 
+  /**
+   * @returns A g-buffer in the layout the pipelines were created for.
+   */
   [[nodiscard]]
   auto allocateGBuffer(IAllocator& allocator, vk::Extent2D extent) -> GBuffer;
 
-  auto render(vk::CommandBuffer cmdBuffer, Scene const& scene, GBuffer const& gBuffer,
-              Image2D const& renderTarget, vk::Extent2D renderExtent) -> void;
+  [[nodiscard]]
+  auto getGBufferLayout() const noexcept -> GBufferLayout;
+
+  /**
+   * @returns Counters of the last recorded geometry pass.
+   */
+  [[nodiscard]]
+  auto getDrawListStats() const noexcept -> DrawListStats;
+
+  /**
+   * @returns The registry materials have to be registered with before they are drawn or a
+   * nullptr if materials use their own descriptor sets.
+   */
+  [[nodiscard]]
+  auto getMaterialRegistry() noexcept -> MaterialRegistry*;
+
+  /**
+   * @returns Whether the gpu driven path was created, this needs its shaders and device
+   * support for indirect count draws.
+   */
+  [[nodiscard]]
+  auto isGpuDrivenSupported() const noexcept -> bool;
+
+  [[nodiscard]]
+  auto isGpuDriven() const noexcept -> bool;
+
+  /**
+   * Switches between recording the draw list on the cpu and culling it on the gpu with
+   * indirect draws.
+   * @note The gpu driven path is only used if it is supported.
+   */
+  auto setGpuDriven(bool gpuDriven) noexcept -> void;
+
+  /**
+   * @returns Counters of the last recorded culling pass.
+   * @note The gpu driven path has to be supported.
+   */
+  [[nodiscard]]
+  auto getCullingStats() const noexcept -> CullingStats;
+
+  /**
+   * @returns Whether occlusion culling was created, this needs the gpu driven path and
+   * the shaders of the depth pyramid and the occlusion culling.
+   */
+  [[nodiscard]]
+  auto isOcclusionCullingSupported() const noexcept -> bool;
+
+  [[nodiscard]]
+  auto isOcclusionCulling() const noexcept -> bool;
+
+  /**
+   * Switches occlusion culling on or off. Instances hidden behind the depth of the
+   * instances visible in the previous frame are not drawn.
+   * @note Occlusion culling is only used on the gpu driven path if it is supported.
+   */
+  auto setOcclusionCulling(bool occlusionCulling) noexcept -> void;
+
+  /**
+   * @note The gpu driven path has to be supported.
+   */
+  [[nodiscard]]
+  auto isMeshletCulling() const noexcept -> bool;
+
+  /**
+   * Switches between culling primitives meshlet by meshlet, against the frustum and by
+   * their normal cones, and culling them as a whole on the gpu driven path.
+   * @note The gpu driven path has to be supported.
+   */
+  auto setMeshletCulling(bool meshletCulling) noexcept -> void;
+
+  [[nodiscard]]
+  auto isFrustumCulling() const noexcept -> bool;
+
+  /**
+   * Switches frustum culling on the cpu on or off. Nodes whose world space box is outside
+   * of the camera frustum are left out of the draw list, on either path.
+   */
+  auto setFrustumCulling(bool frustumCulling) noexcept -> void;
+
+  /**
+   * @returns Counters of the last cpu side frustum culling.
+   */
+  [[nodiscard]]
+  auto getFrustumCullingStats() const noexcept -> FrustumCullingStats;
+
+  [[nodiscard]]
+  auto isSoftwareOcclusionCulling() const noexcept -> bool;
+
+  /**
+   * Switches culling on the cpu on or off. Nodes hidden behind the largest meshes with an
+   * occluder are left out of the draw list, on either path.
+   */
+  auto setSoftwareOcclusionCulling(bool softwareOcclusionCulling) noexcept -> void;
+
+  /**
+   * @returns Counters of the last cpu side culling.
+   */
+  [[nodiscard]]
+  auto getSoftwareOcclusionStats() const noexcept -> SoftwareOcclusionStats;
+
+  [[nodiscard]]
+  auto isLods() const noexcept -> bool;
+
+  /**
+   * Switches levels of detail on or off. Primitives are drawn with their coarsest level
+   * of detail whose error stays within a pixel, on either path.
+   */
+  auto setLods(bool lods) noexcept -> void;
+
+  /**
+   * @returns Whether the tiled lighting pass was created, this needs its shader.
+   */
+  [[nodiscard]]
+  auto isTiledLightingSupported() const noexcept -> bool;
+
+  [[nodiscard]]
+  auto isTiledLighting() const noexcept -> bool;
+
+  /**
+   * Switches between the fullscreen lighting pass and the tiled compute pass which
+   * shades the lights of the scene.
+   * @note The tiled lighting pass is only used if it is supported.
+   */
+  auto setTiledLighting(bool tiledLighting) noexcept -> void;
+
+  /**
+   * @returns Counters of the last recorded tiled lighting pass.
+   * @note The tiled lighting pass has to be supported.
+   */
+  [[nodiscard]]
+  auto getTiledLightingStats() const noexcept -> TiledLightingStats;
+
+  /**
+   * @returns Whether the depth pre-pass pipelines were created, this needs their shaders.
+   */
+  [[nodiscard]]
+  auto isDepthPrepassSupported() const noexcept -> bool;
+
+  [[nodiscard]]
+  auto isDepthPrepass() const noexcept -> bool;
+
+  /**
+   * Switches the depth pre-pass on or off. With it the geometry pass only shades the
+   * fragments that end up visible, so overdraw no longer writes the g-buffer.
+   * @note The pre-pass is only used if it is supported for the current path.
+   */
+  auto setDepthPrepass(bool depthPrepass) noexcept -> void;
+
+  /**
+   * @returns Whether getOverdrawStats is measured, this needs precise occlusion queries.
+   */
+  [[nodiscard]]
+  auto isOverdrawQuerySupported() const noexcept -> bool;
+
+  /**
+   * @returns Samples of the frame that last finished in the slot being recorded, counters
+   * of passes that were not measured are zero.
+   */
+  [[nodiscard]]
+  auto getOverdrawStats() const noexcept -> OverdrawStats;
+
+  /**
+   * @returns Counters of the last light upload, lights are only uploaded for the tiled
+   * lighting pass.
+   */
+  [[nodiscard]]
+  auto getLightBufferStats() const noexcept -> LightBufferStats;
+
+  /**
+   * @param frameIndex The slot of the frame in flight, the gpu must have finished the
+   * previous frame that used it.
+   * @note Uploads the instances and the lights right away, the passes are recorded when
+   * the graph is executed during the same frame.
+   */
+  auto render(RenderGraph& graph, std::uint32_t frameIndex, Scene const& scene,
+              GBuffer const& gBuffer, Image2D const& renderTarget,
+              vk::Extent2D renderExtent) -> void;
 
 private:
-  auto recordGeometryPass(vk::CommandBuffer cmdBuffer, Scene const& scene,
-                          GBuffer const& gBuffer) -> void;
+  [[nodiscard]]
+  auto getFrame() noexcept -> FrameResources&;
+  [[nodiscard]]
+  auto getFrame() const noexcept -> FrameResources const&;
+  [[nodiscard]]
+  auto getMaterialBinding() const noexcept -> MaterialBinding;
+  /**
+   * Copies the instances of the draw list to the instance buffer, growing it if needed.
+   */
+  auto uploadInstances() -> void;
+  /**
+   * Points the instance set at the visible instances of the culling system.
+   */
+  auto updateVisibleInstances() -> void;
+  /**
+   * Reads the queries of the previous use of the frame and resets them.
+   */
+  auto readOverdrawQueries(vk::CommandBuffer cmdBuffer) -> void;
+  auto beginOverdrawQuery(vk::CommandBuffer cmdBuffer, std::uint32_t query) const -> void;
+  auto endOverdrawQuery(vk::CommandBuffer cmdBuffer, std::uint32_t query) const -> void;
+  /**
+   * Adds a pass building the depth pyramid from the depth drawn so far and recording the
+   * second phase of occlusion culling.
+   */
+  auto addOcclusionCulling(RenderGraph& graph, GBufferImages const& images,
+                           bool keepEveryVisible) -> void;
+  /**
+   * Fills the depth attachment of the g-buffer with the depth of the visible surfaces.
+   * @param occlusionCulling Whether the second phase of occlusion culling runs here.
+   */
+  auto addDepthPrepass(RenderGraph& graph, Scene const& scene, GBuffer const& gBuffer,
+                       GBufferImages const& images, bool gpuDriven,
+                       bool occlusionCulling) -> void;
+  auto recordDepthDraws(vk::CommandBuffer cmdBuffer, Scene const& scene,
+                        GBuffer const& gBuffer, bool gpuDriven,
+                        vk::AttachmentLoadOp loadOp) -> void;
+  /**
+   * @param depthPrepass Whether the depth attachment was filled by the depth pre-pass.
+   * @param occlusionCulling Whether the second phase of occlusion culling runs here.
+   */
+  auto addGeometryPass(RenderGraph& graph, Scene const& scene, GBuffer const& gBuffer,
+                       GBufferImages const& images, bool gpuDriven, bool depthPrepass,
+                       bool occlusionCulling) -> void;
+  /**
+   * @param loadAttachments Whether to draw on top of the first phase instead of clearing.
+   */
+  auto recordGeometryDraws(vk::CommandBuffer cmdBuffer, Scene const& scene,
+                           GBuffer const& gBuffer, bool gpuDriven, bool depthPrepass,
+                           std::uint32_t chunkCount, bool loadAttachments) -> void;
+  /**
+   * Sets the dynamic state and binds the descriptor sets of the geometry pass.
+   */
+  auto bindGeometryState(vk::CommandBuffer cmdBuffer, Scene const& scene,
+                         vk::Extent2D extent) const -> void;
+  /**
+   * @returns Into how many secondary command buffers the draw list gets split, 1 means it
+   * is recorded directly.
+   */
+  [[nodiscard]]
+  auto getRecordingChunkCount() const noexcept -> std::uint32_t;
+  /**
+   * Records the draw list in parallel into secondary command buffers and executes them.
+   */
+  auto recordGeometryChunks(vk::CommandBuffer cmdBuffer, Scene const& scene,
+                            vk::Extent2D extent, std::uint32_t chunkCount) -> void;
+  /**
+   * @returns Whether the samples of the geometry pass can be counted, secondary command
+   * buffers need inherited queries for that.
+   */
+  [[nodiscard]]
+  auto isGeometryPassQueryable(std::uint32_t chunkCount) const noexcept -> bool;
   auto recordLightingPass(vk::CommandBuffer cmdBuffer, Scene const& scene, GBuffer const& gBuffer,
                           Image2D const& renderTo, vk::Rect2D renderArea) -> void;
 };
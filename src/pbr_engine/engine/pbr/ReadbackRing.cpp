@@ -0,0 +1,125 @@
+#include "pbr/ReadbackRing.hpp"
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/Buffer.hpp"
+#include "pbr/RenderGraph.hpp"
+#include "pbr/memory/Allocation.hpp"
+#include "pbr/memory/IAllocator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <vector>
+
+namespace {
+[[nodiscard]]
+auto createBuffers(pbr::IAllocator& allocator, vk::DeviceSize const size,
+                   std::uint32_t const count) -> std::vector<pbr::Buffer> {
+  std::vector<pbr::Buffer> buffers;
+  buffers.reserve(count);
+  for (auto i = 0u; i < count; ++i) {
+    // Random access prefers cached memory, which the encoders read a lot faster.
+    buffers.emplace_back(allocator.allocateBuffer(
+        {
+            .size = size,
+            .usage = vk::BufferUsageFlagBits::eTransferDst,
+        },
+        {
+            .preference = pbr::AllocationPreference::Host,
+            .ableToBeMapped = true,
+            .randomAccess = true,
+        }));
+  }
+  return buffers;
+}
+} // namespace
+
+pbr::ReadbackRing::ReadbackRing(IAllocator& allocator, vk::DeviceSize const slotSize,
+                                std::uint32_t const slotCount)
+    : _buffers(::createBuffers(allocator, slotSize, slotCount))
+    , _slotSize(slotSize)
+    , _busy(slotCount, false) {
+  assert(slotCount > 0);
+}
+
+auto pbr::ReadbackRing::acquire() -> std::uint32_t {
+  std::unique_lock lock(_mutex);
+  auto const waitStart = std::chrono::steady_clock::now();
+  _slotReleased.wait(lock, [this] { return std::ranges::contains(_busy, false); });
+  _stats.slotWait += std::chrono::steady_clock::now() - waitStart;
+
+  auto const slot = std::ranges::find(_busy, false);
+  *slot = true;
+  ++_stats.busySlots;
+  return static_cast<std::uint32_t>(std::distance(_busy.begin(), slot));
+}
+
+auto pbr::ReadbackRing::addReadback(RenderGraph& graph, std::uint32_t const slot,
+                                    vk::Image const image,
+                                    vk::Extent2D const extent) const -> void {
+  auto const imageHandle = graph.importImage(image, vk::ImageAspectFlagBits::eColor);
+  auto const buffer = _buffers[slot].getBuffer();
+  // The host reads the buffer, which the graph does not know about.
+  graph
+      .addPass("readback",
+               [image, buffer, extent](vk::CommandBuffer const cmdBuffer) {
+                 cmdBuffer.copyImageToBuffer(
+                     image, vk::ImageLayout::eTransferSrcOptimal, buffer,
+                     vk::BufferImageCopy {
+                         .imageSubresource {
+                             .aspectMask = vk::ImageAspectFlagBits::eColor,
+                             .layerCount = 1,
+                         },
+                         .imageExtent {
+                             .width = extent.width,
+                             .height = extent.height,
+                             .depth = 1,
+                         },
+                     });
+                 // Waiting for the fence alone does not make the copy visible to the
+                 // host.
+                 vk::MemoryBarrier2 const barrier {
+                     .srcStageMask = vk::PipelineStageFlagBits2::eCopy,
+                     .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+                     .dstStageMask = vk::PipelineStageFlagBits2::eHost,
+                     .dstAccessMask = vk::AccessFlagBits2::eHostRead,
+                 };
+                 cmdBuffer.pipelineBarrier2(
+                     vk::DependencyInfo {}.setMemoryBarriers(barrier));
+               })
+      .read(imageHandle, usages::TRANSFER_READ)
+      .setSideEffects();
+}
+
+auto pbr::ReadbackRing::map(std::uint32_t const slot) const -> Allocation::Mapping {
+  _buffers[slot].invalidate();
+  return _buffers[slot].map();
+}
+
+auto pbr::ReadbackRing::release(std::uint32_t const slot) -> void {
+  {
+    std::scoped_lock const lock(_mutex);
+    assert(_busy[slot]);
+    _busy[slot] = false;
+    --_stats.busySlots;
+  }
+  _slotReleased.notify_all();
+}
+
+auto pbr::ReadbackRing::waitIdle() -> void {
+  std::unique_lock lock(_mutex);
+  _slotReleased.wait(lock, [this] { return _stats.busySlots == 0; });
+}
+
+auto pbr::ReadbackRing::getSlotCount() const noexcept -> std::uint32_t {
+  return static_cast<std::uint32_t>(_buffers.size());
+}
+
+auto pbr::ReadbackRing::getStats() const -> ReadbackRingStats {
+  std::scoped_lock const lock(_mutex);
+  return _stats;
+}
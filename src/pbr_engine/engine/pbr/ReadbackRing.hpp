@@ -0,0 +1,91 @@
+#pragma once
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/Buffer.hpp"
+#include "pbr/RenderGraph.hpp"
+#include "pbr/memory/Allocation.hpp"
+#include "pbr/memory/IAllocator.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace pbr {
+struct ReadbackRingStats {
+  /// The slots held by readbacks that were not released yet.
+  std::uint32_t busySlots {};
+  /// The time acquire waited for a slot to be released, summed over every call.
+  std::chrono::nanoseconds slotWait {};
+};
+/**
+ * Host visible buffers images are copied into at the end of a frame.
+ *
+ * A slot stays acquired until its consumer releases it, which can be long after the gpu
+ * has finished the frame, so the pixels are converted on other threads straight out of
+ * the buffer while later frames render into other slots. Rendering only waits once
+ * every slot is held.
+ * @note Acquiring and releasing slots is thread safe.
+ */
+class ReadbackRing {
+  std::vector<Buffer> _buffers;
+  vk::DeviceSize _slotSize;
+
+  mutable std::mutex _mutex;
+  std::condition_variable _slotReleased;
+  std::vector<bool> _busy;
+  ReadbackRingStats _stats {};
+
+public:
+  /**
+   * @param slotSize The bytes of the largest image a slot is copied from.
+   * @param slotCount Should exceed the frames in flight by the consumers of the slots.
+   */
+  ReadbackRing(IAllocator& allocator, vk::DeviceSize slotSize, std::uint32_t slotCount);
+
+  ReadbackRing(const ReadbackRing&) = delete;
+  auto operator=(const ReadbackRing&) -> ReadbackRing& = delete;
+  ReadbackRing(ReadbackRing&&) = delete;
+  auto operator=(ReadbackRing&&) -> ReadbackRing& = delete;
+
+  ~ReadbackRing() noexcept = default;
+
+  /**
+   * Blocks until a slot is free.
+   * @returns The slot, it is held until it is released.
+   */
+  [[nodiscard]]
+  auto acquire() -> std::uint32_t;
+  /**
+   * Adds a pass copying the first mip level of the image into the slot, tightly packed.
+   */
+  auto addReadback(RenderGraph& graph, std::uint32_t slot, vk::Image image,
+                   vk::Extent2D extent) const -> void;
+  /**
+   * @returns A mapping of the slot, it holds what the readback copied.
+   * @note The gpu must have finished the frame that copied into the slot.
+   */
+  [[nodiscard]]
+  auto map(std::uint32_t slot) const -> Allocation::Mapping;
+  auto release(std::uint32_t slot) -> void;
+  /**
+   * Blocks until every slot is released.
+   */
+  auto waitIdle() -> void;
+
+  [[nodiscard]]
+  auto getSlotCount() const noexcept -> std::uint32_t;
+  [[nodiscard]]
+  constexpr auto getSlotSize() const noexcept -> vk::DeviceSize;
+  [[nodiscard]]
+  auto getStats() const -> ReadbackRingStats;
+};
+} // namespace pbr
+
+/* IMPLEMENTATIONS */
+
+constexpr auto pbr::ReadbackRing::getSlotSize() const noexcept -> vk::DeviceSize {
+  return _slotSize;
+}
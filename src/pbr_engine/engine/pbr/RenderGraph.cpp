@@ -0,0 +1,442 @@
+#include "pbr/RenderGraph.hpp"
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/GpuProfiler.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <optional>
+#include <ranges>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace constants {
+static constexpr vk::AccessFlags2 WRITE_ACCESS =
+    vk::AccessFlagBits2::eColorAttachmentWrite
+    | vk::AccessFlagBits2::eDepthStencilAttachmentWrite
+    | vk::AccessFlagBits2::eShaderStorageWrite | vk::AccessFlagBits2::eShaderWrite
+    | vk::AccessFlagBits2::eTransferWrite | vk::AccessFlagBits2::eHostWrite
+    | vk::AccessFlagBits2::eMemoryWrite;
+} // namespace constants
+
+namespace {
+/**
+ * @returns Whether the usage reads the previous contents besides writing them.
+ */
+[[nodiscard]]
+constexpr auto isLoading(pbr::ResourceUsage const usage) noexcept -> bool {
+  return static_cast<bool>(usage.access & ~constants::WRITE_ACCESS);
+}
+} // namespace
+
+pbr::RenderGraph::PassBuilder::PassBuilder(RenderGraph& graph,
+                                           std::uint32_t const pass) noexcept
+    : _graph(&graph), _pass(pass) {}
+
+auto pbr::RenderGraph::PassBuilder::read(ImageHandle const image,
+                                         ResourceUsage const usage,
+                                         std::uint32_t const baseLevel,
+                                         std::uint32_t const levelCount) -> PassBuilder& {
+  _graph->addImageAccess(_pass, {
+                                    .image = image,
+                                    .usage = usage,
+                                    .baseLevel = baseLevel,
+                                    .levelCount = levelCount,
+                                    .reads = true,
+                                    .writes = false,
+                                });
+  return *this;
+}
+
+auto pbr::RenderGraph::PassBuilder::write(ImageHandle const image,
+                                          ResourceUsage const usage,
+                                          std::uint32_t const baseLevel,
+                                          std::uint32_t const levelCount)
+    -> PassBuilder& {
+  _graph->addImageAccess(_pass, {
+                                    .image = image,
+                                    .usage = usage,
+                                    .baseLevel = baseLevel,
+                                    .levelCount = levelCount,
+                                    .reads = ::isLoading(usage),
+                                    .writes = true,
+                                });
+  return *this;
+}
+
+auto pbr::RenderGraph::PassBuilder::read(BufferHandle const buffer,
+                                         ResourceUsage const usage) -> PassBuilder& {
+  _graph->addBufferAccess(_pass, {
+                                     .buffer = buffer,
+                                     .usage = usage,
+                                     .reads = true,
+                                     .writes = false,
+                                 });
+  return *this;
+}
+
+auto pbr::RenderGraph::PassBuilder::write(BufferHandle const buffer,
+                                          ResourceUsage const usage) -> PassBuilder& {
+  _graph->addBufferAccess(_pass, {
+                                     .buffer = buffer,
+                                     .usage = usage,
+                                     .reads = ::isLoading(usage),
+                                     .writes = true,
+                                 });
+  return *this;
+}
+
+auto pbr::RenderGraph::PassBuilder::setSideEffects() -> PassBuilder& {
+  _graph->_passes[_pass].sideEffects = true;
+  return *this;
+}
+
+auto pbr::RenderGraph::importImage(vk::Image const image,
+                                   vk::ImageAspectFlags const aspect,
+                                   ImageContents const contents,
+                                   std::uint32_t const levelCount) -> ImageHandle {
+  auto const imported = std::ranges::find(_images, image, &ImageResource::image);
+  if (imported != _images.end()) {
+    return static_cast<ImageHandle>(imported - _images.begin());
+  }
+
+  // Images the previous compile did not see may still be in use by earlier submissions
+  // or wait on a semaphore, so their first barrier waits for every earlier command.
+  ResourceState const unknown {
+      .writeStages = vk::PipelineStageFlagBits2::eAllCommands,
+  };
+  std::vector<ResourceState> levels(levelCount, unknown);
+  if (auto const state = _imageStates.find(image);
+      state != _imageStates.end() && state->second.size() == levelCount) {
+    levels = state->second;
+  }
+  if (contents == ImageContents::Discard) {
+    for (auto& level : levels) {
+      level.layout = vk::ImageLayout::eUndefined;
+    }
+  }
+  _images.push_back({
+      .image = image,
+      .aspect = aspect,
+      .contents = contents,
+      .levels = std::move(levels),
+      .exportUsage = std::nullopt,
+  });
+  return static_cast<ImageHandle>(_images.size() - 1);
+}
+
+auto pbr::RenderGraph::importBuffer(vk::Buffer const buffer) -> BufferHandle {
+  auto const imported = std::ranges::find(_buffers, buffer, &BufferResource::buffer);
+  if (imported != _buffers.end()) {
+    return static_cast<BufferHandle>(imported - _buffers.begin());
+  }
+
+  auto const state = _bufferStates.find(buffer);
+  _buffers.push_back({
+      .buffer = buffer,
+      .state = state != _bufferStates.end()
+                   ? state->second
+                   : ResourceState {
+                         .writeStages = vk::PipelineStageFlagBits2::eAllCommands,
+                     },
+  });
+  return static_cast<BufferHandle>(_buffers.size() - 1);
+}
+
+auto pbr::RenderGraph::exportImage(ImageHandle const image, ResourceUsage const usage)
+    -> void {
+  _images[std::to_underlying(image)].exportUsage = usage;
+}
+
+auto pbr::RenderGraph::addPass(std::string name, RecordFunction record) -> PassBuilder {
+  _passes.push_back({
+      .name = std::move(name),
+      .record = std::move(record),
+      .images = {},
+      .buffers = {},
+      .sideEffects = false,
+  });
+  return {*this, static_cast<std::uint32_t>(_passes.size() - 1)};
+}
+
+auto pbr::RenderGraph::compile() -> CompiledGraph {
+  auto const keep = cullPasses();
+  _stats = {
+      .passes = static_cast<std::uint32_t>(std::ranges::count(keep, true)),
+      .culledPasses = static_cast<std::uint32_t>(std::ranges::count(keep, false)),
+      .imageBarriers = 0,
+      .bufferBarriers = 0,
+      .barrierBatches = 0,
+  };
+
+  CompiledGraph compiled;
+  compiled.passes.reserve(_stats.passes);
+  for (auto&& [pass, kept] : std::views::zip(_passes, keep)) {
+    if (!kept) {
+      continue;
+    }
+
+    CompiledPass compiledPass {
+        .name = std::move(pass.name),
+        .record = std::move(pass.record),
+        .imageBarriers = {},
+        .bufferBarriers = {},
+    };
+    for (auto const& access : pass.images) {
+      auto& image = _images[std::to_underlying(access.image)];
+      // Consecutive levels waiting for the same accesses share a barrier.
+      std::optional<Dependency> run = std::nullopt;
+      for (auto level = access.baseLevel;
+           level < access.baseLevel + access.levelCount; ++level) {
+        auto const dependency =
+            accessResource(image.levels[level], access.usage, access.writes);
+        if (dependency.has_value() && dependency == run) {
+          ++compiledPass.imageBarriers.back().subresourceRange.levelCount;
+          continue;
+        }
+        run = dependency;
+        if (dependency.has_value()) {
+          compiledPass.imageBarriers.push_back({
+              .srcStageMask = dependency->srcStages,
+              .srcAccessMask = dependency->srcAccess,
+              .dstStageMask = access.usage.stages,
+              .dstAccessMask = access.usage.access,
+              .oldLayout = dependency->oldLayout,
+              .newLayout = access.usage.layout,
+              .image = image.image,
+              .subresourceRange {
+                  .aspectMask = image.aspect,
+                  .baseMipLevel = level,
+                  .levelCount = 1,
+                  .layerCount = 1,
+              },
+          });
+        }
+      }
+    }
+    for (auto const& access : pass.buffers) {
+      auto& buffer = _buffers[std::to_underlying(access.buffer)];
+      if (auto const dependency =
+              accessResource(buffer.state, access.usage, access.writes)) {
+        compiledPass.bufferBarriers.push_back({
+            .srcStageMask = dependency->srcStages,
+            .srcAccessMask = dependency->srcAccess,
+            .dstStageMask = access.usage.stages,
+            .dstAccessMask = access.usage.access,
+            .buffer = buffer.buffer,
+            .size = vk::WholeSize,
+        });
+      }
+    }
+
+    _stats.imageBarriers += static_cast<std::uint32_t>(compiledPass.imageBarriers.size());
+    _stats.bufferBarriers +=
+        static_cast<std::uint32_t>(compiledPass.bufferBarriers.size());
+    if (!compiledPass.imageBarriers.empty() || !compiledPass.bufferBarriers.empty()) {
+      ++_stats.barrierBatches;
+    }
+    compiled.passes.push_back(std::move(compiledPass));
+  }
+
+  for (auto& image : _images) {
+    if (!image.exportUsage.has_value()) {
+      continue;
+    }
+    for (auto&& [level, state] : std::views::enumerate(image.levels)) {
+      if (auto const dependency = accessResource(state, *image.exportUsage, false)) {
+        compiled.finalBarriers.push_back({
+            .srcStageMask = dependency->srcStages,
+            .srcAccessMask = dependency->srcAccess,
+            .dstStageMask = image.exportUsage->stages,
+            .dstAccessMask = image.exportUsage->access,
+            .oldLayout = dependency->oldLayout,
+            .newLayout = image.exportUsage->layout,
+            .image = image.image,
+            .subresourceRange {
+                .aspectMask = image.aspect,
+                .baseMipLevel = static_cast<std::uint32_t>(level),
+                .levelCount = 1,
+                .layerCount = 1,
+            },
+        });
+      }
+    }
+  }
+  _stats.imageBarriers += static_cast<std::uint32_t>(compiled.finalBarriers.size());
+  if (!compiled.finalBarriers.empty()) {
+    ++_stats.barrierBatches;
+  }
+
+  // Only the resources of this frame are remembered, the others may have been destroyed.
+  _imageStates.clear();
+  for (auto& image : _images) {
+    _imageStates.emplace(image.image, std::move(image.levels));
+  }
+  _bufferStates.clear();
+  for (auto const& buffer : _buffers) {
+    _bufferStates.emplace(buffer.buffer, buffer.state);
+  }
+  _images.clear();
+  _buffers.clear();
+  _passes.clear();
+  return compiled;
+}
+
+auto pbr::RenderGraph::execute(vk::CommandBuffer cmdBuffer, GpuProfiler* profiler)
+    -> void {
+  auto compiled = compile();
+  for (auto& pass : compiled.passes) {
+    if (!pass.imageBarriers.empty() || !pass.bufferBarriers.empty()) {
+      cmdBuffer.pipelineBarrier2(vk::DependencyInfo {}
+                                     .setImageMemoryBarriers(pass.imageBarriers)
+                                     .setBufferMemoryBarriers(pass.bufferBarriers));
+    }
+    if (profiler != nullptr) {
+      profiler->beginPass(cmdBuffer, pass.name);
+    }
+    pass.record(cmdBuffer);
+    if (profiler != nullptr) {
+      profiler->endPass(cmdBuffer);
+    }
+  }
+  if (!compiled.finalBarriers.empty()) {
+    cmdBuffer.pipelineBarrier2(
+        vk::DependencyInfo {}.setImageMemoryBarriers(compiled.finalBarriers));
+  }
+}
+
+auto pbr::RenderGraph::addImageAccess(std::uint32_t const pass, ImageAccess access)
+    -> void {
+  auto const levels =
+      static_cast<std::uint32_t>(_images[std::to_underlying(access.image)].levels.size());
+  assert(access.baseLevel < levels);
+  access.levelCount = std::min(access.levelCount, levels - access.baseLevel);
+
+  // A pass uses every level in one layout, so its uses of the same levels are merged.
+  auto& accesses = _passes[pass].images;
+  auto const used = std::ranges::find_if(accesses, [&](auto const& other) {
+    return other.image == access.image && other.baseLevel == access.baseLevel
+           && other.levelCount == access.levelCount;
+  });
+  if (used == accesses.end()) {
+    accesses.push_back(access);
+    return;
+  }
+  assert(used->usage.layout == access.usage.layout);
+  used->usage.stages |= access.usage.stages;
+  used->usage.access |= access.usage.access;
+  used->reads = used->reads || access.reads;
+  used->writes = used->writes || access.writes;
+}
+
+auto pbr::RenderGraph::addBufferAccess(std::uint32_t const pass, BufferAccess access)
+    -> void {
+  auto& accesses = _passes[pass].buffers;
+  auto const used = std::ranges::find(accesses, access.buffer, &BufferAccess::buffer);
+  if (used == accesses.end()) {
+    accesses.push_back(access);
+    return;
+  }
+  used->usage.stages |= access.usage.stages;
+  used->usage.access |= access.usage.access;
+  used->reads = used->reads || access.reads;
+  used->writes = used->writes || access.writes;
+}
+
+auto pbr::RenderGraph::cullPasses() const -> std::vector<bool> {
+  // Walks the passes backwards, a pass is kept if a kept pass after it or an export reads
+  // what it writes.
+  std::vector<bool> neededImages;
+  neededImages.reserve(_images.size());
+  for (auto const& image : _images) {
+    neededImages.push_back(image.exportUsage.has_value());
+  }
+  std::vector<bool> neededBuffers(_buffers.size(), false);
+
+  std::vector<bool> keep(_passes.size(), false);
+  for (auto const [index, pass] : std::views::enumerate(_passes) | std::views::reverse) {
+    keep[index] = pass.sideEffects
+                  || std::ranges::any_of(pass.images,
+                                         [&](auto const& access) {
+                                           return access.writes
+                                                  && neededImages[std::to_underlying(
+                                                      access.image)];
+                                         })
+                  || std::ranges::any_of(pass.buffers, [&](auto const& access) {
+                       return access.writes
+                              && neededBuffers[std::to_underlying(access.buffer)];
+                     });
+    if (!keep[index]) {
+      continue;
+    }
+
+    // Overwriting all of an image hides what the passes before wrote to it.
+    for (auto const& access : pass.images) {
+      auto const image = std::to_underlying(access.image);
+      if (access.writes && !access.reads && access.baseLevel == 0
+          && access.levelCount == _images[image].levels.size()) {
+        neededImages[image] = false;
+      }
+    }
+    for (auto const& access : pass.buffers) {
+      if (access.writes && !access.reads) {
+        neededBuffers[std::to_underlying(access.buffer)] = false;
+      }
+    }
+    for (auto const& access : pass.images) {
+      if (access.reads) {
+        neededImages[std::to_underlying(access.image)] = true;
+      }
+    }
+    for (auto const& access : pass.buffers) {
+      if (access.reads) {
+        neededBuffers[std::to_underlying(access.buffer)] = true;
+      }
+    }
+  }
+  return keep;
+}
+
+auto pbr::RenderGraph::accessResource(ResourceState& state, ResourceUsage const usage,
+                                      bool const writes) noexcept
+    -> std::optional<Dependency> {
+  std::optional<Dependency> dependency = std::nullopt;
+  auto const transition = usage.layout != state.layout;
+  if (writes || transition) {
+    // Writes and layout transitions wait for every access since the last write.
+    if (transition || state.writeStages || state.readStages) {
+      dependency = {
+          .srcStages = state.writeStages | state.readStages,
+          .srcAccess = state.writeAccess,
+          .oldLayout = state.layout,
+      };
+    }
+    // A transition is a write done before the stages of the usage.
+    state = {
+        .layout = usage.layout,
+        .writeStages = usage.stages,
+        .writeAccess = writes ? usage.access & constants::WRITE_ACCESS
+                              : vk::AccessFlags2 {},
+        .readStages = writes ? vk::PipelineStageFlags2 {} : usage.stages,
+        .readAccess = writes ? vk::AccessFlags2 {} : usage.access,
+    };
+    return dependency;
+  }
+
+  // Reads only wait for the write if it is not visible to them already.
+  auto const visible =
+      !(usage.stages & ~state.readStages) && !(usage.access & ~state.readAccess);
+  if (state.writeStages && !visible) {
+    dependency = {
+        .srcStages = state.writeStages,
+        .srcAccess = state.writeAccess,
+        .oldLayout = state.layout,
+    };
+  }
+  state.readStages |= usage.stages;
+  state.readAccess |= usage.access;
+  return dependency;
+}
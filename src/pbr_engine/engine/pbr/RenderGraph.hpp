@@ -0,0 +1,277 @@
+#pragma once
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/GpuProfiler.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pbr {
+/**
+ * How a pass uses an image or a buffer.
+ */
+struct ResourceUsage {
+  vk::PipelineStageFlags2 stages {};
+  vk::AccessFlags2 access {};
+  /// The layout the image has to be in, buffers ignore it.
+  vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+};
+namespace usages {
+inline constexpr ResourceUsage COLOR_ATTACHMENT_WRITE {
+    .stages = vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+    .access = vk::AccessFlagBits2::eColorAttachmentWrite,
+    .layout = vk::ImageLayout::eColorAttachmentOptimal,
+};
+/// Attachments that are loaded before they are written.
+inline constexpr ResourceUsage COLOR_ATTACHMENT_LOAD {
+    .stages = vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+    .access = vk::AccessFlagBits2::eColorAttachmentRead
+              | vk::AccessFlagBits2::eColorAttachmentWrite,
+    .layout = vk::ImageLayout::eColorAttachmentOptimal,
+};
+inline constexpr ResourceUsage DEPTH_ATTACHMENT_WRITE {
+    .stages = vk::PipelineStageFlagBits2::eEarlyFragmentTests
+              | vk::PipelineStageFlagBits2::eLateFragmentTests,
+    .access = vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
+    .layout = vk::ImageLayout::eDepthAttachmentOptimal,
+};
+inline constexpr ResourceUsage DEPTH_ATTACHMENT_LOAD {
+    .stages = vk::PipelineStageFlagBits2::eEarlyFragmentTests
+              | vk::PipelineStageFlagBits2::eLateFragmentTests,
+    .access = vk::AccessFlagBits2::eDepthStencilAttachmentRead
+              | vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
+    .layout = vk::ImageLayout::eDepthAttachmentOptimal,
+};
+inline constexpr ResourceUsage FRAGMENT_SAMPLED_READ {
+    .stages = vk::PipelineStageFlagBits2::eFragmentShader,
+    .access = vk::AccessFlagBits2::eShaderSampledRead,
+    .layout = vk::ImageLayout::eShaderReadOnlyOptimal,
+};
+inline constexpr ResourceUsage COMPUTE_SAMPLED_READ {
+    .stages = vk::PipelineStageFlagBits2::eComputeShader,
+    .access = vk::AccessFlagBits2::eShaderSampledRead,
+    .layout = vk::ImageLayout::eShaderReadOnlyOptimal,
+};
+inline constexpr ResourceUsage COMPUTE_STORAGE_READ {
+    .stages = vk::PipelineStageFlagBits2::eComputeShader,
+    .access = vk::AccessFlagBits2::eShaderStorageRead,
+    .layout = vk::ImageLayout::eGeneral,
+};
+inline constexpr ResourceUsage COMPUTE_STORAGE_WRITE {
+    .stages = vk::PipelineStageFlagBits2::eComputeShader,
+    .access = vk::AccessFlagBits2::eShaderStorageWrite,
+    .layout = vk::ImageLayout::eGeneral,
+};
+inline constexpr ResourceUsage TRANSFER_READ {
+    .stages = vk::PipelineStageFlagBits2::eCopy,
+    .access = vk::AccessFlagBits2::eTransferRead,
+    .layout = vk::ImageLayout::eTransferSrcOptimal,
+};
+inline constexpr ResourceUsage TRANSFER_WRITE {
+    .stages = vk::PipelineStageFlagBits2::eCopy,
+    .access = vk::AccessFlagBits2::eTransferWrite,
+    .layout = vk::ImageLayout::eTransferDstOptimal,
+};
+/// The next use after presenting waits for every command, which includes the stages
+/// waiting on the acquire semaphore.
+inline constexpr ResourceUsage PRESENT {
+    .stages = vk::PipelineStageFlagBits2::eAllCommands,
+    .access = {},
+    .layout = vk::ImageLayout::ePresentSrcKHR,
+};
+} // namespace usages
+enum struct ImageHandle : std::uint32_t {};
+enum struct BufferHandle : std::uint32_t {};
+/**
+ * What the first pass of a frame finds in an image.
+ */
+enum struct ImageContents : std::uint8_t {
+  /// The image keeps the contents and the layout the previous frame left it with.
+  Preserve,
+  /// The image is fully overwritten, it is transitioned from the undefined layout.
+  Discard,
+};
+struct RenderGraphStats {
+  std::uint32_t passes {};
+  /// Passes that were dropped because nothing used what they wrote.
+  std::uint32_t culledPasses {};
+  std::uint32_t imageBarriers {};
+  std::uint32_t bufferBarriers {};
+  /// The pipeline barrier commands the barriers were batched into.
+  std::uint32_t barrierBatches {};
+};
+/**
+ * Records the passes of a frame with the barriers between them.
+ *
+ * Passes declare the images and buffers they use, the graph then drops the passes whose
+ * writes are never used, tracks the layout and the pending accesses of every mip level
+ * and records one pipeline barrier before every pass that needs any. The states images
+ * and buffers are left in carry over to the next frame, so the first passes of a frame
+ * wait for the last ones of the previous frame that used the same resources.
+ */
+class RenderGraph {
+public:
+  using RecordFunction = std::move_only_function<void(vk::CommandBuffer)>;
+  /**
+   * A pass with the barriers to record before it.
+   */
+  struct CompiledPass {
+    std::string name;
+    RecordFunction record;
+    std::vector<vk::ImageMemoryBarrier2> imageBarriers;
+    std::vector<vk::BufferMemoryBarrier2> bufferBarriers;
+  };
+  struct CompiledGraph {
+    std::vector<CompiledPass> passes;
+    /// Moves the exported images to their final usage.
+    std::vector<vk::ImageMemoryBarrier2> finalBarriers;
+  };
+
+private:
+  /// The accesses to a mip level or a buffer since it was last written.
+  struct ResourceState {
+    vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+    vk::PipelineStageFlags2 writeStages {};
+    vk::AccessFlags2 writeAccess {};
+    /// Reads after the write, they are visible to these stages and accesses.
+    vk::PipelineStageFlags2 readStages {};
+    vk::AccessFlags2 readAccess {};
+  };
+  /// What a barrier before an access waits for.
+  struct Dependency {
+    vk::PipelineStageFlags2 srcStages;
+    vk::AccessFlags2 srcAccess;
+    vk::ImageLayout oldLayout;
+
+    auto operator==(Dependency const&) const -> bool = default;
+  };
+  struct ImageResource {
+    vk::Image image;
+    vk::ImageAspectFlags aspect;
+    ImageContents contents;
+    std::vector<ResourceState> levels;
+    std::optional<ResourceUsage> exportUsage;
+  };
+  struct BufferResource {
+    vk::Buffer buffer;
+    ResourceState state;
+  };
+  struct ImageAccess {
+    ImageHandle image;
+    ResourceUsage usage;
+    std::uint32_t baseLevel;
+    std::uint32_t levelCount;
+    /// Whether the pass uses the previous contents.
+    bool reads;
+    bool writes;
+  };
+  struct BufferAccess {
+    BufferHandle buffer;
+    ResourceUsage usage;
+    bool reads;
+    bool writes;
+  };
+  struct Pass {
+    std::string name;
+    RecordFunction record;
+    std::vector<ImageAccess> images;
+    std::vector<BufferAccess> buffers;
+    bool sideEffects;
+  };
+
+  std::vector<ImageResource> _images;
+  std::vector<BufferResource> _buffers;
+  std::vector<Pass> _passes;
+  /// The states the previous compile left the images and buffers in.
+  std::unordered_map<VkImage, std::vector<ResourceState>> _imageStates;
+  std::unordered_map<VkBuffer, ResourceState> _bufferStates;
+  RenderGraphStats _stats;
+
+public:
+  /**
+   * Declares what a pass uses, a resource used twice by a pass is used in one layout.
+   */
+  class PassBuilder {
+    RenderGraph* _graph;
+    std::uint32_t _pass;
+
+  public:
+    PassBuilder(RenderGraph& graph, std::uint32_t pass) noexcept;
+
+    auto read(ImageHandle image, ResourceUsage usage, std::uint32_t baseLevel = 0,
+              std::uint32_t levelCount = vk::RemainingMipLevels) -> PassBuilder&;
+    auto write(ImageHandle image, ResourceUsage usage, std::uint32_t baseLevel = 0,
+               std::uint32_t levelCount = vk::RemainingMipLevels) -> PassBuilder&;
+    auto read(BufferHandle buffer, ResourceUsage usage) -> PassBuilder&;
+    auto write(BufferHandle buffer, ResourceUsage usage) -> PassBuilder&;
+    /**
+     * Keeps the pass even if nothing uses its writes, for passes writing resources the
+     * graph does not know about.
+     */
+    auto setSideEffects() -> PassBuilder&;
+  };
+
+  RenderGraph() = default;
+
+  /**
+   * @returns The handle of the image, importing it again returns the same handle.
+   */
+  auto importImage(vk::Image image, vk::ImageAspectFlags aspect,
+                   ImageContents contents = ImageContents::Preserve,
+                   std::uint32_t levelCount = 1) -> ImageHandle;
+  /**
+   * @returns The handle of the buffer, importing it again returns the same handle.
+   */
+  auto importBuffer(vk::Buffer buffer) -> BufferHandle;
+  /**
+   * Keeps the passes writing the image and moves it to the usage after the last one.
+   */
+  auto exportImage(ImageHandle image, ResourceUsage usage) -> void;
+  /**
+   * @param record Records the pass when the graph is executed.
+   */
+  auto addPass(std::string name, RecordFunction record) -> PassBuilder;
+
+  /**
+   * Culls the passes and computes their barriers. The declared passes and resources are
+   * cleared for the next frame.
+   */
+  [[nodiscard]]
+  auto compile() -> CompiledGraph;
+  /**
+   * Compiles the graph and records the passes with their barriers.
+   * @param profiler Times every pass, its frame has to be begun.
+   */
+  auto execute(vk::CommandBuffer cmdBuffer, GpuProfiler* profiler = nullptr) -> void;
+
+  /**
+   * @returns The stats of the last compile.
+   */
+  [[nodiscard]]
+  constexpr auto getStats() const noexcept -> RenderGraphStats;
+
+private:
+  auto addImageAccess(std::uint32_t pass, ImageAccess access) -> void;
+  auto addBufferAccess(std::uint32_t pass, BufferAccess access) -> void;
+  [[nodiscard]]
+  auto cullPasses() const -> std::vector<bool>;
+  /**
+   * Moves the state to the usage.
+   * @returns What the access has to wait for, if anything.
+   */
+  [[nodiscard]]
+  static auto accessResource(ResourceState& state, ResourceUsage usage,
+                             bool writes) noexcept -> std::optional<Dependency>;
+};
+} // namespace pbr
+
+/* IMPLEMENTATIONS */
+
+constexpr auto pbr::RenderGraph::getStats() const noexcept -> RenderGraphStats {
+  return _stats;
+}
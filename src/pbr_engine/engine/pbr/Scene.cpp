@@ -1,109 +1,444 @@
 #include "pbr/Scene.hpp"
 
 #include "pbr/CameraUniform.hpp"
+#include "pbr/Light.hpp"
 #include "pbr/Mesh.hpp"
 
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
 #include <generator>
 #include <memory>
 #include <optional>
 #include <span>
 #include <string>
+#include <string_view>
 #include <utility>
+#include <vector>
 
-pbr::Node::Node(std::pmr::string name, allocator_type alloc)
-    : _name(std::move(name), alloc), _children(alloc) {}
+#include <glm/ext/matrix_float3x3.hpp>
+#include <glm/ext/matrix_float3x4.hpp>
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/geometric.hpp>
+#include <glm/trigonometric.hpp>
 
-pbr::Node::Node(std::pmr::string name, Transform transform, allocator_type alloc)
-    : Node(std::move(name), alloc) {
-  _transform = transform;
+auto pbr::Node::getName() const noexcept -> std::pmr::string const& {
+  return _scene->_names[_scene->toDense(_handle)];
 }
 
-pbr::Node::Node(Node&& node, allocator_type alloc) noexcept
-    : _name(std::move(node._name), alloc)
-    , _children(std::move(node._children), alloc)
-    , _transform(node._transform)
-    , _mesh(std::move(node._mesh))
-    , _camera(std::move(node._camera)) {}
-
-auto pbr::Node::getName() const noexcept -> std::pmr::string const& { return _name; }
+auto pbr::Node::getParent() const noexcept -> std::optional<Node> {
+  auto const parent = _scene->_hierarchy[_scene->toDense(_handle)].parent;
+  if (parent == Scene::NO_NODE) {
+    return std::nullopt;
+  }
+  return Node(*_scene, _scene->_handles[parent]);
+}
 
-auto pbr::Node::getChildren() const noexcept -> std::span<Node const> {
-  return _children;
+auto pbr::Node::hasChildren() const noexcept -> bool {
+  return _scene->_hierarchy[_scene->toDense(_handle)].firstChild != Scene::NO_NODE;
 }
 
-auto pbr::Node::getChildren() noexcept -> std::span<Node> { return _children; }
+auto pbr::Node::iterateChildren() const -> std::generator<Node> {
+  for (auto child = _scene->_hierarchy[_scene->toDense(_handle)].firstChild;
+       child != Scene::NO_NODE; child = _scene->_hierarchy[child].nextSibling) {
+    co_yield Node(*_scene, _scene->_handles[child]);
+  }
+}
 
-auto pbr::Node::getTransform() const noexcept -> Transform { return _transform; }
+auto pbr::Node::getTransform() const noexcept -> Transform {
+  return _scene->_localTransforms[_scene->toDense(_handle)];
+}
 
 auto pbr::Node::setTransform(Transform transform) noexcept -> void {
-  _transform = transform;
+  auto const index = _scene->toDense(_handle);
+  _scene->_localTransforms[index] = transform;
+  _scene->markDirty(index);
 }
 
-auto pbr::Node::getMesh() const noexcept -> std::shared_ptr<Mesh> const& { return _mesh; }
+auto pbr::Node::getWorldMatrix() const noexcept -> glm::mat4x4 const& {
+  return _scene->_worldMatrices[_scene->toDense(_handle)];
+}
+
+auto pbr::Node::getMesh() const noexcept -> std::shared_ptr<Mesh> const& {
+  return _scene->_meshes[_scene->toDense(_handle)];
+}
 
 auto pbr::Node::setMesh(std::shared_ptr<Mesh> mesh) noexcept -> void {
-  _mesh = std::move(mesh);
+  _scene->_meshes[_scene->toDense(_handle)] = std::move(mesh);
 }
 
 auto pbr::Node::getCamera() const noexcept -> std::shared_ptr<CameraUniform> const& {
-  return _camera;
+  return _scene->_cameras[_scene->toDense(_handle)];
+}
+
+auto pbr::Node::setCamera(std::shared_ptr<CameraUniform> camera) -> void {
+  auto& slot = _scene->_cameras[_scene->toDense(_handle)];
+  if (slot == nullptr && camera != nullptr) {
+    _scene->_cameraNodes.push_back(_handle);
+    if (!_scene->_activeCamera.has_value()) {
+      _scene->_activeCamera = _handle;
+    }
+  } else if (slot != nullptr && camera == nullptr) {
+    _scene->forgetCamera(_handle);
+  }
+  slot = std::move(camera);
+}
+
+auto pbr::Node::getLight() const noexcept -> std::optional<Light> const& {
+  return _scene->_lights[_scene->toDense(_handle)];
+}
+
+auto pbr::Node::setLight(std::optional<Light> light) -> void {
+  auto& slot = _scene->_lights[_scene->toDense(_handle)];
+  if (!slot.has_value() && light.has_value()) {
+    _scene->_lightNodes.push_back(_handle);
+  } else if (slot.has_value() && !light.has_value()) {
+    std::erase(_scene->_lightNodes, _handle);
+  }
+  slot = light;
+}
+
+auto pbr::Node::addChild(std::string_view name, Transform transform) -> Node {
+  return {*_scene, _scene->insertNode(name, transform, _scene->toDense(_handle))};
+}
+
+pbr::Scene::Scene(allocator_type alloc)
+    : _slots(alloc)
+    , _freeSlots(alloc)
+    , _handles(alloc)
+    , _names(alloc)
+    , _hierarchy(alloc)
+    , _localTransforms(alloc)
+    , _worldMatrices(alloc)
+    , _normalMatrices(alloc)
+    , _meshes(alloc)
+    , _cameras(alloc)
+    , _lights(alloc)
+    , _dirtyFlags(alloc)
+    , _cameraNodes(alloc)
+    , _lightNodes(alloc)
+    , _dirtyNodes(alloc) {}
+
+auto pbr::Scene::getNodeCount() const noexcept -> std::uint32_t {
+  return static_cast<std::uint32_t>(_handles.size()) - _deadCount;
+}
+
+auto pbr::Scene::isValid(NodeHandle handle) const noexcept -> bool {
+  return handle.slot < _slots.size() && _slots[handle.slot].dense != NO_NODE
+         && _slots[handle.slot].generation == handle.generation;
+}
+
+auto pbr::Scene::getNode(NodeHandle handle) noexcept -> Node {
+  assert(isValid(handle));
+  return {*this, handle};
+}
+
+auto pbr::Scene::iterateTopLevelNodes() -> std::generator<Node> {
+  for (auto root = _firstRoot; root != NO_NODE; root = _hierarchy[root].nextSibling) {
+    co_yield Node(*this, _handles[root]);
+  }
+}
+
+auto pbr::Scene::iterateNodes() -> std::generator<Node> {
+  for (auto index = 0uz; index < _handles.size(); ++index) {
+    if (_handles[index].slot != NO_NODE) {
+      co_yield Node(*this, _handles[index]);
+    }
+  }
+}
+
+auto pbr::Scene::getCameraNodes() const noexcept -> std::span<NodeHandle const> {
+  return _cameraNodes;
+}
+
+auto pbr::Scene::getActiveCameraNode() const noexcept -> std::optional<NodeHandle> {
+  return _activeCamera;
+}
+
+auto pbr::Scene::getActiveCamera() const noexcept -> CameraUniform* {
+  if (!_activeCamera.has_value()) {
+    return nullptr;
+  }
+  return _cameras[toDense(*_activeCamera)].get();
+}
+
+auto pbr::Scene::setActiveCamera(NodeHandle handle) noexcept -> void {
+  assert(_cameras[toDense(handle)] != nullptr && "the node has no camera");
+  _activeCamera = handle;
+}
+
+auto pbr::Scene::getLightNodes() const noexcept -> std::span<NodeHandle const> {
+  return _lightNodes;
+}
+
+auto pbr::Scene::collectLights(std::vector<LightData>& lights) const -> void {
+  assert(_dirtyNodes.empty() && "updateWorldTransforms was not called");
+  lights.clear();
+  for (auto const handle : _lightNodes) {
+    auto const index = toDense(handle);
+    auto const& light = *_lights[index];
+    auto const& world = _worldMatrices[index];
+    lights.push_back({
+        .position = glm::vec3(world[3]),
+        .range = light.range,
+        .color = light.color,
+        .intensity = light.intensity,
+        // Lights shine down the -z axis of their node.
+        .direction = -glm::normalize(glm::vec3(world[2])),
+        .type = light.type,
+        .cosInnerCone = glm::cos(light.innerConeAngle),
+        .cosOuterCone = glm::cos(light.outerConeAngle),
+    });
+  }
 }
 
-auto pbr::Node::setCamera(std::shared_ptr<CameraUniform> camera) noexcept -> void {
-  _camera = std::move(camera);
+auto pbr::Scene::addNode(std::string_view name, Transform transform) -> Node {
+  return {*this, insertNode(name, transform, NO_NODE)};
 }
 
-auto pbr::Node::iterateChildren() const -> std::generator<Node const&> {
-  for (auto const& child : _children) {
-    co_yield std::ranges::elements_of(child.iterateChildren());
-    co_yield child;
+auto pbr::Scene::removeNode(NodeHandle handle) -> void {
+  auto const root = toDense(handle);
+  unlinkNode(root);
+
+  // The links of dead entries are kept intact until compaction so the walk still works.
+  for (auto node = root; node != NO_NODE; node = nextInSubtree(root, node)) {
+    killNode(node);
+  }
+
+  if (_deadCount > MIN_COMPACTION_THRESHOLD && _deadCount * 2 > _handles.size()) {
+    compact();
   }
 }
 
-auto pbr::Node::iterateChildren() -> std::generator<Node&> {
-  for (auto& child : _children) {
-    co_yield std::ranges::elements_of(child.iterateChildren());
-    co_yield child;
+auto pbr::Scene::updateWorldTransforms() -> TransformUpdateStats {
+  // Parents have smaller indices than their children, so after sorting an ancestor is
+  // always processed before its dirty descendants. Recomputing the ancestor subtree clears
+  // the descendants dirty flags which makes them get skipped.
+  std::ranges::sort(_dirtyNodes);
+
+  TransformUpdateStats stats {
+      .dirtyNodes = static_cast<std::uint32_t>(_dirtyNodes.size()),
+  };
+  for (auto const index : _dirtyNodes) {
+    if (_dirtyFlags[index] != 0) {
+      stats.recomputedMatrices += recomputeSubtree(index);
+    }
   }
+  _dirtyNodes.clear();
+
+  _lastUpdateStats = stats;
+  return stats;
+}
+
+auto pbr::Scene::getLastUpdateStats() const noexcept -> TransformUpdateStats {
+  return _lastUpdateStats;
+}
+
+auto pbr::Scene::getHandles() const noexcept -> std::span<NodeHandle const> {
+  return _handles;
+}
+
+auto pbr::Scene::getMeshes() const noexcept -> std::span<std::shared_ptr<Mesh> const> {
+  return _meshes;
+}
+
+auto pbr::Scene::getWorldMatrices() const noexcept -> std::span<glm::mat4x4 const> {
+  assert(_dirtyNodes.empty() && "updateWorldTransforms was not called");
+  return _worldMatrices;
 }
 
-auto pbr::Node::addChild(Node node) -> Node& {
-  _children.emplace_back(std::move(node));
-  return _children.back();
+auto pbr::Scene::getNormalMatrices() const noexcept -> std::span<glm::mat3x4 const> {
+  assert(_dirtyNodes.empty() && "updateWorldTransforms was not called");
+  return _normalMatrices;
 }
 
-pbr::Scene::Scene(allocator_type alloc) : _nodes(alloc) {}
+auto pbr::Scene::toDense(NodeHandle handle) const noexcept -> std::uint32_t {
+  assert(isValid(handle) && "the node was removed");
+  return _slots[handle.slot].dense;
+}
+
+auto pbr::Scene::insertNode(std::string_view name, Transform transform,
+                            std::uint32_t parent) -> NodeHandle {
+  auto const index = static_cast<std::uint32_t>(_handles.size());
+
+  std::uint32_t slot {};
+  if (_freeSlots.empty()) {
+    slot = static_cast<std::uint32_t>(_slots.size());
+    _slots.emplace_back();
+  } else {
+    slot = _freeSlots.back();
+    _freeSlots.pop_back();
+  }
+  _slots[slot].dense = index;
+  NodeHandle const handle {.slot = slot, .generation = _slots[slot].generation};
+
+  _handles.push_back(handle);
+  _names.emplace_back(name);
+  _hierarchy.push_back({.parent = parent});
+  _localTransforms.push_back(transform);
+  _worldMatrices.emplace_back(1.0f);
+  _normalMatrices.emplace_back(1.0f);
+  _meshes.emplace_back();
+  _cameras.emplace_back();
+  _lights.emplace_back();
+  _dirtyFlags.push_back(0);
 
-auto pbr::Scene::iterateAllNodes() const -> std::generator<Node const&> {
-  for (auto const& node : _nodes) {
-    co_yield std::ranges::elements_of(node.iterateChildren());
-    co_yield node;
+  // Link the node as the last child of its parent (or as the last root).
+  auto& first = parent == NO_NODE ? _firstRoot : _hierarchy[parent].firstChild;
+  auto& last = parent == NO_NODE ? _lastRoot : _hierarchy[parent].lastChild;
+  if (last == NO_NODE) {
+    first = index;
+  } else {
+    _hierarchy[last].nextSibling = index;
+    _hierarchy[index].previousSibling = last;
   }
+  last = index;
+
+  markDirty(index);
+  return handle;
 }
 
-auto pbr::Scene::iterateAllNodes() -> std::generator<Node&> {
-  for (auto& node : _nodes) {
-    co_yield std::ranges::elements_of(node.iterateChildren());
-    co_yield node;
+auto pbr::Scene::unlinkNode(std::uint32_t index) noexcept -> void {
+  auto& links = _hierarchy[index];
+  auto& first = links.parent == NO_NODE ? _firstRoot : _hierarchy[links.parent].firstChild;
+  auto& last = links.parent == NO_NODE ? _lastRoot : _hierarchy[links.parent].lastChild;
+
+  if (links.previousSibling == NO_NODE) {
+    first = links.nextSibling;
+  } else {
+    _hierarchy[links.previousSibling].nextSibling = links.nextSibling;
+  }
+  if (links.nextSibling == NO_NODE) {
+    last = links.previousSibling;
+  } else {
+    _hierarchy[links.nextSibling].previousSibling = links.previousSibling;
   }
+
+  // The parent link is kept, it is needed to tell where a removed subtree ends.
+  links.previousSibling = NO_NODE;
+  links.nextSibling = NO_NODE;
 }
 
-auto pbr::Scene::getTopLevelNodes() const noexcept -> std::span<Node const> {
-  return _nodes;
+auto pbr::Scene::killNode(std::uint32_t index) noexcept -> void {
+  auto& slot = _slots[_handles[index].slot];
+  slot.dense = NO_NODE;
+  ++slot.generation;
+  _freeSlots.push_back(_handles[index].slot);
+
+  if (_cameras[index] != nullptr) {
+    forgetCamera(_handles[index]);
+    _cameras[index].reset();
+  }
+  if (_lights[index].has_value()) {
+    std::erase(_lightNodes, _handles[index]);
+    _lights[index].reset();
+  }
+  _handles[index] = {};
+  _names[index].clear();
+  _meshes[index].reset();
+  _dirtyFlags[index] = 0;
+  ++_deadCount;
 }
 
-auto pbr::Scene::getTopLevelNodes() noexcept -> std::span<Node> { return _nodes; }
+auto pbr::Scene::compact() -> void {
+  std::pmr::vector<std::uint32_t> remap(_handles.size(), NO_NODE,
+                                        _handles.get_allocator());
+  std::uint32_t liveCount {};
+  for (auto index = 0uz; index < _handles.size(); ++index) {
+    if (_handles[index].slot != NO_NODE) {
+      remap[index] = liveCount++;
+    }
+  }
 
-auto pbr::Scene::findCamera() const -> std::optional<std::shared_ptr<CameraUniform>> {
-  for (const auto& node : iterateAllNodes()) {
-    if (auto const& camera = node.getCamera(); camera) {
-      return camera;
+  // Entries only ever move towards the front so moving in order never overwrites a live
+  // entry that was not moved yet.
+  auto const compactArray = [&](auto& array) {
+    for (auto index = 0uz; index < array.size(); ++index) {
+      if (remap[index] != NO_NODE && remap[index] != index) {
+        array[remap[index]] = std::move(array[index]);
+      }
     }
+    array.erase(array.begin() + liveCount, array.end());
+  };
+  compactArray(_handles);
+  compactArray(_names);
+  compactArray(_hierarchy);
+  compactArray(_localTransforms);
+  compactArray(_worldMatrices);
+  compactArray(_normalMatrices);
+  compactArray(_meshes);
+  compactArray(_cameras);
+  compactArray(_lights);
+  compactArray(_dirtyFlags);
+
+  auto const remapLink = [&](std::uint32_t link) {
+    return link == NO_NODE ? NO_NODE : remap[link];
+  };
+  for (auto index = 0u; index < liveCount; ++index) {
+    _slots[_handles[index].slot].dense = index;
+
+    auto& links = _hierarchy[index];
+    links.parent = remapLink(links.parent);
+    links.firstChild = remapLink(links.firstChild);
+    links.lastChild = remapLink(links.lastChild);
+    links.previousSibling = remapLink(links.previousSibling);
+    links.nextSibling = remapLink(links.nextSibling);
+  }
+  _firstRoot = remapLink(_firstRoot);
+  _lastRoot = remapLink(_lastRoot);
+
+  std::erase_if(_dirtyNodes, [&](std::uint32_t index) { return remap[index] == NO_NODE; });
+  std::ranges::transform(_dirtyNodes, _dirtyNodes.begin(), remapLink);
+
+  _deadCount = 0;
+}
+
+auto pbr::Scene::markDirty(std::uint32_t index) -> void {
+  if (_dirtyFlags[index] == 0) {
+    _dirtyFlags[index] = 1;
+    _dirtyNodes.push_back(index);
   }
-  return std::nullopt;
 }
 
-auto pbr::Scene::addNode(Node node) -> Node& {
-  _nodes.emplace_back(std::move(node));
-  return _nodes.back();
+auto pbr::Scene::forgetCamera(NodeHandle handle) noexcept -> void {
+  std::erase(_cameraNodes, handle);
+  if (_activeCamera == handle) {
+    _activeCamera = _cameraNodes.empty() ? std::nullopt
+                                         : std::optional<NodeHandle>(_cameraNodes.front());
+  }
+}
+
+auto pbr::Scene::nextInSubtree(std::uint32_t const root, std::uint32_t node) const noexcept
+    -> std::uint32_t {
+  if (_hierarchy[node].firstChild != NO_NODE) {
+    return _hierarchy[node].firstChild;
+  }
+  while (node != root && _hierarchy[node].nextSibling == NO_NODE) {
+    node = _hierarchy[node].parent;
+  }
+  return node == root ? NO_NODE : _hierarchy[node].nextSibling;
+}
+
+auto pbr::Scene::recomputeWorldTransform(std::uint32_t index) noexcept -> void {
+  auto const parent = _hierarchy[index].parent;
+  auto const local = _localTransforms[index];
+  if (parent == NO_NODE) {
+    _worldMatrices[index] = pbr::toMatrix(local);
+    _normalMatrices[index] = glm::mat3x4(pbr::toNormalMatrix(local));
+  } else {
+    _worldMatrices[index] = _worldMatrices[parent] * pbr::toMatrix(local);
+    _normalMatrices[index] = glm::mat3x4(glm::mat3x3(_normalMatrices[parent])
+                                         * pbr::toNormalMatrix(local));
+  }
+  _dirtyFlags[index] = 0;
+}
+
+auto pbr::Scene::recomputeSubtree(std::uint32_t const root) noexcept -> std::uint32_t {
+  std::uint32_t count {};
+  for (auto node = root; node != NO_NODE; node = nextInSubtree(root, node)) {
+    recomputeWorldTransform(node);
+    ++count;
+  }
+  return count;
 }
@@ -1,19 +1,27 @@
 #pragma once
 
 #include "pbr/CameraUniform.hpp"
+#include "pbr/Light.hpp"
 #include "pbr/Mesh.hpp"
 
+#include <cstdint>
 #include <generator>
+#include <limits>
 #include <memory>
 #include <memory_resource>
 #include <optional>
 #include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include <glm/ext/matrix_float3x3.hpp>
+#include <glm/ext/matrix_float3x4.hpp>
+#include <glm/ext/matrix_float4x4.hpp>
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/ext/quaternion_float.hpp>
 #include <glm/ext/vector_float3.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 namespace pbr {
 struct Transform {
@@ -21,41 +29,83 @@ struct Transform {
   glm::quat rotation = glm::identity<glm::quat>();
   glm::vec3 scale {1.0f};
 };
-class Node {
-  std::pmr::string _name;
-  std::pmr::vector<Node> _children;
-  Transform _transform {};
-  std::shared_ptr<Mesh> _mesh = nullptr;
-  std::shared_ptr<CameraUniform> _camera = nullptr;
+/**
+ * Creates the model matrix described by the transform.
+ */
+[[nodiscard]]
+constexpr auto toMatrix(Transform transform) noexcept -> glm::mat4x4;
+/**
+ * Creates the matrix that transforms normals for the transform.
+ * @note Because the rotation is orthonormal this is R * S^-1 and needs no inverse.
+ */
+[[nodiscard]]
+constexpr auto toNormalMatrix(Transform transform) noexcept -> glm::mat3x3;
 
-public:
-  using allocator_type = std::pmr::polymorphic_allocator<>;
+/**
+ * Counters describing the work done by a single Scene::updateWorldTransforms call.
+ */
+struct TransformUpdateStats {
+  /// The number of nodes whose local transform changed since the last update.
+  std::uint32_t dirtyNodes {};
+  /// The number of world and normal matrices that were recomputed.
+  std::uint32_t recomputedMatrices {};
+};
 
-  explicit Node(std::pmr::string name, allocator_type alloc = {});
-  explicit Node(std::pmr::string name, Transform transform, allocator_type alloc = {});
+/**
+ * Stable reference to a node inside a Scene.
+ *
+ * A handle stays valid across insertions, removals and internal compaction of the scene
+ * and can be checked for validity with Scene::isValid once its node has been removed.
+ */
+struct NodeHandle {
+  /// Index of the slot in the scene slot map.
+  std::uint32_t slot = std::numeric_limits<std::uint32_t>::max();
+  /// Generation of the slot when the handle was created.
+  std::uint32_t generation {};
 
-  Node(const Node&) = delete;
-  auto operator=(const Node&) -> Node& = delete;
+  [[nodiscard]]
+  constexpr auto operator==(NodeHandle const&) const noexcept -> bool = default;
+};
 
-  Node(Node&& node, allocator_type alloc = {}) noexcept;
-  auto operator=(Node&&) -> Node& = default;
+class Scene;
+/**
+ * Non owning view of a single node stored inside a Scene.
+ * @note Views are cheap to copy and stay valid for as long as the scene is not moved and
+ * the node is not removed.
+ */
+class Node {
+  Scene* _scene;
+  NodeHandle _handle;
 
-  ~Node() = default;
+public:
+  constexpr Node(Scene& scene, NodeHandle handle) noexcept;
+
+  [[nodiscard]]
+  constexpr auto getHandle() const noexcept -> NodeHandle;
 
   [[nodiscard]]
   auto getName() const noexcept -> std::pmr::string const&;
 
   [[nodiscard]]
-  auto getChildren() const noexcept -> std::span<Node const>;
+  auto getParent() const noexcept -> std::optional<Node>;
 
   [[nodiscard]]
-  auto getChildren() noexcept -> std::span<Node>;
+  auto hasChildren() const noexcept -> bool;
+
+  [[nodiscard]]
+  auto iterateChildren() const -> std::generator<Node>;
 
   [[nodiscard]]
   auto getTransform() const noexcept -> Transform;
 
+  /**
+   * Sets the local transform and marks the subtree of this node as dirty.
+   */
   auto setTransform(Transform) noexcept -> void;
 
+  [[nodiscard]]
+  auto getWorldMatrix() const noexcept -> glm::mat4x4 const&;
+
   [[nodiscard]]
   auto getMesh() const noexcept -> std::shared_ptr<Mesh> const&;
 
@@ -64,53 +114,271 @@ public:
   [[nodiscard]]
   auto getCamera() const noexcept -> std::shared_ptr<CameraUniform> const&;
 
-  auto setCamera(std::shared_ptr<CameraUniform>) noexcept -> void;
+  /**
+   * Sets the camera of the node, nodes with a camera are indexed by the scene.
+   */
+  auto setCamera(std::shared_ptr<CameraUniform>) -> void;
 
   [[nodiscard]]
-  auto iterateChildren() const -> std::generator<Node const&>;
+  auto getLight() const noexcept -> std::optional<Light> const&;
 
-  [[nodiscard]]
-  auto iterateChildren() -> std::generator<Node&>;
+  /**
+   * Sets the light of the node, nodes with a light are indexed by the scene.
+   */
+  auto setLight(std::optional<Light>) -> void;
 
   /**
-   * Adds a new node to the tree that will be this nodes child.
-   * @returns A reference to the newly added node.
-   *
-   * @note Every time this is called anything that references any child of this node will
-   * be invalidated.
+   * Adds a new node to the scene that will be this nodes last child.
+   * @returns A view of the newly added node.
    */
-  auto addChild(Node) -> Node&;
+  auto addChild(std::string_view name, Transform transform = {}) -> Node;
+
+  [[nodiscard]]
+  constexpr auto operator==(Node const&) const noexcept -> bool = default;
 };
+/**
+ * Flat storage of a node hierarchy.
+ *
+ * Every node property is kept in its own dense array (structure of arrays). Nodes are
+ * addressed through generational handles that go through a slot map, so they stay valid
+ * while the dense arrays change. A parent always has a smaller dense index than any of
+ * its children.
+ *
+ * Removed nodes are only marked as dead and the dense arrays get compacted once enough of
+ * them accumulate, which keeps removal amortized O(1) per node.
+ *
+ * World matrices are cached and only the subtrees of nodes whose local transform changed
+ * get recomputed, so the update cost is proportional to the changed nodes and not to the
+ * size of the scene.
+ *
+ * Nodes with a camera are tracked separately so finding the active camera never needs to
+ * look at the whole scene, the same goes for nodes with a light.
+ */
 class Scene {
-  std::pmr::vector<Node> _nodes;
-
 public:
   using allocator_type = std::pmr::polymorphic_allocator<>;
 
+  /// Index used to mark the absence of a node.
+  static constexpr auto NO_NODE = std::numeric_limits<std::uint32_t>::max();
+  /// Dead nodes that are always tolerated before compacting.
+  static constexpr std::uint32_t MIN_COMPACTION_THRESHOLD = 64;
+
+private:
+  /**
+   * Links of a node to its neighbours in the hierarchy, all of these are dense indices.
+   */
+  struct Hierarchy {
+    std::uint32_t parent = NO_NODE;
+    std::uint32_t firstChild = NO_NODE;
+    std::uint32_t lastChild = NO_NODE;
+    std::uint32_t previousSibling = NO_NODE;
+    std::uint32_t nextSibling = NO_NODE;
+  };
+  struct Slot {
+    /// Dense index of the node or NO_NODE if the slot is free.
+    std::uint32_t dense = NO_NODE;
+    std::uint32_t generation {};
+  };
+
+  std::pmr::vector<Slot> _slots;
+  std::pmr::vector<std::uint32_t> _freeSlots;
+
+  /// Handle of every dense entry, dead entries hold a default handle.
+  std::pmr::vector<NodeHandle> _handles;
+  std::pmr::vector<std::pmr::string> _names;
+  std::pmr::vector<Hierarchy> _hierarchy;
+  std::pmr::vector<Transform> _localTransforms;
+  std::pmr::vector<glm::mat4x4> _worldMatrices;
+  // This has to be a 3x4 matrix because of glsl alignment rules
+  std::pmr::vector<glm::mat3x4> _normalMatrices;
+  std::pmr::vector<std::shared_ptr<Mesh>> _meshes;
+  std::pmr::vector<std::shared_ptr<CameraUniform>> _cameras;
+  std::pmr::vector<std::optional<Light>> _lights;
+
+  /// Whether the node is in _dirtyNodes, used to skip subtrees already recomputed.
+  std::pmr::vector<std::uint8_t> _dirtyFlags;
+
+  std::uint32_t _firstRoot = NO_NODE;
+  std::uint32_t _lastRoot = NO_NODE;
+  std::uint32_t _deadCount {};
+  /// Every node that has a camera in the order the cameras were set.
+  std::pmr::vector<NodeHandle> _cameraNodes;
+  std::optional<NodeHandle> _activeCamera = std::nullopt;
+  /// Every node that has a light in the order the lights were set.
+  std::pmr::vector<NodeHandle> _lightNodes;
+  /// Nodes whose local transform changed since the last update.
+  std::pmr::vector<std::uint32_t> _dirtyNodes;
+  TransformUpdateStats _lastUpdateStats {};
+
+public:
   explicit Scene(allocator_type alloc = {});
 
+  /**
+   * @returns The number of live nodes.
+   */
+  [[nodiscard]]
+  auto getNodeCount() const noexcept -> std::uint32_t;
+
+  [[nodiscard]]
+  auto isValid(NodeHandle handle) const noexcept -> bool;
+
+  /**
+   * @returns A view of the node.
+   * @note The handle has to be valid.
+   */
   [[nodiscard]]
-  auto iterateAllNodes() const -> std::generator<Node const&>;
+  auto getNode(NodeHandle handle) noexcept -> Node;
 
   [[nodiscard]]
-  auto iterateAllNodes() -> std::generator<Node&>;
+  auto iterateTopLevelNodes() -> std::generator<Node>;
 
+  /**
+   * Iterates over every live node in parent before child order.
+   */
   [[nodiscard]]
-  auto getTopLevelNodes() const noexcept -> std::span<Node const>;
+  auto iterateNodes() -> std::generator<Node>;
 
+  /**
+   * @returns Handles of every node that has a camera.
+   */
   [[nodiscard]]
-  auto getTopLevelNodes() noexcept -> std::span<Node>;
+  auto getCameraNodes() const noexcept -> std::span<NodeHandle const>;
 
+  /**
+   * @returns The node of the active camera.
+   * @note If no camera was explicitly selected the first added camera is active.
+   */
   [[nodiscard]]
-  auto findCamera() const -> std::optional<std::shared_ptr<CameraUniform>>;
+  auto getActiveCameraNode() const noexcept -> std::optional<NodeHandle>;
 
   /**
-   * Adds a new top level node to the scene.
-   * @returns A reference to the newly added node.
+   * @returns The active camera or a nullptr if the scene has no cameras.
+   */
+  [[nodiscard]]
+  auto getActiveCamera() const noexcept -> CameraUniform*;
+
+  /**
+   * Selects the camera used for rendering.
+   * @note The node has to have a camera.
+   */
+  auto setActiveCamera(NodeHandle handle) noexcept -> void;
+
+  /**
+   * @returns Handles of every node that has a light.
+   */
+  [[nodiscard]]
+  auto getLightNodes() const noexcept -> std::span<NodeHandle const>;
+
+  /**
+   * Replaces the contents of lights with the world space lights of the scene.
    *
-   * @note Every time this is called anything that references any top level node will
-   * be invalidated.
+   * The lights keep their order until a light is added or removed, so a light that did
+   * not change between two calls ends up at the same index.
+   * @note The world transforms have to be up to date.
+   */
+  auto collectLights(std::vector<LightData>& lights) const -> void;
+
+  /**
+   * Adds a new top level node to the scene.
+   * @returns A view of the newly added node.
+   */
+  auto addNode(std::string_view name, Transform transform = {}) -> Node;
+
+  /**
+   * Removes the node and all of its descendants, their handles become invalid and their
+   * slots get reused by later insertions.
+   * @note This may compact the dense arrays which invalidates previously returned spans.
+   */
+  auto removeNode(NodeHandle handle) -> void;
+
+  /**
+   * Recomputes the world and normal matrices of every dirty node and its descendants.
+   * @returns Counters of the performed work, these are also kept until the next update.
+   * @note This has to be called before the matrices are read after any transform change.
+   */
+  auto updateWorldTransforms() -> TransformUpdateStats;
+
+  [[nodiscard]]
+  auto getLastUpdateStats() const noexcept -> TransformUpdateStats;
+
+  /* WHOLE SCENE ACCESS */
+
+  /**
+   * @note The whole scene spans are indexed by dense indices and can contain dead entries,
+   * those never have a mesh.
+   */
+  [[nodiscard]]
+  auto getHandles() const noexcept -> std::span<NodeHandle const>;
+
+  [[nodiscard]]
+  auto getMeshes() const noexcept -> std::span<std::shared_ptr<Mesh> const>;
+
+  [[nodiscard]]
+  auto getWorldMatrices() const noexcept -> std::span<glm::mat4x4 const>;
+
+  [[nodiscard]]
+  auto getNormalMatrices() const noexcept -> std::span<glm::mat3x4 const>;
+
+private:
+  [[nodiscard]]
+  auto toDense(NodeHandle handle) const noexcept -> std::uint32_t;
+  auto insertNode(std::string_view name, Transform transform, std::uint32_t parent)
+      -> NodeHandle;
+  auto unlinkNode(std::uint32_t index) noexcept -> void;
+  /**
+   * Marks the dense entry as dead and frees its slot.
+   */
+  auto killNode(std::uint32_t index) noexcept -> void;
+  /**
+   * Removes every dead entry from the dense arrays while keeping the order of the live
+   * ones.
+   */
+  auto compact() -> void;
+  auto markDirty(std::uint32_t index) -> void;
+  /**
+   * Removes the node from the camera index and picks a new active camera if needed.
    */
-  auto addNode(Node) -> Node&;
+  auto forgetCamera(NodeHandle handle) noexcept -> void;
+  /**
+   * @returns The node after node in a pre-order walk of the subtree rooted at root or
+   * NO_NODE if the walk is done.
+   */
+  [[nodiscard]]
+  auto nextInSubtree(std::uint32_t root, std::uint32_t node) const noexcept
+      -> std::uint32_t;
+  /**
+   * Recomputes the matrices of the node at index from its parent.
+   */
+  auto recomputeWorldTransform(std::uint32_t index) noexcept -> void;
+  /**
+   * Recomputes the matrices of the whole subtree rooted at index.
+   * @returns The number of recomputed nodes.
+   */
+  auto recomputeSubtree(std::uint32_t root) noexcept -> std::uint32_t;
+
+  friend class Node;
 };
 } // namespace pbr
+
+/* IMPLEMENTATIONS */
+
+constexpr auto pbr::toMatrix(Transform const transform) noexcept -> glm::mat4x4 {
+  auto const mTranslation = glm::translate(glm::mat4x4 {1.0f}, transform.position);
+  auto const mRotation = glm::mat4_cast(transform.rotation);
+  auto const mScale = glm::scale(glm::mat4x4 {1.0f}, transform.scale);
+  return mTranslation * mRotation * mScale;
+}
+
+constexpr auto pbr::toNormalMatrix(Transform const transform) noexcept -> glm::mat3x3 {
+  auto const mRotation = glm::mat3_cast(transform.rotation);
+  return {
+      mRotation[0] / transform.scale.x,
+      mRotation[1] / transform.scale.y,
+      mRotation[2] / transform.scale.z,
+  };
+}
+
+constexpr pbr::Node::Node(Scene& scene, NodeHandle handle) noexcept
+    : _scene(&scene), _handle(handle) {}
+
+constexpr auto pbr::Node::getHandle() const noexcept -> NodeHandle { return _handle; }
@@ -0,0 +1,489 @@
+#include "pbr/SoftwareOcclusionCuller.hpp"
+
+#include "pbr/CpuKernels.hpp"
+#include "pbr/DepthPyramidSystem.hpp"
+#include "pbr/Frustum.hpp"
+#include "pbr/Mesh.hpp"
+#include "pbr/Scene.hpp"
+#include "pbr/ThreadPool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <ranges>
+#include <span>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <glm/common.hpp>
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/vector_float2.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+#include <glm/ext/vector_int2.hpp>
+#include <glm/geometric.hpp>
+#include <glm/vector_relational.hpp>
+
+#ifdef PBR_AVX2_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace constants {
+static constexpr float FAR_DEPTH = 1.0f;
+static constexpr auto TILES_PER_ROW =
+    pbr::SoftwareOcclusionCuller::WIDTH / pbr::SoftwareOcclusionCuller::TILE_WIDTH;
+static constexpr auto LANES =
+    static_cast<std::int32_t>(pbr::SoftwareOcclusionCuller::LANES);
+static constexpr std::uint8_t LEFT_SIDE = 0b01;
+static constexpr std::uint8_t RIGHT_SIDE = 0b10;
+} // namespace constants
+
+namespace {
+/**
+ * @returns The plane a * x + b * y + c that is positive on the left of the edge from a
+ * to b and grows with the distance to it.
+ */
+[[nodiscard]]
+constexpr auto makeEdge(glm::vec3 const a, glm::vec3 const b) noexcept -> glm::vec3 {
+  auto const x = a.y - b.y;
+  auto const y = b.x - a.x;
+  return {x, y, -((x * a.x) + (y * a.y))};
+}
+/**
+ * @returns The pixel coordinates of a clip space position in front of the camera with
+ * its depth in z.
+ */
+[[nodiscard]]
+auto toScreen(glm::vec4 const clip) noexcept -> glm::vec3 {
+  auto const ndc = glm::vec3(clip) / clip.w;
+  return {((ndc.x * 0.5f) + 0.5f) * pbr::SoftwareOcclusionCuller::WIDTH,
+          ((ndc.y * 0.5f) + 0.5f) * pbr::SoftwareOcclusionCuller::HEIGHT, ndc.z};
+}
+[[nodiscard]]
+constexpr auto makeEdgeKey(std::uint32_t const first, std::uint32_t const second) noexcept
+    -> std::uint64_t {
+  return (static_cast<std::uint64_t>(first) << 32) | second;
+}
+/**
+ * Writes the nearer depth of a triangle to the pixels of the row from firstX, a multiple
+ * of LANES, to lastX. The edges exclude the pixels outside of the triangle.
+ */
+auto rasterizeRowScalar(std::array<glm::vec3, 3> const& edges, glm::vec3 const depth,
+                        float* const row, std::int32_t const firstX,
+                        std::int32_t const lastX, float const y) noexcept -> void {
+  auto const evaluate = [y](glm::vec3 const plane, float const pixelX) {
+    return (plane.x * pixelX) + ((plane.y * y) + plane.z);
+  };
+  for (auto x = firstX; x <= lastX; x += constants::LANES) {
+    for (auto lane = 0; lane < constants::LANES; ++lane) {
+      auto const pixelX = static_cast<float>(x) + (static_cast<float>(lane) + 0.5f);
+      if (std::ranges::all_of(edges, [&](glm::vec3 const edge) {
+            return evaluate(edge, pixelX) >= 0.0f;
+          })) {
+        row[x + lane] = std::min(row[x + lane], evaluate(depth, pixelX));
+      }
+    }
+  }
+}
+/**
+ * @returns Whether any pixel of the row from first to last is not in front of depth.
+ * @param alignedX first rounded down to a multiple of LANES.
+ */
+[[nodiscard]]
+auto isAnyPixelVisibleScalar(float const* const row, std::int32_t const alignedX,
+                             std::int32_t const first, std::int32_t const last,
+                             float const depth) noexcept -> bool {
+  for (auto x = alignedX; x <= last; x += constants::LANES) {
+    for (auto lane = 0; lane < constants::LANES; ++lane) {
+      if (x + lane >= first && x + lane <= last && row[x + lane] >= depth) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+#ifdef PBR_AVX2_KERNELS
+// Lambdas are not compiled for the target of the function around them, so the AVX2
+// kernels only call functions of their own target.
+[[nodiscard]]
+PBR_TARGET_AVX2
+auto evaluateAvx2(glm::vec3 const plane, __m256 const pixelX, float const y) noexcept
+    -> __m256 {
+  return _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), pixelX),
+                       _mm256_set1_ps((plane.y * y) + plane.z));
+}
+[[nodiscard]]
+PBR_TARGET_AVX2
+auto isInsideAvx2(glm::vec3 const edge, __m256 const pixelX, float const y) noexcept
+    -> __m256 {
+  return _mm256_cmp_ps(::evaluateAvx2(edge, pixelX, y), _mm256_setzero_ps(), _CMP_GE_OQ);
+}
+/**
+ * The LANES wide rasterizeRowScalar.
+ */
+PBR_TARGET_AVX2
+auto rasterizeRowAvx2(std::array<glm::vec3, 3> const& edges, glm::vec3 const depth,
+                      float* const row, std::int32_t const firstX,
+                      std::int32_t const lastX, float const y) noexcept -> void {
+  auto const laneCenters = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+  for (auto x = firstX; x <= lastX; x += constants::LANES) {
+    auto const pixelX = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), laneCenters);
+    auto const inside =
+        _mm256_and_ps(::isInsideAvx2(edges[0], pixelX, y),
+                      _mm256_and_ps(::isInsideAvx2(edges[1], pixelX, y),
+                                    ::isInsideAvx2(edges[2], pixelX, y)));
+    auto* const pixels = row + x;
+    auto const current = _mm256_loadu_ps(pixels);
+    auto const nearer = _mm256_min_ps(current, ::evaluateAvx2(depth, pixelX, y));
+    _mm256_storeu_ps(pixels, _mm256_blendv_ps(current, nearer, inside));
+  }
+}
+/**
+ * The LANES wide isAnyPixelVisibleScalar.
+ */
+[[nodiscard]]
+PBR_TARGET_AVX2
+auto isAnyPixelVisibleAvx2(float const* const row, std::int32_t const alignedX,
+                           std::int32_t const first, std::int32_t const last,
+                           float const depth) noexcept -> bool {
+  auto const laneOffsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  for (auto x = alignedX; x <= last; x += constants::LANES) {
+    auto const lanes = _mm256_add_epi32(_mm256_set1_epi32(x), laneOffsets);
+    auto const inside =
+        _mm256_and_si256(_mm256_cmpgt_epi32(lanes, _mm256_set1_epi32(first - 1)),
+                         _mm256_cmpgt_epi32(_mm256_set1_epi32(last + 1), lanes));
+    auto const visible =
+        _mm256_cmp_ps(_mm256_loadu_ps(row + x), _mm256_set1_ps(depth), _CMP_GE_OQ);
+    if (_mm256_movemask_ps(_mm256_and_ps(visible, _mm256_castsi256_ps(inside))) != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+#endif
+auto rasterizeRow(pbr::CpuKernels const kernels, std::array<glm::vec3, 3> const& edges,
+                  glm::vec3 const depth, float* const row, std::int32_t const firstX,
+                  std::int32_t const lastX, float const y) noexcept -> void {
+#ifdef PBR_AVX2_KERNELS
+  if (kernels == pbr::CpuKernels::Avx2) {
+    ::rasterizeRowAvx2(edges, depth, row, firstX, lastX, y);
+    return;
+  }
+#endif
+  ::rasterizeRowScalar(edges, depth, row, firstX, lastX, y);
+}
+[[nodiscard]]
+auto isAnyPixelVisible(pbr::CpuKernels const kernels, float const* const row,
+                       std::int32_t const alignedX, std::int32_t const first,
+                       std::int32_t const last, float const depth) noexcept -> bool {
+#ifdef PBR_AVX2_KERNELS
+  if (kernels == pbr::CpuKernels::Avx2) {
+    return ::isAnyPixelVisibleAvx2(row, alignedX, first, last, depth);
+  }
+#endif
+  return ::isAnyPixelVisibleScalar(row, alignedX, first, last, depth);
+}
+} // namespace
+
+pbr::SoftwareOcclusionCuller::SoftwareOcclusionCuller(CpuKernels const kernels)
+    : _kernels(pbr::getSupportedCpuKernels(kernels))
+    , _depth(static_cast<std::size_t>(WIDTH) * HEIGHT, constants::FAR_DEPTH) {}
+
+auto pbr::SoftwareOcclusionCuller::getKernels() const noexcept -> CpuKernels {
+  return _kernels;
+}
+
+auto pbr::SoftwareOcclusionCuller::clear() noexcept -> void {
+  std::ranges::fill(_depth, constants::FAR_DEPTH);
+  _stats = {};
+}
+
+auto pbr::SoftwareOcclusionCuller::rasterize(glm::mat4x4 const& viewProj,
+                                             std::span<Occluder const> const occluders,
+                                             ThreadPool* const threadPool) -> void {
+  _triangles.clear();
+  for (auto const& occluder : occluders) {
+    setupOccluder(viewProj * occluder.model, *occluder.mesh);
+  }
+  _stats.occluders += static_cast<std::uint32_t>(occluders.size());
+  _stats.occluderTriangles += static_cast<std::uint32_t>(_triangles.size());
+
+  // Every tile only writes its own pixels, so they need no synchronization.
+  if (threadPool != nullptr) {
+    threadPool->parallelFor(getTileCount(),
+                            [this](std::uint32_t const tile) { rasterizeTile(tile); });
+  } else {
+    for (auto tile = 0u; tile < getTileCount(); ++tile) {
+      rasterizeTile(tile);
+    }
+  }
+}
+
+auto pbr::SoftwareOcclusionCuller::isVisible(ScreenBounds const& bounds) const noexcept
+    -> bool {
+  // Every pixel the bounds overlap is tested, not only the ones with their center inside.
+  auto const getFirst = [](float const coordinate, std::uint32_t const size) {
+    return std::clamp(static_cast<std::int32_t>(std::floor(coordinate * size)), 0,
+                      static_cast<std::int32_t>(size - 1));
+  };
+  auto const getLast = [](float const coordinate, std::uint32_t const size,
+                          std::int32_t const first) {
+    return std::clamp(static_cast<std::int32_t>(std::ceil(coordinate * size)) - 1, first,
+                      static_cast<std::int32_t>(size - 1));
+  };
+  auto const firstX = getFirst(bounds.min.x, WIDTH);
+  auto const lastX = getLast(bounds.max.x, WIDTH, firstX);
+  auto const firstY = getFirst(bounds.min.y, HEIGHT);
+  auto const lastY = getLast(bounds.max.y, HEIGHT, firstY);
+
+  // Rows are a multiple of LANES wide, so aligned lanes never leave the row.
+  auto const alignedX = firstX & ~(constants::LANES - 1);
+  for (auto y = firstY; y <= lastY; ++y) {
+    auto const* const row = _depth.data() + (static_cast<std::size_t>(y) * WIDTH);
+    if (::isAnyPixelVisible(_kernels, row, alignedX, firstX, lastX, bounds.depth)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+auto pbr::SoftwareOcclusionCuller::isVisible(glm::mat4x4 const& viewProj,
+                                             glm::vec4 const sphere) const noexcept
+    -> bool {
+  auto const bounds = pbr::projectSphere(viewProj, sphere);
+  return !bounds || isVisible(*bounds);
+}
+
+auto pbr::SoftwareOcclusionCuller::cull(Scene const& scene, glm::mat4x4 const& viewProj,
+                                        ThreadPool* const threadPool,
+                                        std::span<std::uint8_t const> const visibleNodes)
+    -> std::span<std::uint8_t const> {
+  clear();
+  auto const meshes = scene.getMeshes();
+  auto const worldMatrices = scene.getWorldMatrices();
+  if (visibleNodes.empty()) {
+    _visibleNodes.assign(meshes.size(), 1);
+  } else {
+    _visibleNodes.assign(visibleNodes.begin(), visibleNodes.end());
+  }
+
+  _candidates.clear();
+  for (auto const [node, mesh] : std::views::enumerate(meshes)) {
+    if (!mesh || !mesh->getOccluder() || _visibleNodes[node] == 0) {
+      continue;
+    }
+    auto const bounds = pbr::projectSphere(
+        viewProj, pbr::transformSphere(worldMatrices[node], mesh->getBoundingSphere()));
+    if (bounds) {
+      auto const size = bounds->max - bounds->min;
+      _candidates.emplace_back(size.x * size.y, static_cast<std::uint32_t>(node));
+    }
+  }
+  auto const occluderCount =
+      std::min(_candidates.size(), static_cast<std::size_t>(MAX_OCCLUDERS));
+  std::ranges::partial_sort(
+      _candidates, _candidates.begin() + static_cast<std::ptrdiff_t>(occluderCount),
+      std::ranges::greater {});
+  auto const occluders = std::span(_candidates).first(occluderCount);
+
+  _occluders.clear();
+  for (auto const node : occluders | std::views::values) {
+    _occluders.push_back({
+        .mesh = meshes[node]->getOccluder().get(),
+        .model = worldMatrices[node],
+    });
+  }
+  rasterize(viewProj, _occluders, threadPool);
+
+  for (auto const [node, mesh] : std::views::enumerate(meshes)) {
+    // An occluder would only be tested against itself.
+    if (!mesh || _visibleNodes[node] == 0
+        || std::ranges::contains(occluders | std::views::values,
+                                 static_cast<std::uint32_t>(node))) {
+      continue;
+    }
+    ++_stats.testedNodes;
+    auto const sphere =
+        pbr::transformSphere(worldMatrices[node], mesh->getBoundingSphere());
+    if (!isVisible(viewProj, sphere)) {
+      _visibleNodes[node] = 0;
+      ++_stats.occludedNodes;
+    }
+  }
+  return _visibleNodes;
+}
+
+auto pbr::SoftwareOcclusionCuller::getDepth() const noexcept -> std::span<float const> {
+  return _depth;
+}
+
+auto pbr::SoftwareOcclusionCuller::getStats() const noexcept -> SoftwareOcclusionStats {
+  return _stats;
+}
+
+auto pbr::SoftwareOcclusionCuller::setupOccluder(glm::mat4x4 const& modelViewProj,
+                                                 OccluderMesh const& mesh) -> void {
+  _clipPositions.clear();
+  _screenPositions.clear();
+  for (auto const& position : mesh.positions) {
+    auto const clip = modelViewProj * glm::vec4(position, 1.0f);
+    _clipPositions.push_back(clip);
+    _screenPositions.push_back(::toScreen(clip));
+  }
+
+  auto const& positions = mesh.positions;
+  _sortedVertices.resize(positions.size());
+  std::iota(_sortedVertices.begin(), _sortedVertices.end(), 0u);
+  std::ranges::sort(_sortedVertices, {}, [&positions](std::uint32_t const vertex) {
+    return std::tuple(positions[vertex].x, positions[vertex].y, positions[vertex].z);
+  });
+  _weldedVertices.resize(positions.size());
+  for (auto const [index, vertex] : std::views::enumerate(_sortedVertices)) {
+    auto const previous = index > 0 ? _sortedVertices[index - 1] : vertex;
+    _weldedVertices[vertex] =
+        positions[vertex] == positions[previous] ? _weldedVertices[previous] : vertex;
+  }
+
+  auto const& indices = mesh.indices;
+  auto const triangleCount = indices.size() / 3;
+  auto const isInFront = [&](std::size_t const triangle) {
+    return std::ranges::all_of(std::span(indices).subspan(triangle * 3, 3),
+                               [this](std::uint32_t const vertex) {
+                                 auto const& clip = _clipPositions[vertex];
+                                 return clip.w > 0.0f && clip.z >= -clip.w;
+                               });
+  };
+  auto const getVertex = [&](std::size_t const triangle, std::size_t const corner) {
+    return indices[(triangle * 3) + (corner % 3)];
+  };
+  // The edge opposite of the corner, ordered so both of its triangles find it.
+  auto const getEdge = [&](std::size_t const triangle, std::size_t const corner) {
+    auto const a = _weldedVertices[getVertex(triangle, corner + 1)];
+    auto const b = _weldedVertices[getVertex(triangle, corner + 2)];
+    return std::pair(std::min(a, b), std::max(a, b));
+  };
+
+  // Edges with triangles on both of their sides are inside of the silhouette.
+  _edgeSides.clear();
+  for (auto triangle = 0uz; triangle < triangleCount; ++triangle) {
+    if (!isInFront(triangle)) {
+      continue;
+    }
+    for (auto corner = 0uz; corner < 3; ++corner) {
+      auto const [first, second] = getEdge(triangle, corner);
+      auto const opposite = _screenPositions[getVertex(triangle, corner)];
+      auto const distance =
+          glm::dot(::makeEdge(_screenPositions[first], _screenPositions[second]),
+                   glm::vec3(opposite.x, opposite.y, 1.0f));
+      // Degenerate triangles are never rasterized, so they cover neither side.
+      if (std::abs(distance) > std::numeric_limits<float>::epsilon()) {
+        _edgeSides[::makeEdgeKey(first, second)] |=
+            distance > 0.0f ? constants::LEFT_SIDE : constants::RIGHT_SIDE;
+      }
+    }
+  }
+
+  for (auto triangle = 0uz; triangle < triangleCount; ++triangle) {
+    if (!isInFront(triangle)) {
+      continue;
+    }
+    std::array<glm::vec3, 3> vertices {};
+    std::array<bool, 3> silhouettes {};
+    for (auto corner = 0uz; corner < 3; ++corner) {
+      auto const [first, second] = getEdge(triangle, corner);
+      vertices[corner] = _screenPositions[getVertex(triangle, corner)];
+      silhouettes[corner] = _edgeSides[::makeEdgeKey(first, second)]
+                            != (constants::LEFT_SIDE | constants::RIGHT_SIDE);
+    }
+    setupTriangle(vertices, silhouettes);
+  }
+}
+
+auto pbr::SoftwareOcclusionCuller::setupTriangle(std::array<glm::vec3, 3> vertices,
+                                                 std::array<bool, 3> silhouettes)
+    -> void {
+  // Both windings are rasterized, the counter clockwise one keeps the edges positive.
+  auto area = glm::dot(::makeEdge(vertices[0], vertices[1]),
+                       glm::vec3(vertices[2].x, vertices[2].y, 1.0f));
+  if (area < 0.0f) {
+    std::swap(vertices[1], vertices[2]);
+    std::swap(silhouettes[1], silhouettes[2]);
+    area = -area;
+  }
+  if (area <= std::numeric_limits<float>::epsilon()) {
+    return;
+  }
+
+  // Pixel centers are at half coordinates.
+  auto const min = glm::ceil(
+      glm::min(glm::vec2(vertices[0]), glm::min(glm::vec2(vertices[1]),
+                                                glm::vec2(vertices[2])))
+      - 0.5f);
+  auto const max = glm::floor(
+      glm::max(glm::vec2(vertices[0]), glm::max(glm::vec2(vertices[1]),
+                                                glm::vec2(vertices[2])))
+      - 0.5f);
+  glm::vec2 const lastPixel {WIDTH - 1, HEIGHT - 1};
+  if (glm::any(glm::lessThan(max, glm::vec2(0.0f)))
+      || glm::any(glm::greaterThan(min, lastPixel))
+      || glm::any(glm::lessThan(max, min))) {
+    return;
+  }
+
+  std::array edges {
+      ::makeEdge(vertices[1], vertices[2]),
+      ::makeEdge(vertices[2], vertices[0]),
+      ::makeEdge(vertices[0], vertices[1]),
+  };
+  // Every edge is the barycentric weight of the opposite vertex scaled by the area.
+  auto depth = ((edges[0] * vertices[0].z) + (edges[1] * vertices[1].z)
+                + (edges[2] * vertices[2].z))
+               / area;
+
+  // The corners of a pixel are half a pixel away from its center along both axes, so
+  // moving the planes by that much evaluates them at the corner farthest out of the
+  // silhouette and farthest from the camera.
+  for (auto const [edge, silhouette] : std::views::zip(edges, silhouettes)) {
+    if (silhouette) {
+      edge.z -= 0.5f * (std::abs(edge.x) + std::abs(edge.y));
+    }
+  }
+  depth.z += 0.5f * (std::abs(depth.x) + std::abs(depth.y));
+
+  _triangles.push_back({
+      .edges = edges,
+      .depth = depth,
+      .min = glm::ivec2(glm::clamp(min, glm::vec2(0.0f), lastPixel)),
+      .max = glm::ivec2(glm::clamp(max, glm::vec2(0.0f), lastPixel)),
+  });
+}
+
+auto pbr::SoftwareOcclusionCuller::rasterizeTile(std::uint32_t const tile) noexcept
+    -> void {
+  auto const tileMin = glm::ivec2((tile % constants::TILES_PER_ROW) * TILE_WIDTH,
+                                  (tile / constants::TILES_PER_ROW) * TILE_HEIGHT);
+  auto const tileMax = tileMin + glm::ivec2(TILE_WIDTH - 1, TILE_HEIGHT - 1);
+
+  for (auto const& triangle : _triangles) {
+    auto const min = glm::max(triangle.min, tileMin);
+    auto const max = glm::min(triangle.max, tileMax);
+    if (glm::any(glm::greaterThan(min, max))) {
+      continue;
+    }
+
+    // Tiles are a multiple of LANES wide, so aligned lanes stay inside of the tile. The
+    // edges exclude the lanes outside of the triangle.
+    auto const firstX = min.x & ~(constants::LANES - 1);
+    for (auto y = min.y; y <= max.y; ++y) {
+      ::rasterizeRow(_kernels, triangle.edges, triangle.depth,
+                     _depth.data() + (static_cast<std::size_t>(y) * WIDTH), firstX, max.x,
+                     static_cast<float>(y) + 0.5f);
+    }
+  }
+}
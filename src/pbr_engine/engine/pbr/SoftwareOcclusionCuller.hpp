@@ -0,0 +1,175 @@
+#pragma once
+
+#include "pbr/CpuKernels.hpp"
+#include "pbr/DepthPyramidSystem.hpp"
+#include "pbr/Mesh.hpp"
+#include "pbr/Scene.hpp"
+#include "pbr/ThreadPool.hpp"
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+#include <glm/ext/vector_int2.hpp>
+
+namespace pbr {
+/**
+ * Counters describing the work done by the last SoftwareOcclusionCuller::cull call.
+ */
+struct SoftwareOcclusionStats {
+  std::uint32_t occluders {};
+  /// Triangles of the occluders that were in front of the near plane.
+  std::uint32_t occluderTriangles {};
+  /// Nodes tested against the depth buffer, occluders are never tested.
+  std::uint32_t testedNodes {};
+  std::uint32_t occludedNodes {};
+};
+/**
+ * Culls the nodes of a scene hidden behind a few large occluders on the cpu, so their
+ * draws are never recorded.
+ *
+ * The occluders are rasterized into a small depth buffer in parallel over screen tiles,
+ * 8 pixels at a time with AVX2 on cpus supporting it and one pixel at a time otherwise.
+ * Every pixel keeps the nearest depth of the occluders, a node is hidden if the nearest
+ * depth of its bounding box is behind every pixel the box covers. The rasterization is
+ * conservative, occluders only write to the pixels they cover entirely and with their
+ * farthest depth over the pixel.
+ */
+class SoftwareOcclusionCuller {
+public:
+  static constexpr std::uint32_t WIDTH = 256;
+  static constexpr std::uint32_t HEIGHT = 128;
+  /// Tiles are rasterized independently, the width has to be a multiple of LANES.
+  static constexpr std::uint32_t TILE_WIDTH = 64;
+  static constexpr std::uint32_t TILE_HEIGHT = 32;
+  /// Pixels rasterized and tested at once, the width of an AVX2 register.
+  static constexpr std::uint32_t LANES = 8;
+  /// Only the occluders covering the most of the screen are rasterized.
+  static constexpr std::uint32_t MAX_OCCLUDERS = 16;
+  /// Meshes with more triangles are too expensive to rasterize as occluders.
+  static constexpr std::uint32_t MAX_OCCLUDER_TRIANGLES = 1024;
+
+  struct Occluder {
+    OccluderMesh const* mesh;
+    glm::mat4x4 model;
+  };
+
+private:
+  /**
+   * A triangle set up for rasterization, every edge and the depth are planes a * x +
+   * b * y + c over the pixels.
+   */
+  struct Triangle {
+    /// A pixel is covered if it is on the positive side of every edge.
+    std::array<glm::vec3, 3> edges;
+    glm::vec3 depth;
+    /// Inclusive pixel bounds clamped to the depth buffer.
+    glm::ivec2 min;
+    glm::ivec2 max;
+  };
+
+  CpuKernels _kernels;
+  std::vector<float> _depth;
+  /// Clip space positions of the occluder being set up.
+  std::vector<glm::vec4> _clipPositions;
+  /// Pixel coordinates of the occluder being set up with their depth in z.
+  std::vector<glm::vec3> _screenPositions;
+  std::vector<std::uint32_t> _sortedVertices;
+  /// For every vertex the first one at the same position, split vertices share edges.
+  std::vector<std::uint32_t> _weldedVertices;
+  /// The sides of every edge between welded vertices their triangles are on.
+  std::unordered_map<std::uint64_t, std::uint8_t> _edgeSides;
+  std::vector<Triangle> _triangles;
+  /// Occluders of the scene with the screen area they cover and their node.
+  std::vector<std::pair<float, std::uint32_t>> _candidates;
+  std::vector<Occluder> _occluders;
+  std::vector<std::uint8_t> _visibleNodes;
+  SoftwareOcclusionStats _stats {};
+
+public:
+  /**
+   * @param kernels Falls back to the scalar kernels if the cpu does not support them.
+   */
+  explicit SoftwareOcclusionCuller(CpuKernels kernels = pbr::getBestCpuKernels());
+
+  [[nodiscard]]
+  auto getKernels() const noexcept -> CpuKernels;
+
+  [[nodiscard]]
+  static constexpr auto getTileCount() noexcept -> std::uint32_t;
+
+  /**
+   * Resets every pixel to the far plane.
+   */
+  auto clear() noexcept -> void;
+
+  /**
+   * Rasterizes the triangles of the occluders on top of the depth buffer.
+   * @param threadPool Optional, the tiles are rasterized by its threads.
+   * @note Triangles reaching in front of the near plane are skipped, the camera could
+   * see past them.
+   */
+  auto rasterize(glm::mat4x4 const& viewProj, std::span<Occluder const> occluders,
+                 ThreadPool* threadPool = nullptr) -> void;
+
+  /**
+   * @returns Whether any pixel covered by the bounds is not in front of their depth.
+   */
+  [[nodiscard]]
+  auto isVisible(ScreenBounds const& bounds) const noexcept -> bool;
+  /**
+   * @param sphere The world space center of the sphere in xyz and its radius in w.
+   * @returns Whether the box enclosing the sphere is visible, boxes reaching behind the
+   * camera always are.
+   */
+  [[nodiscard]]
+  auto isVisible(glm::mat4x4 const& viewProj, glm::vec4 sphere) const noexcept -> bool;
+
+  /**
+   * Rasterizes the meshes with an occluder that cover the most of the screen and tests
+   * every other node with a mesh against them.
+   * @param threadPool Optional, the tiles are rasterized by its threads.
+   * @param visibleNodes Optional, one entry per node and nodes whose entry is 0 are
+   * neither rasterized nor tested and stay hidden.
+   * @returns One entry per node of the scene that is 0 if the node is hidden, it stays
+   * valid until the next call.
+   */
+  auto cull(Scene const& scene, glm::mat4x4 const& viewProj,
+            ThreadPool* threadPool = nullptr,
+            std::span<std::uint8_t const> visibleNodes = {})
+      -> std::span<std::uint8_t const>;
+
+  /**
+   * @returns The pixels row by row, the first row and column are at -1 in NDC.
+   */
+  [[nodiscard]]
+  auto getDepth() const noexcept -> std::span<float const>;
+
+  [[nodiscard]]
+  auto getStats() const noexcept -> SoftwareOcclusionStats;
+
+private:
+  auto setupOccluder(glm::mat4x4 const& modelViewProj, OccluderMesh const& mesh) -> void;
+  /**
+   * @param vertices Pixel coordinates with their depth in z.
+   * @param silhouettes Whether the edge opposite of every vertex is on the silhouette of
+   * the occluder, the pixels crossing other edges are covered by the triangles on both
+   * of their sides.
+   */
+  auto setupTriangle(std::array<glm::vec3, 3> vertices, std::array<bool, 3> silhouettes)
+      -> void;
+  auto rasterizeTile(std::uint32_t tile) noexcept -> void;
+};
+} // namespace pbr
+
+/* IMPLEMENTATIONS */
+
+constexpr auto pbr::SoftwareOcclusionCuller::getTileCount() noexcept -> std::uint32_t {
+  return (WIDTH / TILE_WIDTH) * (HEIGHT / TILE_HEIGHT);
+}
@@ -0,0 +1,108 @@
+#include "pbr/ThreadPool.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+
+pbr::ThreadPool::ThreadPool(std::uint32_t const threadCount) {
+  _workers.reserve(threadCount);
+  for (auto i = 0u; i < threadCount; ++i) {
+    _workers.emplace_back([this](std::stop_token const& stopToken) { work(stopToken); });
+  }
+}
+
+pbr::ThreadPool::~ThreadPool() noexcept {
+  for (auto& worker : _workers) {
+    worker.request_stop();
+  }
+  // Joining happens in the jthread destructors, the stop request wakes up every worker.
+  _workers.clear();
+}
+
+auto pbr::ThreadPool::getDefaultThreadCount() noexcept -> std::uint32_t {
+  return std::max(std::thread::hardware_concurrency(), 2u) - 1;
+}
+
+auto pbr::ThreadPool::getThreadCount() const noexcept -> std::uint32_t {
+  return static_cast<std::uint32_t>(_workers.size());
+}
+
+auto pbr::ThreadPool::submit(std::move_only_function<void()> task) -> void {
+  {
+    std::scoped_lock const lock(_mutex);
+    _tasks.push_back(std::move(task));
+  }
+  _taskAvailable.notify_one();
+}
+
+auto pbr::ThreadPool::parallelFor(std::uint32_t const count,
+                                  std::function<void(std::uint32_t)> const& function)
+    -> void {
+  // The state is only touched under its mutex so it can not be destroyed while the last
+  // task is still signalling completion.
+  std::mutex mutex;
+  std::condition_variable finished;
+  auto remaining = count;
+  std::exception_ptr exception;
+  for (auto index = 0u; index < count; ++index) {
+    submit([&, index] {
+      std::exception_ptr taskException;
+      try {
+        function(index);
+      } catch (...) {
+        taskException = std::current_exception();
+      }
+      std::scoped_lock const lock(mutex);
+      if (taskException && !exception) {
+        exception = std::move(taskException);
+      }
+      if (--remaining == 0) {
+        finished.notify_all();
+      }
+    });
+  }
+
+  while (tryRunTask()) {
+  }
+  std::unique_lock lock(mutex);
+  finished.wait(lock, [&remaining] { return remaining == 0; });
+
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+}
+
+auto pbr::ThreadPool::work(std::stop_token const& stopToken) -> void {
+  while (true) {
+    std::move_only_function<void()> task;
+    {
+      std::unique_lock lock(_mutex);
+      if (!_taskAvailable.wait(lock, stopToken, [this] { return !_tasks.empty(); })) {
+        return;
+      }
+      task = std::move(_tasks.front());
+      _tasks.pop_front();
+    }
+    task();
+  }
+}
+
+auto pbr::ThreadPool::tryRunTask() -> bool {
+  std::move_only_function<void()> task;
+  {
+    std::scoped_lock const lock(_mutex);
+    if (_tasks.empty()) {
+      return false;
+    }
+    task = std::move(_tasks.front());
+    _tasks.pop_front();
+  }
+  task();
+  return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace pbr {
+/**
+ * Fixed set of worker threads executing tasks from a shared queue.
+ * @note On destruction queued tasks that have not started are discarded.
+ */
+class ThreadPool {
+  std::mutex _mutex;
+  std::condition_variable_any _taskAvailable;
+  std::deque<std::move_only_function<void()>> _tasks;
+  std::vector<std::jthread> _workers;
+
+public:
+  /**
+   * @param threadCount The number of worker threads, the default leaves one hardware
+   * thread for the thread that submits work.
+   */
+  explicit ThreadPool(std::uint32_t threadCount = getDefaultThreadCount());
+
+  ThreadPool(const ThreadPool&) = delete;
+  auto operator=(const ThreadPool&) -> ThreadPool& = delete;
+  ThreadPool(ThreadPool&&) = delete;
+  auto operator=(ThreadPool&&) -> ThreadPool& = delete;
+
+  ~ThreadPool() noexcept;
+
+  [[nodiscard]]
+  static auto getDefaultThreadCount() noexcept -> std::uint32_t;
+
+  [[nodiscard]]
+  auto getThreadCount() const noexcept -> std::uint32_t;
+
+  /**
+   * Queues a task to be executed by one of the workers.
+   */
+  auto submit(std::move_only_function<void()> task) -> void;
+
+  /**
+   * Calls function once for every index in [0, count) spread over the workers, the
+   * calling thread executes queued tasks as well.
+   * @note This blocks until every call has returned, the first exception thrown by a call
+   * is rethrown after that.
+   */
+  auto parallelFor(std::uint32_t count,
+                   std::function<void(std::uint32_t)> const& function) -> void;
+
+private:
+  auto work(std::stop_token const& stopToken) -> void;
+  /**
+   * Executes a single queued task on the calling thread.
+   * @returns Whether there was a task to execute.
+   */
+  auto tryRunTask() -> bool;
+};
+} // namespace pbr
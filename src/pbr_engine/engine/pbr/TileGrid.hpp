@@ -0,0 +1,105 @@
+#pragma once
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/CameraData.hpp"
+
+#include <glm/ext/vector_float2.hpp>
+
+#include <algorithm>
+#include <cstdint>
+
+namespace pbr {
+/**
+ * Splits an image into tiles of one extent, so images larger than the device can create
+ * are rendered with bounded memory. Tiles are ordered row by row, the tiles of the last
+ * column and row reach past the image.
+ */
+class TileGrid {
+  vk::Extent2D _imageExtent;
+  vk::Extent2D _tileExtent;
+  std::uint32_t _columns;
+  std::uint32_t _rows;
+
+public:
+  /**
+   * @param maxTileSize The largest width and height of a tile, images that fit are a
+   * single tile of their own extent.
+   */
+  constexpr TileGrid(vk::Extent2D imageExtent, std::uint32_t maxTileSize) noexcept;
+
+  /**
+   * @returns The pixels of the image the tile covers, clipped to the image.
+   */
+  [[nodiscard]]
+  constexpr auto getTile(std::uint32_t index) const noexcept -> vk::Rect2D;
+  /**
+   * @returns The camera rendering the tile at the tile extent.
+   */
+  [[nodiscard]]
+  constexpr auto getTileCameraData(CameraData const& camera,
+                                   std::uint32_t index) const noexcept -> CameraData;
+
+  [[nodiscard]]
+  constexpr auto getImageExtent() const noexcept -> vk::Extent2D;
+  [[nodiscard]]
+  constexpr auto getTileExtent() const noexcept -> vk::Extent2D;
+  [[nodiscard]]
+  constexpr auto getColumns() const noexcept -> std::uint32_t;
+  [[nodiscard]]
+  constexpr auto getRows() const noexcept -> std::uint32_t;
+  [[nodiscard]]
+  constexpr auto getTileCount() const noexcept -> std::uint32_t;
+};
+} // namespace pbr
+
+/* IMPLEMENTATIONS */
+
+constexpr pbr::TileGrid::TileGrid(vk::Extent2D const imageExtent,
+                                  std::uint32_t const maxTileSize) noexcept
+    : _imageExtent(imageExtent)
+    , _tileExtent {
+          .width = std::min(imageExtent.width, maxTileSize),
+          .height = std::min(imageExtent.height, maxTileSize),
+      }
+    , _columns((imageExtent.width + _tileExtent.width - 1) / _tileExtent.width)
+    , _rows((imageExtent.height + _tileExtent.height - 1) / _tileExtent.height) {}
+
+constexpr auto pbr::TileGrid::getTile(std::uint32_t const index) const noexcept
+    -> vk::Rect2D {
+  auto const x = index % _columns * _tileExtent.width;
+  auto const y = index / _columns * _tileExtent.height;
+  return {
+      .offset {.x = static_cast<std::int32_t>(x), .y = static_cast<std::int32_t>(y)},
+      .extent {
+          .width = std::min(_tileExtent.width, _imageExtent.width - x),
+          .height = std::min(_tileExtent.height, _imageExtent.height - y),
+      },
+  };
+}
+
+constexpr auto pbr::TileGrid::getTileCameraData(CameraData const& camera,
+                                                std::uint32_t const index) const noexcept
+    -> CameraData {
+  auto const tile = getTile(index);
+  return pbr::makeTileCameraData(
+      camera, {static_cast<float>(tile.offset.x), static_cast<float>(tile.offset.y)},
+      {static_cast<float>(_tileExtent.width), static_cast<float>(_tileExtent.height)},
+      {static_cast<float>(_imageExtent.width), static_cast<float>(_imageExtent.height)});
+}
+
+constexpr auto pbr::TileGrid::getImageExtent() const noexcept -> vk::Extent2D {
+  return _imageExtent;
+}
+constexpr auto pbr::TileGrid::getTileExtent() const noexcept -> vk::Extent2D {
+  return _tileExtent;
+}
+constexpr auto pbr::TileGrid::getColumns() const noexcept -> std::uint32_t {
+  return _columns;
+}
+constexpr auto pbr::TileGrid::getRows() const noexcept -> std::uint32_t {
+  return _rows;
+}
+constexpr auto pbr::TileGrid::getTileCount() const noexcept -> std::uint32_t {
+  return _columns * _rows;
+}
@@ -0,0 +1,246 @@
+#include "pbr/TiledLightingSystem.hpp"
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/core/GpuHandle.hpp"
+
+#include "pbr/Buffer.hpp"
+#include "pbr/CameraData.hpp"
+#include "pbr/DescriptorSetAllocator.hpp"
+#include "pbr/GBuffer.hpp"
+#include "pbr/Image2D.hpp"
+#include "pbr/LightBuffer.hpp"
+#include "pbr/memory/AllocationInfo.hpp"
+#include "pbr/memory/IAllocator.hpp"
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+
+namespace constants {
+static constexpr std::uint32_t LIGHTS_BINDING = 0;
+static constexpr std::uint32_t OUTPUT_BINDING = 1;
+static constexpr std::uint32_t COUNTERS_BINDING = 2;
+} // namespace constants
+
+namespace {
+[[nodiscard]]
+constexpr auto createDescriptorSetLayout(pbr::core::GpuHandle const& gpu)
+    -> vk::UniqueDescriptorSetLayout {
+  std::array const bindings {
+      vk::DescriptorSetLayoutBinding {
+          .binding = constants::LIGHTS_BINDING,
+          .descriptorType = vk::DescriptorType::eStorageBuffer,
+          .descriptorCount = 1,
+          .stageFlags = vk::ShaderStageFlagBits::eCompute,
+      },
+      vk::DescriptorSetLayoutBinding {
+          .binding = constants::OUTPUT_BINDING,
+          .descriptorType = vk::DescriptorType::eStorageImage,
+          .descriptorCount = 1,
+          .stageFlags = vk::ShaderStageFlagBits::eCompute,
+      },
+      vk::DescriptorSetLayoutBinding {
+          .binding = constants::COUNTERS_BINDING,
+          .descriptorType = vk::DescriptorType::eStorageBuffer,
+          .descriptorCount = 1,
+          .stageFlags = vk::ShaderStageFlagBits::eCompute,
+      },
+  };
+  return gpu.getDevice().createDescriptorSetLayoutUnique(
+      vk::DescriptorSetLayoutCreateInfo {}.setBindings(bindings));
+}
+[[nodiscard]]
+constexpr auto createPipelineLayout(pbr::core::GpuHandle const& gpu,
+                                    vk::DescriptorSetLayout gBufferSetLayout,
+                                    vk::DescriptorSetLayout descLayout)
+    -> vk::UniquePipelineLayout {
+  std::array const setLayouts {gBufferSetLayout, descLayout};
+  vk::PushConstantRange const pushConstants {
+      .stageFlags = vk::ShaderStageFlagBits::eCompute,
+      .size = sizeof(pbr::TiledLightingSystem::PushConstants),
+  };
+  return gpu.getDevice().createPipelineLayoutUnique(
+      vk::PipelineLayoutCreateInfo {}.setSetLayouts(setLayouts).setPushConstantRanges(
+          pushConstants));
+}
+[[nodiscard]]
+constexpr auto createPipeline(pbr::core::GpuHandle const& gpu, vk::PipelineLayout layout,
+                              vk::PipelineShaderStageCreateInfo shader)
+    -> vk::UniquePipeline {
+  auto [result, pipeline] = gpu.getDevice().createComputePipelineUnique(
+      nullptr, {
+                   .stage = shader,
+                   .layout = layout,
+               });
+  assert(result == vk::Result::eSuccess);
+  return std::move(pipeline);
+}
+[[nodiscard]]
+constexpr auto createDescriptorPool(pbr::core::GpuHandle const& gpu,
+                                    std::uint32_t setCount) -> vk::UniqueDescriptorPool {
+  std::array const sizes {
+      // The lights and the counters.
+      vk::DescriptorPoolSize {
+          .type = vk::DescriptorType::eStorageBuffer,
+          .descriptorCount = 2 * setCount,
+      },
+      vk::DescriptorPoolSize {
+          .type = vk::DescriptorType::eStorageImage,
+          .descriptorCount = setCount,
+      },
+  };
+  return gpu.getDevice().createDescriptorPoolUnique(vk::DescriptorPoolCreateInfo {
+      .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+      .maxSets = setCount,
+  }
+                                                        .setPoolSizes(sizes));
+}
+[[nodiscard]]
+auto createCounterBuffer(pbr::IAllocator& allocator) -> pbr::Buffer {
+  // The host reads the counters back, which is a lot faster from cached memory.
+  return allocator.allocateBuffer(
+      {
+          .size = sizeof(pbr::TiledLightingSystem::Counters),
+          .usage = vk::BufferUsageFlagBits::eStorageBuffer
+                   | vk::BufferUsageFlagBits::eTransferDst,
+      },
+      {
+          .preference = pbr::AllocationPreference::Host,
+          .ableToBeMapped = true,
+          .persistentlyMapped = true,
+          .randomAccess = true,
+      });
+}
+} // namespace
+
+pbr::TiledLightingSystem::TiledLightingSystem(core::SharedGpuHandle gpu,
+                                              IAllocator& allocator,
+                                              vk::PipelineShaderStageCreateInfo shader,
+                                              vk::DescriptorSetLayout gBufferSetLayout,
+                                              std::uint32_t const frameCount)
+    : _gpu(std::move(gpu))
+    , _descLayout(::createDescriptorSetLayout(*_gpu))
+    , _layout(::createPipelineLayout(*_gpu, gBufferSetLayout, _descLayout.get()))
+    , _pipeline(::createPipeline(*_gpu, _layout.get(), shader))
+    , _descPool(::createDescriptorPool(*_gpu, frameCount)) {
+  auto descSets = DescriptorSetAllocator(_gpu, _descPool.get(), _descLayout.get())
+                      .allocate(frameCount);
+  _frames.reserve(frameCount);
+  for (auto& descSet : descSets) {
+    _frames.push_back({
+        .descSet = std::move(descSet),
+        .counterBuffer = ::createCounterBuffer(allocator),
+    });
+  }
+}
+
+auto pbr::TiledLightingSystem::record(vk::CommandBuffer cmdBuffer,
+                                      std::uint32_t const frameIndex,
+                                      LightBuffer const& lights,
+                                      CameraData const& camera, GBuffer const& gBuffer,
+                                      Image2D const& renderTarget, vk::Extent2D extent)
+    -> void {
+  auto& frame = _frames[frameIndex % _frames.size()];
+
+  // The previous use of the frame has finished so its counters hold what it wrote.
+  std::uint32_t overflowTiles = 0;
+  if (frame.recorded) {
+    frame.counterBuffer.invalidate();
+    auto const mapping = frame.counterBuffer.map();
+    overflowTiles = static_cast<Counters const*>(mapping.get())->overflowTiles;
+  }
+  frame.recorded = true;
+
+  // The previous use of the frame has finished so the set is not in use.
+  if (frame.lightBuffer != lights.getBuffer()
+      || frame.renderTarget != renderTarget.getImageView()) {
+    frame.lightBuffer = lights.getBuffer();
+    frame.renderTarget = renderTarget.getImageView();
+    writeDescriptorSet(frame);
+  }
+
+  cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, _pipeline.get());
+  std::array const descSets {gBuffer.getDescriptorSet(), frame.descSet.get()};
+  cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, _layout.get(), 0,
+                               descSets, {});
+
+  PushConstants const pushConstants {
+      .invViewProj = camera.invViewProj,
+      .cameraPosition = camera.position,
+      .lightCount = lights.getCount(),
+      .extent {extent.width, extent.height},
+  };
+  cmdBuffer.pushConstants(_layout.get(), vk::ShaderStageFlagBits::eCompute, 0,
+                          sizeof(PushConstants), &pushConstants);
+
+  cmdBuffer.fillBuffer(frame.counterBuffer.getBuffer(), 0, vk::WholeSize, 0);
+  vk::MemoryBarrier2 const clearBarrier {
+      .srcStageMask = vk::PipelineStageFlagBits2::eClear,
+      .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+      .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+      .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead
+                       | vk::AccessFlagBits2::eShaderStorageWrite,
+  };
+  cmdBuffer.pipelineBarrier2(vk::DependencyInfo {}.setMemoryBarriers(clearBarrier));
+
+  auto const tileCount = getTileCount(extent);
+  cmdBuffer.dispatch(tileCount.x, tileCount.y, 1);
+
+  // Waiting for the fence alone does not make the counters visible to the host.
+  vk::MemoryBarrier2 const readbackBarrier {
+      .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+      .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+      .dstStageMask = vk::PipelineStageFlagBits2::eHost,
+      .dstAccessMask = vk::AccessFlagBits2::eHostRead,
+  };
+  cmdBuffer.pipelineBarrier2(vk::DependencyInfo {}.setMemoryBarriers(readbackBarrier));
+
+  _stats = {
+      .lights = pushConstants.lightCount,
+      .tiles = tileCount.x * tileCount.y,
+      .overflowTiles = overflowTiles,
+  };
+}
+
+auto pbr::TiledLightingSystem::getStats() const noexcept -> TiledLightingStats {
+  return _stats;
+}
+
+auto pbr::TiledLightingSystem::writeDescriptorSet(Frame const& frame) -> void {
+  vk::DescriptorBufferInfo const bufferInfo {
+      .buffer = frame.lightBuffer,
+      .range = vk::WholeSize,
+  };
+  vk::DescriptorImageInfo const imageInfo {
+      .imageView = frame.renderTarget,
+      .imageLayout = vk::ImageLayout::eGeneral,
+  };
+  vk::DescriptorBufferInfo const counterInfo {
+      .buffer = frame.counterBuffer.getBuffer(),
+      .range = vk::WholeSize,
+  };
+  _gpu->getDevice().updateDescriptorSets(
+      std::array {
+          vk::WriteDescriptorSet {
+              .dstSet = frame.descSet.get(),
+              .dstBinding = constants::LIGHTS_BINDING,
+              .descriptorType = vk::DescriptorType::eStorageBuffer,
+          }
+              .setBufferInfo(bufferInfo),
+          vk::WriteDescriptorSet {
+              .dstSet = frame.descSet.get(),
+              .dstBinding = constants::OUTPUT_BINDING,
+              .descriptorType = vk::DescriptorType::eStorageImage,
+          }
+              .setImageInfo(imageInfo),
+          vk::WriteDescriptorSet {
+              .dstSet = frame.descSet.get(),
+              .dstBinding = constants::COUNTERS_BINDING,
+              .descriptorType = vk::DescriptorType::eStorageBuffer,
+          }
+              .setBufferInfo(counterInfo),
+      },
+      {});
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/core/GpuHandle.hpp"
+
+#include "pbr/Buffer.hpp"
+#include "pbr/CameraData.hpp"
+#include "pbr/GBuffer.hpp"
+#include "pbr/Image2D.hpp"
+#include "pbr/LightBuffer.hpp"
+#include "pbr/memory/IAllocator.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_uint2.hpp>
+
+namespace pbr {
+/**
+ * Counters describing the work recorded by the last TiledLightingSystem::record call.
+ */
+struct TiledLightingStats {
+  std::uint32_t lights {};
+  std::uint32_t tiles {};
+  /// Tiles touched by more lights than fit in a batch, read back from the previous use
+  /// of the frame.
+  std::uint32_t overflowTiles {};
+};
+/**
+ * Shades the g-buffer in a compute pass that bins the lights into screen tiles.
+ *
+ * Every workgroup covers a tile, it first reduces the depth of its pixels to a min and
+ * max depth and culls the lights against the box enclosing that slice of the view
+ * frustum. The pixels are then only shaded against the lights of their tile, so the cost
+ * of a pixel depends on the lights near it and not on the lights in the scene. The lights
+ * are binned and shaded in batches, so tiles touched by many lights never drop any and
+ * always add them up in the same order.
+ */
+class TiledLightingSystem {
+public:
+  /// Width and height of a tile in pixels, this is the workgroup size of the shader.
+  static constexpr std::uint32_t TILE_SIZE = 16;
+  /// Lights binned at once, one per thread of the workgroup, mirrors the shader.
+  static constexpr std::uint32_t LIGHTS_PER_BATCH = TILE_SIZE * TILE_SIZE;
+
+  /// Mirrors PushConstants of the tiled lighting shader.
+  struct PushConstants {
+    glm::mat4x4 invViewProj;
+    glm::vec3 cameraPosition;
+    std::uint32_t lightCount;
+    glm::uvec2 extent;
+  };
+  /// Mirrors CounterBuffer of the tiled lighting shader.
+  struct Counters {
+    std::uint32_t overflowTiles;
+  };
+
+private:
+  /// Every frame in flight has its own descriptor set.
+  struct Frame {
+    vk::UniqueDescriptorSet descSet;
+    /// The buffers the descriptor set was last written with.
+    vk::Buffer lightBuffer {};
+    vk::ImageView renderTarget {};
+    /// Cleared and written by every dispatch, read back by the next use of the frame.
+    Buffer counterBuffer;
+    bool recorded = false;
+  };
+
+  core::SharedGpuHandle _gpu;
+
+  vk::UniqueDescriptorSetLayout _descLayout;
+  vk::UniquePipelineLayout _layout;
+  vk::UniquePipeline _pipeline;
+  vk::UniqueDescriptorPool _descPool;
+
+  std::vector<Frame> _frames;
+  TiledLightingStats _stats {};
+
+public:
+  /**
+   * @param allocator Allocates the counters read back from the gpu.
+   * @param shader Has to be compiled for the layout of the g-buffers it shades.
+   * @param gBufferSetLayout The layout of the g-buffer descriptor sets, it has to be
+   * visible to the compute stage.
+   * @param frameCount The number of frames in flight.
+   */
+  TiledLightingSystem(core::SharedGpuHandle gpu, IAllocator& allocator,
+                      vk::PipelineShaderStageCreateInfo shader,
+                      vk::DescriptorSetLayout gBufferSetLayout,
+                      std::uint32_t frameCount = 1);
+
+  /**
+   * @returns The number of tiles covering the extent.
+   */
+  [[nodiscard]]
+  static constexpr auto getTileCount(vk::Extent2D extent) noexcept -> glm::uvec2;
+
+  /**
+   * Records the lighting pass, this has to be recorded outside of a render pass.
+   * @param frameIndex Selects the descriptor set of the frame, the gpu must be done with
+   * its previous use.
+   * @param lights Has to be updated for this frame.
+   * @note The g-buffer has to be readable by the compute stage and the render target has
+   * to be in the general layout.
+   */
+  auto record(vk::CommandBuffer cmdBuffer, std::uint32_t frameIndex,
+              LightBuffer const& lights, CameraData const& camera,
+              GBuffer const& gBuffer, Image2D const& renderTarget, vk::Extent2D extent)
+      -> void;
+
+  [[nodiscard]]
+  auto getStats() const noexcept -> TiledLightingStats;
+
+private:
+  auto writeDescriptorSet(Frame const& frame) -> void;
+};
+} // namespace pbr
+
+/* IMPLEMENTATIONS */
+
+constexpr auto pbr::TiledLightingSystem::getTileCount(vk::Extent2D const extent) noexcept
+    -> glm::uvec2 {
+  return {(extent.width + TILE_SIZE - 1) / TILE_SIZE,
+          (extent.height + TILE_SIZE - 1) / TILE_SIZE};
+}
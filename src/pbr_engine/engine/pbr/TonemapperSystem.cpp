@@ -2,6 +2,7 @@
 
 #include "pbr/DescriptorSetAllocator.hpp"
 #include "pbr/HdrImage.hpp"
+#include "pbr/RenderGraph.hpp"
 #include "pbr/Vulkan.hpp"
 
 #include "pbr/core/GpuHandle.hpp"
@@ -76,59 +77,49 @@ constexpr auto createDescriptorPool(pbr::core::GpuHandle const& gpu,
 } // namespace
 
 pbr::TonemapperSystem::TonemapperSystem(core::SharedGpuHandle gpu,
-                                        vk::PipelineShaderStageCreateInfo shader)
+                                        vk::PipelineShaderStageCreateInfo shader,
+                                        std::uint32_t const frameCount)
     : _gpu(std::move(gpu))
     , _descLayout(::createDescriptorSetLayout(*_gpu))
     , _layout(::createPipelineLayout(*_gpu, _descLayout.get()))
     , _pipeline(::createPipeline(*_gpu, _layout, shader))
-    , _descPool(::createDescriptorPool(*_gpu, constants::MAX_HDR_IMAGE_DESCRIPTOR_SETS)) {
-}
+    , _descPool(::createDescriptorPool(
+          *_gpu, constants::MAX_HDR_IMAGE_DESCRIPTOR_SETS * frameCount))
+    , _frameCount(frameCount) {}
 
 auto pbr::TonemapperSystem::allocateHdrImage(IAllocator& allocator,
                                              vk::Extent2D extent) -> HdrImage {
   return {
       _gpu,
       allocator,
-      DescriptorSetAllocator(_gpu, _descPool.get(), _descLayout.get()).allocate(),
+      DescriptorSetAllocator(_gpu, _descPool.get(), _descLayout.get())
+          .allocate(_frameCount),
       extent,
   };
 }
 
-auto pbr::TonemapperSystem::run(vk::CommandBuffer cmdBuffer,
-                                HdrImage const& hdrImage) -> void {
-  std::array const barriers {
-      vk::ImageMemoryBarrier2 {
-          .srcStageMask = vk::PipelineStageFlagBits2::eTopOfPipe,
-          .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
-          .dstAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
-          .newLayout = vk::ImageLayout::eGeneral,
-          .image = hdrImage.getOutputImage(),
-          .subresourceRange {
-              .aspectMask = vk::ImageAspectFlagBits::eColor,
-              .levelCount = 1,
-              .layerCount = 1,
-          },
-      },
-      vk::ImageMemoryBarrier2 {
-          .srcStageMask = vk::PipelineStageFlagBits2::eTopOfPipe,
-          .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
-          .dstAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
-          .newLayout = vk::ImageLayout::eGeneral,
-          .image = hdrImage.getImage().getImage(),
-          .subresourceRange {
-              .aspectMask = vk::ImageAspectFlagBits::eColor,
-              .levelCount = 1,
-              .layerCount = 1,
-          },
-      },
-  };
-  cmdBuffer.pipelineBarrier2(vk::DependencyInfo {}.setImageMemoryBarriers(barriers));
-
-  cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, _pipeline.get());
-  cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, _layout.get(), 0,
-                               hdrImage.getDescriptorSet(), {});
+auto pbr::TonemapperSystem::run(RenderGraph& graph, HdrImage const& hdrImage,
+                                std::uint32_t const frameIndex) -> void {
+  auto const input = graph.importImage(hdrImage.getImage().getImage(),
+                                       vk::ImageAspectFlagBits::eColor);
+  // Every pixel of the output is written.
+  auto const output = graph.importImage(hdrImage.getOutputImage(frameIndex),
+                                        vk::ImageAspectFlagBits::eColor,
+                                        ImageContents::Discard);
+  graph
+      .addPass("tonemap",
+               [this, &hdrImage, frameIndex](vk::CommandBuffer const cmdBuffer) {
+                 cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, _pipeline.get());
+                 cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                                              _layout.get(), 0,
+                                              hdrImage.getDescriptorSet(frameIndex), {});
 
-  auto const extent = hdrImage.getExtent();
-  cmdBuffer.dispatch(std::ceil(static_cast<float>(extent.width) / constants::LOCAL_SIZE),
-                     std::ceil(static_cast<float>(extent.height) / constants::LOCAL_SIZE), 1);
+                 auto const extent = hdrImage.getExtent();
+                 cmdBuffer.dispatch(
+                     std::ceil(static_cast<float>(extent.width) / constants::LOCAL_SIZE),
+                     std::ceil(static_cast<float>(extent.height) / constants::LOCAL_SIZE),
+                     1);
+               })
+      .read(input, usages::COMPUTE_STORAGE_READ)
+      .write(output, usages::COMPUTE_STORAGE_WRITE);
 }
@@ -5,8 +5,11 @@
 #include "pbr/core/GpuHandle.hpp"
 
 #include "pbr/HdrImage.hpp"
+#include "pbr/RenderGraph.hpp"
 #include "pbr/memory/IAllocator.hpp"
 
+#include <cstdint>
+
 namespace pbr {
 class TonemapperSystem {
   core::SharedGpuHandle _gpu;
@@ -16,13 +19,23 @@ class TonemapperSystem {
   vk::UniquePipeline _pipeline;
 
   vk::UniqueDescriptorPool _descPool;
+  std::uint32_t _frameCount;
 
 public:
-  TonemapperSystem(core::SharedGpuHandle gpu, vk::PipelineShaderStageCreateInfo shader);
+  /**
+   * @param frameCount The number of frames in flight, every hdr image gets a descriptor
+   * set per frame.
+   */
+  TonemapperSystem(core::SharedGpuHandle gpu, vk::PipelineShaderStageCreateInfo shader,
+                   std::uint32_t frameCount = 1);
 
   [[nodiscard]]
   auto allocateHdrImage(IAllocator& allocator, vk::Extent2D extent) -> HdrImage;
 
-  auto run(vk::CommandBuffer cmdBuffer, HdrImage const& hdrImage) -> void;
+  /**
+   * Adds a pass writing the hdr image tonemapped to the output image of the frame.
+   */
+  auto run(RenderGraph& graph, HdrImage const& hdrImage, std::uint32_t frameIndex)
+      -> void;
 };
 }
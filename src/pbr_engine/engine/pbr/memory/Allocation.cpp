@@ -26,6 +26,8 @@ pbr::Allocation::Mapping::~Mapping() noexcept {
   }
 }
 
+pbr::Allocation::Allocation() noexcept : _allocator(), _allocation(), _info() {}
+
 pbr::Allocation::Allocation(VmaAllocator allocator, VmaAllocation allocation,
                             VmaAllocationInfo info) noexcept
     : _allocator(allocator), _allocation(allocation), _info(info) {}
@@ -42,6 +44,19 @@ auto pbr::Allocation::operator=(Allocation&& rhs) noexcept -> Allocation& {
   return *this;
 }
 
-pbr::Allocation::~Allocation() noexcept { vmaFreeMemory(_allocator, _allocation); }
+pbr::Allocation::~Allocation() noexcept {
+  if (_allocation != nullptr) {
+    vmaFreeMemory(_allocator, _allocation);
+  }
+}
 
 auto pbr::Allocation::map() const -> Mapping { return Mapping(*this); }
+
+auto pbr::Allocation::invalidate() const -> void {
+  vk::Result const result {
+      vmaInvalidateAllocation(_allocator, _allocation, 0, vk::WholeSize)};
+  if (result != vk::Result::eSuccess) {
+    vk::detail::throwResultException(result,
+                                     std::source_location::current().function_name());
+  }
+}
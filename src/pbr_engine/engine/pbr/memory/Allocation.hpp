@@ -3,7 +3,11 @@
 #include "vk_mem_alloc.h"
 
 namespace pbr {
+class MemoryAllocator;
 class Allocation {
+  // Binds aliasing resources to the allocation.
+  friend MemoryAllocator;
+
   VmaAllocator _allocator;
   VmaAllocation _allocation;
   VmaAllocationInfo _info;
@@ -24,6 +28,10 @@ public:
     [[nodiscard]]
     constexpr auto get() const noexcept -> void*;
   };
+  /**
+   * An allocation without memory, for resources bound to the memory of another one.
+   */
+  Allocation() noexcept;
   Allocation(VmaAllocator allocator, VmaAllocation allocation,
              VmaAllocationInfo info) noexcept;
 
@@ -34,11 +42,22 @@ public:
 
   ~Allocation() noexcept;
 
+  [[nodiscard]]
+  constexpr auto getSize() const noexcept -> VkDeviceSize;
+
   [[nodiscard]]
   auto map() const -> Mapping;
+  /**
+   * Makes device writes visible to mappings, memory that is not host coherent keeps
+   * stale cache lines until it is invalidated.
+   */
+  auto invalidate() const -> void;
 };
 } // namespace pbr
 
 /* IMPLEMENTATIONS */
 
 constexpr auto pbr::Allocation::Mapping::get() const noexcept -> void* { return _memory; }
+constexpr auto pbr::Allocation::getSize() const noexcept -> VkDeviceSize {
+  return _info.size;
+}
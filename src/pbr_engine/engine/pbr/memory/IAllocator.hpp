@@ -17,5 +17,18 @@ public:
   [[nodiscard]]
   virtual auto allocateImage(vk::ImageCreateInfo, AllocationInfo)
       -> std::pair<Allocation, vk::UniqueImage> = 0;
+  /**
+   * Allocates memory no resource is bound to yet, see allocateAliasingImage.
+   */
+  [[nodiscard]]
+  virtual auto allocateMemory(vk::MemoryRequirements, AllocationInfo) -> Allocation = 0;
+  /**
+   * Creates an image bound to the memory of the allocation at the offset, other images
+   * may be bound to the same memory.
+   * @note The image must be destroyed before the allocation.
+   */
+  [[nodiscard]]
+  virtual auto allocateAliasingImage(Allocation const& allocation, vk::DeviceSize offset,
+                                     vk::ImageCreateInfo) -> vk::UniqueImage = 0;
 };
 } // namespace pbr
@@ -142,3 +142,42 @@ auto pbr::MemoryAllocator::allocateImage(vk::ImageCreateInfo const imageInfo,
   return std::make_pair(Allocation(_allocator, allocation, allocationInfo),
                         vk::UniqueImage(imageRaw, _gpu->getDevice()));
 }
+
+auto pbr::MemoryAllocator::allocateMemory(vk::MemoryRequirements const requirements,
+                                          AllocationInfo const allocInfo) -> Allocation {
+  auto const requirementsRaw = static_cast<VkMemoryRequirements>(requirements);
+  // The automatic usages need to know the resource, so the preference picks the flags.
+  auto allocInfoRaw = ::convertAllocationInfo(allocInfo);
+  allocInfoRaw.usage = VMA_MEMORY_USAGE_UNKNOWN;
+  allocInfoRaw.preferredFlags = allocInfo.preference == AllocationPreference::Device
+                                    ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+                                    : VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+  VmaAllocation allocation {};
+  VmaAllocationInfo allocationInfo {};
+  vk::Result const result {vmaAllocateMemory(_allocator, &requirementsRaw, &allocInfoRaw,
+                                             &allocation, &allocationInfo)};
+
+  if(result != vk::Result::eSuccess) {
+    vk::detail::throwResultException(result,
+                                     std::source_location::current().function_name());
+  }
+
+  return {_allocator, allocation, allocationInfo};
+}
+
+auto pbr::MemoryAllocator::allocateAliasingImage(Allocation const& allocation,
+                                                 vk::DeviceSize const offset,
+                                                 vk::ImageCreateInfo const imageInfo)
+    -> vk::UniqueImage {
+  auto const imageInfoRaw = static_cast<VkImageCreateInfo>(imageInfo);
+  VkImage imageRaw {};
+  vk::Result const result {vmaCreateAliasingImage2(_allocator, allocation._allocation,
+                                                   offset, &imageInfoRaw, &imageRaw)};
+
+  if(result != vk::Result::eSuccess) {
+    vk::detail::throwResultException(result,
+                                     std::source_location::current().function_name());
+  }
+
+  return vk::UniqueImage(imageRaw, _gpu->getDevice());
+}
@@ -34,5 +34,13 @@ public:
   [[nodiscard]]
   auto allocateImage(vk::ImageCreateInfo imageInfo,
                      AllocationInfo allocInfo) -> std::pair<Allocation, vk::UniqueImage> override;
+
+  [[nodiscard]]
+  auto allocateMemory(vk::MemoryRequirements requirements, AllocationInfo allocInfo)
+      -> Allocation override;
+
+  [[nodiscard]]
+  auto allocateAliasingImage(Allocation const& allocation, vk::DeviceSize offset,
+                             vk::ImageCreateInfo imageInfo) -> vk::UniqueImage override;
 };
 } // namespace pbr
@@ -0,0 +1,278 @@
+#include "pbr/memory/TransientAllocator.hpp"
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/core/GpuHandle.hpp"
+
+#include "pbr/memory/Allocation.hpp"
+#include "pbr/memory/AllocationInfo.hpp"
+#include "pbr/memory/IAllocator.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace constants {
+static constexpr vk::AccessFlags2 WRITE_ACCESS =
+    vk::AccessFlagBits2::eColorAttachmentWrite
+    | vk::AccessFlagBits2::eDepthStencilAttachmentWrite
+    | vk::AccessFlagBits2::eShaderStorageWrite | vk::AccessFlagBits2::eTransferWrite;
+} // namespace constants
+
+namespace {
+/**
+ * The stages and accesses an image with the usage may be used in.
+ */
+struct UsageScope {
+  vk::PipelineStageFlags2 stages;
+  vk::AccessFlags2 access;
+};
+[[nodiscard]]
+constexpr auto getUsageScope(vk::ImageUsageFlags const usage) noexcept -> UsageScope {
+  UsageScope scope {};
+  if (usage & vk::ImageUsageFlagBits::eColorAttachment) {
+    scope.stages |= vk::PipelineStageFlagBits2::eColorAttachmentOutput;
+    scope.access |= vk::AccessFlagBits2::eColorAttachmentRead
+                    | vk::AccessFlagBits2::eColorAttachmentWrite;
+  }
+  if (usage & vk::ImageUsageFlagBits::eDepthStencilAttachment) {
+    scope.stages |= vk::PipelineStageFlagBits2::eEarlyFragmentTests
+                    | vk::PipelineStageFlagBits2::eLateFragmentTests;
+    scope.access |= vk::AccessFlagBits2::eDepthStencilAttachmentRead
+                    | vk::AccessFlagBits2::eDepthStencilAttachmentWrite;
+  }
+  if (usage & vk::ImageUsageFlagBits::eStorage) {
+    scope.stages |= vk::PipelineStageFlagBits2::eComputeShader
+                    | vk::PipelineStageFlagBits2::eFragmentShader;
+    scope.access |= vk::AccessFlagBits2::eShaderStorageRead
+                    | vk::AccessFlagBits2::eShaderStorageWrite;
+  }
+  if (usage & vk::ImageUsageFlagBits::eSampled) {
+    scope.stages |= vk::PipelineStageFlagBits2::eComputeShader
+                    | vk::PipelineStageFlagBits2::eFragmentShader;
+    scope.access |= vk::AccessFlagBits2::eShaderSampledRead;
+  }
+  if (usage
+      & (vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst)) {
+    scope.stages |= vk::PipelineStageFlagBits2::eAllTransfer;
+    scope.access |=
+        vk::AccessFlagBits2::eTransferRead | vk::AccessFlagBits2::eTransferWrite;
+  }
+  return scope;
+}
+[[nodiscard]]
+constexpr auto sharesBytes(vk::DeviceSize const lhsOffset, vk::DeviceSize const lhsSize,
+                           vk::DeviceSize const rhsOffset,
+                           vk::DeviceSize const rhsSize) noexcept -> bool {
+  return lhsOffset < rhsOffset + rhsSize && rhsOffset < lhsOffset + lhsSize;
+}
+[[nodiscard]]
+constexpr auto alignUp(vk::DeviceSize const offset,
+                       vk::DeviceSize const alignment) noexcept -> vk::DeviceSize {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+auto pbr::placeTransientResources(std::span<TransientResource const> const resources)
+    -> TransientPlacement {
+  std::vector<std::size_t> order(resources.size());
+  std::ranges::iota(order, 0uz);
+  std::ranges::stable_sort(order, std::ranges::greater {},
+                           [&](auto const index) { return resources[index].size; });
+
+  TransientPlacement placement {
+      .offsets = std::vector<vk::DeviceSize>(resources.size(), 0),
+      .size = 0,
+  };
+  std::vector<std::size_t> placed;
+  placed.reserve(resources.size());
+  for (auto const index : order) {
+    auto const& resource = resources[index];
+    auto offset = vk::DeviceSize {0};
+    // Every conflict moves the offset past a placed resource, so this ends.
+    auto moved = true;
+    while (moved) {
+      moved = false;
+      offset = ::alignUp(offset, std::max(resource.alignment, vk::DeviceSize {1}));
+      for (auto const other : placed) {
+        auto const& otherResource = resources[other];
+        if (pbr::overlaps(resource.lifetime, otherResource.lifetime)
+            && ::sharesBytes(offset, resource.size, placement.offsets[other],
+                             otherResource.size)) {
+          offset = placement.offsets[other] + otherResource.size;
+          moved = true;
+          break;
+        }
+      }
+    }
+    placement.offsets[index] = offset;
+    placement.size = std::max(placement.size, offset + resource.size);
+    placed.push_back(index);
+  }
+  return placement;
+}
+
+auto pbr::getPeakTransientSize(std::span<TransientResource const> const resources)
+    -> vk::DeviceSize {
+  // The bytes in use only grow when a lifetime starts.
+  vk::DeviceSize peak = 0;
+  for (auto const& resource : resources) {
+    auto const pass = resource.lifetime.firstPass;
+    vk::DeviceSize size = 0;
+    for (auto const& other : resources) {
+      if (other.lifetime.firstPass <= pass && pass <= other.lifetime.lastPass) {
+        size += other.size;
+      }
+    }
+    peak = std::max(peak, size);
+  }
+  return peak;
+}
+
+pbr::TransientAllocator::TransientAllocator(core::SharedGpuHandle gpu,
+                                            std::shared_ptr<IAllocator> allocator)
+    : _gpu(std::move(gpu)), _allocator(std::move(allocator)), _stats() {}
+
+auto pbr::TransientAllocator::clear() noexcept -> void { _reservations.clear(); }
+
+auto pbr::TransientAllocator::reserveImage(vk::ImageCreateInfo const& info,
+                                           TransientLifetime const lifetime) -> void {
+  auto const requirements =
+      _gpu->getDevice()
+          .getImageMemoryRequirements(vk::DeviceImageMemoryRequirements {
+              .pCreateInfo = &info,
+          })
+          .memoryRequirements;
+  _reservations.push_back({
+      .info = info,
+      .lifetime = lifetime,
+      .requirements = requirements,
+      .offset = 0,
+      .aliased = false,
+      .claimed = false,
+  });
+}
+
+auto pbr::TransientAllocator::allocate() -> void {
+  _memory.reset();
+  _stats = {};
+  if (_reservations.empty()) {
+    return;
+  }
+
+  std::vector<TransientResource> resources;
+  resources.reserve(_reservations.size());
+  // All reservations share one allocation, so its type must suit every one of them.
+  auto memoryTypeBits = ~std::uint32_t {0};
+  for (auto const& reservation : _reservations) {
+    resources.push_back({
+        .size = reservation.requirements.size,
+        .alignment = reservation.requirements.alignment,
+        .lifetime = reservation.lifetime,
+    });
+    memoryTypeBits &= reservation.requirements.memoryTypeBits;
+  }
+  auto const placement = pbr::placeTransientResources(resources);
+
+  for (auto&& [reservation, offset] : std::views::zip(_reservations, placement.offsets)) {
+    reservation.offset = offset;
+    reservation.claimed = false;
+  }
+  for (auto& reservation : _reservations) {
+    reservation.aliased = std::ranges::any_of(_reservations, [&](auto const& other) {
+      return &reservation != &other
+             && ::sharesBytes(reservation.offset, reservation.requirements.size,
+                              other.offset, other.requirements.size);
+    });
+  }
+
+  _memory = _allocator->allocateMemory(
+      vk::MemoryRequirements {
+          .size = placement.size,
+          .alignment = std::ranges::max(resources, {}, &TransientResource::alignment)
+                           .alignment,
+          .memoryTypeBits = memoryTypeBits,
+      },
+      {.priority = AllocationPriority::Memory});
+  _stats = {
+      .summedSize = std::ranges::fold_left(resources, vk::DeviceSize {0},
+                                           [](auto const sum, auto const& resource) {
+                                             return sum + resource.size;
+                                           }),
+      .peakSize = pbr::getPeakTransientSize(resources),
+      .allocatedSize = placement.size,
+      .images = static_cast<std::uint32_t>(_reservations.size()),
+      .aliasedImages = static_cast<std::uint32_t>(
+          std::ranges::count(_reservations, true, &Reservation::aliased)),
+  };
+}
+
+auto pbr::TransientAllocator::recordAliasingBarriers(vk::CommandBuffer cmdBuffer,
+                                                     std::uint32_t const pass) const
+    -> void {
+  // One global barrier covers every image starting at the pass, the images start out
+  // undefined so their own barriers transition them from the undefined layout.
+  vk::MemoryBarrier2 barrier {};
+  for (auto const& reservation : _reservations) {
+    if (!reservation.aliased || reservation.lifetime.firstPass != pass) {
+      continue;
+    }
+    auto const scope = ::getUsageScope(reservation.info.usage);
+    barrier.dstStageMask |= scope.stages;
+    barrier.dstAccessMask |= scope.access;
+    for (auto const& other : _reservations) {
+      if (&reservation != &other
+          && ::sharesBytes(reservation.offset, reservation.requirements.size,
+                           other.offset, other.requirements.size)) {
+        auto const otherScope = ::getUsageScope(other.info.usage);
+        barrier.srcStageMask |= otherScope.stages;
+        barrier.srcAccessMask |= otherScope.access & constants::WRITE_ACCESS;
+      }
+    }
+  }
+  if (barrier.dstStageMask) {
+    cmdBuffer.pipelineBarrier2(vk::DependencyInfo {}.setMemoryBarriers(barrier));
+  }
+}
+
+auto pbr::TransientAllocator::allocateBuffer(vk::BufferCreateInfo const bufferInfo,
+                                             AllocationInfo const allocInfo)
+    -> std::pair<Allocation, vk::UniqueBuffer> {
+  return _allocator->allocateBuffer(bufferInfo, allocInfo);
+}
+
+auto pbr::TransientAllocator::allocateImage(vk::ImageCreateInfo const imageInfo,
+                                            AllocationInfo const allocInfo)
+    -> std::pair<Allocation, vk::UniqueImage> {
+  auto const reservation = std::ranges::find_if(_reservations, [&](auto const& reserved) {
+    return !reserved.claimed && reserved.info == imageInfo;
+  });
+  if (!_memory.has_value() || reservation == _reservations.end()) {
+    return _allocator->allocateImage(imageInfo, allocInfo);
+  }
+
+  reservation->claimed = true;
+  return std::make_pair(
+      Allocation(),
+      _allocator->allocateAliasingImage(*_memory, reservation->offset, imageInfo));
+}
+
+auto pbr::TransientAllocator::allocateMemory(vk::MemoryRequirements const requirements,
+                                             AllocationInfo const allocInfo)
+    -> Allocation {
+  return _allocator->allocateMemory(requirements, allocInfo);
+}
+
+auto pbr::TransientAllocator::allocateAliasingImage(Allocation const& allocation,
+                                                    vk::DeviceSize const offset,
+                                                    vk::ImageCreateInfo const imageInfo)
+    -> vk::UniqueImage {
+  return _allocator->allocateAliasingImage(allocation, offset, imageInfo);
+}
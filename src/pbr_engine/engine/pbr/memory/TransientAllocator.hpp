@@ -0,0 +1,151 @@
+#pragma once
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/core/GpuHandle.hpp"
+
+#include "pbr/memory/Allocation.hpp"
+#include "pbr/memory/AllocationInfo.hpp"
+#include "pbr/memory/IAllocator.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace pbr {
+/**
+ * The passes of a frame that use a resource, both inclusive.
+ */
+struct TransientLifetime {
+  std::uint32_t firstPass {};
+  std::uint32_t lastPass {};
+};
+/**
+ * A resource to place in the shared memory of the transient allocator.
+ */
+struct TransientResource {
+  vk::DeviceSize size {};
+  vk::DeviceSize alignment = 1;
+  TransientLifetime lifetime {};
+};
+/**
+ * Where the resources are placed in the shared memory.
+ */
+struct TransientPlacement {
+  /// The offsets in the order of the resources.
+  std::vector<vk::DeviceSize> offsets;
+  /// The bytes the shared memory needs.
+  vk::DeviceSize size {};
+};
+struct TransientMemoryStats {
+  /// The bytes the images would take with memory of their own.
+  vk::DeviceSize summedSize {};
+  /// The most bytes used by the images of a single pass.
+  vk::DeviceSize peakSize {};
+  /// The bytes of the shared memory, at least the peak.
+  vk::DeviceSize allocatedSize {};
+  std::uint32_t images {};
+  /// Images that share some of their memory with another image.
+  std::uint32_t aliasedImages {};
+};
+/**
+ * @returns Whether the passes of the lifetimes overlap.
+ */
+[[nodiscard]]
+constexpr auto overlaps(TransientLifetime lhs, TransientLifetime rhs) noexcept -> bool;
+/**
+ * Places the resources so that resources with overlapping lifetimes never share bytes.
+ *
+ * The largest resources are placed first, every one at the lowest aligned offset that is
+ * free throughout its lifetime.
+ */
+[[nodiscard]]
+auto placeTransientResources(std::span<TransientResource const> resources)
+    -> TransientPlacement;
+/**
+ * @returns The most bytes the resources alive in any single pass take.
+ */
+[[nodiscard]]
+auto getPeakTransientSize(std::span<TransientResource const> resources) -> vk::DeviceSize;
+/**
+ * Aliases images that are not used in the same passes of a frame onto one allocation.
+ *
+ * Images are reserved with their lifetimes first and allocate places them all in shared
+ * memory. allocateImage then hands out the reserved image matching the create info, and
+ * anything that was not reserved comes from the backing allocator.
+ */
+class TransientAllocator : public IAllocator {
+  struct Reservation {
+    vk::ImageCreateInfo info;
+    TransientLifetime lifetime;
+    vk::MemoryRequirements requirements;
+    vk::DeviceSize offset;
+    /// Whether the image shares bytes with another reservation.
+    bool aliased;
+    /// Whether allocateImage handed out the image.
+    bool claimed;
+  };
+
+  core::SharedGpuHandle _gpu;
+  std::shared_ptr<IAllocator> _allocator;
+  std::vector<Reservation> _reservations;
+  std::optional<Allocation> _memory;
+  TransientMemoryStats _stats;
+
+public:
+  TransientAllocator(core::SharedGpuHandle gpu, std::shared_ptr<IAllocator> allocator);
+
+  /**
+   * Drops the reservations, the shared memory is kept until the next allocate.
+   */
+  auto clear() noexcept -> void;
+  auto reserveImage(vk::ImageCreateInfo const& info, TransientLifetime lifetime) -> void;
+  /**
+   * Places the reservations and allocates the memory they share.
+   * @note Frees the previous memory, so the images of the previous reservations must not
+   * be used anymore.
+   */
+  auto allocate() -> void;
+  /**
+   * Makes the images whose lifetime starts at the pass wait for the images sharing their
+   * memory, which were last used in an earlier pass or the previous frame.
+   */
+  auto recordAliasingBarriers(vk::CommandBuffer cmdBuffer, std::uint32_t pass) const
+      -> void;
+
+  [[nodiscard]]
+  constexpr auto getStats() const noexcept -> TransientMemoryStats;
+
+  [[nodiscard]]
+  auto allocateBuffer(vk::BufferCreateInfo bufferInfo, AllocationInfo allocInfo)
+      -> std::pair<Allocation, vk::UniqueBuffer> override;
+  /**
+   * @returns A reserved image bound to the shared memory and an allocation without
+   * memory, or an image of the backing allocator if no reservation matches.
+   */
+  [[nodiscard]]
+  auto allocateImage(vk::ImageCreateInfo imageInfo, AllocationInfo allocInfo)
+      -> std::pair<Allocation, vk::UniqueImage> override;
+  [[nodiscard]]
+  auto allocateMemory(vk::MemoryRequirements requirements, AllocationInfo allocInfo)
+      -> Allocation override;
+  [[nodiscard]]
+  auto allocateAliasingImage(Allocation const& allocation, vk::DeviceSize offset,
+                             vk::ImageCreateInfo imageInfo) -> vk::UniqueImage override;
+};
+} // namespace pbr
+
+/* IMPLEMENTATIONS */
+
+constexpr auto pbr::overlaps(TransientLifetime const lhs,
+                             TransientLifetime const rhs) noexcept -> bool {
+  return lhs.firstPass <= rhs.lastPass && rhs.firstPass <= lhs.lastPass;
+}
+
+constexpr auto pbr::TransientAllocator::getStats() const noexcept
+    -> TransientMemoryStats {
+  return _stats;
+}
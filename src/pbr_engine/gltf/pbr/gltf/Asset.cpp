@@ -4,26 +4,33 @@
 
 #include "pbr/core/GpuHandle.hpp"
 
+#include "pbr/BoundingBox.hpp"
 #include "pbr/CameraUniform.hpp"
 #include "pbr/DescriptorSetAllocator.hpp"
 #include "pbr/Image2D.hpp"
+#include "pbr/Light.hpp"
 #include "pbr/Material.hpp"
+#include "pbr/MaterialRegistry.hpp"
 #include "pbr/Mesh.hpp"
 #include "pbr/MeshBuilder.hpp"
 #include "pbr/MeshVertex.hpp"
 #include "pbr/Scene.hpp"
+#include "pbr/SoftwareOcclusionCuller.hpp"
 #include "pbr/TransferStager.hpp"
 #include "pbr/Uniform.hpp"
 #include "pbr/image/LoadImage.hpp"
 
 #include <cassert>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <filesystem>
 #include <format>
 #include <iterator>
 #include <memory>
 #include <memory_resource>
+#include <optional>
 #include <print>
 #include <span>
 #include <stdexcept>
@@ -50,8 +57,69 @@ static constexpr auto NORMAL_NAME = "NORMAL";
 static constexpr auto TANGENT_NAME = "TANGENT";
 [[maybe_unused]]
 static constexpr auto TEX_COORDS_NAME = "TEXCOORD_0";
+/// Lights without a range are cut off where their intensity falls below this.
+static constexpr auto MIN_LIGHT_INTENSITY = 0.01f;
+/// Levels of detail built for every primitive, each halves the triangles.
+static constexpr std::uint32_t LOD_COUNT = 3;
 } // namespace constants
 
+namespace {
+[[nodiscard]]
+constexpr auto getTransform(fastgltf::Node const& gltfNode) -> pbr::Transform {
+  auto const trs = std::get<fastgltf::TRS>(gltfNode.transform);
+  return {
+      .position {trs.translation.x(), trs.translation.y(), trs.translation.z()},
+      .rotation {trs.rotation.w(), trs.rotation.x(), trs.rotation.y(), trs.rotation.z()},
+      .scale {trs.scale.x(), trs.scale.y(), trs.scale.z()},
+  };
+}
+[[nodiscard]]
+constexpr auto getLightType(fastgltf::LightType type) -> pbr::LightType {
+  switch (type) {
+  case fastgltf::LightType::Directional:
+    return pbr::LightType::Directional;
+  case fastgltf::LightType::Spot:
+    return pbr::LightType::Spot;
+  case fastgltf::LightType::Point:
+    return pbr::LightType::Point;
+  }
+  std::unreachable();
+}
+/**
+ * @returns The bounds of a position accessor or nothing if it has none.
+ */
+[[nodiscard]]
+constexpr auto getBoundingBox(fastgltf::Accessor const& accessor)
+    -> std::optional<pbr::BoundingBox> {
+  if (!accessor.min || !accessor.max || accessor.min->size() < 3
+      || accessor.max->size() < 3) {
+    return std::nullopt;
+  }
+  auto const toVec3 = [](fastgltf::AccessorBoundsArray const& bounds) {
+    return glm::vec3(bounds.get<double>(0), bounds.get<double>(1), bounds.get<double>(2));
+  };
+  return pbr::BoundingBox {
+      .min = toVec3(*accessor.min),
+      .max = toVec3(*accessor.max),
+  };
+}
+[[nodiscard]]
+constexpr auto getLight(fastgltf::Light const& gltfLight) -> pbr::Light {
+  pbr::Light const defaults {};
+  return {
+      .type = ::getLightType(gltfLight.type),
+      .color {gltfLight.color.x(), gltfLight.color.y(), gltfLight.color.z()},
+      .intensity = gltfLight.intensity,
+      // Without a range the light falls off with the inverse square forever, the tiles
+      // need a bound so it ends where it stops being visible.
+      .range = gltfLight.range.value_or(
+          std::sqrt(gltfLight.intensity / constants::MIN_LIGHT_INTENSITY)),
+      .innerConeAngle = gltfLight.innerConeAngle.value_or(defaults.innerConeAngle),
+      .outerConeAngle = gltfLight.outerConeAngle.value_or(defaults.outerConeAngle),
+  };
+}
+} // namespace
+
 class ImageDataSourceVisitor {
   fastgltf::Asset const* _asset;
   pbr::core::GpuHandle const* _gpu;
@@ -148,13 +216,18 @@ auto pbr::gltf::Asset::loadMaterial(TransferStager& stager, std::size_t index)
       _asset.textures.at(matInfo.pbrData.baseColorTexture.value().textureIndex);
   auto const& normalTexture =
       _asset.textures.at(matInfo.normalTexture.value().textureIndex);
+  auto* const registry = _dependencies.materialRegistry;
   auto material = std::make_shared<Material>(
       *_dependencies.gpu, Uniform<MaterialData>(*_dependencies.allocator, matData),
       loadImage2D(stager, colorTexture.imageIndex.value()),
       loadSampler(colorTexture.samplerIndex.value()),
       loadImage2D(stager, normalTexture.imageIndex.value()),
       loadSampler(normalTexture.samplerIndex.value()),
-      _dependencies.materialAllocator.allocate());
+      registry != nullptr ? vk::UniqueDescriptorSet {}
+                          : _dependencies.materialAllocator.allocate());
+  if (registry != nullptr) {
+    registry->registerMaterial(material);
+  }
   _materialCache[matInfo.name] = material;
   return material;
 }
@@ -204,6 +277,7 @@ auto pbr::gltf::Asset::loadPrimitive(TransferStager& stager,
       .material = loadMaterial(stager, primitive.materialIndex.value()),
       .vertices = std::move(vertices),
       .indices = std::move(indices),
+      .boundingBox = ::getBoundingBox(positionAcc),
   };
 }
 
@@ -215,6 +289,7 @@ auto pbr::gltf::Asset::loadMesh(TransferStager& stager, std::size_t index)
   }
 
   MeshBuilder meshBuilder;
+  meshBuilder.setLodCount(constants::LOD_COUNT).setMeshlets(true);
   for (auto const& primitive : meshInfo.primitives) {
     meshBuilder.addPrimitive(loadPrimitive(stager, primitive));
   }
@@ -225,49 +300,69 @@ auto pbr::gltf::Asset::loadMesh(TransferStager& stager, std::size_t index)
   std::vector<std::byte> indices(builtMesh.indices.size() * sizeof(std::uint16_t));
   std::memcpy(indices.data(), builtMesh.indices.data(), indices.size());
 
+  // Simple meshes like walls and floors make cheap occluders, the levels of detail at
+  // the end of the indices are not part of them.
+  auto triangleCount = 0uz;
+  for (auto const& primitive : builtMesh.primitives) {
+    triangleCount += primitive.indexCount / 3;
+  }
+  std::shared_ptr<OccluderMesh const> occluder;
+  if (triangleCount <= SoftwareOcclusionCuller::MAX_OCCLUDER_TRIANGLES) {
+    occluder = std::make_shared<OccluderMesh const>(pbr::makeOccluderMesh(builtMesh));
+  }
+
   auto mesh = std::make_shared<Mesh>(
       stager.addTransfer(std::move(vertices), vk::BufferUsageFlagBits::eVertexBuffer),
       stager.addTransfer(std::move(indices), vk::BufferUsageFlagBits::eIndexBuffer),
       std::move(builtMesh.primitives));
+  mesh->setOccluder(std::move(occluder));
   _meshCache[meshInfo.name] = mesh;
   return mesh;
 }
 
-auto pbr::gltf::Asset::loadNode(TransferStager& stager, std::size_t index,
-                                std::pmr::polymorphic_allocator<> alloc) -> Node {
+auto pbr::gltf::Asset::loadNode(TransferStager& stager, std::size_t index, Scene& scene)
+    -> Node {
   auto const& gltfNode = _asset.nodes.at(index);
-  auto const trs = std::get<fastgltf::TRS>(gltfNode.transform);
-  Transform const transform {
-      .position {trs.translation.x(), trs.translation.y(), trs.translation.z()},
-      .rotation {trs.rotation.w(), trs.rotation.x(), trs.rotation.y(), trs.rotation.z()},
-      .scale {trs.scale.x(), trs.scale.y(), trs.scale.z()},
-  };
-
-  Node node(std::pmr::string(gltfNode.name, alloc), transform, alloc);
-
-  for (auto const childIdx : gltfNode.children) {
-    node.addChild(loadNode(stager, childIdx, alloc));
-  }
-
-  if (gltfNode.meshIndex) {
-    node.setMesh(loadMesh(stager, *gltfNode.meshIndex));
-  }
+  auto node = scene.addNode(gltfNode.name, ::getTransform(gltfNode));
+  populateNode(stager, gltfNode, node);
+  return node;
+}
 
+auto pbr::gltf::Asset::loadNode(TransferStager& stager, std::size_t index, Node parent)
+    -> Node {
+  auto const& gltfNode = _asset.nodes.at(index);
+  auto node = parent.addChild(gltfNode.name, ::getTransform(gltfNode));
+  populateNode(stager, gltfNode, node);
   return node;
 }
 
 auto pbr::gltf::Asset::loadScene(TransferStager& stager, std::size_t index,
                                  std::pmr::polymorphic_allocator<> alloc) -> Scene {
   Scene scene(alloc);
-  scene.addNode(Node(std::pmr::string("DefaultCamera", alloc), alloc))
+  scene.addNode("DefaultCamera")
       .setCamera(
-          std::make_shared<CameraUniform>(*_dependencies.gpu, *_dependencies.allocator,
-                                          _dependencies.cameraAllocator.allocate()));
+          std::make_shared<CameraUniform>(
+              *_dependencies.gpu, *_dependencies.allocator,
+              _dependencies.cameraAllocator.allocate(_dependencies.framesInFlight)));
 
   auto const& gltfScene = _asset.scenes.at(index);
   for (auto const nodeIdx : gltfScene.nodeIndices) {
-    scene.addNode(loadNode(stager, nodeIdx, alloc));
+    loadNode(stager, nodeIdx, scene);
   }
 
   return scene;
 }
+
+auto pbr::gltf::Asset::populateNode(TransferStager& stager, fastgltf::Node const& gltfNode,
+                                    Node node) -> void {
+  if (gltfNode.meshIndex) {
+    node.setMesh(loadMesh(stager, *gltfNode.meshIndex));
+  }
+  if (gltfNode.lightIndex) {
+    node.setLight(::getLight(_asset.lights.at(*gltfNode.lightIndex)));
+  }
+
+  for (auto const childIdx : gltfNode.children) {
+    loadNode(stager, childIdx, node);
+  }
+}
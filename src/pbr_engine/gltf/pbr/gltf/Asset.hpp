@@ -8,12 +8,14 @@
 
 #include "pbr/Image2D.hpp"
 #include "pbr/Material.hpp"
+#include "pbr/MaterialRegistry.hpp"
 #include "pbr/Mesh.hpp"
 #include "pbr/Scene.hpp"
 #include "pbr/TransferStager.hpp"
 #include "pbr/memory/IAllocator.hpp"
 
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <memory_resource>
 #include <string>
@@ -28,6 +30,10 @@ struct AssetDependencies {
   std::shared_ptr<IAllocator> allocator;
   DescriptorSetAllocator cameraAllocator;
   DescriptorSetAllocator materialAllocator;
+  /// Materials are registered here instead of getting their own descriptor set if set.
+  MaterialRegistry* materialRegistry = nullptr;
+  /// Cameras get a uniform for every frame in flight.
+  std::uint32_t framesInFlight = 1;
 };
 /**
  * Contains data for a gltf asset.
@@ -69,12 +75,23 @@ public:
   [[nodiscard]]
   auto loadMesh(TransferStager& stager, std::size_t index) -> std::shared_ptr<Mesh>;
 
-  [[nodiscard]]
-  auto loadNode(TransferStager& stager, std::size_t index,
-                std::pmr::polymorphic_allocator<> alloc = {}) -> Node;
+  /**
+   * Adds the gltf node at index and all of its descendants as a top level node of scene.
+   * @note Nodes keep their KHR_lights_punctual light.
+   */
+  auto loadNode(TransferStager& stager, std::size_t index, Scene& scene) -> Node;
+
+  /**
+   * Adds the gltf node at index and all of its descendants as a child of parent.
+   */
+  auto loadNode(TransferStager& stager, std::size_t index, Node parent) -> Node;
 
   [[nodiscard]]
   auto loadScene(TransferStager& stager, std::size_t index,
                  std::pmr::polymorphic_allocator<> alloc = {}) -> Scene;
+
+private:
+  auto populateNode(TransferStager& stager, fastgltf::Node const& gltfNode, Node node)
+      -> void;
 };
 } // namespace pbr::gltf
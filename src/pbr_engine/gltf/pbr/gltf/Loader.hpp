@@ -11,7 +11,12 @@ namespace pbr::gltf {
  * Type that caches the fastgltf::Parser for asset loading.
  */
 class Loader {
-  fastgltf::Parser _parser;
+public:
+  /// The extensions the assets are parsed with, the rest is ignored.
+  static constexpr auto EXTENSIONS = fastgltf::Extensions::KHR_lights_punctual;
+
+private:
+  fastgltf::Parser _parser {EXTENSIONS};
 
 public:
   /**
@@ -94,7 +94,8 @@ constexpr auto createDescriptorSet(pbr::core::GpuHandle const& gpu,
 pbr::imgui::Renderer::Renderer(core::SharedGpuHandle gpu,
                                std::shared_ptr<IAllocator> allocator,
                                vk::CommandPool const cmdPool,
-                               PipelineCreateInfo const info)
+                               PipelineCreateInfo const info,
+                               std::uint32_t const frameCount)
     : _gpu(std::move(gpu))
     , _allocator(std::move(allocator))
     , _fontImage(::createFontImage(_gpu, _allocator, cmdPool))
@@ -107,7 +108,8 @@ pbr::imgui::Renderer::Renderer(core::SharedGpuHandle gpu,
       }))
     , _pipeline(*_gpu, info)
     , _descPool(::createDescriptorPool(*_gpu))
-    , _descSet(::createDescriptorSet(*_gpu, _pipeline, _descPool.get())) {
+    , _descSet(::createDescriptorSet(*_gpu, _pipeline, _descPool.get()))
+    , _frames(frameCount) {
   vk::DescriptorImageInfo const imageInfo {
       .sampler = _fontSampler.get(),
       .imageView = _fontImage.getImageView(),
@@ -122,7 +124,8 @@ pbr::imgui::Renderer::Renderer(core::SharedGpuHandle gpu,
       {});
 }
 
-auto pbr::imgui::Renderer::render(vk::CommandBuffer cmdBuffer) -> void {
+auto pbr::imgui::Renderer::render(vk::CommandBuffer cmdBuffer,
+                                  std::uint32_t const frameIndex) -> void {
   auto const& imguiIo = ImGui::GetIO();
   auto const* const drawData = ImGui::GetDrawData();
 
@@ -130,7 +133,8 @@ auto pbr::imgui::Renderer::render(vk::CommandBuffer cmdBuffer) -> void {
     return;
   }
 
-  updateBuffers(drawData);
+  auto& frame = _frames[frameIndex % _frames.size()];
+  updateBuffers(frame, drawData);
 
   cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, _pipeline.getPipeline());
   cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
@@ -145,10 +149,11 @@ auto pbr::imgui::Renderer::render(vk::CommandBuffer cmdBuffer) -> void {
   std::int32_t vertexOffset {};
   std::uint32_t indexOffset {};
 
-  cmdBuffer.bindVertexBuffers(0, _vertexBuffer->buffer.getBuffer(), {0});
+  cmdBuffer.bindVertexBuffers(0, frame.vertexBuffer->buffer.getBuffer(), {0});
   static_assert(sizeof(ImDrawIdx) == sizeof(std::uint16_t),
                 "Imgui index size is unsuported");
-  cmdBuffer.bindIndexBuffer(_indexBuffer->buffer.getBuffer(), 0, vk::IndexType::eUint16);
+  cmdBuffer.bindIndexBuffer(frame.indexBuffer->buffer.getBuffer(), 0,
+                            vk::IndexType::eUint16);
 
   for (auto const* const cmdList : drawData->CmdLists) {
     for (auto cmd : std::span(cmdList->CmdBuffer.Data, cmdList->CmdBuffer.Size)) {
@@ -171,7 +176,8 @@ auto pbr::imgui::Renderer::render(vk::CommandBuffer cmdBuffer) -> void {
   }
 }
 
-auto pbr::imgui::Renderer::updateBuffers(ImDrawData const* const data) -> void {
+auto pbr::imgui::Renderer::updateBuffers(FrameBuffers& frame,
+                                         ImDrawData const* const data) -> void {
   AllocationInfo const allocInfo {
       .preference = AllocationPreference::Host,
       .priority = AllocationPriority::Time,
@@ -213,6 +219,6 @@ auto pbr::imgui::Renderer::updateBuffers(ImDrawData const* const data) -> void {
     std::memcpy(ibMapping.get(), indices.data(), ibSize);
   }
 
-  _vertexBuffer.emplace(std::move(vertexBuffer), vbSize);
-  _indexBuffer.emplace(std::move(indexBuffer), ibSize);
+  frame.vertexBuffer.emplace(std::move(vertexBuffer), vbSize);
+  frame.indexBuffer.emplace(std::move(indexBuffer), ibSize);
 }
@@ -11,8 +11,10 @@
 
 #include "imgui.h"
 
+#include <cstdint>
 #include <memory>
 #include <optional>
+#include <vector>
 
 namespace pbr::imgui {
 /**
@@ -23,6 +25,11 @@ class Renderer {
     Buffer buffer;
     vk::DeviceSize size;
   };
+  /// The buffers of a frame are only replaced once the frame has finished.
+  struct FrameBuffers {
+    std::optional<ImguiBuffer> vertexBuffer = std::nullopt;
+    std::optional<ImguiBuffer> indexBuffer = std::nullopt;
+  };
 
   core::SharedGpuHandle _gpu;
   std::shared_ptr<IAllocator> _allocator;
@@ -35,8 +42,7 @@ class Renderer {
   vk::UniqueDescriptorPool _descPool;
   vk::DescriptorSet _descSet;
 
-  std::optional<ImguiBuffer> _vertexBuffer = std::nullopt;
-  std::optional<ImguiBuffer> _indexBuffer = std::nullopt;
+  std::vector<FrameBuffers> _frames;
 
 public:
   /**
@@ -48,21 +54,24 @@ public:
    * @param cmdPool The command pool to use for the command buffer that will stage the
    * font image copy.
    * @param info The info for the imgui render pipeline.
+   * @param frameCount The number of frames in flight, each one gets its own vertex and
+   * index buffers.
    *
    * @note This constructor blocks until font image gets copied on the gpu.
    */
   Renderer(core::SharedGpuHandle gpu, std::shared_ptr<IAllocator> allocator,
-           vk::CommandPool cmdPool, PipelineCreateInfo info);
+           vk::CommandPool cmdPool, PipelineCreateInfo info,
+           std::uint32_t frameCount = 1);
 
   /**
    * Records imgui render commands to the provided cmdBuffer.
    */
-  auto render(vk::CommandBuffer cmdBuffer) -> void;
+  auto render(vk::CommandBuffer cmdBuffer, std::uint32_t frameIndex) -> void;
 
 private:
   /**
-   * Updates the contained vertex and index buffers with the provided data.
+   * Updates the vertex and index buffers of the frame with the provided data.
    */
-  auto updateBuffers(ImDrawData const* data) -> void;
+  auto updateBuffers(FrameBuffers& frame, ImDrawData const* data) -> void;
 };
 } // namespace pbr::imgui
@@ -0,0 +1,284 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "pbr/BoundingBox.hpp"
+#include "pbr/CameraData.hpp"
+#include "pbr/CpuKernels.hpp"
+#include "pbr/DepthPyramidSystem.hpp"
+#include "pbr/Frustum.hpp"
+#include "pbr/FrustumCuller.hpp"
+#include "pbr/MeshBuilder.hpp"
+#include "pbr/MeshVertex.hpp"
+#include "pbr/Meshlet.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ranges>
+#include <span>
+#include <vector>
+
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/ext/vector_float2.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+#include <glm/geometric.hpp>
+#include <glm/trigonometric.hpp>
+#include <glm/vector_relational.hpp>
+
+TEST_CASE("Spheres are tested against the frustum", "[pbr::Frustum]") {
+  auto const camera = pbr::makeCameraData({0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, -1.0f},
+                                          glm::radians(90.0f), 1.0f);
+  auto const planes = pbr::extractFrustumPlanes(camera.proj * camera.view);
+
+  REQUIRE(pbr::isSphereInFrustum(planes, {0.0f, 0.0f, -10.0f, 1.0f}));
+  // Behind the camera.
+  REQUIRE_FALSE(pbr::isSphereInFrustum(planes, {0.0f, 0.0f, 10.0f, 1.0f}));
+  // Beyond the far plane.
+  REQUIRE_FALSE(pbr::isSphereInFrustum(planes, {0.0f, 0.0f, -2048.0f, 1.0f}));
+  // Outside of the side planes but large enough to reach inside.
+  REQUIRE_FALSE(pbr::isSphereInFrustum(planes, {20.0f, 0.0f, -10.0f, 1.0f}));
+  REQUIRE(pbr::isSphereInFrustum(planes, {20.0f, 0.0f, -10.0f, 8.0f}));
+}
+
+TEST_CASE("Boxes are tested against the frustum", "[pbr::Frustum]") {
+  auto const camera = pbr::makeCameraData({0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, -1.0f},
+                                          glm::radians(90.0f), 1.0f);
+  auto const planes = pbr::extractFrustumPlanes(camera.proj * camera.view);
+
+  REQUIRE(pbr::isBoxInFrustum(planes, {.min = {-1.0f, -1.0f, -11.0f},
+                                       .max = {1.0f, 1.0f, -9.0f}}));
+  // Behind the camera.
+  REQUIRE_FALSE(pbr::isBoxInFrustum(planes, {.min = {-1.0f, -1.0f, 9.0f},
+                                             .max = {1.0f, 1.0f, 11.0f}}));
+  // Outside of the side planes unless wide enough to reach inside.
+  REQUIRE_FALSE(pbr::isBoxInFrustum(planes, {.min = {19.0f, -1.0f, -11.0f},
+                                             .max = {21.0f, 1.0f, -9.0f}}));
+  REQUIRE(pbr::isBoxInFrustum(planes, {.min = {8.0f, -1.0f, -11.0f},
+                                       .max = {21.0f, 1.0f, -9.0f}}));
+}
+
+TEST_CASE("Transformed boxes enclose their transformed corners", "[pbr::BoundingBox]") {
+  pbr::BoundingBox const box {.min = {-1.0f, 0.0f, 2.0f}, .max = {3.0f, 1.0f, 4.0f}};
+  auto model = glm::translate(glm::mat4x4(1.0f), {5.0f, -2.0f, 1.0f});
+  model = glm::rotate(model, glm::radians(30.0f), {0.0f, 1.0f, 0.0f});
+  model = glm::scale(model, {2.0f, 1.0f, 0.5f});
+
+  auto const transformed = pbr::transformBoundingBox(model, box);
+  for (auto corner = 0u; corner < 8; ++corner) {
+    glm::vec3 const position {
+        (corner & 1u) != 0 ? box.max.x : box.min.x,
+        (corner & 2u) != 0 ? box.max.y : box.min.y,
+        (corner & 4u) != 0 ? box.max.z : box.min.z,
+    };
+    auto const world = glm::vec3(model * glm::vec4(position, 1.0f));
+    REQUIRE(glm::all(glm::greaterThanEqual(world, transformed.min - 1e-4f)));
+    REQUIRE(glm::all(glm::lessThanEqual(world, transformed.max + 1e-4f)));
+  }
+
+  auto const sphere = pbr::makeBoundingSphere(box);
+  REQUIRE(glm::vec3(sphere) == glm::vec3 {1.0f, 0.5f, 3.0f});
+  REQUIRE(sphere.w == glm::distance(box.min, box.max) * 0.5f);
+}
+
+TEST_CASE("Batched frustum tests match testing every box", "[pbr::FrustumCuller]") {
+  auto const camera = pbr::makeCameraData({0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, -1.0f},
+                                          glm::radians(60.0f), 1.5f);
+  auto const planes = pbr::extractFrustumPlanes(camera.proj * camera.view);
+
+  // Not a multiple of the lanes, so the last batch is padded.
+  std::vector<pbr::BoundingBox> boxes;
+  for (auto x = -5; x <= 5; ++x) {
+    for (auto z = -2; z <= 2; ++z) {
+      glm::vec3 const center {static_cast<float>(x) * 4.3f, 0.7f,
+                              static_cast<float>(z) * 6.1f};
+      boxes.push_back({.min = center - 0.8f, .max = center + 0.8f});
+    }
+  }
+  REQUIRE(boxes.size() % pbr::FrustumCuller::LANES != 0);
+
+  pbr::FrustumCuller culler;
+  auto const visible = culler.cull(planes, boxes);
+  REQUIRE(visible.size() == boxes.size());
+  std::uint32_t visibleCount = 0;
+  for (auto index = 0uz; index < boxes.size(); ++index) {
+    REQUIRE((visible[index] != 0) == pbr::isBoxInFrustum(planes, boxes[index]));
+    visibleCount += visible[index];
+  }
+  // Some boxes are on either side of the planes.
+  REQUIRE(visibleCount > 0);
+  REQUIRE(visibleCount < boxes.size());
+}
+
+TEST_CASE("AVX2 frustum tests match the scalar ones", "[pbr::FrustumCuller]") {
+  if (pbr::getBestCpuKernels() != pbr::CpuKernels::Avx2) {
+    SKIP("The cpu does not support AVX2");
+  }
+  auto const camera = pbr::makeCameraData({0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, -1.0f},
+                                          glm::radians(60.0f), 1.5f);
+  auto const planes = pbr::extractFrustumPlanes(camera.proj * camera.view);
+
+  std::vector<pbr::BoundingBox> boxes;
+  for (auto x = -6; x <= 6; ++x) {
+    for (auto y = -3; y <= 3; ++y) {
+      for (auto z = -6; z <= 1; ++z) {
+        glm::vec3 const center {static_cast<float>(x) * 2.9f,
+                                static_cast<float>(y) * 1.7f,
+                                static_cast<float>(z) * 5.3f};
+        auto const extent = 0.2f + (static_cast<float>((x + y + z + 15) % 5) * 0.4f);
+        boxes.push_back({.min = center - extent, .max = center + extent});
+      }
+    }
+  }
+
+  pbr::FrustumCuller scalar(pbr::CpuKernels::Scalar);
+  pbr::FrustumCuller avx2(pbr::CpuKernels::Avx2);
+  REQUIRE(scalar.getKernels() == pbr::CpuKernels::Scalar);
+  REQUIRE(avx2.getKernels() == pbr::CpuKernels::Avx2);
+  REQUIRE(std::ranges::equal(scalar.cull(planes, boxes), avx2.cull(planes, boxes)));
+}
+
+TEST_CASE("Known bounds are used instead of the vertices", "[pbr::MeshBuilder]") {
+  std::vector<pbr::MeshVertex> const vertices {
+      {.position = {0.0f, 0.0f, 0.0f}},
+      {.position = {1.0f, 2.0f, 0.0f}},
+  };
+  pbr::BoundingBox const known {.min = {-1.0f, -1.0f, -1.0f}, .max = {1.0f, 3.0f, 1.0f}};
+  auto const builtMesh = pbr::MeshBuilder()
+                             .addPrimitive({.vertices = vertices, .indices = {0, 1}})
+                             .addPrimitive({
+                                 .vertices = vertices,
+                                 .indices = {0, 1},
+                                 .boundingBox = known,
+                             })
+                             .build();
+
+  auto const& computed = builtMesh.primitives[0];
+  REQUIRE(computed.boundingBox.min == glm::vec3 {0.0f, 0.0f, 0.0f});
+  REQUIRE(computed.boundingBox.max == glm::vec3 {1.0f, 2.0f, 0.0f});
+  REQUIRE(builtMesh.primitives[1].boundingBox.min == known.min);
+  REQUIRE(builtMesh.primitives[1].boundingBox.max == known.max);
+  REQUIRE(builtMesh.primitives[1].boundingSphere == pbr::makeBoundingSphere(known));
+}
+
+TEST_CASE("Bounding spheres enclose every vertex", "[pbr::MeshBuilder]") {
+  std::array const vertices {
+      pbr::MeshVertex {.position = {-1.0f, 0.0f, 0.0f}},
+      pbr::MeshVertex {.position = {3.0f, 0.0f, 0.0f}},
+      pbr::MeshVertex {.position = {1.0f, 2.0f, 0.0f}},
+  };
+  auto const sphere = pbr::computeBoundingSphere(vertices);
+
+  REQUIRE(glm::vec3(sphere) == glm::vec3 {1.0f, 1.0f, 0.0f});
+  for (auto const& vertex : vertices) {
+    REQUIRE(glm::distance(glm::vec3(sphere), vertex.position) <= sphere.w);
+  }
+  REQUIRE(pbr::computeBoundingSphere({}) == glm::vec4 {});
+}
+
+TEST_CASE("Depth pyramids halve down to a single texel", "[pbr::DepthPyramidSystem]") {
+  auto const extent = pbr::DepthPyramidSystem::getExtent({.width = 1920, .height = 1080});
+  REQUIRE(extent == vk::Extent2D {.width = 960, .height = 540});
+  // 960, 480, 240, 120, 60, 30, 15, 7, 3 and 1.
+  REQUIRE(pbr::DepthPyramidSystem::getLevelCount(extent) == 10);
+
+  auto const single = pbr::DepthPyramidSystem::getExtent({.width = 1, .height = 1});
+  REQUIRE(single == vk::Extent2D {.width = 1, .height = 1});
+  REQUIRE(pbr::DepthPyramidSystem::getLevelCount(single) == 1);
+}
+
+TEST_CASE("Projected spheres are covered by their screen bounds",
+          "[pbr::DepthPyramidSystem]") {
+  auto const camera = pbr::makeCameraData({0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, -1.0f},
+                                          glm::radians(90.0f), 1.0f);
+  auto const viewProj = camera.proj * camera.view;
+  glm::vec4 const sphere {2.0f, -1.0f, -10.0f, 1.5f};
+
+  auto const bounds = pbr::projectSphere(viewProj, sphere);
+  REQUIRE(bounds.has_value());
+  std::array const directions {
+      glm::vec3 {1.0f, 0.0f, 0.0f}, glm::vec3 {-1.0f, 0.0f, 0.0f},
+      glm::vec3 {0.0f, 1.0f, 0.0f}, glm::vec3 {0.0f, -1.0f, 0.0f},
+      glm::vec3 {0.0f, 0.0f, 1.0f}, glm::vec3 {0.0f, 0.0f, -1.0f},
+      glm::vec3 {0.6f, 0.8f, 0.0f}, glm::vec3 {0.0f, -0.6f, 0.8f},
+  };
+  for (auto const direction : directions) {
+    auto const clip =
+        viewProj * glm::vec4(glm::vec3(sphere) + (direction * sphere.w), 1.0f);
+    auto const ndc = glm::vec3(clip) / clip.w;
+    auto const uv = (glm::vec2(ndc) * 0.5f) + 0.5f;
+    REQUIRE(glm::all(glm::greaterThanEqual(uv, bounds->min)));
+    REQUIRE(glm::all(glm::lessThanEqual(uv, bounds->max)));
+    REQUIRE(bounds->depth <= ndc.z);
+  }
+
+  // Around the camera the bounds cannot be projected, so it is never occluded.
+  REQUIRE_FALSE(pbr::projectSphere(viewProj, {0.0f, 0.0f, -1.0f, 2.0f}).has_value());
+}
+
+TEST_CASE("Meshlets split every triangle within their limits", "[pbr::Meshlet]") {
+  // A flat grid of 40 by 40 quads facing up.
+  static constexpr std::uint16_t SIZE = 40;
+  pbr::MeshBuilder::Primitive grid;
+  for (auto z = 0u; z <= SIZE; ++z) {
+    for (auto x = 0u; x <= SIZE; ++x) {
+      grid.vertices.push_back({.position = {static_cast<float>(x) / SIZE, 0.0f,
+                                            static_cast<float>(z) / SIZE}});
+    }
+  }
+  for (auto z = 0u; z < SIZE; ++z) {
+    for (auto x = 0u; x < SIZE; ++x) {
+      auto const first = static_cast<std::uint16_t>((z * (SIZE + 1)) + x);
+      auto const below = static_cast<std::uint16_t>(first + SIZE + 1);
+      grid.indices.insert(grid.indices.end(),
+                          {first, below, static_cast<std::uint16_t>(first + 1),
+                           static_cast<std::uint16_t>(first + 1), below,
+                           static_cast<std::uint16_t>(below + 1)});
+    }
+  }
+  auto const builtMesh = pbr::MeshBuilder().addPrimitive(grid).setMeshlets(true).build();
+
+  auto const& primitive = builtMesh.primitives[0];
+  REQUIRE(primitive.meshlets.size() > 1);
+  auto end = primitive.firstIndex;
+  for (auto const& meshlet : primitive.meshlets) {
+    REQUIRE(meshlet.firstIndex == end);
+    REQUIRE(meshlet.indexCount % 3 == 0);
+    REQUIRE(meshlet.indexCount / 3 <= pbr::MAX_MESHLET_TRIANGLES);
+    end += meshlet.indexCount;
+
+    std::vector<std::uint16_t> vertices(
+        builtMesh.indices.begin() + meshlet.firstIndex,
+        builtMesh.indices.begin() + meshlet.firstIndex + meshlet.indexCount);
+    std::ranges::sort(vertices);
+    auto const unique = std::ranges::unique(vertices);
+    REQUIRE(static_cast<std::size_t>(unique.begin() - vertices.begin())
+            <= pbr::MAX_MESHLET_VERTICES);
+    for (auto const index : std::span(builtMesh.indices)
+                                .subspan(meshlet.firstIndex, meshlet.indexCount)) {
+      REQUIRE(glm::distance(glm::vec3(meshlet.boundingSphere),
+                            builtMesh.vertices[index].position)
+              <= meshlet.boundingSphere.w + 1e-5f);
+    }
+
+    // Every triangle faces up, so only cameras below see the back of the meshlet.
+    REQUIRE(meshlet.cone.w < 1.0f);
+    REQUIRE(pbr::isMeshletBackfacing(meshlet.boundingSphere, meshlet.cone,
+                                     {0.5f, -10.0f, 0.5f}));
+    REQUIRE_FALSE(pbr::isMeshletBackfacing(meshlet.boundingSphere, meshlet.cone,
+                                           {0.5f, 10.0f, 0.5f}));
+  }
+  REQUIRE(end == primitive.firstIndex + primitive.indexCount);
+
+  // The meshlets reorder the triangles of the primitive without changing them.
+  auto const getTriangles = [](std::span<std::uint16_t const> indices) {
+    std::vector<std::array<std::uint16_t, 3>> triangles;
+    for (auto const triangle : indices | std::views::chunk(3)) {
+      triangles.push_back({triangle[0], triangle[1], triangle[2]});
+    }
+    std::ranges::sort(triangles);
+    return triangles;
+  };
+  REQUIRE(getTriangles(builtMesh.indices) == getTriangles(grid.indices));
+}
@@ -0,0 +1,39 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "pbr/DrawList.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+TEST_CASE("Draw keys order by state", "[pbr::DrawList]") {
+  // Pipeline changes are the most expensive so they dominate the order.
+  REQUIRE(pbr::makeDrawKey(0, 5, 5, 5) < pbr::makeDrawKey(1, 0, 0, 0));
+  REQUIRE(pbr::makeDrawKey(0, 0, 5, 5) < pbr::makeDrawKey(0, 1, 0, 0));
+  REQUIRE(pbr::makeDrawKey(0, 0, 0, 5) < pbr::makeDrawKey(0, 0, 1, 0));
+}
+
+TEST_CASE("Draw items are radix sorted stably", "[pbr::DrawList]") {
+  std::vector<pbr::DrawItem> items;
+  std::uint32_t node = 0;
+  for (auto const material : {3u, 1u, 2u, 1u, 3u, 0u, 2u, 1u}) {
+    items.push_back({
+        .key = pbr::makeDrawKey(0, material, node % 3, 0),
+        .node = node,
+        .handle = {},
+        .primitiveIndex = 0,
+        .pipeline = {},
+        .mesh = nullptr,
+        .primitive = nullptr,
+    });
+    ++node;
+  }
+  std::vector<pbr::DrawItem> scratch;
+
+  auto expected = items;
+  std::ranges::stable_sort(expected, {}, &pbr::DrawItem::key);
+  pbr::sortDrawItems(items, scratch);
+
+  REQUIRE(std::ranges::equal(items, expected, {}, &pbr::DrawItem::node,
+                             &pbr::DrawItem::node));
+}
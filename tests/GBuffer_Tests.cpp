@@ -0,0 +1,72 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "pbr/CameraData.hpp"
+#include "pbr/GBuffer.hpp"
+#include "pbr/Octahedral.hpp"
+
+#include <array>
+#include <cmath>
+
+#include <glm/common.hpp>
+#include <glm/ext/vector_float2.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+#include <glm/geometric.hpp>
+#include <glm/trigonometric.hpp>
+
+TEST_CASE("The compact layout writes fewer bytes per frame", "[pbr::GBuffer]") {
+  // Three 8 byte color attachments and the depth.
+  REQUIRE(pbr::GBuffer::getBytesPerPixel(pbr::GBufferLayout::Wide) == 28);
+  // Octahedral normals, srgb albedo and the depth.
+  REQUIRE(pbr::GBuffer::getBytesPerPixel(pbr::GBufferLayout::Compact) == 12);
+
+  vk::Extent2D const extent {.width = 3840, .height = 2160};
+  auto const wide = pbr::GBuffer::getBytesPerFrame(pbr::GBufferLayout::Wide, extent);
+  auto const compact =
+      pbr::GBuffer::getBytesPerFrame(pbr::GBufferLayout::Compact, extent);
+  REQUIRE(wide == 3840uz * 2160 * 28);
+  REQUIRE(compact * 2 < wide);
+}
+
+TEST_CASE("The compact layout has no positions", "[pbr::GBuffer]") {
+  REQUIRE(pbr::GBuffer::getColorFormats(pbr::GBufferLayout::Wide).size()
+          == pbr::GBuffer::MAX_COLOR_ATTACHMENTS);
+  REQUIRE(pbr::GBuffer::getFirstBinding(pbr::GBufferLayout::Wide) == 0);
+  // Normals and albedo keep their bindings.
+  REQUIRE(pbr::GBuffer::getColorFormats(pbr::GBufferLayout::Compact).size() == 2);
+  REQUIRE(pbr::GBuffer::getFirstBinding(pbr::GBufferLayout::Compact) == 1);
+}
+
+TEST_CASE("Octahedral normals survive 16 bit quantization", "[pbr::Octahedral]") {
+  std::array const normals {
+      glm::vec3 {0.0f, 0.0f, 1.0f},   glm::vec3 {0.0f, 0.0f, -1.0f},
+      glm::vec3 {1.0f, 0.0f, 0.0f},   glm::vec3 {0.0f, -1.0f, 0.0f},
+      glm::vec3 {1.0f, 1.0f, 1.0f},   glm::vec3 {-1.0f, 2.0f, -3.0f},
+      glm::vec3 {0.3f, -0.2f, -0.9f}, glm::vec3 {-0.5f, -0.5f, 0.1f},
+  };
+  for (auto const normal : normals) {
+    auto const unit = glm::normalize(normal);
+    auto const encoded = pbr::octEncode(unit);
+    REQUIRE(glm::abs(encoded.x) <= 1.0f);
+    REQUIRE(glm::abs(encoded.y) <= 1.0f);
+
+    // Same rounding as an R16G16Snorm attachment.
+    auto const quantized = glm::round(encoded * 32767.0f) / 32767.0f;
+    REQUIRE(glm::dot(pbr::octDecode(quantized), unit) > 0.99999f);
+  }
+}
+
+TEST_CASE("Positions are reconstructed from the depth", "[pbr::CameraData]") {
+  auto const camera = pbr::makeCameraData({1.0f, 2.0f, 3.0f}, {0.0f, 0.0f, -5.0f},
+                                          glm::radians(70.0f), 16.0f / 9.0f);
+  glm::vec3 const position {0.5f, -0.25f, -4.0f};
+
+  auto const clip = camera.proj * camera.view * glm::vec4(position, 1.0f);
+  auto const ndc = glm::vec3(clip) / clip.w;
+  // Mirrors reconstructPosition of Camera.lib.glsl, the depth attachment stores ndc z.
+  auto const uv = (glm::vec2(ndc) + 1.0f) * 0.5f;
+  auto const reconstructed =
+      camera.invViewProj * glm::vec4((uv * 2.0f) - 1.0f, ndc.z, 1.0f);
+
+  REQUIRE(glm::distance(glm::vec3(reconstructed) / reconstructed.w, position) < 1e-3f);
+}
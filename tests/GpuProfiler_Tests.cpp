@@ -0,0 +1,55 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "pbr/GpuProfiler.hpp"
+
+#include <array>
+#include <chrono>
+
+using namespace std::chrono_literals;
+
+TEST_CASE("Pass timings average over the last frames", "[pbr::GpuTimings]") {
+  pbr::GpuTimings timings;
+  timings.addFrame(std::array {pbr::GpuPassSample {.name = "geometry", .duration = 2ms},
+                               pbr::GpuPassSample {.name = "lighting", .duration = 1ms}},
+                   3ms);
+  timings.addFrame(std::array {pbr::GpuPassSample {.name = "geometry", .duration = 4ms},
+                               pbr::GpuPassSample {.name = "lighting", .duration = 1ms}},
+                   5ms);
+
+  auto const passes = timings.getPasses();
+  REQUIRE(passes.size() == 2);
+  REQUIRE(passes[0].name == "geometry");
+  REQUIRE(passes[0].last == 4ms);
+  REQUIRE(passes[0].average == 3ms);
+  REQUIRE(passes[0].max == 4ms);
+  REQUIRE(passes[1].average == 1ms);
+  REQUIRE(timings.getFrame().average == 4ms);
+}
+
+TEST_CASE("Pass timings forget frames past the history", "[pbr::GpuTimings]") {
+  pbr::GpuTimings timings;
+  timings.addFrame(std::array {pbr::GpuPassSample {.name = "tonemap", .duration = 9ms}},
+                   9ms);
+  for (auto i = 0u; i < pbr::GpuTimings::HISTORY; ++i) {
+    timings.addFrame(std::array {pbr::GpuPassSample {.name = "tonemap", .duration = 1ms}},
+                     1ms);
+  }
+  REQUIRE(timings.getPasses()[0].average == 1ms);
+  REQUIRE(timings.getPasses()[0].max == 1ms);
+}
+
+TEST_CASE("Passes that did not run keep their history", "[pbr::GpuTimings]") {
+  pbr::GpuTimings timings;
+  timings.addFrame(std::array {pbr::GpuPassSample {.name = "culling", .duration = 2ms},
+                               pbr::GpuPassSample {.name = "geometry", .duration = 4ms}},
+                   6ms);
+  timings.addFrame(std::array {pbr::GpuPassSample {.name = "geometry", .duration = 4ms}},
+                   4ms);
+  REQUIRE(timings.getPasses().size() == 1);
+
+  timings.addFrame(std::array {pbr::GpuPassSample {.name = "culling", .duration = 4ms},
+                               pbr::GpuPassSample {.name = "geometry", .duration = 4ms}},
+                   8ms);
+  REQUIRE(timings.getPasses()[0].name == "culling");
+  REQUIRE(timings.getPasses()[0].average == 3ms);
+}
@@ -0,0 +1,124 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "pbr/ImageEncoder.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace {
+[[nodiscard]]
+auto toBytes(std::string_view const text) -> std::vector<std::byte> {
+  std::vector<std::byte> bytes;
+  for (auto const character : text) {
+    bytes.push_back(static_cast<std::byte>(character));
+  }
+  return bytes;
+}
+[[nodiscard]]
+auto readBigEndian(std::span<std::byte const> bytes, std::size_t const offset)
+    -> std::uint32_t {
+  auto value = 0u;
+  for (auto i = 0uz; i < 4; ++i) {
+    value = (value << 8) | std::to_integer<std::uint32_t>(bytes[offset + i]);
+  }
+  return value;
+}
+[[nodiscard]]
+auto readLittleEndian(std::span<std::byte const> bytes, std::size_t const offset)
+    -> std::uint64_t {
+  std::uint64_t value = 0;
+  for (auto i = 8uz; i-- > 0;) {
+    value = (value << 8) | std::to_integer<std::uint64_t>(bytes[offset + i]);
+  }
+  return value;
+}
+} // namespace
+
+TEST_CASE("The checksums match their reference values", "[pbr::ImageEncoder]") {
+  REQUIRE(pbr::crc32(::toBytes("123456789")) == 0xcbf43926u);
+  REQUIRE(pbr::adler32(::toBytes("Wikipedia")) == 0x11e60398u);
+  REQUIRE(pbr::adler32({}) == 1);
+  // Streamed bands continue the checksum of the previous ones.
+  REQUIRE(pbr::adler32(::toBytes("pedia"), pbr::adler32(::toBytes("Wiki")))
+          == 0x11e60398u);
+}
+
+TEST_CASE("encodePng writes the header and compresses flat images",
+          "[pbr::ImageEncoder]") {
+  static constexpr std::uint32_t WIDTH = 64;
+  static constexpr std::uint32_t HEIGHT = 48;
+  std::vector<std::byte> pixels(WIDTH * HEIGHT * 4, std::byte {0x80});
+  auto const png = pbr::encodePng(pixels, WIDTH, HEIGHT);
+
+  std::array<std::uint8_t, 8> const signature {0x89, 0x50, 0x4e, 0x47,
+                                               0x0d, 0x0a, 0x1a, 0x0a};
+  REQUIRE(std::ranges::equal(std::span(png).first(8), signature, {},
+                             [](std::byte const byte) {
+                               return std::to_integer<std::uint8_t>(byte);
+                             }));
+  // The header chunk is the first one, its crc covers its type and data.
+  REQUIRE(::readBigEndian(png, 8) == 13);
+  REQUIRE(::readBigEndian(png, 16) == WIDTH);
+  REQUIRE(::readBigEndian(png, 20) == HEIGHT);
+  REQUIRE(::readBigEndian(png, 29) == pbr::crc32(std::span(png).subspan(12, 17)));
+
+  // Every IEND chunk is the same 12 bytes.
+  REQUIRE(::readBigEndian(png, png.size() - 12) == 0);
+  REQUIRE(::readBigEndian(png, png.size() - 4) == 0xae426082u);
+
+  REQUIRE(png.size() < pixels.size() / 10);
+}
+
+TEST_CASE("PngEncoder ends the file with the last band", "[pbr::ImageEncoder]") {
+  static constexpr std::uint32_t WIDTH = 16;
+  static constexpr std::uint32_t HEIGHT = 10;
+  std::vector<std::byte> pixels(WIDTH * HEIGHT * 4);
+  for (auto i = 0uz; i < pixels.size(); ++i) {
+    pixels[i] = static_cast<std::byte>(i * 7);
+  }
+  pbr::PngEncoder encoder(WIDTH, HEIGHT);
+  auto png = encoder.begin();
+  REQUIRE(png.size() == 33);
+
+  auto const first = encoder.encodeRows(std::span(pixels).first(WIDTH * 4 * 6));
+  REQUIRE_FALSE(encoder.isFinished());
+  // A band that does not end the image is a single data chunk.
+  REQUIRE(::readBigEndian(first, 0) == first.size() - 12);
+  REQUIRE(::readBigEndian(first, first.size() - 4)
+          == pbr::crc32(std::span(first).subspan(4, first.size() - 8)));
+
+  auto const last = encoder.encodeRows(std::span(pixels).subspan(WIDTH * 4 * 6));
+  REQUIRE(encoder.isFinished());
+  REQUIRE(::readBigEndian(last, last.size() - 12) == 0);
+  REQUIRE(::readBigEndian(last, last.size() - 4) == 0xae426082u);
+}
+
+TEST_CASE("encodeExr writes every scanline uncompressed", "[pbr::ImageEncoder]") {
+  static constexpr std::uint32_t WIDTH = 5;
+  static constexpr std::uint32_t HEIGHT = 3;
+  static constexpr auto LINE_SIZE = WIDTH * 4uz * 2;
+  std::vector<std::byte> pixels(WIDTH * HEIGHT * 4 * 2);
+  for (auto i = 0uz; i < pixels.size(); ++i) {
+    pixels[i] = static_cast<std::byte>(i);
+  }
+  auto const exr = pbr::encodeExr(pixels, WIDTH, HEIGHT);
+
+  REQUIRE(std::to_integer<std::uint8_t>(exr[0]) == 0x76);
+  REQUIRE(std::to_integer<std::uint8_t>(exr[3]) == 0x01);
+
+  // The offset table follows the header, the blocks are laid out back to back.
+  auto const firstBlock = ::readLittleEndian(exr, exr.size() - HEIGHT * (8 + LINE_SIZE)
+                                                      - HEIGHT * 8);
+  REQUIRE(firstBlock == exr.size() - HEIGHT * (8 + LINE_SIZE));
+
+  // The channels are stored alphabetically, so alpha comes first.
+  auto const line = std::span(exr).subspan(firstBlock + 8, LINE_SIZE);
+  REQUIRE(line[0] == pixels[6]);
+  REQUIRE(line[1] == pixels[7]);
+  REQUIRE(line[WIDTH * 2 * 3] == pixels[0]);
+}
@@ -0,0 +1,32 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "pbr/Light.hpp"
+#include "pbr/LightBuffer.hpp"
+
+#include <array>
+#include <vector>
+
+TEST_CASE("Only changed lights are rewritten", "[pbr::LightBuffer]") {
+  std::array<pbr::LightData, 4> destination {};
+  std::vector<pbr::LightData> uploaded;
+  std::vector<pbr::LightData> lights(3, pbr::LightData {.range = 1.0f});
+
+  // Nothing was uploaded yet.
+  REQUIRE(pbr::LightBuffer::writeChanged(lights, uploaded, destination) == 3);
+  REQUIRE(uploaded == lights);
+
+  REQUIRE(pbr::LightBuffer::writeChanged(lights, uploaded, destination) == 0);
+
+  lights[1].intensity = 2.0f;
+  destination[1] = {};
+  REQUIRE(pbr::LightBuffer::writeChanged(lights, uploaded, destination) == 1);
+  REQUIRE(destination[1] == lights[1]);
+
+  // Appended lights are new, removed ones are left behind in the buffer.
+  lights.push_back({.range = 4.0f});
+  REQUIRE(pbr::LightBuffer::writeChanged(lights, uploaded, destination) == 1);
+  REQUIRE(destination[3] == lights[3]);
+  lights.erase(lights.begin());
+  REQUIRE(pbr::LightBuffer::writeChanged(lights, uploaded, destination) == 3);
+  REQUIRE(uploaded.size() == 3);
+}
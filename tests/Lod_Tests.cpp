@@ -0,0 +1,147 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "pbr/CameraData.hpp"
+#include "pbr/Lod.hpp"
+#include "pbr/MeshBuilder.hpp"
+#include "pbr/MeshSimplifier.hpp"
+#include "pbr/MeshVertex.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <ranges>
+#include <span>
+#include <vector>
+
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/geometric.hpp>
+#include <glm/trigonometric.hpp>
+
+namespace {
+/**
+ * A grid of size by size quads on the xz plane, displaced along y by height.
+ */
+auto makeGrid(std::uint16_t const size, auto const height)
+    -> pbr::MeshBuilder::Primitive {
+  pbr::MeshBuilder::Primitive grid;
+  for (auto z = 0u; z <= size; ++z) {
+    for (auto x = 0u; x <= size; ++x) {
+      auto const u = static_cast<float>(x) / size;
+      auto const v = static_cast<float>(z) / size;
+      grid.vertices.push_back({.position = {u, height(u, v), v}});
+    }
+  }
+  for (auto z = 0u; z < size; ++z) {
+    for (auto x = 0u; x < size; ++x) {
+      auto const first = static_cast<std::uint16_t>((z * (size + 1)) + x);
+      auto const below = static_cast<std::uint16_t>(first + size + 1);
+      grid.indices.insert(grid.indices.end(),
+                          {first, below, static_cast<std::uint16_t>(first + 1),
+                           static_cast<std::uint16_t>(first + 1), below,
+                           static_cast<std::uint16_t>(below + 1)});
+    }
+  }
+  return grid;
+}
+/**
+ * Requires valid, non degenerate triangles facing the same way as the grid.
+ */
+auto requireValidTriangles(std::span<pbr::MeshVertex const> vertices,
+                           std::span<std::uint16_t const> indices) -> void {
+  REQUIRE(indices.size() % 3 == 0);
+  for (auto const triangle : indices | std::views::chunk(3)) {
+    for (auto const index : triangle) {
+      REQUIRE(index < vertices.size());
+    }
+    REQUIRE(triangle[0] != triangle[1]);
+    REQUIRE(triangle[1] != triangle[2]);
+    REQUIRE(triangle[2] != triangle[0]);
+    auto const& origin = vertices[triangle[0]].position;
+    auto const normal = glm::cross(vertices[triangle[1]].position - origin,
+                                   vertices[triangle[2]].position - origin);
+    REQUIRE(normal.y > 0.0f);
+  }
+}
+} // namespace
+
+TEST_CASE("Flat meshes simplify without error", "[pbr::MeshSimplifier]") {
+  auto const grid = ::makeGrid(16, [](float, float) { return 0.0f; });
+  auto const simplified = pbr::simplifyIndices(grid.vertices, grid.indices, 256 * 3);
+
+  REQUIRE(simplified.indices.size() == 256 * 3);
+  REQUIRE(simplified.error == 0.0f);
+  ::requireValidTriangles(grid.vertices, simplified.indices);
+}
+
+TEST_CASE("Curved meshes simplify with an error", "[pbr::MeshSimplifier]") {
+  auto const grid = ::makeGrid(16, [](float const u, float const v) {
+    return 0.2f * std::sin(3.0f * u) * std::cos(3.0f * v);
+  });
+  auto const simplified = pbr::simplifyIndices(grid.vertices, grid.indices, 128 * 3);
+
+  REQUIRE(simplified.indices.size() <= 128 * 3);
+  REQUIRE(simplified.error > 0.0f);
+  ::requireValidTriangles(grid.vertices, simplified.indices);
+}
+
+TEST_CASE("Levels of detail follow the original indices", "[pbr::MeshBuilder]") {
+  auto const grid = ::makeGrid(16, [](float, float) { return 0.0f; });
+  auto const builtMesh = pbr::MeshBuilder {}
+                             .addPrimitive(grid)
+                             .setLodCount(pbr::MeshBuilder::MAX_LOD_COUNT + 1)
+                             .build();
+
+  auto const& primitive = builtMesh.primitives[0];
+  REQUIRE(primitive.indexCount == 512 * 3);
+  REQUIRE_FALSE(primitive.lods.empty());
+  REQUIRE(primitive.lods.size() <= pbr::MeshBuilder::MAX_LOD_COUNT);
+
+  auto end = primitive.firstIndex + primitive.indexCount;
+  auto previousCount = primitive.indexCount;
+  for (auto const& lod : primitive.lods) {
+    REQUIRE(lod.firstIndex == end);
+    REQUIRE(lod.indexCount < previousCount);
+    REQUIRE(lod.firstVertex == primitive.firstVertex);
+    REQUIRE(lod.boundingSphere == primitive.boundingSphere);
+    ::requireValidTriangles(
+        builtMesh.vertices,
+        std::span(builtMesh.indices).subspan(lod.firstIndex, lod.indexCount));
+    end += lod.indexCount;
+    previousCount = lod.indexCount;
+  }
+  REQUIRE(end == builtMesh.indices.size());
+}
+
+TEST_CASE("Distant primitives select coarser levels of detail", "[pbr::Lod]") {
+  pbr::PrimitiveSpan primitive {
+      .material = nullptr,
+      .firstVertex = 0,
+      .vertexCount = 0,
+      .firstIndex = 0,
+      .indexCount = 0,
+      .boundingSphere = {0.0f, 0.0f, 0.0f, 1.0f},
+  };
+  primitive.lods = {
+      {.material = nullptr, .firstVertex = 0, .vertexCount = 0, .firstIndex = 0,
+       .indexCount = 0, .error = 0.01f},
+      {.material = nullptr, .firstVertex = 0, .vertexCount = 0, .firstIndex = 0,
+       .indexCount = 0, .error = 0.1f},
+  };
+  auto const camera = pbr::makeCameraData({0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, -1.0f},
+                                          glm::radians(90.0f), 1.0f);
+  auto const selection = pbr::makeLodSelection(camera, 1000.0f);
+  auto const at = [](float const distance) {
+    return glm::translate(glm::mat4x4(1.0f), {0.0f, 0.0f, -distance});
+  };
+
+  // 500 pixels per unit at one unit away, the distances are to the surface of the
+  // sphere and the camera is inside of it at first.
+  REQUIRE(pbr::selectLod(primitive, at(0.5f), selection) == 0);
+  REQUIRE(pbr::selectLod(primitive, at(3.0f), selection) == 0);
+  REQUIRE(pbr::selectLod(primitive, at(11.0f), selection) == 1);
+  REQUIRE(pbr::selectLod(primitive, at(101.0f), selection) == 2);
+  // Scaling the primitive scales its errors.
+  REQUIRE(pbr::selectLod(primitive, glm::scale(at(101.0f), glm::vec3(2.0f)), selection)
+          == 1);
+}
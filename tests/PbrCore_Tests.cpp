@@ -4,6 +4,7 @@
 #include "pbr/utils/Conversions.hpp"
 
 #include "pbr/core/GpuHandle.hpp"
+#include "pbr/core/PipelineBuilder.hpp"
 #include "pbr/core/Swapchain.hpp"
 
 #include "vkfw/vkfw.hpp"
@@ -55,3 +56,16 @@ TEST_CASE("Core tests", "[pbr::core]") {
     REQUIRE(imageView != nullptr);
   }
 }
+
+TEST_CASE("Pipelines can test against an earlier depth pass", "[pbr::core]") {
+  pbr::core::PipelineBuilder builder;
+  builder.enableDepthTesting(vk::Format::eD32Sfloat);
+  auto const* depthState = builder.build(nullptr).pDepthStencilState;
+  REQUIRE(depthState->depthCompareOp == vk::CompareOp::eLess);
+  REQUIRE(depthState->depthWriteEnable == vk::True);
+
+  builder.enableDepthTesting(vk::Format::eD32Sfloat, vk::CompareOp::eEqual, false);
+  depthState = builder.build(nullptr).pDepthStencilState;
+  REQUIRE(depthState->depthCompareOp == vk::CompareOp::eEqual);
+  REQUIRE(depthState->depthWriteEnable == vk::False);
+}
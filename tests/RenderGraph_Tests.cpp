@@ -0,0 +1,128 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "pbr/RenderGraph.hpp"
+#include "pbr/Vulkan.hpp"
+
+#include <cstdint>
+
+namespace {
+/**
+ * The graph never dereferences the handles, so any distinct value works.
+ */
+[[nodiscard]]
+auto makeImage(std::uintptr_t const value) -> vk::Image {
+  // NOLINTNEXTLINE(performance-no-int-to-ptr)
+  return vk::Image(reinterpret_cast<VkImage>(value));
+}
+[[nodiscard]]
+auto recordNothing() -> pbr::RenderGraph::RecordFunction {
+  return [](vk::CommandBuffer) {};
+}
+} // namespace
+
+TEST_CASE("Passes whose writes are never used are culled", "[pbr::RenderGraph]") {
+  pbr::RenderGraph graph;
+  auto const unused = graph.importImage(::makeImage(1), vk::ImageAspectFlagBits::eColor,
+                                        pbr::ImageContents::Discard);
+  auto const target = graph.importImage(::makeImage(2), vk::ImageAspectFlagBits::eColor,
+                                        pbr::ImageContents::Discard);
+  graph.addPass("unused", ::recordNothing())
+      .write(unused, pbr::usages::COLOR_ATTACHMENT_WRITE);
+  graph.addPass("overwritten", ::recordNothing())
+      .write(target, pbr::usages::COLOR_ATTACHMENT_WRITE);
+  graph.addPass("side effects", ::recordNothing()).setSideEffects();
+  graph.addPass("target", ::recordNothing())
+      .write(target, pbr::usages::COMPUTE_STORAGE_WRITE);
+  graph.exportImage(target, pbr::usages::PRESENT);
+
+  auto const compiled = graph.compile();
+  REQUIRE(compiled.passes.size() == 2);
+  REQUIRE(compiled.passes[0].name == "side effects");
+  REQUIRE(compiled.passes[1].name == "target");
+  REQUIRE(graph.getStats().culledPasses == 2);
+}
+
+TEST_CASE("Barriers transition layouts and skip visible reads", "[pbr::RenderGraph]") {
+  pbr::RenderGraph graph;
+  auto const color = graph.importImage(::makeImage(1), vk::ImageAspectFlagBits::eColor,
+                                       pbr::ImageContents::Discard);
+  auto const depth = graph.importImage(::makeImage(2), vk::ImageAspectFlagBits::eDepth,
+                                       pbr::ImageContents::Discard);
+  graph.addPass("geometry", ::recordNothing())
+      .write(color, pbr::usages::COLOR_ATTACHMENT_WRITE)
+      .write(depth, pbr::usages::DEPTH_ATTACHMENT_WRITE);
+  graph.addPass("lighting", ::recordNothing())
+      .read(color, pbr::usages::COMPUTE_SAMPLED_READ)
+      .read(depth, pbr::usages::COMPUTE_SAMPLED_READ)
+      .setSideEffects();
+  graph.addPass("second read", ::recordNothing())
+      .read(color, pbr::usages::COMPUTE_SAMPLED_READ)
+      .setSideEffects();
+
+  auto const compiled = graph.compile();
+  REQUIRE(compiled.passes.size() == 3);
+
+  auto const& geometry = compiled.passes[0].imageBarriers;
+  REQUIRE(geometry.size() == 2);
+  REQUIRE(geometry[0].oldLayout == vk::ImageLayout::eUndefined);
+  REQUIRE(geometry[0].newLayout == vk::ImageLayout::eColorAttachmentOptimal);
+  REQUIRE(geometry[1].newLayout == vk::ImageLayout::eDepthAttachmentOptimal);
+
+  // Both images move to the read layout in the same batch.
+  auto const& lighting = compiled.passes[1].imageBarriers;
+  REQUIRE(lighting.size() == 2);
+  REQUIRE(lighting[0].srcAccessMask == vk::AccessFlagBits2::eColorAttachmentWrite);
+  REQUIRE(lighting[0].oldLayout == vk::ImageLayout::eColorAttachmentOptimal);
+  REQUIRE(lighting[0].newLayout == vk::ImageLayout::eShaderReadOnlyOptimal);
+  REQUIRE(lighting[1].srcAccessMask
+          == vk::AccessFlagBits2::eDepthStencilAttachmentWrite);
+
+  REQUIRE(compiled.passes[2].imageBarriers.empty());
+  REQUIRE(graph.getStats().imageBarriers == 4);
+  REQUIRE(graph.getStats().barrierBatches == 2);
+}
+
+TEST_CASE("Consecutive mip levels share a barrier", "[pbr::RenderGraph]") {
+  pbr::RenderGraph graph;
+  auto const pyramid = graph.importImage(::makeImage(1), vk::ImageAspectFlagBits::eColor,
+                                         pbr::ImageContents::Discard, 4);
+  graph.addPass("base level", ::recordNothing())
+      .write(pyramid, pbr::usages::COMPUTE_STORAGE_WRITE, 0, 1);
+  graph.addPass("every level", ::recordNothing())
+      .read(pyramid, pbr::usages::COMPUTE_SAMPLED_READ)
+      .setSideEffects();
+
+  auto const compiled = graph.compile();
+  auto const& barriers = compiled.passes[1].imageBarriers;
+  // The written level waits for its write, the untouched ones only change layout.
+  REQUIRE(barriers.size() == 2);
+  REQUIRE(barriers[0].subresourceRange.baseMipLevel == 0);
+  REQUIRE(barriers[0].subresourceRange.levelCount == 1);
+  REQUIRE(barriers[1].subresourceRange.baseMipLevel == 1);
+  REQUIRE(barriers[1].subresourceRange.levelCount == 3);
+}
+
+TEST_CASE("States carry over to the next compile", "[pbr::RenderGraph]") {
+  pbr::RenderGraph graph;
+  auto const image = ::makeImage(1);
+  auto target = graph.importImage(image, vk::ImageAspectFlagBits::eColor);
+  graph.addPass("write", ::recordNothing())
+      .write(target, pbr::usages::COLOR_ATTACHMENT_WRITE);
+  graph.addPass("read", ::recordNothing())
+      .read(target, pbr::usages::COMPUTE_SAMPLED_READ)
+      .setSideEffects();
+  static_cast<void>(graph.compile());
+
+  // The next frame overwrites the image while the last frame may still be reading it.
+  target = graph.importImage(image, vk::ImageAspectFlagBits::eColor,
+                             pbr::ImageContents::Discard);
+  graph.addPass("overwrite", ::recordNothing())
+      .write(target, pbr::usages::COLOR_ATTACHMENT_WRITE)
+      .setSideEffects();
+  auto const compiled = graph.compile();
+
+  auto const& barriers = compiled.passes[0].imageBarriers;
+  REQUIRE(barriers.size() == 1);
+  REQUIRE(barriers[0].srcStageMask == vk::PipelineStageFlagBits2::eComputeShader);
+  REQUIRE(barriers[0].oldLayout == vk::ImageLayout::eUndefined);
+}
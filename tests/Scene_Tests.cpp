@@ -0,0 +1,283 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "pbr/Scene.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+#include <glm/geometric.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/trigonometric.hpp>
+
+namespace {
+/**
+ * @returns A camera the scene can index, it never looks inside of it.
+ */
+[[nodiscard]]
+auto makeCamera() -> std::shared_ptr<pbr::CameraUniform> {
+  // Real cameras need a gpu, an aliasing pointer without an owner stands in for them.
+  alignas(pbr::CameraUniform) static std::array<std::byte, sizeof(pbr::CameraUniform)>
+      storage {};
+  return {std::shared_ptr<void> {},
+          reinterpret_cast<pbr::CameraUniform*>(storage.data())};
+}
+} // namespace
+
+TEST_CASE("Scene hierarchy", "[pbr::Scene]") {
+  pbr::Scene scene;
+
+  auto root = scene.addNode("root");
+  auto const first = root.addChild("first");
+  auto const second = root.addChild("second");
+  auto const grandChild = first.addChild("grandChild");
+  scene.addNode("otherRoot");
+
+  REQUIRE(scene.getNodeCount() == 5);
+  REQUIRE(first.getParent() == root);
+  REQUIRE(grandChild.getParent() == first);
+  REQUIRE_FALSE(root.getParent().has_value());
+
+  std::vector<pbr::Node> children;
+  for (auto const child : root.iterateChildren()) {
+    children.push_back(child);
+  }
+  REQUIRE(children == std::vector {first, second});
+
+  std::vector<std::string> roots;
+  for (auto const node : scene.iterateTopLevelNodes()) {
+    roots.emplace_back(node.getName());
+  }
+  REQUIRE(roots == std::vector<std::string> {"root", "otherRoot"});
+}
+
+TEST_CASE("Scene world transforms", "[pbr::Scene]") {
+  pbr::Scene scene;
+
+  auto root = scene.addNode("root", {.position {1.0f, 0.0f, 0.0f}});
+  auto child = root.addChild("child", {.position {0.0f, 2.0f, 0.0f}, .scale {2.0f}});
+  auto const grandChild = child.addChild("grandChild", {.position {0.0f, 0.0f, 3.0f}});
+  scene.updateWorldTransforms();
+
+  auto const origin = [](pbr::Node const& node) {
+    return glm::vec3(node.getWorldMatrix() * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+  };
+  REQUIRE(origin(root) == glm::vec3(1.0f, 0.0f, 0.0f));
+  REQUIRE(origin(child) == glm::vec3(1.0f, 2.0f, 0.0f));
+  REQUIRE(origin(grandChild) == glm::vec3(1.0f, 2.0f, 6.0f));
+
+  root.setTransform({.position {-1.0f, 0.0f, 0.0f}});
+  scene.updateWorldTransforms();
+  REQUIRE(origin(grandChild) == glm::vec3(-1.0f, 2.0f, 6.0f));
+}
+
+TEST_CASE("Scene incremental transform updates", "[pbr::Scene]") {
+  pbr::Scene scene;
+
+  auto root = scene.addNode("root");
+  auto left = root.addChild("left");
+  auto const leftChild = left.addChild("leftChild");
+  auto right = root.addChild("right");
+  right.addChild("rightChild");
+
+  auto stats = scene.updateWorldTransforms();
+  REQUIRE(stats.dirtyNodes == 5);
+  REQUIRE(stats.recomputedMatrices == 5);
+
+  stats = scene.updateWorldTransforms();
+  REQUIRE(stats.dirtyNodes == 0);
+  REQUIRE(stats.recomputedMatrices == 0);
+
+  // Only the subtree of the changed node is recomputed.
+  left.setTransform({.position {0.0f, 1.0f, 0.0f}});
+  stats = scene.updateWorldTransforms();
+  REQUIRE(stats.dirtyNodes == 1);
+  REQUIRE(stats.recomputedMatrices == 2);
+  REQUIRE(leftChild.getWorldMatrix()[3] == glm::vec4(0.0f, 1.0f, 0.0f, 1.0f));
+
+  // Dirty descendants of a dirty node are not recomputed twice.
+  right.setTransform({});
+  root.setTransform({.position {1.0f, 0.0f, 0.0f}});
+  left.setTransform({});
+  stats = scene.updateWorldTransforms();
+  REQUIRE(stats.dirtyNodes == 3);
+  REQUIRE(stats.recomputedMatrices == 5);
+  REQUIRE(scene.getLastUpdateStats().recomputedMatrices == 5);
+  REQUIRE(leftChild.getWorldMatrix()[3] == glm::vec4(1.0f, 0.0f, 0.0f, 1.0f));
+}
+
+TEST_CASE("Scene node handles", "[pbr::Scene]") {
+  pbr::Scene scene;
+
+  auto root = scene.addNode("root");
+  auto const removed = root.addChild("removed");
+  auto const removedChild = removed.addChild("removedChild");
+  auto const kept = root.addChild("kept");
+  auto const keptHandle = kept.getHandle();
+
+  scene.removeNode(removed.getHandle());
+  REQUIRE(scene.getNodeCount() == 2);
+  REQUIRE_FALSE(scene.isValid(removed.getHandle()));
+  REQUIRE_FALSE(scene.isValid(removedChild.getHandle()));
+  REQUIRE(scene.isValid(keptHandle));
+  REQUIRE(scene.getNode(keptHandle).getParent() == root);
+
+  std::vector<pbr::Node> children;
+  for (auto const child : root.iterateChildren()) {
+    children.push_back(child);
+  }
+  REQUIRE(children == std::vector {kept});
+
+  // Freed slots are reused with a new generation.
+  auto const reused = root.addChild("reused");
+  REQUIRE(reused.getHandle().slot == removedChild.getHandle().slot);
+  REQUIRE(reused.getHandle() != removedChild.getHandle());
+  REQUIRE_FALSE(scene.isValid(removedChild.getHandle()));
+}
+
+TEST_CASE("Scene compaction keeps handles valid", "[pbr::Scene]") {
+  pbr::Scene scene;
+
+  auto root = scene.addNode("root", {.position {1.0f, 0.0f, 0.0f}});
+  std::vector<pbr::NodeHandle> removed;
+  for (auto index = 0u; index < pbr::Scene::MIN_COMPACTION_THRESHOLD * 2; ++index) {
+    removed.push_back(root.addChild("removed").getHandle());
+  }
+  auto const kept = root.addChild("kept", {.position {0.0f, 1.0f, 0.0f}});
+  scene.updateWorldTransforms();
+
+  for (auto const handle : removed) {
+    scene.removeNode(handle);
+  }
+  REQUIRE(scene.getNodeCount() == 2);
+  REQUIRE(scene.getMeshes().size() < removed.size());
+
+  REQUIRE(scene.isValid(kept.getHandle()));
+  REQUIRE(kept.getName() == "kept");
+  REQUIRE(kept.getWorldMatrix()[3] == glm::vec4(1.0f, 1.0f, 0.0f, 1.0f));
+
+  root.setTransform({});
+  scene.updateWorldTransforms();
+  REQUIRE(kept.getWorldMatrix()[3] == glm::vec4(0.0f, 1.0f, 0.0f, 1.0f));
+}
+
+TEST_CASE("Scene lights follow their nodes", "[pbr::Scene]") {
+  pbr::Scene scene;
+
+  auto root = scene.addNode("root", {.position {1.0f, 0.0f, 0.0f}});
+  auto lamp = root.addChild("lamp", {.position {0.0f, 2.0f, 0.0f}});
+  auto const other = root.addChild("other");
+  lamp.setLight(pbr::Light {.color {1.0f, 0.5f, 0.0f}, .intensity = 4.0f, .range = 3.0f});
+  scene.updateWorldTransforms();
+
+  REQUIRE(scene.getLightNodes().size() == 1);
+  std::vector<pbr::LightData> lights;
+  scene.collectLights(lights);
+  REQUIRE(lights.size() == 1);
+  REQUIRE(lights.front().position == glm::vec3(1.0f, 2.0f, 0.0f));
+  REQUIRE(lights.front().range == 3.0f);
+  REQUIRE(lights.front().intensity == 4.0f);
+
+  root.setTransform({});
+  scene.updateWorldTransforms();
+  scene.collectLights(lights);
+  REQUIRE(lights.front().position == glm::vec3(0.0f, 2.0f, 0.0f));
+
+  scene.removeNode(lamp.getHandle());
+  REQUIRE(scene.getLightNodes().empty());
+  REQUIRE_FALSE(other.getLight().has_value());
+}
+
+TEST_CASE("Scene lights point down the -z axis of their node", "[pbr::Scene]") {
+  pbr::Scene scene;
+
+  auto const rotation = glm::angleAxis(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+  auto spot = scene.addNode("spot", {.rotation = rotation});
+  spot.setLight(pbr::Light {
+      .type = pbr::LightType::Spot,
+      .innerConeAngle = 0.0f,
+      .outerConeAngle = glm::radians(60.0f),
+  });
+  scene.updateWorldTransforms();
+
+  std::vector<pbr::LightData> lights;
+  scene.collectLights(lights);
+  REQUIRE(lights.front().type == pbr::LightType::Spot);
+  REQUIRE(glm::distance(lights.front().direction, glm::vec3(0.0f, 1.0f, 0.0f)) < 1e-5f);
+  REQUIRE(lights.front().cosInnerCone == 1.0f);
+  REQUIRE(glm::abs(lights.front().cosOuterCone - 0.5f) < 1e-5f);
+}
+
+TEST_CASE("Scene indexes the nodes with cameras", "[pbr::Scene]") {
+  pbr::Scene scene;
+
+  auto first = scene.addNode("first");
+  auto second = scene.addNode("second");
+  scene.addNode("empty");
+  REQUIRE(scene.getCameraNodes().empty());
+
+  first.setCamera(::makeCamera());
+  second.setCamera(::makeCamera());
+  REQUIRE(first.getCamera() != nullptr);
+  REQUIRE(std::ranges::equal(scene.getCameraNodes(),
+                             std::array {first.getHandle(), second.getHandle()}));
+
+  // Replacing the camera of a node keeps a single entry.
+  first.setCamera(::makeCamera());
+  REQUIRE(scene.getCameraNodes().size() == 2);
+
+  first.setCamera(nullptr);
+  REQUIRE(std::ranges::equal(scene.getCameraNodes(), std::array {second.getHandle()}));
+}
+
+TEST_CASE("Scene defaults to the first camera", "[pbr::Scene]") {
+  pbr::Scene scene;
+  REQUIRE_FALSE(scene.getActiveCameraNode().has_value());
+  REQUIRE(scene.getActiveCamera() == nullptr);
+
+  auto first = scene.addNode("first");
+  auto second = scene.addNode("second");
+  second.setCamera(::makeCamera());
+  first.setCamera(::makeCamera());
+  REQUIRE(scene.getActiveCameraNode() == second.getHandle());
+  REQUIRE(scene.getActiveCamera() == second.getCamera().get());
+
+  scene.setActiveCamera(first.getHandle());
+  REQUIRE(scene.getActiveCameraNode() == first.getHandle());
+}
+
+TEST_CASE("Scene falls back to another camera", "[pbr::Scene]") {
+  pbr::Scene scene;
+
+  auto root = scene.addNode("root");
+  auto active = root.addChild("active");
+  auto first = scene.addNode("first");
+  auto second = scene.addNode("second");
+  first.setCamera(::makeCamera());
+  active.setCamera(::makeCamera());
+  second.setCamera(::makeCamera());
+
+  // Removing an ancestor removes the camera too.
+  scene.setActiveCamera(active.getHandle());
+  scene.removeNode(root.getHandle());
+  REQUIRE(scene.getActiveCameraNode() == first.getHandle());
+
+  first.setCamera(nullptr);
+  REQUIRE(scene.getActiveCameraNode() == second.getHandle());
+
+  // Clearing a camera that is not active keeps the active one.
+  first.setCamera(::makeCamera());
+  first.setCamera(nullptr);
+  REQUIRE(scene.getActiveCameraNode() == second.getHandle());
+
+  second.setCamera(nullptr);
+  REQUIRE_FALSE(scene.getActiveCameraNode().has_value());
+  REQUIRE(scene.getActiveCamera() == nullptr);
+}
@@ -0,0 +1,212 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "pbr/CameraData.hpp"
+#include "pbr/CpuKernels.hpp"
+#include "pbr/DepthPyramidSystem.hpp"
+#include "pbr/Mesh.hpp"
+#include "pbr/MeshBuilder.hpp"
+#include "pbr/MeshVertex.hpp"
+#include "pbr/SoftwareOcclusionCuller.hpp"
+#include "pbr/ThreadPool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/trigonometric.hpp>
+
+namespace {
+/**
+ * @returns A square facing the camera at depth z with half the given size.
+ */
+[[nodiscard]]
+auto makeQuad(float const z, float const halfSize) -> pbr::OccluderMesh {
+  return {
+      .positions = {{-halfSize, -halfSize, z},
+                    {halfSize, -halfSize, z},
+                    {halfSize, halfSize, z},
+                    {-halfSize, halfSize, z}},
+      .indices = {0, 1, 2, 0, 2, 3},
+  };
+}
+[[nodiscard]]
+auto getViewProj() -> glm::mat4x4 {
+  auto const camera = pbr::makeCameraData({0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, -1.0f},
+                                          glm::radians(90.0f), 1.0f);
+  return camera.proj * camera.view;
+}
+} // namespace
+
+TEST_CASE("Occluders hide the boxes behind them", "[pbr::SoftwareOcclusionCuller]") {
+  auto const quad = ::makeQuad(-5.0f, 2.0f);
+  std::array const occluders {
+      pbr::SoftwareOcclusionCuller::Occluder {.mesh = &quad, .model = glm::mat4x4(1.0f)},
+  };
+  auto const viewProj = ::getViewProj();
+
+  pbr::SoftwareOcclusionCuller culler;
+  REQUIRE(culler.isVisible(viewProj, {0.0f, 0.0f, -10.0f, 0.5f}));
+
+  culler.rasterize(viewProj, occluders);
+  REQUIRE(culler.getStats().occluders == 1);
+  REQUIRE(culler.getStats().occluderTriangles == 2);
+
+  // Behind the quad.
+  REQUIRE_FALSE(culler.isVisible(viewProj, {0.0f, 0.0f, -10.0f, 0.5f}));
+  REQUIRE_FALSE(culler.isVisible(viewProj, {1.5f, -1.5f, -20.0f, 1.0f}));
+  // In front of the quad.
+  REQUIRE(culler.isVisible(viewProj, {0.0f, 0.0f, -3.0f, 0.5f}));
+  // Behind the quad but next to it.
+  REQUIRE(culler.isVisible(viewProj, {6.0f, 0.0f, -10.0f, 0.5f}));
+  // Reaching past the edge of the quad.
+  REQUIRE(culler.isVisible(viewProj, {0.0f, 3.5f, -10.0f, 1.0f}));
+  // Reaching behind the camera.
+  REQUIRE(culler.isVisible(viewProj, {0.0f, 0.0f, -10.0f, 20.0f}));
+
+  culler.clear();
+  REQUIRE(culler.isVisible(viewProj, {0.0f, 0.0f, -10.0f, 0.5f}));
+}
+
+TEST_CASE("Occluders crossing the near plane are not rasterized",
+          "[pbr::SoftwareOcclusionCuller]") {
+  // The first triangle reaches behind the camera, the second is in front of it.
+  pbr::OccluderMesh const triangles {
+      .positions = {{-2.0f, -2.0f, 1.0f},
+                    {2.0f, -2.0f, 1.0f},
+                    {2.0f, -2.0f, -5.0f},
+                    {-1.0f, -1.0f, -5.0f},
+                    {1.0f, -1.0f, -5.0f},
+                    {0.0f, 1.0f, -5.0f}},
+      .indices = {0, 1, 2, 3, 4, 5},
+  };
+  std::array const occluders {
+      pbr::SoftwareOcclusionCuller::Occluder {.mesh = &triangles,
+                                              .model = glm::mat4x4(1.0f)},
+  };
+
+  pbr::SoftwareOcclusionCuller culler;
+  culler.rasterize(::getViewProj(), occluders);
+
+  REQUIRE(culler.getStats().occluderTriangles == 1);
+}
+
+TEST_CASE("Only pixels covered entirely keep the depth of an occluder",
+          "[pbr::SoftwareOcclusionCuller]") {
+  // The right edge ends at three quarters of the pixel 140 of the rows in the middle.
+  auto const halfWidth = static_cast<float>(pbr::SoftwareOcclusionCuller::WIDTH / 2);
+  auto const right = ((140.75f / halfWidth) - 1.0f) * 5.0f;
+  pbr::OccluderMesh const quad {
+      .positions = {{-2.0f, -2.0f, -5.0f},
+                    {right, -2.0f, -5.0f},
+                    {right, 2.0f, -5.0f},
+                    {-2.0f, 2.0f, -5.0f}},
+      .indices = {0, 1, 2, 0, 2, 3},
+  };
+  std::array const occluders {
+      pbr::SoftwareOcclusionCuller::Occluder {.mesh = &quad, .model = glm::mat4x4(1.0f)},
+  };
+
+  pbr::SoftwareOcclusionCuller culler;
+  culler.rasterize(::getViewProj(), occluders);
+
+  auto const row = culler.getDepth().subspan(
+      (pbr::SoftwareOcclusionCuller::HEIGHT / 2) * pbr::SoftwareOcclusionCuller::WIDTH,
+      pbr::SoftwareOcclusionCuller::WIDTH);
+  REQUIRE(row[140] == 1.0f);
+  // The pixels crossing the diagonal shared by both triangles are covered.
+  REQUIRE(std::ranges::all_of(row.subspan(77, 63), [](float const depth) {
+    return depth < 1.0f;
+  }));
+}
+
+TEST_CASE("Tiles rasterize the same on a thread pool", "[pbr::SoftwareOcclusionCuller]") {
+  auto const near = ::makeQuad(-5.0f, 2.0f);
+  auto const far = ::makeQuad(-8.0f, 6.0f);
+  std::array const occluders {
+      pbr::SoftwareOcclusionCuller::Occluder {.mesh = &far, .model = glm::mat4x4(1.0f)},
+      pbr::SoftwareOcclusionCuller::Occluder {.mesh = &near, .model = glm::mat4x4(1.0f)},
+  };
+  auto const viewProj = ::getViewProj();
+
+  pbr::SoftwareOcclusionCuller serial;
+  serial.rasterize(viewProj, occluders);
+  pbr::ThreadPool threadPool(3);
+  pbr::SoftwareOcclusionCuller parallel;
+  parallel.rasterize(viewProj, occluders, &threadPool);
+
+  REQUIRE(std::ranges::equal(serial.getDepth(), parallel.getDepth()));
+  // The nearer quad wins where they overlap.
+  auto const depth = serial.getDepth();
+  auto const center = (pbr::SoftwareOcclusionCuller::HEIGHT / 2
+                       * pbr::SoftwareOcclusionCuller::WIDTH)
+                      + (pbr::SoftwareOcclusionCuller::WIDTH / 2);
+  REQUIRE(depth[center] < depth[center + (pbr::SoftwareOcclusionCuller::WIDTH / 4)]);
+  REQUIRE(depth[center + (pbr::SoftwareOcclusionCuller::WIDTH / 4)] < 1.0f);
+  REQUIRE(depth.front() == 1.0f);
+}
+
+TEST_CASE("AVX2 rasterization matches the scalar one", "[pbr::SoftwareOcclusionCuller]") {
+  if (pbr::getBestCpuKernels() != pbr::CpuKernels::Avx2) {
+    SKIP("The cpu does not support AVX2");
+  }
+  auto const near = ::makeQuad(-5.0f, 2.0f);
+  auto const far = ::makeQuad(-8.0f, 6.0f);
+  std::array const occluders {
+      pbr::SoftwareOcclusionCuller::Occluder {.mesh = &far, .model = glm::mat4x4(1.0f)},
+      pbr::SoftwareOcclusionCuller::Occluder {
+          .mesh = &near,
+          .model = glm::rotate(glm::mat4x4(1.0f), glm::radians(30.0f),
+                               glm::vec3(0.3f, 1.0f, 0.2f)),
+      },
+  };
+  auto const viewProj = ::getViewProj();
+
+  pbr::SoftwareOcclusionCuller scalar(pbr::CpuKernels::Scalar);
+  scalar.rasterize(viewProj, occluders);
+  pbr::SoftwareOcclusionCuller avx2(pbr::CpuKernels::Avx2);
+  avx2.rasterize(viewProj, occluders);
+  REQUIRE(scalar.getKernels() == pbr::CpuKernels::Scalar);
+  REQUIRE(avx2.getKernels() == pbr::CpuKernels::Avx2);
+  REQUIRE(std::ranges::equal(scalar.getDepth(), avx2.getDepth()));
+
+  // The bounds start and end in the middle of the lanes.
+  auto const quadDepth = scalar.getDepth()[(pbr::SoftwareOcclusionCuller::HEIGHT / 2
+                                            * pbr::SoftwareOcclusionCuller::WIDTH)
+                                           + (pbr::SoftwareOcclusionCuller::WIDTH / 2)];
+  for (auto const depth : {0.0f, quadDepth, 1.0f}) {
+    for (auto x = 0; x < 16; ++x) {
+      for (auto y = 0; y < 8; ++y) {
+        auto const u = static_cast<float>(x) / 16.0f;
+        auto const v = static_cast<float>(y) / 8.0f;
+        pbr::ScreenBounds const bounds {
+            .min = {u + 0.013f, v},
+            .max = {u + 0.09f, v + 0.1f},
+            .depth = depth,
+        };
+        REQUIRE(scalar.isVisible(bounds) == avx2.isVisible(bounds));
+      }
+    }
+  }
+}
+
+TEST_CASE("Occluder meshes offset the indices of every primitive",
+          "[pbr::MeshBuilder]") {
+  std::vector<pbr::MeshVertex> const vertices {
+      {.position = {0.0f, 0.0f, 0.0f}},
+      {.position = {1.0f, 0.0f, 0.0f}},
+      {.position = {0.0f, 1.0f, 0.0f}},
+  };
+  auto const builtMesh = pbr::MeshBuilder()
+                             .addPrimitive(vertices, {0, 1, 2})
+                             .addPrimitive(vertices, {2, 1, 0})
+                             .build();
+  auto const occluder = pbr::makeOccluderMesh(builtMesh);
+
+  REQUIRE(occluder.positions.size() == 6);
+  REQUIRE(occluder.positions[4] == glm::vec3 {1.0f, 0.0f, 0.0f});
+  REQUIRE(occluder.indices == std::vector<std::uint32_t> {0, 1, 2, 5, 4, 3});
+}
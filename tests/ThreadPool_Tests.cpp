@@ -0,0 +1,48 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "pbr/ThreadPool.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+TEST_CASE("parallelFor calls the function once for every index", "[pbr::ThreadPool]") {
+  pbr::ThreadPool pool(3);
+  REQUIRE(pool.getThreadCount() == 3);
+
+  std::vector<std::atomic<std::uint32_t>> calls(1000);
+  pool.parallelFor(static_cast<std::uint32_t>(calls.size()),
+                   [&](std::uint32_t const index) { ++calls[index]; });
+
+  for (auto const& count : calls) {
+    REQUIRE(count == 1);
+  }
+}
+
+TEST_CASE("parallelFor rethrows exceptions of the calls", "[pbr::ThreadPool]") {
+  pbr::ThreadPool pool(2);
+
+  std::atomic<std::uint32_t> calls = 0;
+  REQUIRE_THROWS_AS(pool.parallelFor(16,
+                                     [&](std::uint32_t const index) {
+                                       ++calls;
+                                       if (index == 7) {
+                                         throw std::runtime_error("failed");
+                                       }
+                                     }),
+                    std::runtime_error);
+  REQUIRE(calls == 16);
+}
+
+TEST_CASE("Submitted tasks are executed by the workers", "[pbr::ThreadPool]") {
+  pbr::ThreadPool pool(1);
+
+  std::atomic<bool> executed = false;
+  pool.submit([&] {
+    executed = true;
+    executed.notify_one();
+  });
+  executed.wait(false);
+  REQUIRE(executed);
+}
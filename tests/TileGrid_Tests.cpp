@@ -0,0 +1,85 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "pbr/Vulkan.hpp"
+
+#include "pbr/CameraData.hpp"
+#include "pbr/TileGrid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <glm/ext/vector_float2.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+#include <glm/trigonometric.hpp>
+
+namespace {
+/**
+ * @returns The pixel coordinates of the point in an image of the extent.
+ */
+[[nodiscard]]
+auto project(pbr::CameraData const& camera, glm::vec3 const point,
+             vk::Extent2D const extent) -> glm::vec2 {
+  auto const clip = camera.proj * camera.view * glm::vec4(point, 1.0f);
+  auto const ndc = glm::vec2(clip) / clip.w;
+  return (ndc + 1.0f) * 0.5f
+         * glm::vec2(static_cast<float>(extent.width), static_cast<float>(extent.height));
+}
+} // namespace
+
+TEST_CASE("Tiles cover every pixel of the image once", "[pbr::TileGrid]") {
+  static constexpr vk::Extent2D EXTENT {.width = 100, .height = 70};
+  pbr::TileGrid const grid(EXTENT, 32);
+  REQUIRE(grid.getColumns() == 4);
+  REQUIRE(grid.getRows() == 3);
+  REQUIRE(grid.getTile(11).extent == vk::Extent2D {.width = 4, .height = 6});
+
+  std::vector<std::uint32_t> coverage(EXTENT.width * EXTENT.height);
+  for (auto tile = 0u; tile < grid.getTileCount(); ++tile) {
+    auto const rect = grid.getTile(tile);
+    for (auto y = 0u; y < rect.extent.height; ++y) {
+      for (auto x = 0u; x < rect.extent.width; ++x) {
+        ++coverage[((rect.offset.y + y) * EXTENT.width) + rect.offset.x + x];
+      }
+    }
+  }
+  REQUIRE(std::ranges::all_of(coverage, [](auto const count) { return count == 1; }));
+}
+
+TEST_CASE("Images that fit are a single tile", "[pbr::TileGrid]") {
+  pbr::TileGrid const grid({.width = 640, .height = 480}, 4096);
+  REQUIRE(grid.getTileCount() == 1);
+  REQUIRE(grid.getTileExtent() == grid.getImageExtent());
+
+  auto const camera = pbr::makeCameraData({1.0f, 2.0f, 3.0f}, {}, glm::radians(60.0f),
+                                          640.0f / 480.0f);
+  auto const tileCamera = grid.getTileCameraData(camera, 0);
+  for (auto column = 0; column < 4; ++column) {
+    for (auto row = 0; row < 4; ++row) {
+      REQUIRE(std::abs(tileCamera.proj[column][row] - camera.proj[column][row]) < 1e-6f);
+    }
+  }
+}
+
+TEST_CASE("Tile cameras render their part of the image", "[pbr::TileGrid]") {
+  static constexpr vk::Extent2D EXTENT {.width = 300, .height = 200};
+  pbr::TileGrid const grid(EXTENT, 128);
+  auto const camera = pbr::makeCameraData({0.0f, 0.0f, 5.0f}, {}, glm::radians(60.0f),
+                                          300.0f / 200.0f);
+
+  for (auto const point : {glm::vec3 {0.0f}, glm::vec3 {1.5f, -0.7f, 0.3f},
+                           glm::vec3 {-2.0f, 1.0f, -1.0f}}) {
+    auto const pixel = ::project(camera, point, EXTENT);
+    for (auto tile = 0u; tile < grid.getTileCount(); ++tile) {
+      auto const rect = grid.getTile(tile);
+      auto const offset = glm::vec2(static_cast<float>(rect.offset.x),
+                                    static_cast<float>(rect.offset.y));
+      auto const tilePixel = ::project(grid.getTileCameraData(camera, tile), point,
+                                       grid.getTileExtent());
+      REQUIRE(std::abs(tilePixel.x - (pixel.x - offset.x)) < 1e-2f);
+      REQUIRE(std::abs(tilePixel.y - (pixel.y - offset.y)) < 1e-2f);
+    }
+  }
+}
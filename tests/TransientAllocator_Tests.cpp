@@ -0,0 +1,51 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "pbr/memory/TransientAllocator.hpp"
+
+#include <array>
+#include <vector>
+
+TEST_CASE("Resources used in different passes share memory",
+          "[pbr::TransientAllocator]") {
+  std::array const resources {
+      pbr::TransientResource {.size = 1024, .lifetime = {.firstPass = 0, .lastPass = 0}},
+      pbr::TransientResource {.size = 512, .lifetime = {.firstPass = 1, .lastPass = 1}},
+      pbr::TransientResource {.size = 768, .lifetime = {.firstPass = 2, .lastPass = 2}},
+  };
+  auto const placement = pbr::placeTransientResources(resources);
+
+  REQUIRE(placement.offsets == std::vector<vk::DeviceSize> {0, 0, 0});
+  REQUIRE(placement.size == 1024);
+  REQUIRE(pbr::getPeakTransientSize(resources) == 1024);
+}
+
+TEST_CASE("Resources used in the same passes never share bytes",
+          "[pbr::TransientAllocator]") {
+  std::array const resources {
+      pbr::TransientResource {.size = 1000, .lifetime = {.firstPass = 0, .lastPass = 1}},
+      pbr::TransientResource {
+          .size = 100, .alignment = 256, .lifetime = {.firstPass = 1, .lastPass = 2}},
+      pbr::TransientResource {.size = 600, .lifetime = {.firstPass = 2, .lastPass = 3}},
+      pbr::TransientResource {.size = 300, .lifetime = {.firstPass = 3, .lastPass = 3}},
+  };
+  auto const placement = pbr::placeTransientResources(resources);
+
+  for (auto i = 0uz; i < resources.size(); ++i) {
+    REQUIRE(placement.offsets[i] % resources[i].alignment == 0);
+    REQUIRE(placement.offsets[i] + resources[i].size <= placement.size);
+    for (auto j = i + 1; j < resources.size(); ++j) {
+      if (pbr::overlaps(resources[i].lifetime, resources[j].lifetime)) {
+        REQUIRE((placement.offsets[i] + resources[i].size <= placement.offsets[j]
+                 || placement.offsets[j] + resources[j].size <= placement.offsets[i]));
+      }
+    }
+  }
+  // The largest resource is placed first and the others reuse its bytes once it ends.
+  REQUIRE(placement.offsets[0] == 0);
+  REQUIRE(placement.offsets[1] == 1024);
+  REQUIRE(placement.offsets[2] == 0);
+  REQUIRE(placement.offsets[3] == 600);
+  REQUIRE(placement.size == 1124);
+  // The sum is 2000 bytes while at most 1100 are used in a single pass.
+  REQUIRE(pbr::getPeakTransientSize(resources) == 1100);
+}